@@ -2386,18 +2386,23 @@ make_thumbnail_field(GwyDataField *dfield,
                      gint *width,
                      gint *height)
 {
-    gint xres, yres;
+    gint xres, yres, oldxres, oldyres;
     gdouble scale;
 
-    xres = gwy_data_field_get_xres(dfield);
-    yres = gwy_data_field_get_yres(dfield);
+    oldxres = xres = gwy_data_field_get_xres(dfield);
+    oldyres = yres = gwy_data_field_get_yres(dfield);
     scale = MAX(xres/(gdouble)*width, yres/(gdouble)*height);
     if (scale > 1.0) {
         xres = xres/scale;
         yres = yres/scale;
         xres = CLAMP(xres, 2, *width);
         yres = CLAMP(yres, 2, *height);
-        dfield = gwy_data_field_new_resampled(dfield, xres, yres, GWY_INTERPOLATION_NNA);
+        /* Box averaging reads each pixel once and, unlike picking pixels, does not make thumbnails of noisy data look
+         * like noise.  It can only reduce the size though. */
+        if (xres <= oldxres && yres <= oldyres)
+            dfield = gwy_data_field_new_downsampled(dfield, xres, yres);
+        else
+            dfield = gwy_data_field_new_resampled(dfield, xres, yres, GWY_INTERPOLATION_NNA);
     }
     else
         g_object_ref(dfield);
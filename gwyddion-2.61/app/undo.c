@@ -24,31 +24,73 @@
 
 #include "config.h"
 #include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <glib/gstdio.h>
 #include <libgwyddion/gwymacros.h>
 #include <libprocess/datafield.h>
+#include <libprocess/brick.h>
 #include <app/menu.h>
 #include <app/log.h>
 #include <app/undo.h>
 #include "gwyappinternal.h"
 
+/* Default budgets, in MiB. */
 enum {
 #if (SIZEOF_VOIDP > 4)
-    UNDO_LEVELS = 8
+    UNDO_MEMORY_BUDGET = 256,
+    UNDO_DISK_BUDGET = 2048,
 #else
-    UNDO_LEVELS = 4
+    UNDO_MEMORY_BUDGET = 64,
+    UNDO_DISK_BUDGET = 512,
 #endif
 };
 
+enum {
+    /* Data fields and bricks smaller than this are never stored as deltas. */
+    UNDO_PACK_MIN_SIZE = 16384,
+    /* Rough bookkeeping cost of an item; it keeps the number of levels
+     * bounded even if they only hold tiny values. */
+    UNDO_ITEM_OVERHEAD = 256,
+};
+
+typedef enum {
+    UNDO_ITEM_VALUE   = 0,
+    UNDO_ITEM_PACKED  = 1,
+    UNDO_ITEM_SPILLED = 2,
+} GwyAppUndoItemState;
+
+/* Data field or brick stored as compressed XOR against the same item in the
+ * nearest newer level.  The meta object is a 1×1(×1) object of the same type
+ * carrying everything except the data. */
+typedef struct {
+    GObject *meta;
+    gint xres;
+    gint yres;
+    gint zres;
+    gsize size;
+    guchar *data;
+} GwyAppUndoPacked;
+
 typedef struct {
     GQuark key;
     GValue value;
+    GwyAppUndoItemState state;
+    gboolean incompressible;
+    GType vtype;
+    GwyAppUndoPacked *packed;
+    gsize size;
+    gsize offset;
 } GwyAppUndoItem;
 
 typedef struct {
     gulong id;
     guint nitems;
     GwyAppUndoItem *items;
+    gchar *spill_file;
 } GwyAppUndoLevel;
 
 typedef struct {
@@ -64,12 +106,14 @@ static void        gwy_app_undo_reuse_levels       (GwyAppUndoLevel *level,
                                                     GList *available);
 static void        gwy_app_undo_or_redo            (GwyContainer *data,
                                                     GwyAppUndoLevel *level);
-static GList*      gwy_list_split                  (GList *list,
-                                                    guint n,
-                                                    GList **tail);
+static gboolean    gwy_app_undo_prepare_head       (GList **list);
+static void        gwy_app_undo_enforce_budget     (void);
 static void        gwy_app_undo_container_finalized(gpointer userdata,
                                                     GObject *deceased_data);
 static void        gwy_app_undo_list_free          (GList *list);
+static void        gwy_app_undo_level_free         (GwyAppUndoLevel *level);
+static void        gwy_app_undo_item_clear         (GwyAppUndoItem *item);
+static void        gwy_app_undo_item_update_size   (GwyAppUndoItem *item);
 static gint        gwy_app_undo_compare_data       (gconstpointer a,
                                                     gconstpointer b);
 static GwyAppUndo* gwy_undo_get_for_data           (GwyContainer *data,
@@ -80,6 +124,8 @@ static void        gwy_app_log_undo_or_redo        (GwyContainer *data,
 
 static GList *container_list = NULL;
 static gboolean undo_disabled = FALSE;
+static gsize memory_budget = (gsize)UNDO_MEMORY_BUDGET << 20;
+static gsize disk_budget = (gsize)UNDO_DISK_BUDGET << 20;
 
 /**
  * gwy_app_undo_checkpoint:
@@ -327,8 +373,8 @@ gwy_app_undo_undo_container(GwyContainer *data)
     if (!appundo)
         return;
     gwy_app_sensitivity_set_state(GWY_MENU_FLAG_UNDO | GWY_MENU_FLAG_REDO,
-                                  GWY_MENU_FLAG_REDO
-                                  | (appundo->undo ? GWY_MENU_FLAG_UNDO : 0));
+                                  (appundo->undo ? GWY_MENU_FLAG_UNDO : 0)
+                                  | (appundo->redo ? GWY_MENU_FLAG_REDO : 0));
 }
 
 /**
@@ -353,7 +399,7 @@ gwy_app_undo_redo_container(GwyContainer *data)
     if (!appundo)
         return;
     gwy_app_sensitivity_set_state(GWY_MENU_FLAG_UNDO | GWY_MENU_FLAG_REDO,
-                                  GWY_MENU_FLAG_UNDO
+                                  (appundo->undo ? GWY_MENU_FLAG_UNDO : 0)
                                   | (appundo->redo ? GWY_MENU_FLAG_REDO : 0));
 }
 
@@ -461,7 +507,7 @@ gwy_undo_checkpointv(GwyContainer *data,
     GQuark *qkeys;
     guint i, j;
 
-    if (!UNDO_LEVELS || undo_disabled)
+    if (undo_disabled)
         return 0;
 
     g_return_val_if_fail(GWY_IS_CONTAINER(data), 0UL);
@@ -506,7 +552,7 @@ gwy_undo_qcheckpointv(GwyContainer *data,
     GList *available;
     guint i, j;
 
-    if (!UNDO_LEVELS || undo_disabled)
+    if (undo_disabled)
         return 0;
 
     g_return_val_if_fail(GWY_IS_CONTAINER(data), 0UL);
@@ -523,7 +569,7 @@ gwy_undo_qcheckpointv(GwyContainer *data,
     /* Create new undo level */
     undo_level_id++;
     gwy_debug("Creating a new appundo->undo level #%lu", undo_level_id);
-    level = g_new(GwyAppUndoLevel, 1);
+    level = g_new0(GwyAppUndoLevel, 1);
     level->nitems = j;
     level->items = g_new0(GwyAppUndoItem, level->nitems);
     level->id = undo_level_id;
@@ -547,14 +593,15 @@ gwy_undo_qcheckpointv(GwyContainer *data,
     /* add to the undo queue */
     appundo = gwy_undo_get_for_data(data, TRUE);
 
-    /* gather undo/redo levels we are going to free for potential reuse */
-    appundo->undo = gwy_list_split(appundo->undo, UNDO_LEVELS-1, &available);
-    available = g_list_concat(available, appundo->redo);
+    /* gather redo levels we are going to free for potential reuse; old undo
+     * levels are only discarded when the budget says so */
+    available = appundo->redo;
     appundo->redo = NULL;
 
     gwy_app_undo_reuse_levels(level, available);
     appundo->undo = g_list_prepend(appundo->undo, level);
     appundo->modif++;    /* TODO */
+    gwy_app_undo_enforce_budget();
 
     return level->id;
 }
@@ -581,8 +628,10 @@ gwy_app_undo_reuse_levels(GwyAppUndoLevel *level,
 
     for (i = 0; i < level->nitems; i++) {
         item = level->items + i;
-        if (!G_VALUE_HOLDS_OBJECT(&item->value))
+        if (!G_VALUE_HOLDS_OBJECT(&item->value)) {
+            gwy_app_undo_item_update_size(item);
             continue;
+        }
 
         found = FALSE;
         iobject = g_value_get_object(&item->value);
@@ -621,6 +670,7 @@ gwy_app_undo_reuse_levels(GwyAppUndoLevel *level,
             }
             gwy_debug("Item (%lu,%x) created as new", level->id, item->key);
         }
+        gwy_app_undo_item_update_size(item);
     }
 
     gwy_app_undo_list_free(available);
@@ -647,6 +697,11 @@ gwy_undo_undo_container(GwyContainer *data)
     appundo = gwy_undo_get_for_data(data, FALSE);
     g_return_if_fail(appundo && appundo->undo);
 
+    if (!gwy_app_undo_prepare_head(&appundo->undo)) {
+        g_warning("Saved undo/redo data cannot be restored, discarding them.");
+        return;
+    }
+
     level = (GwyAppUndoLevel*)appundo->undo->data;
     gwy_debug("Undoing to undo level id #%lu", level->id);
     gwy_app_undo_or_redo(data, level);
@@ -655,6 +710,7 @@ gwy_undo_undo_container(GwyContainer *data)
     appundo->undo = g_list_remove_link(appundo->undo, l);
     appundo->redo = g_list_concat(l, appundo->redo);
     appundo->modif--;    /* TODO */
+    gwy_app_undo_enforce_budget();
 }
 
 static void
@@ -692,6 +748,11 @@ gwy_undo_redo_container(GwyContainer *data)
     appundo = gwy_undo_get_for_data(data, FALSE);
     g_return_if_fail(appundo && appundo->redo);
 
+    if (!gwy_app_undo_prepare_head(&appundo->redo)) {
+        g_warning("Saved undo/redo data cannot be restored, discarding them.");
+        return;
+    }
+
     level = (GwyAppUndoLevel*)appundo->redo->data;
     gwy_debug("Redoing to undo level id #%lu", level->id);
     gwy_app_undo_or_redo(data, level);
@@ -700,6 +761,7 @@ gwy_undo_redo_container(GwyContainer *data)
     appundo->redo = g_list_remove_link(appundo->redo, l);
     appundo->undo = g_list_concat(l, appundo->undo);
     appundo->modif++;    /* TODO */
+    gwy_app_undo_enforce_budget();
 }
 
 static void
@@ -774,6 +836,7 @@ gwy_app_undo_or_redo(GwyContainer *data,
         }
         else
             g_warning("Undoing/redoing NULL to another NULL");
+        gwy_app_undo_item_update_size(item);
     }
 }
 
@@ -810,40 +873,753 @@ gwy_app_log_undo_or_redo(GwyContainer *data,
     g_slist_free(channel_ids);
 }
 
-/**
- * gwy_list_split:
- * @list: A list.
- * @n: Length to split list at.
- * @tail: Pointer to store list tail to.
- *
- * Splits a list at given position.
- *
- * Returns: New list head.
- **/
-static GList*
-gwy_list_split(GList *list,
-               guint n,
-               GList **tail)
+static GwyAppUndoItem*
+gwy_app_undo_level_find_item(GwyAppUndoLevel *level,
+                             GQuark key)
 {
-    GList *l;
+    guint i;
 
-    g_return_val_if_fail(tail, list);
-    *tail = NULL;
-    if (!list)
-        return NULL;
+    for (i = 0; i < level->nitems; i++) {
+        if (level->items[i].key == key)
+            return level->items + i;
+    }
+    return NULL;
+}
 
-    list = g_list_first(list);
-    l = g_list_nth(list, n);
-    if (!l)
-        return list;
+static void
+gwy_app_undo_item_update_size(GwyAppUndoItem *item)
+{
+    GObject *object;
+
+    /* Spilled items keep the size they occupy in the spill file. */
+    if (item->state == UNDO_ITEM_PACKED)
+        item->size = item->packed->size;
+    else if (item->state == UNDO_ITEM_VALUE) {
+        if (G_VALUE_HOLDS_OBJECT(&item->value)
+            && (object = g_value_get_object(&item->value))
+            && GWY_IS_SERIALIZABLE(object))
+            item->size = gwy_serializable_get_size(object);
+        else
+            item->size = 0;
+    }
+}
+
+static void
+gwy_app_undo_level_get_sizes(GwyAppUndoLevel *level,
+                             gsize *memsize,
+                             gsize *disksize)
+{
+    guint i;
+
+    for (i = 0; i < level->nitems; i++) {
+        GwyAppUndoItem *item = level->items + i;
+
+        *memsize += UNDO_ITEM_OVERHEAD;
+        if (item->state == UNDO_ITEM_SPILLED)
+            *disksize += item->size;
+        else
+            *memsize += item->size;
+    }
+}
+
+static GList*
+gwy_app_undo_list_truncate(GList *list,
+                           GList *l)
+{
+    if (l == list) {
+        gwy_app_undo_list_free(list);
+        return NULL;
+    }
 
     l->prev->next = NULL;
     l->prev = NULL;
-    *tail = l;
+    gwy_app_undo_list_free(l);
 
     return list;
 }
 
+/* Zero runs shorter than 128 bytes are encoded in the control byte itself,
+ * longer ones use UNDO_RLE_LONG_ZEROS followed by a 32bit count.  Control
+ * bytes below 128 introduce literal runs of 1 to 128 bytes. */
+#define UNDO_RLE_LONG_ZEROS 0xff
+
+static void
+undo_rle_put_zeros(GByteArray *buffer,
+                   gsize len)
+{
+    guchar buf[5];
+    guint32 chunk;
+
+    while (len) {
+        if (len < 128) {
+            buf[0] = 127 + len;
+            g_byte_array_append(buffer, buf, 1);
+            return;
+        }
+        chunk = MIN(len, G_MAXUINT32);
+        buf[0] = UNDO_RLE_LONG_ZEROS;
+        buf[1] = chunk & 0xff;
+        buf[2] = (chunk >> 8) & 0xff;
+        buf[3] = (chunk >> 16) & 0xff;
+        buf[4] = (chunk >> 24) & 0xff;
+        g_byte_array_append(buffer, buf, 5);
+        len -= chunk;
+    }
+}
+
+static void
+undo_rle_encode(GByteArray *buffer,
+                const guchar *plane,
+                gsize n)
+{
+    gsize i, j;
+    guchar c;
+
+    i = 0;
+    while (i < n) {
+        if (!plane[i]) {
+            for (j = i+1; j < n && !plane[j]; j++)
+                ;
+            undo_rle_put_zeros(buffer, j - i);
+        }
+        else {
+            /* Single zeros are cheaper to keep in the literal run. */
+            for (j = i+1; j < n && j - i < 128; j++) {
+                if (!plane[j] && (j+1 == n || !plane[j+1]))
+                    break;
+            }
+            c = j-i - 1;
+            g_byte_array_append(buffer, &c, 1);
+            g_byte_array_append(buffer, plane + i, j - i);
+        }
+        i = j;
+    }
+}
+
+/* Decodes exactly @n bytes of one plane.  Returns the position after the
+ * plane data or %NULL if the data are corrupted.  *@is_zero is set when the
+ * entire plane was zero. */
+static const guchar*
+undo_rle_decode(const guchar *p,
+                const guchar *end,
+                guchar *plane,
+                gsize n,
+                gboolean *is_zero)
+{
+    gsize i, len;
+    guint c;
+
+    *is_zero = TRUE;
+    i = 0;
+    while (i < n) {
+        if (p == end)
+            return NULL;
+        c = *(p++);
+        if (c < 128) {
+            len = c + 1;
+            if (len > n - i || len > (gsize)(end - p))
+                return NULL;
+            memcpy(plane + i, p, len);
+            p += len;
+            *is_zero = FALSE;
+        }
+        else {
+            if (c == UNDO_RLE_LONG_ZEROS) {
+                if (end - p < 4)
+                    return NULL;
+                len = p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32)p[3] << 24);
+                p += 4;
+            }
+            else
+                len = c - 127;
+            if (len > n - i)
+                return NULL;
+            memset(plane + i, 0, len);
+        }
+        i += len;
+    }
+
+    return p;
+}
+
+/* Stores the XOR of @data and @base as eight byte planes, from the lowest
+ * byte of the IEEE representation to the sign and exponent.  Small local
+ * edits give long zero runs in all planes; global edits usually still leave
+ * the high planes nearly empty. */
+static guchar*
+undo_delta_pack(const gdouble *data,
+                const gdouble *base,
+                gsize n,
+                gsize *packedsize)
+{
+    GByteArray *buffer;
+    guchar *plane;
+    guint64 u, v;
+    gsize i;
+    guint b;
+
+    buffer = g_byte_array_new();
+    plane = g_new(guchar, n);
+    for (b = 0; b < 8; b++) {
+        for (i = 0; i < n; i++) {
+            memcpy(&u, data + i, sizeof(guint64));
+            memcpy(&v, base + i, sizeof(guint64));
+            plane[i] = ((u ^ v) >> (8*b)) & 0xff;
+        }
+        undo_rle_encode(buffer, plane, n);
+    }
+    g_free(plane);
+
+    *packedsize = buffer->len;
+    return g_byte_array_free(buffer, FALSE);
+}
+
+static gboolean
+undo_delta_unpack(const guchar *packed,
+                  gsize packedsize,
+                  const gdouble *base,
+                  gdouble *data,
+                  gsize n)
+{
+    const guchar *p = packed, *end = packed + packedsize;
+    gboolean is_zero;
+    guchar *plane;
+    guint64 u;
+    gsize i;
+    guint b;
+
+    memcpy(data, base, n*sizeof(gdouble));
+    plane = g_new(guchar, n);
+    for (b = 0; b < 8; b++) {
+        if (!(p = undo_rle_decode(p, end, plane, n, &is_zero)))
+            break;
+        if (is_zero)
+            continue;
+        for (i = 0; i < n; i++) {
+            memcpy(&u, data + i, sizeof(guint64));
+            u ^= (guint64)plane[i] << (8*b);
+            memcpy(data + i, &u, sizeof(guint64));
+        }
+    }
+    g_free(plane);
+
+    return p == end;
+}
+
+/* Gets the data of an object which can be stored as a delta, i.e. a data
+ * field or a brick.  Returns %NULL for other objects. */
+static const gdouble*
+undo_delta_get_data(GObject *object,
+                    gint *xres,
+                    gint *yres,
+                    gint *zres)
+{
+    if (GWY_IS_DATA_FIELD(object)) {
+        GwyDataField *field = GWY_DATA_FIELD(object);
+
+        *xres = gwy_data_field_get_xres(field);
+        *yres = gwy_data_field_get_yres(field);
+        *zres = 1;
+        return gwy_data_field_get_data_const(field);
+    }
+    if (GWY_IS_BRICK(object)) {
+        GwyBrick *brick = GWY_BRICK(object);
+
+        *xres = gwy_brick_get_xres(brick);
+        *yres = gwy_brick_get_yres(brick);
+        *zres = gwy_brick_get_zres(brick);
+        return gwy_brick_get_data_const(brick);
+    }
+    return NULL;
+}
+
+/* Creates an object of the same type as @model with the given dimensions,
+ * copying everything except the data from @model. */
+static GObject*
+undo_delta_new_alike(GObject *model,
+                     gint xres,
+                     gint yres,
+                     gint zres)
+{
+    if (GWY_IS_DATA_FIELD(model)) {
+        GwyDataField *field, *mfield = GWY_DATA_FIELD(model);
+
+        field = gwy_data_field_new(xres, yres,
+                                   gwy_data_field_get_xreal(mfield),
+                                   gwy_data_field_get_yreal(mfield),
+                                   FALSE);
+        gwy_data_field_set_xoffset(field, gwy_data_field_get_xoffset(mfield));
+        gwy_data_field_set_yoffset(field, gwy_data_field_get_yoffset(mfield));
+        gwy_data_field_copy_units(mfield, field);
+        return G_OBJECT(field);
+    }
+    else {
+        GwyBrick *brick, *mbrick = GWY_BRICK(model);
+        GwyDataLine *zcal;
+
+        brick = gwy_brick_new(xres, yres, zres,
+                              gwy_brick_get_xreal(mbrick),
+                              gwy_brick_get_yreal(mbrick),
+                              gwy_brick_get_zreal(mbrick),
+                              FALSE);
+        gwy_brick_set_xoffset(brick, gwy_brick_get_xoffset(mbrick));
+        gwy_brick_set_yoffset(brick, gwy_brick_get_yoffset(mbrick));
+        gwy_brick_set_zoffset(brick, gwy_brick_get_zoffset(mbrick));
+        gwy_brick_copy_units(mbrick, brick);
+        if ((zcal = gwy_brick_get_zcalibration(mbrick))) {
+            zcal = gwy_data_line_duplicate(zcal);
+            gwy_brick_set_zcalibration(brick, zcal);
+            g_object_unref(zcal);
+        }
+        return G_OBJECT(brick);
+    }
+}
+
+/* Replaces a saved data field or brick with its delta against @base, the
+ * same item in the nearest newer level.  Only done when it saves at least
+ * half of the memory. */
+static gboolean
+gwy_app_undo_item_pack(GwyAppUndoItem *item,
+                       GwyAppUndoItem *base)
+{
+    GObject *object, *baseobject;
+    GwyAppUndoPacked *packed;
+    const gdouble *d, *based;
+    gint xres, yres, zres, bxres, byres, bzres;
+    gsize n, packedsize;
+    guchar *data;
+
+    if (item->state != UNDO_ITEM_VALUE
+        || base->state != UNDO_ITEM_VALUE
+        || item->incompressible
+        || !G_VALUE_HOLDS_OBJECT(&item->value)
+        || !G_VALUE_HOLDS_OBJECT(&base->value))
+        return FALSE;
+
+    object = g_value_get_object(&item->value);
+    baseobject = g_value_get_object(&base->value);
+    if (!object || !baseobject
+        || G_OBJECT_TYPE(object) != G_OBJECT_TYPE(baseobject)
+        || !(d = undo_delta_get_data(object, &xres, &yres, &zres))
+        || !(based = undo_delta_get_data(baseobject, &bxres, &byres, &bzres)))
+        return FALSE;
+
+    n = (gsize)xres*yres*zres;
+    if (n*sizeof(gdouble) < UNDO_PACK_MIN_SIZE
+        || bxres != xres || byres != yres || bzres != zres)
+        return FALSE;
+
+    data = undo_delta_pack(d, based, n, &packedsize);
+    if (packedsize > n*sizeof(gdouble)/2) {
+        g_free(data);
+        item->incompressible = TRUE;
+        return FALSE;
+    }
+
+    packed = g_new(GwyAppUndoPacked, 1);
+    packed->meta = undo_delta_new_alike(object, 1, 1, 1);
+    packed->xres = xres;
+    packed->yres = yres;
+    packed->zres = zres;
+    packed->size = packedsize;
+    packed->data = data;
+
+    item->vtype = G_VALUE_TYPE(&item->value);
+    g_value_unset(&item->value);
+    item->packed = packed;
+    item->state = UNDO_ITEM_PACKED;
+    gwy_app_undo_item_update_size(item);
+
+    return TRUE;
+}
+
+static gboolean
+gwy_app_undo_item_unpack(GwyAppUndoItem *item,
+                         GwyAppUndoItem *base)
+{
+    GwyAppUndoPacked *packed = item->packed;
+    GObject *object, *baseobject;
+    const gdouble *based;
+    gdouble *d;
+    gint xres, yres, zres;
+
+    g_return_val_if_fail(item->state == UNDO_ITEM_PACKED, FALSE);
+    if (base->state != UNDO_ITEM_VALUE || !G_VALUE_HOLDS_OBJECT(&base->value))
+        return FALSE;
+
+    baseobject = g_value_get_object(&base->value);
+    if (!baseobject
+        || G_OBJECT_TYPE(baseobject) != G_OBJECT_TYPE(packed->meta)
+        || !(based = undo_delta_get_data(baseobject, &xres, &yres, &zres))
+        || xres != packed->xres
+        || yres != packed->yres
+        || zres != packed->zres)
+        return FALSE;
+
+    object = undo_delta_new_alike(packed->meta, xres, yres, zres);
+    if (GWY_IS_DATA_FIELD(object))
+        d = gwy_data_field_get_data(GWY_DATA_FIELD(object));
+    else
+        d = gwy_brick_get_data(GWY_BRICK(object));
+    if (!undo_delta_unpack(packed->data, packed->size, based, d,
+                           (gsize)xres*yres*zres)) {
+        g_object_unref(object);
+        return FALSE;
+    }
+
+    gwy_app_undo_item_clear(item);
+    g_value_init(&item->value, item->vtype);
+    g_value_take_object(&item->value, object);
+    item->state = UNDO_ITEM_VALUE;
+    gwy_app_undo_item_update_size(item);
+
+    return TRUE;
+}
+
+static gboolean
+gwy_app_undo_level_can_spill(GwyAppUndoLevel *level)
+{
+    guint i;
+
+    if (level->spill_file)
+        return FALSE;
+
+    for (i = 0; i < level->nitems; i++) {
+        if (level->items[i].size)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Moves all objects and packed data of a level to a temporary file.  Small
+ * non-object values stay in memory. */
+static gboolean
+gwy_app_undo_level_spill(GwyAppUndoLevel *level)
+{
+    GwyAppUndoItem *item;
+    gchar *filename = NULL;
+    gsize *offsets, *sizes;
+    gboolean ok = TRUE;
+    GObject *object;
+    FILE *fh;
+    glong pos;
+    gint fd;
+    guint i;
+
+    g_return_val_if_fail(!level->spill_file, FALSE);
+    if (!gwy_app_undo_level_can_spill(level))
+        return FALSE;
+
+    fd = g_file_open_tmp("gwyddion-undo-XXXXXX", &filename, NULL);
+    if (fd == -1)
+        return FALSE;
+    if (!(fh = fdopen(fd, "wb"))) {
+        close(fd);
+        g_unlink(filename);
+        g_free(filename);
+        return FALSE;
+    }
+
+    offsets = g_new0(gsize, level->nitems);
+    sizes = g_new0(gsize, level->nitems);
+    for (i = 0; ok && i < level->nitems; i++) {
+        item = level->items + i;
+        if (item->state == UNDO_ITEM_PACKED) {
+            offsets[i] = ftell(fh);
+            sizes[i] = item->packed->size;
+            ok = (fwrite(item->packed->data, 1, sizes[i], fh) == sizes[i]);
+        }
+        else if (item->state == UNDO_ITEM_VALUE
+                 && G_VALUE_HOLDS_OBJECT(&item->value)
+                 && (object = g_value_get_object(&item->value))
+                 && GWY_IS_SERIALIZABLE(object)) {
+            offsets[i] = ftell(fh);
+            ok = gwy_serializable_serialize_to_file(object, fh);
+            pos = ftell(fh);
+            ok = ok && pos >= 0;
+            sizes[i] = pos - offsets[i];
+        }
+    }
+    if (fclose(fh) != 0)
+        ok = FALSE;
+
+    if (!ok) {
+        g_unlink(filename);
+        g_free(filename);
+        g_free(offsets);
+        g_free(sizes);
+        return FALSE;
+    }
+
+    for (i = 0; i < level->nitems; i++) {
+        item = level->items + i;
+        if (!sizes[i])
+            continue;
+        if (item->state == UNDO_ITEM_PACKED)
+            GWY_FREE(item->packed->data);
+        else {
+            item->vtype = G_VALUE_TYPE(&item->value);
+            g_value_unset(&item->value);
+        }
+        item->state = UNDO_ITEM_SPILLED;
+        item->offset = offsets[i];
+        item->size = sizes[i];
+    }
+    level->spill_file = filename;
+    gwy_debug("Level #%lu spilled to %s", level->id, filename);
+    g_free(offsets);
+    g_free(sizes);
+
+    return TRUE;
+}
+
+static gboolean
+gwy_app_undo_level_load(GwyAppUndoLevel *level)
+{
+    GwyAppUndoItem *item;
+    GMappedFile *mfile;
+    GObject *object;
+    gboolean ok = TRUE;
+    const gchar *buffer;
+    gsize size, pos;
+    guint i;
+
+    if (!level->spill_file)
+        return TRUE;
+
+    /* Map the file instead of reading it, so only the deserialized objects
+     * take memory, not also another copy of the file contents. */
+    gwy_debug("Level #%lu loaded from %s", level->id, level->spill_file);
+    if (!(mfile = g_mapped_file_new(level->spill_file, FALSE, NULL)))
+        return FALSE;
+    buffer = g_mapped_file_get_contents(mfile);
+    size = g_mapped_file_get_length(mfile);
+
+    for (i = 0; ok && i < level->nitems; i++) {
+        item = level->items + i;
+        if (item->state != UNDO_ITEM_SPILLED)
+            continue;
+        if (item->offset > size || item->size > size - item->offset) {
+            ok = FALSE;
+            break;
+        }
+        if (item->packed) {
+            item->packed->data = g_new(guchar, item->size);
+            memcpy(item->packed->data, buffer + item->offset, item->size);
+            item->state = UNDO_ITEM_PACKED;
+        }
+        else {
+            pos = 0;
+            object = gwy_serializable_deserialize((const guchar*)buffer
+                                                  + item->offset,
+                                                  item->size, &pos);
+            if (!object) {
+                ok = FALSE;
+                break;
+            }
+            g_value_init(&item->value, item->vtype);
+            g_value_take_object(&item->value, object);
+            item->state = UNDO_ITEM_VALUE;
+        }
+        gwy_app_undo_item_update_size(item);
+    }
+    g_mapped_file_unref(mfile);
+
+    if (ok) {
+        g_unlink(level->spill_file);
+        GWY_FREE(level->spill_file);
+    }
+
+    return ok;
+}
+
+/* Makes sure the level at the head of @list is fully in memory and that the
+ * levels stored as deltas against it are expanded before its data are
+ * swapped into the container.  If something cannot be restored the list is
+ * cut there because older deltas would be meaningless. */
+static gboolean
+gwy_app_undo_prepare_head(GList **list)
+{
+    GwyAppUndoLevel *level, *lvl;
+    GwyAppUndoItem *item, *jtem;
+    GList *l;
+    guint i;
+
+    level = (GwyAppUndoLevel*)(*list)->data;
+    if (!gwy_app_undo_level_load(level)) {
+        *list = gwy_app_undo_list_truncate(*list, *list);
+        return FALSE;
+    }
+
+    for (i = 0; i < level->nitems; i++) {
+        item = level->items + i;
+        for (l = (*list)->next; l; l = g_list_next(l)) {
+            lvl = (GwyAppUndoLevel*)l->data;
+            if (!(jtem = gwy_app_undo_level_find_item(lvl, item->key)))
+                continue;
+            if (jtem->packed
+                && (!gwy_app_undo_level_load(lvl)
+                    || !gwy_app_undo_item_unpack(jtem, item))) {
+                g_warning("Cannot restore undo level #%lu, discarding it "
+                          "and all older.", lvl->id);
+                *list = gwy_app_undo_list_truncate(*list, l);
+            }
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Delta-compresses saved data fields and bricks, oldest first, until the
+ * memory budget is met.  List heads are never packed, so undoing or redoing
+ * a single step costs the same as without a budget. */
+static void
+gwy_app_undo_pack_list(GList *list,
+                       gsize *memsize)
+{
+    GwyAppUndoLevel **levels, *level;
+    GwyAppUndoItem *item, *base = NULL;
+    guint nlevels, i, j, k;
+    GList *l;
+
+    if (!(nlevels = g_list_length(list)))
+        return;
+
+    levels = g_new(GwyAppUndoLevel*, nlevels);
+    for (l = list, i = 0; l; l = g_list_next(l), i++)
+        levels[i] = (GwyAppUndoLevel*)l->data;
+
+    for (i = nlevels-1; i > 0 && *memsize > memory_budget; i--) {
+        level = levels[i];
+        for (j = 0; j < level->nitems; j++) {
+            item = level->items + j;
+            if (item->state != UNDO_ITEM_VALUE)
+                continue;
+            for (k = i; k; k--) {
+                base = gwy_app_undo_level_find_item(levels[k-1], item->key);
+                if (base)
+                    break;
+            }
+            if (!k)
+                continue;
+
+            *memsize -= item->size;
+            gwy_app_undo_item_pack(item, base);
+            *memsize += item->size;
+        }
+    }
+    g_free(levels);
+}
+
+/* Finds the deepest level, except the list head, which is spilled (if
+ * @spilled is %TRUE) or can be spilled (if @spilled is %FALSE). */
+static void
+gwy_app_undo_find_candidate(GList **plist,
+                            gboolean spilled,
+                            GList **pcandidate,
+                            GList ***pcandlist,
+                            guint *maxdepth)
+{
+    GwyAppUndoLevel *level;
+    GList *l, *found = NULL;
+    guint depth, founddepth = 0;
+
+    if (!*plist)
+        return;
+
+    for (l = g_list_next(*plist), depth = 1; l; l = g_list_next(l), depth++) {
+        level = (GwyAppUndoLevel*)l->data;
+        if (spilled
+            ? !!level->spill_file
+            : gwy_app_undo_level_can_spill(level)) {
+            found = l;
+            founddepth = depth;
+        }
+    }
+    if (found && founddepth > *maxdepth) {
+        *maxdepth = founddepth;
+        *pcandidate = found;
+        *pcandlist = plist;
+    }
+}
+
+static void
+gwy_app_undo_enforce_budget(void)
+{
+    GwyAppUndoLevel *level;
+    GwyAppUndo *appundo;
+    GList *l, *ll, **plist, *candidate;
+    gsize memsize = 0, disksize = 0, levelmem, leveldisk;
+    gboolean spilling, can_spill = TRUE;
+    guint maxdepth;
+
+    for (l = container_list; l; l = g_list_next(l)) {
+        appundo = (GwyAppUndo*)l->data;
+        for (ll = appundo->undo; ll; ll = g_list_next(ll))
+            gwy_app_undo_level_get_sizes((GwyAppUndoLevel*)ll->data,
+                                         &memsize, &disksize);
+        for (ll = appundo->redo; ll; ll = g_list_next(ll))
+            gwy_app_undo_level_get_sizes((GwyAppUndoLevel*)ll->data,
+                                         &memsize, &disksize);
+    }
+    if (memsize <= memory_budget && disksize <= disk_budget)
+        return;
+
+    for (l = container_list; l && memsize > memory_budget; l = g_list_next(l)) {
+        appundo = (GwyAppUndo*)l->data;
+        gwy_app_undo_pack_list(appundo->undo, &memsize);
+        gwy_app_undo_pack_list(appundo->redo, &memsize);
+    }
+
+    /* First spill the deepest levels to disk.  When they do not fit there,
+     * discard them together with all older levels.  Then discard the oldest
+     * levels while the spill files take too much space. */
+    while ((can_spill && memsize > memory_budget) || disksize > disk_budget) {
+        spilling = (can_spill && memsize > memory_budget);
+        maxdepth = 0;
+        candidate = NULL;
+        plist = NULL;
+        for (l = container_list; l; l = g_list_next(l)) {
+            appundo = (GwyAppUndo*)l->data;
+            gwy_app_undo_find_candidate(&appundo->undo, !spilling,
+                                        &candidate, &plist, &maxdepth);
+            gwy_app_undo_find_candidate(&appundo->redo, !spilling,
+                                        &candidate, &plist, &maxdepth);
+        }
+        if (!candidate) {
+            if (!spilling)
+                break;
+            can_spill = FALSE;
+            continue;
+        }
+
+        level = (GwyAppUndoLevel*)candidate->data;
+        levelmem = leveldisk = 0;
+        gwy_app_undo_level_get_sizes(level, &levelmem, &leveldisk);
+        if (spilling
+            && disksize + levelmem <= disk_budget
+            && gwy_app_undo_level_spill(level)) {
+            memsize -= levelmem;
+            levelmem = leveldisk = 0;
+            gwy_app_undo_level_get_sizes(level, &levelmem, &leveldisk);
+            memsize += levelmem;
+            disksize += leveldisk;
+            continue;
+        }
+
+        for (ll = candidate; ll; ll = g_list_next(ll)) {
+            levelmem = leveldisk = 0;
+            gwy_app_undo_level_get_sizes((GwyAppUndoLevel*)ll->data,
+                                         &levelmem, &leveldisk);
+            memsize -= levelmem;
+            disksize -= leveldisk;
+        }
+        gwy_debug("Discarding undo levels from #%lu", level->id);
+        *plist = gwy_app_undo_list_truncate(*plist, candidate);
+    }
+}
+
 /**
  * gwy_undo_container_has_undo:
  * @data: Data container to get undo infomation of.
@@ -943,28 +1719,46 @@ gwy_app_undo_container_finalized(gpointer userdata,
 static void
 gwy_app_undo_list_free(GList *list)
 {
-    GwyAppUndoLevel *level;
     GList *l;
-    guint i;
 
     if (!list)
         return;
 
-    for (l = g_list_first(list); l; l = g_list_next(l)) {
-        level = (GwyAppUndoLevel*)l->data;
-        for (i = 0; i < level->nitems; i++) {
-            GwyAppUndoItem *item = level->items + i;
+    for (l = g_list_first(list); l; l = g_list_next(l))
+        gwy_app_undo_level_free((GwyAppUndoLevel*)l->data);
+    g_list_free(list);
+}
 
-            if (G_VALUE_TYPE(&item->value)) {
-                gwy_debug("Item (%lu,%x) destroyed", level->id, item->key);
-                g_value_unset(&item->value);
-            }
-            /* FIXME: GWY_OBJECT_UNREF(level->items[i].object); */
-        }
-        g_free(level->items);
-        g_free(level);
+static void
+gwy_app_undo_level_free(GwyAppUndoLevel *level)
+{
+    guint i;
+
+    for (i = 0; i < level->nitems; i++) {
+        gwy_debug("Item (%lu,%x) destroyed", level->id, level->items[i].key);
+        gwy_app_undo_item_clear(level->items + i);
+    }
+    if (level->spill_file) {
+        g_unlink(level->spill_file);
+        g_free(level->spill_file);
+    }
+    g_free(level->items);
+    g_free(level);
+}
+
+static void
+gwy_app_undo_item_clear(GwyAppUndoItem *item)
+{
+    GwyAppUndoPacked *packed = item->packed;
+
+    if (G_VALUE_TYPE(&item->value))
+        g_value_unset(&item->value);
+    if (packed) {
+        g_object_unref(packed->meta);
+        g_free(packed->data);
+        g_free(packed);
+        item->packed = NULL;
     }
-    g_list_free(list);
 }
 
 static gint
@@ -1025,10 +1819,8 @@ gwy_undo_container_remove_from_list(GList *list,
             key = g_quark_to_string(level->items[i].key);
             if (g_str_has_prefix(key, prefix)
                 && (key[len] == '\0'
-                    || key[len] == '/')) {
-                if (G_VALUE_TYPE(&level->items[i].value))
-                    g_value_unset(&level->items[i].value);
-            }
+                    || key[len] == '/'))
+                gwy_app_undo_item_clear(level->items + i);
             else {
                 if (j != i)
                     level->items[j] = level->items[i];
@@ -1040,8 +1832,7 @@ gwy_undo_container_remove_from_list(GList *list,
         level->nitems = j;
 
         if (!level->nitems) {
-            g_free(level->items);
-            g_free(level);
+            gwy_app_undo_level_free(level);
             l->data = NULL;
         }
     }
@@ -1164,6 +1955,55 @@ gwy_undo_set_enabled(gboolean setting)
     }
 }
 
+/**
+ * gwy_undo_set_budget:
+ * @memory: Memory the saved undo/redo data can occupy, in bytes.
+ * @disk: Space the saved undo/redo data can occupy in temporary files, in
+ *        bytes.
+ *
+ * Sets the limits on saved undo/redo data.
+ *
+ * The limits are global, shared by all data containers.  When the memory
+ * limit is exceeded, older undo levels are first stored as compressed
+ * differences to newer levels and then moved to temporary files.  They are
+ * read back when undo reaches them.  Levels which no longer fit anywhere are
+ * discarded, oldest first.  The most recent undo and redo levels of each
+ * container are always kept in memory.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_undo_set_budget(gsize memory,
+                    gsize disk)
+{
+    memory_budget = memory;
+    disk_budget = disk;
+    if (!undo_disabled)
+        gwy_app_undo_enforce_budget();
+}
+
+/**
+ * gwy_undo_get_budget:
+ * @memory: Location to store the memory limit (in bytes) to, or %NULL.
+ * @disk: Location to store the temporary file space limit (in bytes) to, or
+ *        %NULL.
+ *
+ * Gets the limits on saved undo/redo data.
+ *
+ * See gwy_undo_set_budget() for details.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_undo_get_budget(gsize *memory,
+                    gsize *disk)
+{
+    if (memory)
+        *memory = memory_budget;
+    if (disk)
+        *disk = disk_budget;
+}
+
 /************************** Documentation ****************************/
 
 /**
@@ -1187,6 +2027,9 @@ gwy_undo_set_enabled(gboolean setting)
  *
  * Undo information for a #GwyContainer is automatically destroyed when the
  * container is finalized.
+ *
+ * The amount of saved data is not limited by the number of undo levels but by
+ * a global memory budget, see gwy_undo_set_budget().
  **/
 
 /* vim: set cin et ts=4 sw=4 cino=>1s,e0,n0,f0,{0,}0,^0,\:1s,=0,g1s,h0,t0,+1s,c3,(0,u0 : */
@@ -61,6 +61,10 @@ void     gwy_undo_container_remove        (GwyContainer *data,
                                            const gchar *prefix);
 gboolean gwy_undo_get_enabled             (void);
 void     gwy_undo_set_enabled             (gboolean setting);
+void     gwy_undo_set_budget              (gsize memory,
+                                           gsize disk);
+void     gwy_undo_get_budget              (gsize *memory,
+                                           gsize *disk);
 
 G_END_DECLS
 
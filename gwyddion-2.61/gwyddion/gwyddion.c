@@ -27,6 +27,7 @@
 #include <libgwyddion/gwyddion.h>
 #include <libprocess/gwygrainvalue.h>
 #include <libprocess/gwycalibration.h>
+#include <libprocess/simplefft.h>
 #include <libgwymodule/gwymoduleloader.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <libgwydgets/gwydgets.h>
@@ -113,11 +114,13 @@ main(int argc, char *argv[])
 {
     GtkWidget *toolbox;
     gchar **module_dirs;
-    gchar *settings_file, *recent_file_file = NULL, *accel_file = NULL;
+    gchar *settings_file, *recent_file_file = NULL, *accel_file = NULL, *wisdom_file, *registry_file;
     gboolean has_settings, settings_ok = FALSE;
-    gboolean opening_files = FALSE, show_tips = FALSE;
+    gboolean opening_files = FALSE, show_tips = FALSE, fft_measure = FALSE;
     GwyContainer *settings;
     GError *settings_err = NULL;
+    gsize undo_memory, undo_disk;
+    gint32 mib;
     GTimer *timer;
 
     g_unsetenv("UBUNTU_MENUPROXY");
@@ -202,6 +205,22 @@ main(int argc, char *argv[])
     settings = gwy_app_settings_get();
     debug_time(timer, "load settings");
 
+    /* Measured FFT plans only pay off when the measurements are kept between runs. */
+    wisdom_file = g_build_filename(gwy_get_user_dir(), "fftw-wisdom", NULL);
+    gwy_container_gis_boolean_by_name(settings, "/app/fft/measure-plans", &fft_measure);
+    gwy_fft_set_measure_planning(fft_measure);
+    if (fft_measure)
+        gwy_fft_load_wisdom(wisdom_file);
+    debug_time(timer, "load FFTW wisdom");
+
+    /* Undo budgets are given in MiB in the settings. */
+    gwy_undo_get_budget(&undo_memory, &undo_disk);
+    if (gwy_container_gis_int32_by_name(settings, "/app/undo/memory-budget", &mib) && mib > 0)
+        undo_memory = (gsize)mib << 20;
+    if (gwy_container_gis_int32_by_name(settings, "/app/undo/disk-budget", &mib) && mib >= 0)
+        undo_disk = (gsize)mib << 20;
+    gwy_undo_set_budget(undo_memory, undo_disk);
+
     /* Modules load pretty fast with bundling.  Most time is taken by:
      * 1) pygwy, but only if it registers some Python modules; when it is no-op it is fast, so you only pay the price
      *    when you get the benefits
@@ -214,8 +233,12 @@ main(int argc, char *argv[])
     block_modules(app_options.disabled_modules);
     GWY_FREE(app_options.disabled_modules);
 
+    /* Modules which did not change since the last run are registered from the cache and loaded on demand. */
+    registry_file = g_build_filename(gwy_get_user_dir(), "module-registry", NULL);
+    gwy_module_load_registry_cache(registry_file);
     module_dirs = gwy_app_settings_get_module_dirs();
     gwy_module_register_modules((const gchar**)module_dirs);
+    gwy_module_save_registry_cache(registry_file);
     /* The Python initialisation overrides SIGINT and Gwyddion can no longer be terminated with Ctrl-C.  Fix it. */
     signal(SIGINT, SIG_DFL);
     /* TODO: The Python initialisation also overrides where the warnings go. Restore the handlers. */
@@ -305,6 +328,12 @@ main(int argc, char *argv[])
     debug_time(timer, "save document history");
     gwy_app_process_func_save_use();
     debug_time(timer, "save funcuse");
+    if (gwy_fft_get_measure_planning())
+        gwy_fft_save_wisdom(wisdom_file);
+    debug_time(timer, "save FFTW wisdom");
+    /* Modules which failed to load on demand are dropped from the cache. */
+    gwy_module_save_registry_cache(registry_file);
+    debug_time(timer, "save module registry");
     gwy_app_settings_free();
     /*gwy_resource_classes_finalize();*/
     gwy_app_recent_file_list_free();
@@ -312,6 +341,8 @@ main(int argc, char *argv[])
     g_free(recent_file_file);
     g_free(settings_file);
     g_free(accel_file);
+    g_free(wisdom_file);
+    g_free(registry_file);
     g_strfreev(module_dirs);
     debug_time(timer, "destroy resources");
     g_timer_destroy(timer);
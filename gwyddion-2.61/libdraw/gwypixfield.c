@@ -21,6 +21,7 @@
 
 #include "config.h"
 #include <libgwyddion/gwymacros.h>
+#include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwythreads.h>
 #include <libprocess/stats.h>
 #include <gwypixfield.h>
@@ -179,17 +180,53 @@ void
 gwy_pixbuf_draw_data_field_adaptive(GdkPixbuf *pixbuf,
                                     GwyDataField *data_field,
                                     GwyGradient *gradient)
+{
+    GwyDataLine *cdh;
+
+    cdh = gwy_draw_data_field_cdh(data_field);
+    gwy_pixbuf_draw_data_field_adaptive_with_cdh(pixbuf, data_field, cdh,
+                                                 gradient);
+    g_object_unref(cdh);
+}
+
+/**
+ * gwy_pixbuf_draw_data_field_adaptive_with_cdh:
+ * @pixbuf: A Gdk pixbuf to draw to.
+ * @data_field: A data field to draw.
+ * @cdh: Cumulative height distribution defining the mapping, as returned by
+ *       gwy_draw_data_field_cdh().
+ * @gradient: A color gradient to draw with.
+ *
+ * Paints a data field to a pixbuf with a color gradient adaptively, using
+ * a precomputed mapping.
+ *
+ * With @cdh obtained from another data field, the mapping is the same as
+ * gwy_pixbuf_draw_data_field_adaptive() would use for that field.  This is
+ * useful for painting a scaled-down version of a field, which then has the
+ * same colours as the full data, and for repeated painting of the same data
+ * without recalculating the distribution.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_pixbuf_draw_data_field_adaptive_with_cdh(GdkPixbuf *pixbuf,
+                                             GwyDataField *data_field,
+                                             GwyDataLine *cdh,
+                                             GwyGradient *gradient)
 {
     gint xres, yres, i, rowstride, palsize, cdh_size;
-    gdouble min, max, cor, q, m;
+    gdouble min, cor, q, m;
     const guchar *samples;
-    const gdouble *data;
+    const gdouble *data, *c;
     guchar *pixels;
-    gint *cdh;
 
-    gwy_data_field_get_min_max(data_field, &min, &max);
-    if (min == max) {
-        gwy_pixbuf_draw_data_field(pixbuf, data_field, gradient);
+    g_return_if_fail(GWY_IS_DATA_LINE(cdh));
+
+    cdh_size = gwy_data_line_get_res(cdh);
+    min = gwy_data_line_get_offset(cdh);
+    if (cdh_size < 2) {
+        gwy_pixbuf_draw_data_field_with_range(pixbuf, data_field, gradient,
+                                              min, min);
         return;
     }
 
@@ -198,20 +235,20 @@ gwy_pixbuf_draw_data_field_adaptive(GdkPixbuf *pixbuf,
     g_return_if_fail(xres == gdk_pixbuf_get_width(pixbuf));
     g_return_if_fail(yres == gdk_pixbuf_get_height(pixbuf));
 
-    cdh = calc_cdh(data_field, &cdh_size);
-    q = (cdh_size - 1.0)/(max - min);
+    c = gwy_data_line_get_data_const(cdh);
+    q = (cdh_size - 1.0)/gwy_data_line_get_real(cdh);
     data = gwy_data_field_get_data_const(data_field);
 
     pixels = gdk_pixbuf_get_pixels(pixbuf);
     rowstride = gdk_pixbuf_get_rowstride(pixbuf);
     samples = gwy_gradient_get_samples(gradient, &palsize);
-    cor = (palsize - 1.0)/cdh[cdh_size-1];
+    cor = palsize - 1.0;
 
     m = cdh_size - 1.000001;
 #ifdef _OPENMP
 #pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
             private(i) \
-            shared(pixels,data,samples,cdh,xres,yres,rowstride,q,min,m,cor)
+            shared(pixels,data,samples,c,xres,yres,rowstride,q,min,m,cor)
 #endif
     for (i = 0; i < yres; i++) {
         guchar *line = pixels + i*rowstride;
@@ -225,15 +262,61 @@ gwy_pixbuf_draw_data_field_adaptive(GdkPixbuf *pixbuf,
             v = GWY_CLAMP(v, 0.0, m);
             h = (gint)v;
             v -= h;
-            h = (gint)((cdh[h]*(1.0 - v) + cdh[h+1]*v)*cor + 0.5);
+            h = (gint)((c[h]*(1.0 - v) + c[h+1]*v)*cor + 0.5);
             s = samples + 4*h;
             *(line++) = *(s++);
             *(line++) = *(s++);
             *(line++) = *s;
         }
     }
+}
 
-    g_free(cdh);
+/**
+ * gwy_draw_data_field_cdh:
+ * @data_field: A data field.
+ *
+ * Calculates the cumulative height distribution used for adaptive colour
+ * mapping.
+ *
+ * The distribution is returned as a data line with offset and real length
+ * corresponding to the value range of @data_field, with values growing from
+ * 0 to 1.  For a flat data field the line has a single point and the offset
+ * is the data value.
+ *
+ * The result can be passed to gwy_pixbuf_draw_data_field_adaptive_with_cdh()
+ * as long as @data_field does not change.
+ *
+ * Returns: A newly created data line.
+ *
+ * Since: 2.62
+ **/
+GwyDataLine*
+gwy_draw_data_field_cdh(GwyDataField *data_field)
+{
+    GwyDataLine *cdh;
+    gdouble min, max;
+    gdouble *d;
+    gint i, cdh_size;
+    gint *icdh;
+
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(data_field), NULL);
+
+    gwy_data_field_get_min_max(data_field, &min, &max);
+    if (min == max) {
+        cdh = gwy_data_line_new(1, 1.0, TRUE);
+        gwy_data_line_set_offset(cdh, min);
+        return cdh;
+    }
+
+    icdh = calc_cdh(data_field, &cdh_size);
+    cdh = gwy_data_line_new(cdh_size, max - min, FALSE);
+    gwy_data_line_set_offset(cdh, min);
+    d = gwy_data_line_get_data(cdh);
+    for (i = 0; i < cdh_size; i++)
+        d[i] = (gdouble)icdh[i]/icdh[cdh_size-1];
+    g_free(icdh);
+
+    return cdh;
 }
 
 /**
@@ -285,6 +368,82 @@ gwy_draw_data_field_map_adaptive(GwyDataField *data_field,
     g_free(cdh);
 }
 
+/**
+ * gwy_draw_data_field_halve:
+ * @data_field: A data field.
+ *
+ * Creates a data field with halved resolution for display purposes.
+ *
+ * Each pixel of the result corresponds to a 2×2 block of @data_field (blocks
+ * at the right and bottom edges can be smaller if the resolution is odd).  It
+ * takes the value from the block which differs most from the block mean.
+ * Unlike averaging, this keeps small spikes and pits visible and the value
+ * range is not squeezed, so the result can be painted with the colour range
+ * of the original data.  Repeated halving gives a resolution pyramid for
+ * drawing large data scaled down.
+ *
+ * Returns: A newly created data field.
+ *
+ * Since: 2.62
+ **/
+GwyDataField*
+gwy_draw_data_field_halve(GwyDataField *data_field)
+{
+    GwyDataField *result;
+    gint xres, yres, hxres, hyres, i;
+    const gdouble *data;
+    gdouble *hdata;
+
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(data_field), NULL);
+
+    xres = gwy_data_field_get_xres(data_field);
+    yres = gwy_data_field_get_yres(data_field);
+    hxres = (xres + 1)/2;
+    hyres = (yres + 1)/2;
+    result = gwy_data_field_new(hxres, hyres,
+                                gwy_data_field_get_xreal(data_field),
+                                gwy_data_field_get_yreal(data_field),
+                                FALSE);
+    gwy_data_field_set_xoffset(result, gwy_data_field_get_xoffset(data_field));
+    gwy_data_field_set_yoffset(result, gwy_data_field_get_yoffset(data_field));
+    data = gwy_data_field_get_data_const(data_field);
+    hdata = gwy_data_field_get_data(result);
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(data,hdata,xres,yres,hxres,hyres)
+#endif
+    for (i = 0; i < hyres; i++) {
+        const gdouble *row1 = data + 2*i*xres;
+        const gdouble *row2 = (2*i + 1 < yres) ? row1 + xres : row1;
+        gdouble *hrow = hdata + i*hxres;
+        gdouble v[4], mean, d, best, bestd;
+        gint j, j1, j2, k;
+
+        for (j = 0; j < hxres; j++) {
+            j1 = 2*j;
+            j2 = MIN(j1 + 1, xres-1);
+            v[0] = row1[j1];
+            v[1] = row1[j2];
+            v[2] = row2[j1];
+            v[3] = row2[j2];
+            mean = 0.25*(v[0] + v[1] + v[2] + v[3]);
+            best = v[0];
+            bestd = fabs(v[0] - mean);
+            for (k = 1; k < 4; k++) {
+                if ((d = fabs(v[k] - mean)) > bestd) {
+                    bestd = d;
+                    best = v[k];
+                }
+            }
+            hrow[j] = best;
+        }
+    }
+
+    return result;
+}
+
 static gint*
 calc_cdh(GwyDataField *dfield, gint *cdh_size)
 {
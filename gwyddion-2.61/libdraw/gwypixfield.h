@@ -37,6 +37,11 @@ void gwy_pixbuf_draw_data_field_with_range(GdkPixbuf *pixbuf,
 void gwy_pixbuf_draw_data_field_adaptive  (GdkPixbuf *pixbuf,
                                            GwyDataField *data_field,
                                            GwyGradient *gradient);
+void gwy_pixbuf_draw_data_field_adaptive_with_cdh(GdkPixbuf *pixbuf,
+                                                  GwyDataField *data_field,
+                                                  GwyDataLine *cdh,
+                                                  GwyGradient *gradient);
+GwyDataLine* gwy_draw_data_field_cdh      (GwyDataField *data_field);
 void gwy_draw_data_field_map_adaptive     (GwyDataField *data_field,
                                            const gdouble *z,
                                            gdouble *mapped,
@@ -44,5 +49,6 @@ void gwy_draw_data_field_map_adaptive     (GwyDataField *data_field,
 void gwy_pixbuf_draw_data_field_as_mask   (GdkPixbuf *pixbuf,
                                            GwyDataField *data_field,
                                            const GwyRGBA *color);
+GwyDataField* gwy_draw_data_field_halve   (GwyDataField *data_field);
 
 #endif /*__GWY_PIXFIELD__*/
@@ -27,6 +27,7 @@
 #include <libgwyddion/gwyddiontypes.h>
 #include <libgwyddion/gwyenum.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyascii.h>
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwynlfit.h>
 #include <libgwyddion/gwynlfitpreset.h>
@@ -30,6 +30,9 @@
 
 #define GWY_EXPR_SCOPE_GLOBAL 0
 
+/* Number of items processed at once by each operation in vector execution. */
+enum { GWY_EXPR_BLOCK_SIZE = 256 };
+
 /* things that can appear on code stack */
 typedef enum {
     /* negative values are reserved for variables */
@@ -124,6 +127,15 @@ typedef struct {
     GwyExprOpCode type;  /* consistency check: must be equal to position */
 } GwyExprFunction;
 
+/* Block execution program item.  Function arguments are indices of preceding
+ * items, the first argument is the one on top of the stack. */
+typedef struct {
+    GwyExprOpCode type;
+    gdouble value;
+    guint args[2];
+    guint slot;    /* work buffer for constants and function results */
+} GwyExprNode;
+
 /* Transitional tokenizer token:
  * can hold both initial GScanner tokens and final GwyExpr RPN stacks */
 typedef struct _GwyExprToken GwyExprToken;
@@ -156,6 +168,11 @@ struct _GwyExpr {
     gdouble *stack;    /* stack */
     guint slen;    /* allocated size */
     guint level;   /* level in transform to rpn */
+    /* Block execution program, with common subexpressions merged */
+    GwyExprNode *nodes;
+    guint nnodes;
+    guint nalloc;    /* allocated size */
+    guint nslots;    /* number of work buffers */
 };
 
 static inline gdouble
@@ -410,7 +427,105 @@ gwy_expr_stack_interpret(GwyExpr *expr)
 }
 
 /**
- * gwy_expr_stack_interpret_vectors:
+ * gwy_expr_node_apply:
+ * @node: A function item of the block execution program.
+ * @len: Number of items to process.
+ * @a: First argument values.
+ * @b: Second argument values (ignored for unary functions).
+ * @out: Array to store results to.  It may coincide with @a or @b.
+ *
+ * Evaluates one block execution program function on a block of values.
+ *
+ * Common cheap operations have their own loops the compiler can vectorise,
+ * the rest runs the call table functions on a tiny stack.
+ **/
+static void
+gwy_expr_node_apply(const GwyExprNode *node,
+                    guint len,
+                    const gdouble *a,
+                    const gdouble *b,
+                    gdouble *out)
+{
+    const GwyExprFunction *func;
+    gdouble t[GWY_EXPR_FUNC_MAX_ARGS], *sp;
+    guint k;
+
+    switch (node->type) {
+        case GWY_EXPR_CODE_NEGATE:
+        for (k = 0; k < len; k++)
+            out[k] = -a[k];
+        break;
+
+        case GWY_EXPR_CODE_ADD:
+        for (k = 0; k < len; k++)
+            out[k] = a[k] + b[k];
+        break;
+
+        case GWY_EXPR_CODE_SUBTRACT:
+        for (k = 0; k < len; k++)
+            out[k] = a[k] - b[k];
+        break;
+
+        case GWY_EXPR_CODE_MULTIPLY:
+        for (k = 0; k < len; k++)
+            out[k] = a[k] * b[k];
+        break;
+
+        case GWY_EXPR_CODE_DIVIDE:
+        for (k = 0; k < len; k++)
+            out[k] = a[k] / b[k];
+        break;
+
+        case GWY_EXPR_CODE_MIN:
+        for (k = 0; k < len; k++)
+            out[k] = fmin(a[k], b[k]);
+        break;
+
+        case GWY_EXPR_CODE_MAX:
+        for (k = 0; k < len; k++)
+            out[k] = fmax(a[k], b[k]);
+        break;
+
+        case GWY_EXPR_CODE_STEP:
+        for (k = 0; k < len; k++)
+            out[k] = a[k] > 0.0;
+        break;
+
+        case GWY_EXPR_CODE_ABS:
+        for (k = 0; k < len; k++)
+            out[k] = fabs(a[k]);
+        break;
+
+        case GWY_EXPR_CODE_SQRT:
+        for (k = 0; k < len; k++)
+            out[k] = sqrt(a[k]);
+        break;
+
+        default:
+        func = call_table + node->type;
+        if (func->in_values == 1) {
+            for (k = 0; k < len; k++) {
+                t[0] = a[k];
+                sp = t;
+                func->function(&sp);
+                out[k] = t[0];
+            }
+        }
+        else {
+            for (k = 0; k < len; k++) {
+                t[0] = b[k];
+                t[1] = a[k];
+                sp = t + 1;
+                func->function(&sp);
+                out[k] = t[0];
+            }
+        }
+        break;
+    }
+}
+
+/**
+ * gwy_expr_program_interpret_vectors:
  * @expr: An expression.
  * @n: The lenght of @result and of @data member arrays, that is vector length.
  * @data: An array of arrays of length @n.  The arrays correspond to expression
@@ -418,44 +533,73 @@ gwy_expr_stack_interpret(GwyExpr *expr)
  * @result: An array of length @n to store computation results to.  It may be
  *          one of those in @data.
  *
- * Performs actual vectorized stack interpretation.
+ * Performs actual vectorized interpretation.
  *
- * No checking is done, use gwy_expr_stack_check_executability() beforehand.
+ * The data are processed in blocks of %GWY_EXPR_BLOCK_SIZE items.  Each
+ * operation of the block execution program is carried out for the entire
+ * block before proceeding to the next one.
+ *
+ * No checking is done, the program must be built by gwy_expr_build_program().
  **/
-static inline void
-gwy_expr_stack_interpret_vectors(GwyExpr *expr,
-                                 guint n,
-                                 const gdouble **data,
-                                 gdouble *result)
+static void
+gwy_expr_program_interpret_vectors(GwyExpr *expr,
+                                   guint n,
+                                   const gdouble **data,
+                                   gdouble *result)
 {
-    /* XXX: We cannot have default(none) here due to incompatibility in OpenMP
-     * specification.  Some versions then require shared(call_table), whereas
-     * some forbid it. */
+    const GwyExprNode *nodes = expr->nodes;
+    guint nnodes = expr->nnodes, nslots = expr->nslots;
+    guint nblocks = (n + GWY_EXPR_BLOCK_SIZE-1)/GWY_EXPR_BLOCK_SIZE;
+
 #ifdef _OPENMP
-#pragma omp parallel if(gwy_threads_are_enabled()) \
-            shared(expr,n,data,result)
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(nodes,nnodes,nslots,nblocks,n,data,result)
 #endif
     {
-        gdouble *stack = gwy_omp_if_threads_new(expr->stack, expr->slen);
-        guint jfrom = gwy_omp_chunk_start(n), jto = gwy_omp_chunk_end(n);
-        guint i, j, nin = expr->in;
-        const GwyExprCode *input = expr->input;
-
-        for (j = jfrom; j < jto; j++) {
-            gdouble *sp = stack - 1;
-            for (i = 0; i < nin; i++) {
-                const GwyExprCode *code = input + i;
-
-                if (code->type == GWY_EXPR_CODE_CONSTANT)
-                    *(++sp) = code->value;
-                else if ((gint)code->type > 0)
-                    call_table[code->type].function(&sp);
-                else
-                    *(++sp) = data[-(gint)code->type][j];
+        guint bfrom = gwy_omp_chunk_start(nblocks);
+        guint bto = gwy_omp_chunk_end(nblocks);
+        gdouble *work = g_new(gdouble, MAX(nslots, 1)*GWY_EXPR_BLOCK_SIZE);
+        const gdouble **ptrs = g_new(const gdouble*, nnodes);
+        const GwyExprNode *node;
+        guint i, k, ib, j, len;
+        gdouble *out;
+
+        for (i = 0; i < nnodes; i++) {
+            node = nodes + i;
+            if (node->type == GWY_EXPR_CODE_CONSTANT) {
+                out = work + node->slot*GWY_EXPR_BLOCK_SIZE;
+                for (k = 0; k < GWY_EXPR_BLOCK_SIZE; k++)
+                    out[k] = node->value;
+                ptrs[i] = out;
             }
-            result[j] = stack[0];
         }
-        gwy_omp_if_threads_free(expr->stack, stack);
+
+        for (ib = bfrom; ib < bto; ib++) {
+            j = ib*GWY_EXPR_BLOCK_SIZE;
+            len = MIN(n - j, GWY_EXPR_BLOCK_SIZE);
+            for (i = 0; i < nnodes; i++) {
+                node = nodes + i;
+                if ((gint)node->type < 0)
+                    ptrs[i] = data[-(gint)node->type] + j;
+                else if ((gint)node->type > 0) {
+                    /* The last item writes directly to the result. */
+                    if (i == nnodes-1)
+                        out = result + j;
+                    else
+                        out = work + node->slot*GWY_EXPR_BLOCK_SIZE;
+                    gwy_expr_node_apply(node, len,
+                                        ptrs[node->args[0]],
+                                        ptrs[node->args[1]],
+                                        out);
+                    ptrs[i] = out;
+                }
+            }
+            if ((gint)nodes[nnodes-1].type <= 0 && ptrs[nnodes-1] != result + j)
+                gwy_assign(result + j, ptrs[nnodes-1], len);
+        }
+
+        g_free(ptrs);
+        g_free(work);
     }
 }
 
@@ -585,6 +729,124 @@ gwy_expr_stack_fold_constants(GwyExpr *expr)
     expr->in = to;
 }
 
+static inline gboolean
+gwy_expr_node_is_commutative(GwyExprOpCode type)
+{
+    return (type == GWY_EXPR_CODE_ADD
+            || type == GWY_EXPR_CODE_MULTIPLY
+            || type == GWY_EXPR_CODE_MIN
+            || type == GWY_EXPR_CODE_MAX
+            || type == GWY_EXPR_CODE_HYPOT);
+}
+
+/**
+ * gwy_expr_build_program:
+ * @expr: An expression.
+ *
+ * Builds block execution program from compiled op code representation.
+ *
+ * The stack code is simulated and each value is represented by the program
+ * item that calculates it.  Identical constants, variables and function calls
+ * with identical arguments are merged, so common subexpressions are evaluated
+ * only once.  Arguments of commutative operations are sorted to catch also
+ * things like x*y and y*x.
+ *
+ * Constants and function results are then assigned work buffers.  A function
+ * result can reuse the buffer of any value that is no longer needed,
+ * including its own arguments.
+ **/
+static void
+gwy_expr_build_program(GwyExpr *expr)
+{
+    GwyExprNode *nodes, *node;
+    guint *vstack, *lastuse, *freeslots;
+    guint i, k, m, sp, nfree;
+
+    if (expr->nalloc < expr->in) {
+        expr->nalloc = expr->in;
+        expr->nodes = g_renew(GwyExprNode, expr->nodes, expr->nalloc);
+    }
+    nodes = expr->nodes;
+    vstack = g_new(guint, expr->slen);
+    m = sp = 0;
+    for (i = 0; i < expr->in; i++) {
+        const GwyExprCode *code = expr->input + i;
+        GwyExprNode newnode;
+
+        gwy_clear(&newnode, 1);
+        newnode.type = code->type;
+        if (code->type == GWY_EXPR_CODE_CONSTANT)
+            newnode.value = code->value;
+        else if ((gint)code->type > 0) {
+            const GwyExprFunction *func = call_table + code->type;
+
+            newnode.args[0] = vstack[--sp];
+            if (func->in_values == 2) {
+                newnode.args[1] = vstack[--sp];
+                if (gwy_expr_node_is_commutative(code->type)
+                    && newnode.args[0] > newnode.args[1])
+                    GWY_SWAP(guint, newnode.args[0], newnode.args[1]);
+            }
+            else
+                newnode.args[1] = newnode.args[0];
+        }
+
+        for (k = 0; k < m; k++) {
+            node = nodes + k;
+            if (node->type == newnode.type
+                && !memcmp(&node->value, &newnode.value, sizeof(gdouble))
+                && node->args[0] == newnode.args[0]
+                && node->args[1] == newnode.args[1])
+                break;
+        }
+        if (k == m)
+            nodes[m++] = newnode;
+        vstack[sp++] = k;
+    }
+    g_assert(sp == 1);
+
+    /* The result can be a constant or variable, possibly merged with an
+     * earlier item.  Ensure it is the last item. */
+    if (vstack[0] != m-1) {
+        nodes[m] = nodes[vstack[0]];
+        m++;
+    }
+    expr->nnodes = m;
+    g_free(vstack);
+
+    lastuse = g_new0(guint, m);
+    for (i = 0; i < m; i++) {
+        if ((gint)nodes[i].type > 0) {
+            lastuse[nodes[i].args[0]] = i;
+            lastuse[nodes[i].args[1]] = i;
+        }
+    }
+
+    freeslots = g_new(guint, m);
+    nfree = 0;
+    expr->nslots = 0;
+    for (i = 0; i < m; i++) {
+        node = nodes + i;
+        if ((gint)node->type < 0)
+            continue;
+        /* Constant buffers are filled only once, they must not be shared. */
+        if (node->type == GWY_EXPR_CODE_CONSTANT) {
+            node->slot = expr->nslots++;
+            continue;
+        }
+        for (k = 0; k < 2; k++) {
+            GwyExprNode *arg = nodes + node->args[k];
+
+            if ((gint)arg->type > 0 && lastuse[node->args[k]] == i
+                && (k == 0 || node->args[1] != node->args[0]))
+                freeslots[nfree++] = arg->slot;
+        }
+        node->slot = nfree ? freeslots[--nfree] : expr->nslots++;
+    }
+    g_free(freeslots);
+    g_free(lastuse);
+}
+
 /****************************************************************************
  *
  *  Reimplementation of interesting parts of GList
@@ -1492,6 +1754,7 @@ gwy_expr_free(GwyExpr *expr)
     g_string_free(expr->expr, TRUE);
     g_free(expr->input);
     g_free(expr->stack);
+    g_free(expr->nodes);
     g_slice_free(GwyExpr, expr);
 }
 
@@ -1576,6 +1839,7 @@ gwy_expr_compile(GwyExpr *expr,
         return FALSE;
     }
     gwy_expr_stack_fold_constants(expr);
+    gwy_expr_build_program(expr);
 
     return TRUE;
 }
@@ -1712,7 +1976,8 @@ gwy_expr_vector_execute(GwyExpr *expr,
     g_return_if_fail(result);
     g_return_if_fail(data || expr->identifiers->len <= 1);
 
-    gwy_expr_stack_interpret_vectors(expr, n, data, result);
+    if (n)
+        gwy_expr_program_interpret_vectors(expr, n, data, result);
 }
 
 /**
@@ -35,6 +35,28 @@
 
 #define GWY_TWO_PI 6.28318530717958647692528676655900576839433879875016
 
+enum {
+    /* Arrays at least this large are sorted using radix sort. */
+    RADIX_SORT_MIN = 65536,
+    RADIX_BITS = 11,
+    RADIX_BINS = 1 << RADIX_BITS,
+    RADIX_PASSES = (64 + RADIX_BITS - 1)/RADIX_BITS,
+};
+
+enum {
+    /* Arrays at least this large use parallel selection if threads are enabled. */
+    SELECT_PARALLEL_MIN = 1 << 20,
+    SELECT_NBINS = 1 << 16,
+    /* Give up bucket refinement after this many levels and finish the job with quickselect. */
+    SELECT_MAX_DEPTH = 6,
+};
+
+static void kth_ranks_parallel(gsize n,
+                               gdouble *array,
+                               guint nk,
+                               const guint *k,
+                               gdouble *values);
+
 GType
 gwy_xy_get_type(void)
 {
@@ -914,31 +936,20 @@ kth_rank_simple(gsize n, gdouble *array, gsize k)
     g_assert_not_reached();
 }
 
-/**
- * gwy_math_kth_rank:
- * @n: Number of items in @array.
- * @array: Array of doubles.  It is shuffled by this function.
- * @k: Rank of the value to find (from lowest to highest).
- *
- * Finds k-th item of an array of values using Quick select algorithm.
- *
- * The value positions change as follows.  The returned value is guaranteed to be at @k-th position in the array (i.e.
- * correctly ranked).  All other values are correctly ordered with respect to this value: preceeding values are
- * smaller (or equal) and following values are larger (or equal).
- *
- * Returns: The @k-th value of @array if it was sorted.
- *
- * Since: 2.50
- **/
-gdouble
-gwy_math_kth_rank(gsize n, gdouble *array, gsize k)
+static inline gboolean
+select_in_parallel(gsize n)
+{
+    return n >= SELECT_PARALLEL_MIN && n <= G_MAXUINT && gwy_threads_are_enabled() && gwy_omp_max_threads() > 1;
+}
+
+/* The serial quickselect.  Used directly for small arrays and also by the multiple-rank functions on subarrays. */
+static gdouble
+kth_rank_quickselect(gsize n, gdouble *array, gsize k)
 {
     gsize lo, hi;
     gsize middle, ll, hh;
     gdouble m;
 
-    g_return_val_if_fail(k < n, 0.0);
-
     lo = 0;
     hi = n-1;
     while (TRUE) {
@@ -987,6 +998,39 @@ gwy_math_kth_rank(gsize n, gdouble *array, gsize k)
     }
 }
 
+/**
+ * gwy_math_kth_rank:
+ * @n: Number of items in @array.
+ * @array: Array of doubles.  It is shuffled by this function.
+ * @k: Rank of the value to find (from lowest to highest).
+ *
+ * Finds k-th item of an array of values using Quick select algorithm.
+ *
+ * Large arrays are processed using parallel bucket selection when threads are enabled.
+ *
+ * The value positions change as follows.  The returned value is guaranteed to be at @k-th position in the array (i.e.
+ * correctly ranked).  All other values are correctly ordered with respect to this value: preceeding values are
+ * smaller (or equal) and following values are larger (or equal).
+ *
+ * Returns: The @k-th value of @array if it was sorted.
+ *
+ * Since: 2.50
+ **/
+gdouble
+gwy_math_kth_rank(gsize n, gdouble *array, gsize k)
+{
+    g_return_val_if_fail(k < n, 0.0);
+
+    if (select_in_parallel(n)) {
+        guint kk = k;
+        gdouble v;
+
+        kth_ranks_parallel(n, array, 1, &kk, &v);
+        return v;
+    }
+    return kth_rank_quickselect(n, array, k);
+}
+
 /**
  * gwy_math_median:
  * @n: Number of items in @array.
@@ -1028,7 +1072,7 @@ kth_ranks_small(gsize n, gdouble *array,
 
     k0 = k[0];
     if (nk == 1) {
-        values[0] = gwy_math_kth_rank(n, array, k0);
+        values[0] = kth_rank_quickselect(n, array, k0);
         return;
     }
 
@@ -1036,13 +1080,13 @@ kth_ranks_small(gsize n, gdouble *array,
     d0 = (k0 <= n/2) ? n/2 - k0 : k0 - n/2;
     d1 = (k1 <= n/2) ? n/2 - k1 : k1 - n/2;
     if (d0 <= d1) {
-        values[0] = gwy_math_kth_rank(n, array, k0);
+        values[0] = kth_rank_quickselect(n, array, k0);
         k0++;
-        values[1] = gwy_math_kth_rank(n-k0, array+k0, k1-k0);
+        values[1] = kth_rank_quickselect(n-k0, array+k0, k1-k0);
     }
     else {
-        values[1] = gwy_math_kth_rank(n, array, k1);
-        values[0] = gwy_math_kth_rank(k1, array, k0);
+        values[1] = kth_rank_quickselect(n, array, k1);
+        values[0] = kth_rank_quickselect(k1, array, k0);
     }
 }
 
@@ -1059,7 +1103,7 @@ kth_ranks_recurse(gsize n, gdouble *array,
 
     jmid = nk/2;
     kmid = k[jmid];
-    values[jmid] = gwy_math_kth_rank(n, array, kmid);
+    values[jmid] = kth_rank_quickselect(n, array, kmid);
 
     /* Now recurse into the halfs.  Both are non-empty because nk >= 3. */
     kth_ranks_recurse(kmid, array, jmid, k, values);
@@ -1101,7 +1145,7 @@ kth_ranks_fastpath(gsize n, gdouble *array,
     if (nk < 2 || k[0] < k[1])
         kth_ranks_small(n, array, nk, k, values);
     else if (k[0] == k[1])
-        values[0] = values[1] = gwy_math_kth_rank(n, array, k[0]);
+        values[0] = values[1] = kth_rank_quickselect(n, array, k[0]);
     else {
         guint ksorted[2];
 
@@ -1112,6 +1156,296 @@ kth_ranks_fastpath(gsize n, gdouble *array,
     }
 }
 
+static inline guint
+select_bin(gdouble x, gdouble min, gdouble q)
+{
+    gdouble b = (0.5*x - 0.5*min)*q;
+    return b < SELECT_NBINS-1 ? (guint)b : SELECT_NBINS-1;
+}
+
+/* Finds values with ranks @k (uniq-sorted) without moving anything in @data, except when the array is small and we
+ * switch to quickselect.  NaNs are considered larger than all other values.
+ *
+ * The finite values are distributed to a large number of equal-width bins in parallel.  Only the bins containing the
+ * requested ranks are gathered to a new buffer and each is then processed recursively, usually already by the serial
+ * quickselect because one bin contains a tiny fraction of the data. */
+static void
+select_ranks(gsize n, gdouble *data, guint nk, guint *k, gdouble *values, guint depth)
+{
+    guint nthreads = gwy_omp_max_threads();
+    gdouble *tmin, *tmax, *cand = NULL;
+    gsize *tnan;
+    guint *counts, *bins, *localk, *slotbin, *slotstart, *offsets = NULL;
+    gint *slotofbin;
+    gdouble min = G_MAXDOUBLE, max = -G_MAXDOUBLE, q = 0.0;
+    gsize nfin = n;
+    guint nslots = 0, nkfin = 0;
+    gboolean bucketize = FALSE;
+
+    if (n < SELECT_PARALLEL_MIN || depth >= SELECT_MAX_DEPTH) {
+        kth_ranks_recurse(n, data, nk, k, values);
+        return;
+    }
+
+    tmin = g_new(gdouble, nthreads);
+    tmax = g_new(gdouble, nthreads);
+    tnan = g_new(gsize, nthreads);
+    counts = g_new0(guint, nthreads*SELECT_NBINS);
+    bins = g_new(guint, nk);
+    localk = g_new(guint, nk);
+    slotbin = g_new(guint, nk);
+    slotstart = g_new(guint, nk+1);
+    slotofbin = g_new(gint, SELECT_NBINS);
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(n,data,nk,k,values,nthreads,tmin,tmax,tnan,counts,bins,localk,slotbin,slotstart,slotofbin, \
+                   offsets,cand,min,max,q,nfin,nslots,nkfin,bucketize)
+#endif
+    {
+        gsize ifrom = gwy_omp_chunk_start(n), ito = gwy_omp_chunk_end(n), i;
+        guint t = gwy_omp_thread_num();
+        guint *tcounts = counts + t*SELECT_NBINS;
+        gdouble tmn = G_MAXDOUBLE, tmx = -G_MAXDOUBLE;
+        gsize nn = 0;
+
+        for (i = ifrom; i < ito; i++) {
+            gdouble x = data[i];
+
+            if (gwy_isnan(x))
+                nn++;
+            else {
+                tmn = fmin(tmn, x);
+                tmx = fmax(tmx, x);
+            }
+        }
+        tmin[t] = tmn;
+        tmax[t] = tmx;
+        tnan[t] = nn;
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            guint tt, jj;
+
+            for (tt = 0; tt < gwy_omp_num_threads(); tt++) {
+                min = fmin(min, tmin[tt]);
+                max = fmax(max, tmax[tt]);
+                nfin -= tnan[tt];
+            }
+            /* Ranks falling to the NaN block at the end. */
+            while (nkfin < nk && k[nkfin] < nfin)
+                nkfin++;
+            for (jj = nkfin; jj < nk; jj++)
+                values[jj] = NAN;
+
+            if (nkfin && max > min) {
+                /* Work with halved values to avoid overflow for huge ranges.  For degenerate tiny ranges we just put
+                 * everything to the first bin and let the recursion depth limit resolve it. */
+                q = SELECT_NBINS/(0.5*max - 0.5*min);
+                if (!(q < G_MAXDOUBLE))
+                    q = 0.0;
+                bucketize = TRUE;
+            }
+            else {
+                for (jj = 0; jj < nkfin; jj++)
+                    values[jj] = min;
+            }
+        }
+
+        if (bucketize) {
+            for (i = ifrom; i < ito; i++) {
+                gdouble x = data[i];
+
+                if (!gwy_isnan(x))
+                    tcounts[select_bin(x, min, q)]++;
+            }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+            {
+                guint b, tt, s, jj, total, cum = 0;
+
+                /* Find the bins containing requested ranks.  Since k[] is sorted, so are the bins. */
+                b = 0;
+                total = 0;
+                slotstart[0] = 0;
+                for (tt = 0; tt < nthreads; tt++)
+                    total += counts[tt*SELECT_NBINS];
+                for (jj = 0; jj < nkfin; jj++) {
+                    while (cum + total <= k[jj]) {
+                        cum += total;
+                        b++;
+                        total = 0;
+                        for (tt = 0; tt < nthreads; tt++)
+                            total += counts[tt*SELECT_NBINS + b];
+                    }
+                    if (!nslots || slotbin[nslots-1] != b) {
+                        slotbin[nslots] = b;
+                        slotstart[nslots+1] = slotstart[nslots] + total;
+                        nslots++;
+                    }
+                    bins[jj] = nslots-1;
+                    localk[jj] = k[jj] - cum;
+                }
+
+                for (b = 0; b < SELECT_NBINS; b++)
+                    slotofbin[b] = -1;
+                for (s = 0; s < nslots; s++)
+                    slotofbin[slotbin[s]] = s;
+
+                /* Each thread gathers its values to a separate block inside each slot. */
+                offsets = g_new(guint, nthreads*nslots);
+                for (s = 0; s < nslots; s++) {
+                    cum = slotstart[s];
+                    for (tt = 0; tt < nthreads; tt++) {
+                        offsets[tt*nslots + s] = cum;
+                        cum += counts[tt*SELECT_NBINS + slotbin[s]];
+                    }
+                }
+                cand = g_new(gdouble, slotstart[nslots]);
+            }
+
+            {
+                guint *toffsets = offsets + t*nslots;
+
+                for (i = ifrom; i < ito; i++) {
+                    gdouble x = data[i];
+                    gint s;
+
+                    if (!gwy_isnan(x) && (s = slotofbin[select_bin(x, min, q)]) >= 0)
+                        cand[toffsets[s]++] = x;
+                }
+            }
+        }
+    }
+
+    if (bucketize) {
+        guint s, jfrom = 0, jto;
+
+        for (s = 0; s < nslots; s++) {
+            for (jto = jfrom; jto < nkfin && bins[jto] == s; jto++)
+                ;
+            select_ranks(slotstart[s+1] - slotstart[s], cand + slotstart[s],
+                         jto - jfrom, localk + jfrom, values + jfrom, depth+1);
+            jfrom = jto;
+        }
+    }
+
+    g_free(cand);
+    g_free(offsets);
+    g_free(slotofbin);
+    g_free(slotstart);
+    g_free(slotbin);
+    g_free(localk);
+    g_free(bins);
+    g_free(counts);
+    g_free(tnan);
+    g_free(tmax);
+    g_free(tmin);
+}
+
+static inline guint
+value_class(gdouble x, const gdouble *u, guint m)
+{
+    guint lo = 0, hi = m, mid;
+
+    if (gwy_isnan(x))
+        return 2*m + 1;
+
+    /* Find the number of values in u[] smaller than x. */
+    while (lo < hi) {
+        mid = (lo + hi)/2;
+        if (u[mid] < x)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+    return (lo < m && u[lo] == x) ? 2*lo + 1 : 2*lo;
+}
+
+/* Rearranges @array to satisfy the gwy_math_kth_ranks() guarantees, given the (sorted) values with requested ranks.
+ * Elements are split to classes: smaller than the first value, equal to the first value, between the first and
+ * second, etc., with NaNs forming the last class.  Each requested rank then falls into the block of values equal to
+ * its value. */
+static void
+partition_by_values(gsize n, gdouble *array, guint nk, const gdouble *values)
+{
+    guint nthreads = gwy_omp_max_threads();
+    gdouble *u, *buffer;
+    gsize *counts;
+    guint j, m = 0, ncls;
+
+    u = g_new(gdouble, nk);
+    for (j = 0; j < nk; j++) {
+        if (gwy_isnan(values[j]))
+            break;
+        if (!m || values[j] != u[m-1])
+            u[m++] = values[j];
+    }
+    ncls = 2*m + 2;
+    counts = g_new0(gsize, nthreads*ncls);
+    buffer = g_new(gdouble, n);
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(n,array,u,m,ncls,nthreads,counts,buffer)
+#endif
+    {
+        gsize ifrom = gwy_omp_chunk_start(n), ito = gwy_omp_chunk_end(n), i;
+        gsize *tcounts = counts + gwy_omp_thread_num()*ncls;
+
+        for (i = ifrom; i < ito; i++)
+            tcounts[value_class(array[i], u, m)]++;
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            gsize pos = 0, c;
+            guint cls, tt;
+
+            for (cls = 0; cls < ncls; cls++) {
+                for (tt = 0; tt < nthreads; tt++) {
+                    c = counts[tt*ncls + cls];
+                    counts[tt*ncls + cls] = pos;
+                    pos += c;
+                }
+            }
+        }
+
+        for (i = ifrom; i < ito; i++)
+            buffer[tcounts[value_class(array[i], u, m)]++] = array[i];
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+        gwy_assign(array + ifrom, buffer + ifrom, ito - ifrom);
+    }
+
+    g_free(buffer);
+    g_free(counts);
+    g_free(u);
+}
+
+/* Parallel version of kth_ranks_recurse().  We assume k[] is uniq-sorted. */
+static void
+kth_ranks_parallel(gsize n, gdouble *array,
+                   guint nk, const guint *k, gdouble *values)
+{
+    guint *kcopy = g_new(guint, nk);
+
+    gwy_assign(kcopy, k, nk);
+    select_ranks(n, array, nk, kcopy, values, 0);
+    partition_by_values(n, array, nk, values);
+    g_free(kcopy);
+}
+
 /**
  * gwy_math_kth_ranks:
  * @n: Number of items in @array.
@@ -1126,6 +1460,8 @@ kth_ranks_fastpath(gsize n, gdouble *array,
  * simultaneously.  All values with explicitly requested ranks are at their correct positions and all values lying
  * between them in the array are also between them numerically.
  *
+ * Large arrays are processed using parallel bucket selection when threads are enabled.
+ *
  * Since: 2.50
  **/
 void
@@ -1136,25 +1472,32 @@ gwy_math_kth_ranks(gsize n, gdouble *array,
     gdouble logn;
     guint *ksorted;
     gdouble *valsorted;
+    gboolean parallel;
 
     for (j = 0; j < nk; j++) {
         g_return_if_fail(k[j] < n);
     }
 
-    if (nk <= 2) {
-        kth_ranks_fastpath(n, array, nk, k, values);
-        return;
-    }
-    if (n < 30) {
-        kth_ranks_brute(n, array, nk, k, values);
-        return;
-    }
+    /* The parallel selection takes the same time for any reasonable number of ranks, so do not bother with special
+     * cases. */
+    if (!(parallel = select_in_parallel(n))) {
+        if (nk <= 2) {
+            kth_ranks_fastpath(n, array, nk, k, values);
+            return;
+        }
+        if (n < 30) {
+            kth_ranks_brute(n, array, nk, k, values);
+            return;
+        }
 
-    logn = log(n);
-    if (nk > 0.12*exp(0.3*logn)*logn*logn) {
-        kth_ranks_brute(n, array, nk, k, values);
-        return;
+        logn = log(n);
+        if (nk > 0.12*exp(0.3*logn)*logn*logn) {
+            kth_ranks_brute(n, array, nk, k, values);
+            return;
+        }
     }
+    if (!nk)
+        return;
 
     if (nk <= 64) {
         ksorted = g_newa(guint, nk);
@@ -1177,7 +1520,10 @@ gwy_math_kth_ranks(gsize n, gdouble *array,
     }
     nkred = t+1;
     /* The recursion can be at most log2(nkred) deep. */
-    kth_ranks_recurse(n, array, nkred, ksorted, valsorted);
+    if (parallel)
+        kth_ranks_parallel(n, array, nkred, ksorted, valsorted);
+    else
+        kth_ranks_recurse(n, array, nkred, ksorted, valsorted);
     /* Assign the values to the original array. */
     for (j = 0; j < nk; j++)
         values[j] = valsorted[bisect_lower_guint(ksorted, nkred, k[j])];
@@ -2247,6 +2593,122 @@ gwy_canonicalize_angle(gdouble phi, gboolean positive, gboolean oriented)
     return phi;
 }
 
+/* Maps doubles to unsigned integers with the same ordering.  All NaNs become the largest possible key. */
+static inline guint64
+double_to_sort_key(gdouble x)
+{
+    guint64 u;
+
+    if (G_UNLIKELY(gwy_isnan(x)))
+        return G_MAXUINT64;
+
+    memcpy(&u, &x, sizeof(guint64));
+    return (u & G_GUINT64_CONSTANT(0x8000000000000000)) ? ~u : u ^ G_GUINT64_CONSTANT(0x8000000000000000);
+}
+
+static inline gdouble
+sort_key_to_double(guint64 u)
+{
+    gdouble x;
+
+    u = (u & G_GUINT64_CONSTANT(0x8000000000000000)) ? u ^ G_GUINT64_CONSTANT(0x8000000000000000) : ~u;
+    memcpy(&x, &u, sizeof(gdouble));
+    return x;
+}
+
+/* LSD radix sort of the IEEE 754 bit patterns.  Each thread histograms and then scatters its own contiguous block so
+ * the sort is stable and the result does not depend on the number of threads.  Passes where all keys have the same
+ * digit are skipped; for typical data this is the case for several of the highest digits. */
+static void
+radix_sort(gsize n, gdouble *array, guint *index_array)
+{
+    guint nthreads = gwy_omp_max_threads();
+    guint64 *keys, *tkeys;
+    guint *tindex = NULL;
+    gsize *counts;
+    gboolean trivial = FALSE;
+
+    keys = g_new(guint64, n);
+    tkeys = g_new(guint64, n);
+    if (index_array)
+        tindex = g_new(guint, n);
+    counts = g_new(gsize, nthreads*RADIX_BINS);
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(n,array,index_array,keys,tkeys,tindex,counts,nthreads,trivial)
+#endif
+    {
+        gsize ifrom = gwy_omp_chunk_start(n), ito = gwy_omp_chunk_end(n), i;
+        gsize *tcounts = counts + gwy_omp_thread_num()*RADIX_BINS;
+        guint64 *src = keys, *dst = tkeys;
+        guint *isrc = index_array, *idst = tindex;
+        guint pass, shift;
+
+        for (i = ifrom; i < ito; i++)
+            keys[i] = double_to_sort_key(array[i]);
+
+        for (pass = 0; pass < RADIX_PASSES; pass++) {
+            shift = pass*RADIX_BITS;
+            gwy_clear(tcounts, RADIX_BINS);
+            for (i = ifrom; i < ito; i++)
+                tcounts[(src[i] >> shift) & (RADIX_BINS-1)]++;
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+            {
+                guint nt = gwy_omp_num_threads(), d, tt;
+                gsize pos = 0, c, start;
+
+                trivial = FALSE;
+                for (d = 0; d < RADIX_BINS; d++) {
+                    start = pos;
+                    for (tt = 0; tt < nt; tt++) {
+                        c = counts[tt*RADIX_BINS + d];
+                        counts[tt*RADIX_BINS + d] = pos;
+                        pos += c;
+                    }
+                    if (pos - start == n)
+                        trivial = TRUE;
+                }
+            }
+
+            if (trivial)
+                continue;
+
+            if (isrc) {
+                for (i = ifrom; i < ito; i++) {
+                    gsize j = tcounts[(src[i] >> shift) & (RADIX_BINS-1)]++;
+                    dst[j] = src[i];
+                    idst[j] = isrc[i];
+                }
+                GWY_SWAP(guint*, isrc, idst);
+            }
+            else {
+                for (i = ifrom; i < ito; i++)
+                    dst[tcounts[(src[i] >> shift) & (RADIX_BINS-1)]++] = src[i];
+            }
+            GWY_SWAP(guint64*, src, dst);
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+        }
+
+        for (i = ifrom; i < ito; i++)
+            array[i] = sort_key_to_double(src[i]);
+        if (isrc && isrc != index_array)
+            gwy_assign(index_array + ifrom, isrc + ifrom, ito - ifrom);
+    }
+
+    g_free(counts);
+    g_free(tindex);
+    g_free(tkeys);
+    g_free(keys);
+}
+
 /* Copyright (C) 1991, 1992, 1996, 1997, 1999 Free Software Foundation, Inc.
    This file is part of the GNU C Library.
    Written by Douglas C. Schmidt (schmidt@ics.uci.edu).
@@ -2300,6 +2762,9 @@ gwy_canonicalize_angle(gdouble phi, gboolean positive, gboolean oriented)
  * Sorts an array of doubles using a quicksort algorithm.
  *
  * This is usually about twice as fast as the generic quicksort function thanks to specialization for doubles.
+ *
+ * Large arrays are sorted using a radix sort, in parallel if threads are enabled.  It places NaNs after all other
+ * values.  For small arrays the result is undefined if they contain NaNs.
  **/
 void
 gwy_math_sort(gsize n, gdouble *array)
@@ -2326,6 +2791,11 @@ gwy_math_sort(gsize n, gdouble *array)
         /* Avoid lossage with unsigned arithmetic below.  */
         return;
 
+    if (n >= RADIX_SORT_MIN) {
+        radix_sort(n, array, NULL);
+        return;
+    }
+
     if (n > MAX_THRESH) {
         gdouble *lo = array;
         gdouble *hi = lo + (n - 1);
@@ -2637,6 +3107,9 @@ gwy_guint_sort(gsize n, guint *array)
  * gwy_math_sort().  After sorting, @index_array[@i] then contains the original position of the @i-th item of the
  * sorted array.
  *
+ * Large arrays are sorted using a radix sort, in parallel if threads are enabled.  It is stable, i.e. equal values
+ * keep their relative order, and places NaNs after all other values.
+ *
  * Since: 2.50
  **/
 /* FIXME: It is questionable whether it is still more efficient to use pointers instead of array indices when it
@@ -2662,6 +3135,11 @@ gwy_math_sort_with_index(gsize n, gdouble *array, guint *index_array)
         /* Avoid lossage with unsigned arithmetic below.  */
         return;
 
+    if (n >= RADIX_SORT_MIN) {
+        radix_sort(n, array, index_array);
+        return;
+    }
+
     if (n > MAX_THRESH) {
         gdouble *lo = array;
         gdouble *hi = lo + (n - 1);
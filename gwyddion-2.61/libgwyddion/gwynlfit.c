@@ -398,7 +398,7 @@ gwy_math_nlfit_fit_real(GwyNLFitter *nlfit,
     guint covar_size;
     guint i, j;
     guint n_var_param;
-    guint nthreads = gwy_omp_max_threads();
+    guint nthreads;
     guint miter = 0;
     gint unimproved = 0;
     gboolean end = FALSE;
@@ -406,6 +406,11 @@ gwy_math_nlfit_fit_real(GwyNLFitter *nlfit,
     g_return_val_if_fail(nlfit, -1.0);
     g_return_val_if_fail(param || !nparam, -1.0); /* handle zero nparam later */
 
+    /* When called from an already running parallel region, for instance by
+     * gwy_nlfit_preset_fit_batch(), the J'J computation below cannot spawn
+     * more threads and runs just in thread 0. */
+    nthreads = (gwy_omp_num_threads() > 1) ? 1 : gwy_omp_max_threads();
+
     priv = find_private_data(nlfit, TRUE);
     set_fraction = priv->set_fraction;
     set_message = priv->set_message;
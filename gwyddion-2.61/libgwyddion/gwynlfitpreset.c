@@ -26,8 +26,13 @@
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwydebugobjects.h>
 #include <libgwyddion/gwynlfitpreset.h>
+#include <libgwyddion/gwythreads.h>
+#include "libgwyddion/gwyomp.h"
 #include "gwyddioninternal.h"
 
+/* Number of consecutive curves a thread takes at once in batch fitting. */
+enum { FIT_BATCH_CHUNK = 16 };
+
 static GwyNLFitPreset*
 gwy_nlfit_preset_new_static(const GwyNLFitPresetBuiltin *data);
 
@@ -2298,6 +2303,188 @@ gwy_nlfit_preset_fit(GwyNLFitPreset *preset,
     return fitter;
 }
 
+/**
+ * gwy_nlfit_preset_fit_batch:
+ * @preset: A NL fitter function preset.
+ * @ncurves: Number of curves to fit.
+ * @n_dat: The number of data points in each curve if @offsets is %NULL.
+ *         Ignored otherwise.
+ * @offsets: Array of @ncurves+1 indices to @x and @y where individual curves
+ *           start; the last item is the total number of points.  Pass %NULL
+ *           if all curves have @n_dat points and share the abscissa.
+ * @x: Abscissa points.  Either @n_dat points common to all curves (when
+ *     @offsets is %NULL), or all curves one after another.
+ * @y: Ordinate points of all curves one after another.
+ * @params: Array of @ncurves times the number of preset parameters.  On input
+ *          it contains initial parameter estimates for each curve, on output
+ *          it is filled with the fitted parameters.
+ * @err: Array of the same size as @params to store parameter errors to, may
+ *       be %NULL.  Errors of curves where they are not known are set to zero.
+ * @fixed_param: Which parameters should be treated as fixed (set
+ *               corresponding element to %TRUE for them).  May be %NULL if
+ *               all parameters are variable.
+ * @propagate: %TRUE to start the fit of each curve from the result of the
+ *             preceding curve, if that fit succeeded.  %FALSE to always use
+ *             the initial estimates from @params.
+ * @dispersion: Array of length @ncurves to store the residual dispersion
+ *              (reduced chi-square) of each fit to, may be %NULL.  Failed
+ *              fits have -1.
+ * @fitok: Array of length @ncurves to store whether each fit succeeded, may
+ *         be %NULL.
+ * @set_fraction: Function that sets fraction to output (or %NULL).
+ *
+ * Performs nonlinear fits of many independent curves with a preset.
+ *
+ * This is the same as calling gwy_nlfit_preset_fit() for each curve in turn.
+ * However, the curves are fitted in parallel and fitters and other work
+ * buffers are reused.  Each thread takes a few consecutive curves at a time
+ * and picks another batch when it is done, so that curves converging slowly
+ * do not make other threads idle.
+ *
+ * When @propagate is %TRUE the parameters are propagated only among the
+ * consecutive curves a thread takes at once; the first curve in each batch
+ * always starts from @params.  This makes the results independent on the
+ * number of threads.  Fixed parameters are never propagated, so they can
+ * differ between curves.  When the curves are pixels of an image in the usual
+ * order, each fit thus usually starts from the result of the left neighbour.
+ *
+ * Returns: %TRUE if all curves were processed, %FALSE if the fitting was
+ *          cancelled by @set_fraction.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_nlfit_preset_fit_batch(GwyNLFitPreset *preset,
+                           guint ncurves,
+                           guint n_dat,
+                           const guint *offsets,
+                           const gdouble *x,
+                           const gdouble *y,
+                           gdouble *params,
+                           gdouble *err,
+                           const gboolean *fixed_param,
+                           gboolean propagate,
+                           gdouble *dispersion,
+                           gboolean *fitok,
+                           GwySetFractionFunc set_fraction)
+{
+    const GwyNLFitPresetBuiltin *builtin;
+    guint i, nparams, maxn, nchunks, nextchunk = 0, chunksdone = 0;
+    guint *pnextchunk = &nextchunk, *pchunksdone = &chunksdone;
+    gboolean cancelled = FALSE, *pcancelled = &cancelled;
+
+    g_return_val_if_fail(GWY_IS_NLFIT_PRESET(preset), FALSE);
+    g_return_val_if_fail(x && y && params, FALSE);
+    g_return_val_if_fail(offsets || n_dat, FALSE);
+
+    builtin = preset->builtin;
+    nparams = builtin->nparams;
+    if (offsets) {
+        maxn = 0;
+        for (i = 0; i < ncurves; i++)
+            maxn = MAX(maxn, offsets[i+1] - offsets[i]);
+    }
+    else
+        maxn = n_dat;
+
+    if (fitok) {
+        for (i = 0; i < ncurves; i++)
+            fitok[i] = FALSE;
+    }
+    if (dispersion) {
+        for (i = 0; i < ncurves; i++)
+            dispersion[i] = -1.0;
+    }
+    if (set_fraction && !set_fraction(0.0))
+        return FALSE;
+
+    nchunks = (ncurves + FIT_BATCH_CHUNK-1)/FIT_BATCH_CHUNK;
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(preset,builtin,ncurves,n_dat,offsets,x,y,params,err, \
+                   fixed_param,propagate,dispersion,fitok,set_fraction, \
+                   nparams,maxn,nchunks,pnextchunk,pchunksdone,pcancelled)
+#endif
+    {
+        GwyNLFitter *fitter = gwy_nlfit_preset_create_fitter(preset);
+        gdouble *weight = NULL;
+        gdouble *seed = g_new(gdouble, nparams);
+        const gdouble *xk, *yk;
+        gdouble *pk, *ek;
+        guint chunk, k, kto, n, done;
+        gboolean ok, have_seed;
+
+        if (builtin->set_default_weights)
+            weight = g_new(gdouble, maxn);
+
+        while ((chunk = gwy_omp_atomic_increment_uint(pnextchunk)) < nchunks) {
+            kto = MIN((chunk + 1)*FIT_BATCH_CHUNK, ncurves);
+            have_seed = FALSE;
+            for (k = chunk*FIT_BATCH_CHUNK; k < kto; k++) {
+                if (gwy_omp_atomic_read_boolean(pcancelled))
+                    break;
+
+                if (offsets) {
+                    n = offsets[k+1] - offsets[k];
+                    xk = x + offsets[k];
+                    yk = y + offsets[k];
+                }
+                else {
+                    n = n_dat;
+                    xk = x;
+                    yk = y + (gsize)k*n_dat;
+                }
+                pk = params + (gsize)k*nparams;
+                ek = err ? err + (gsize)k*nparams : NULL;
+
+                if (have_seed) {
+                    for (i = 0; i < nparams; i++) {
+                        if (!fixed_param || !fixed_param[i])
+                            pk[i] = seed[i];
+                    }
+                }
+
+                if (weight)
+                    builtin->set_default_weights(n, xk, yk, weight);
+                ok = (gwy_math_nlfit_fit_full(fitter, n, xk, yk, weight,
+                                              nparams, pk, fixed_param, NULL,
+                                              preset) >= 0.0
+                      && gwy_math_nlfit_succeeded(fitter));
+
+                if (ek) {
+                    for (i = 0; i < nparams; i++)
+                        ek[i] = (ok
+                                 ? gwy_math_nlfit_get_sigma(fitter, i)
+                                 : 0.0);
+                }
+                if (dispersion && ok)
+                    dispersion[k] = gwy_math_nlfit_get_dispersion(fitter);
+                if (fitok)
+                    fitok[k] = ok;
+                if (propagate && ok) {
+                    gwy_assign(seed, pk, nparams);
+                    have_seed = TRUE;
+                }
+            }
+
+            done = gwy_omp_atomic_increment_uint(pchunksdone) + 1;
+            if (set_fraction && !gwy_omp_thread_num()
+                && !set_fraction((gdouble)done/nchunks))
+                gwy_omp_atomic_write_boolean(pcancelled, TRUE);
+            if (gwy_omp_atomic_read_boolean(pcancelled))
+                break;
+        }
+
+        gwy_math_nlfit_free(fitter);
+        g_free(weight);
+        g_free(seed);
+    }
+
+    return !cancelled;
+}
+
 /**
  * gwy_nlfit_presets:
  *
@@ -87,6 +87,19 @@ GwyNLFitter*  gwy_nlfit_preset_fit            (GwyNLFitPreset *preset,
                                                gdouble *params,
                                                gdouble *err,
                                                const gboolean *fixed_param);
+gboolean      gwy_nlfit_preset_fit_batch      (GwyNLFitPreset *preset,
+                                               guint ncurves,
+                                               guint n_dat,
+                                               const guint *offsets,
+                                               const gdouble *x,
+                                               const gdouble *y,
+                                               gdouble *params,
+                                               gdouble *err,
+                                               const gboolean *fixed_param,
+                                               gboolean propagate,
+                                               gdouble *dispersion,
+                                               gboolean *fitok,
+                                               GwySetFractionFunc set_fraction);
 GwyInventory* gwy_nlfit_presets               (void);
 
 G_END_DECLS
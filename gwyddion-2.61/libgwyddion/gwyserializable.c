@@ -21,6 +21,7 @@
 
 #include "config.h"
 #include <string.h>
+#include <stdio.h>
 
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwyutils.h>
@@ -28,6 +29,41 @@
 
 #define GWY_SERIALIZABLE_TYPE_NAME "GwySerializable"
 
+enum {
+    /* Flush the stream buffer when it grows over this size. */
+    STREAM_BUFFER_SIZE = 1 << 18,
+    /* Write arrays at least this large directly from the object storage. */
+    STREAM_DIRECT_WRITE_SIZE = 1 << 14,
+    /* Borrow arrays at least this large from mapped files. */
+    BORROW_MIN_SIZE = 1 << 16,
+};
+
+/* State of streaming serialization.  The buffer is a small write buffer
+ * which the serialize() methods append to as usual; we recognise it in
+ * gwy_serialize_pack_object_struct() and gwy_serialize_object_items() and
+ * flush it to the file instead of building the entire representation. */
+typedef struct {
+    FILE *fh;
+    GByteArray *buffer;
+    guint64 base;
+    guint64 flushed;
+    gboolean failed;
+} GwySerializeStream;
+
+/* Mapped file gwy_serializable_deserialize_mapped() is reading from. */
+typedef struct {
+    const guchar *start;
+    gsize size;
+    GMappedFile *mfile;
+    GType type;    /* Type of the innermost object being deserialized. */
+} GwyDeserializeMapping;
+
+/* Array pointing to a mapped file instead of being allocated. */
+typedef struct {
+    GMappedFile *mfile;
+    gsize size;
+} GwyBorrowedArray;
+
 static GByteArray* gwy_serializable_do_serialize   (GObject *serializable,
                                                     GByteArray *buffer);
 static void        gwy_serialize_skip_type         (const guchar *buffer,
@@ -38,7 +74,8 @@ static void        gwy_serializable_base_init      (gpointer g_class);
 static GObject*    gwy_serializable_duplicate_hard_way(GObject *object);
 
 static GByteArray* gwy_serialize_spec              (GByteArray *buffer,
-                                                    const GwySerializeSpec *sp);
+                                                    const GwySerializeSpec *sp,
+                                                    GwySerializeStream *stream);
 static gsize       gwy_serialize_spec_get_size     (const GwySerializeSpec *sp);
 static gboolean    gwy_deserialize_spec_value      (const guchar *buffer,
                                                     gsize size,
@@ -50,6 +87,23 @@ static GwySerializeItem* gwy_deserialize_hash_items(const guchar *buffer,
 
 static inline gsize ctype_size     (guchar ctype);
 
+static void        gwy_serialize_stream_flush      (GwySerializeStream *stream);
+static GType       gwy_deserialize_enter_type      (const guchar *buffer,
+                                                    GType type);
+static gsize*      gwy_serialize_stream_order      (GwySerializeStream *stream,
+                                                    gsize nspec,
+                                                    const GwySerializeSpec *spec);
+static void        gwy_serialize_store_int32       (GByteArray *buffer,
+                                                    gsize position,
+                                                    guint32 value);
+
+G_LOCK_DEFINE_STATIC(serialize_streams);
+static GSList *serialize_streams = NULL;
+
+G_LOCK_DEFINE_STATIC(borrowed_arrays);
+static GSList *deserialize_mappings = NULL;
+static GHashTable *borrowed_arrays = NULL;
+
 GType
 gwy_serializable_get_type(void)
 {
@@ -139,6 +193,62 @@ gwy_serializable_serialize(GObject *serializable,
     return serialize_method(serializable, buffer);
 }
 
+/**
+ * gwy_serializable_serialize_to_file:
+ * @serializable: A #GObject that implements #GwySerializable interface.
+ * @fh: A file open for writing.
+ *
+ * Serializes an object directly to a file.
+ *
+ * The representation is the same as created by gwy_serializable_serialize(),
+ * but it is never held in memory as a whole.  Object sizes are computed
+ * upfront using gwy_serializable_get_size() and data of large arrays are
+ * written directly from the object storage.  Therefore, the memory
+ * requirements do not depend on the size of the serialized data.
+ *
+ * If some object does not report its size exactly the size is corrected
+ * afterwards, which requires @fh to be seekable.
+ *
+ * The written data may remain buffered in @fh.  The caller needs to close
+ * or flush @fh and check for errors.
+ *
+ * Returns: %TRUE on success, %FALSE if writing failed.  In the latter case
+ *          errno is set accordingly.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_serializable_serialize_to_file(GObject *serializable,
+                                   FILE *fh)
+{
+    GwySerializeStream stream;
+
+    g_return_val_if_fail(serializable, FALSE);
+    g_return_val_if_fail(GWY_IS_SERIALIZABLE(serializable), FALSE);
+    g_return_val_if_fail(fh, FALSE);
+
+    stream.fh = fh;
+    stream.buffer = g_byte_array_sized_new(STREAM_BUFFER_SIZE);
+    stream.base = MAX(ftell(fh), 0);
+    stream.flushed = 0;
+    stream.failed = FALSE;
+
+    G_LOCK(serialize_streams);
+    serialize_streams = g_slist_prepend(serialize_streams, &stream);
+    G_UNLOCK(serialize_streams);
+
+    gwy_serializable_do_serialize(serializable, stream.buffer);
+    gwy_serialize_stream_flush(&stream);
+
+    G_LOCK(serialize_streams);
+    serialize_streams = g_slist_remove(serialize_streams, &stream);
+    G_UNLOCK(serialize_streams);
+
+    g_byte_array_free(stream.buffer, TRUE);
+
+    return !stream.failed;
+}
+
 /**
  * gwy_serializable_get_size:
  * @serializable: A #GObject that implements #GwySerializable interface.
@@ -195,7 +305,7 @@ gwy_serializable_deserialize(const guchar *buffer,
         "This can fail if the class uses some very unusual "
         "serialization practices or we've got out of sync.";
 
-    GType type;
+    GType type, oldtype;
     GwyDeserializeFunc deserialize_method;
     GObject *object;
     gsize typenamesize, oldposition;
@@ -251,7 +361,9 @@ gwy_serializable_deserialize(const guchar *buffer,
         return NULL;
     }
     oldposition = *position;
+    oldtype = gwy_deserialize_enter_type(buffer, type);
     object = deserialize_method(buffer, size, position);
+    gwy_deserialize_enter_type(buffer, oldtype);
     if (object)
         g_type_class_unref(G_OBJECT_GET_CLASS(object));
     else {
@@ -267,6 +379,63 @@ gwy_serializable_deserialize(const guchar *buffer,
     return object;
 }
 
+/**
+ * gwy_serializable_deserialize_mapped:
+ * @mfile: A mapped file containing the object representation.  It must be
+ *         mapped writable (which means copy-on-write in #GMappedFile).
+ * @position: The position of the object in @mfile contents, it's updated to
+ *            point after it.
+ *
+ * Restores a serialized object from a mapped file, avoiding copying of large
+ * arrays.
+ *
+ * This is the same as gwy_serializable_deserialize() except that large
+ * floating point arrays, such as data of #GwyDataField or #GwyBrick, are not
+ * copied to newly allocated memory if their alignment permits it.  Instead,
+ * they point directly to the mapped file contents and are paged in only when
+ * accessed.  Any modification only affects private copies of the modified
+ * pages.  The objects hold a reference to @mfile, so the caller can release
+ * its own reference once the deserialization is done.
+ *
+ * The file must not be truncated or overwritten in place while such objects
+ * exist.
+ *
+ * Classes whose data can be borrowed this way must free and reallocate the
+ * arrays using gwy_serialize_free_array() and gwy_serialize_realloc_array().
+ *
+ * Returns: A newly created object.
+ *
+ * Since: 2.62
+ **/
+GObject*
+gwy_serializable_deserialize_mapped(GMappedFile *mfile,
+                                    gsize *position)
+{
+    GwyDeserializeMapping mapping;
+    GObject *object;
+
+    g_return_val_if_fail(mfile, NULL);
+    g_return_val_if_fail(position, NULL);
+
+    mapping.start = (const guchar*)g_mapped_file_get_contents(mfile);
+    mapping.size = g_mapped_file_get_length(mfile);
+    mapping.mfile = mfile;
+    mapping.type = 0;
+    g_return_val_if_fail(mapping.start, NULL);
+
+    G_LOCK(borrowed_arrays);
+    deserialize_mappings = g_slist_prepend(deserialize_mappings, &mapping);
+    G_UNLOCK(borrowed_arrays);
+
+    object = gwy_serializable_deserialize(mapping.start, mapping.size, position);
+
+    G_LOCK(borrowed_arrays);
+    deserialize_mappings = g_slist_remove(deserialize_mappings, &mapping);
+    G_UNLOCK(borrowed_arrays);
+
+    return object;
+}
+
 /**
  * gwy_serializable_duplicate:
  * @object: An object implementing #GwySerializable interface.
@@ -472,6 +641,201 @@ ctype_size(guchar ctype)
     }
 }
 
+/****************************************************************************
+ *
+ * Streaming
+ *
+ ****************************************************************************/
+
+static GwySerializeStream*
+gwy_serialize_find_stream(GByteArray *buffer)
+{
+    GwySerializeStream *stream = NULL;
+    GSList *l;
+
+    if (!buffer)
+        return NULL;
+
+    G_LOCK(serialize_streams);
+    for (l = serialize_streams; l; l = g_slist_next(l)) {
+        if (((GwySerializeStream*)l->data)->buffer == buffer) {
+            stream = (GwySerializeStream*)l->data;
+            break;
+        }
+    }
+    G_UNLOCK(serialize_streams);
+
+    return stream;
+}
+
+/* Position in the serialized data, counted from the beginning. */
+static inline guint64
+gwy_serialize_stream_position(const GwySerializeStream *stream)
+{
+    return stream->flushed + stream->buffer->len;
+}
+
+static void
+gwy_serialize_stream_write(GwySerializeStream *stream,
+                           const guint8 *data,
+                           gsize len)
+{
+    if (!len || stream->failed)
+        return;
+
+    if (fwrite(data, 1, len, stream->fh) != len)
+        stream->failed = TRUE;
+}
+
+static void
+gwy_serialize_stream_flush(GwySerializeStream *stream)
+{
+    gwy_serialize_stream_write(stream, stream->buffer->data, stream->buffer->len);
+    stream->flushed += stream->buffer->len;
+    g_byte_array_set_size(stream->buffer, 0);
+}
+
+static inline void
+gwy_serialize_stream_check_flush(GwySerializeStream *stream)
+{
+    if (stream->buffer->len >= STREAM_BUFFER_SIZE)
+        gwy_serialize_stream_flush(stream);
+}
+
+/* Write raw array data, bypassing the buffer. */
+static void
+gwy_serialize_stream_write_direct(GwySerializeStream *stream,
+                                  const guint8 *data,
+                                  gsize len)
+{
+    gwy_serialize_stream_flush(stream);
+    gwy_serialize_stream_write(stream, data, len);
+    stream->flushed += len;
+}
+
+/* Choose the order of components so that data of the largest floating point
+ * array are aligned in the file, which permits using them directly when the
+ * file is mapped, see gwy_serializable_deserialize_mapped().  The components
+ * preceding the array are chosen as a subset with the right total size modulo
+ * sizeof(gdouble).  Deserialization does not depend on the order.  Returns
+ * %NULL when the order should be kept. */
+static gsize*
+gwy_serialize_stream_order(GwySerializeStream *stream,
+                           gsize nspec,
+                           const GwySerializeSpec *spec)
+{
+    enum { A = sizeof(gdouble) };
+    gsize i, k, r, big = G_MAXSIZE, bigsize = 0, n = 0;
+    gsize *sizes, *order;
+    guchar *reachable;
+
+    /* Find the array. */
+    for (i = 0; i < nspec; i++) {
+        if (spec[i].ctype == 'D' && spec[i].value && *(gpointer*)spec[i].value
+            && *spec[i].array_size*sizeof(gdouble) > bigsize) {
+            big = i;
+            bigsize = *spec[i].array_size*sizeof(gdouble);
+        }
+    }
+    if (bigsize < BORROW_MIN_SIZE)
+        return NULL;
+
+    /* Subset sums modulo A.  reachable[k*A + r] is nonzero if we can get
+     * remainder r using components 0..k-1, and then it is 1 + the previous
+     * remainder if component k-1 is used, or 1 + A if it is not. */
+    sizes = g_new0(gsize, nspec);
+    for (i = 0; i < nspec; i++) {
+        if (i == big || !spec[i].value)
+            continue;
+        if (spec[i].ctype == 'o' && !*(GObject**)spec[i].value)
+            continue;
+        if (g_ascii_isupper(spec[i].ctype) && !*spec[i].array_size)
+            continue;
+        sizes[i] = gwy_serialize_spec_get_size(spec + i) % A;
+    }
+    reachable = g_new0(guchar, (nspec + 1)*A);
+    /* Where the array data would start without anything before it. */
+    r = (stream->base + gwy_serialize_stream_position(stream)
+         + strlen(spec[big].name) + 2 + sizeof(guint32)) % A;
+    reachable[r] = 1 + A;
+    for (i = 0; i < nspec; i++) {
+        for (r = 0; r < A; r++) {
+            if (!reachable[i*A + r])
+                continue;
+            if (!reachable[(i + 1)*A + r])
+                reachable[(i + 1)*A + r] = 1 + A;
+            if (i != big && sizes[i] && !reachable[(i + 1)*A + (r + sizes[i]) % A])
+                reachable[(i + 1)*A + (r + sizes[i]) % A] = 1 + r;
+        }
+    }
+    if (!reachable[nspec*A]) {
+        g_free(reachable);
+        g_free(sizes);
+        return NULL;
+    }
+
+    /* Backtrack to mark the components before the array (using sizes[] as
+     * flags), then put them first. */
+    r = 0;
+    for (i = nspec; i; i--) {
+        k = reachable[i*A + r];
+        if (k == 1 + A)
+            sizes[i-1] = FALSE;
+        else {
+            sizes[i-1] = TRUE;
+            r = k - 1;
+        }
+    }
+    order = g_new(gsize, nspec);
+    for (i = 0; i < nspec; i++) {
+        if (sizes[i])
+            order[n++] = i;
+    }
+    order[n++] = big;
+    for (i = 0; i < nspec; i++) {
+        if (!sizes[i] && i != big)
+            order[n++] = i;
+    }
+    g_free(reachable);
+    g_free(sizes);
+
+    return order;
+}
+
+/* Finish an object whose header containing the expected body size was stored
+ * at @sizepos.  Normally the expected size is exact and there is nothing to
+ * do.  Otherwise fix the size, seeking back if it has already been written. */
+static void
+gwy_serialize_stream_finish_object(GwySerializeStream *stream,
+                                   guint64 sizepos,
+                                   gsize expected_size)
+{
+    guint64 size = gwy_serialize_stream_position(stream) - (sizepos + sizeof(guint32));
+    guint32 value;
+    glong offset;
+
+    if (size == expected_size)
+        return;
+
+    gwy_debug("size of object mismatch (%" G_GUINT64_FORMAT " != %" G_GSIZE_FORMAT ")", size, expected_size);
+    if (sizepos >= stream->flushed) {
+        gwy_serialize_store_int32(stream->buffer, sizepos - stream->flushed, size);
+        return;
+    }
+
+    gwy_serialize_stream_flush(stream);
+    if (stream->failed)
+        return;
+
+    value = GUINT32_TO_LE((guint32)size);
+    offset = stream->flushed - sizepos;
+    if ((guint64)offset != stream->flushed - sizepos
+        || fseek(stream->fh, -offset, SEEK_CUR) != 0
+        || fwrite(&value, 1, sizeof(guint32), stream->fh) != sizeof(guint32)
+        || fseek(stream->fh, offset - (glong)sizeof(guint32), SEEK_CUR) != 0)
+        stream->failed = TRUE;
+}
+
 /****************************************************************************
  *
  * Serialization
@@ -592,16 +956,28 @@ gwy_serialize_pack_object_struct(GByteArray *buffer,
                                  gsize nspec,
                                  const GwySerializeSpec *spec)
 {
-    gsize before_obj, i;
+    GwySerializeStream *stream;
+    gsize before_obj, i, k, expected_size = 0;
+    guint64 sizepos = 0;
+    gsize *order;
 
     g_return_val_if_fail(spec || !nspec, buffer);
     g_return_val_if_fail(object_name && *object_name, buffer);
     gwy_debug("init size: %u, buffer = %p", buffer ? buffer->len : 0, buffer);
 
+    stream = gwy_serialize_find_stream(buffer);
     buffer = gwy_serialize_pack_object_header(buffer, object_name);
     before_obj = buffer->len;
+    if (stream) {
+        expected_size = (gwy_serialize_get_struct_size(object_name, nspec, spec)
+                         - (strlen(object_name) + 1 + sizeof(guint32)));
+        gwy_serialize_store_int32(buffer, before_obj - sizeof(guint32), expected_size);
+        sizepos = gwy_serialize_stream_position(stream) - sizeof(guint32);
+    }
     gwy_debug("+head size: %u", buffer->len);
-    for (i = 0; i < nspec; i++) {
+    order = stream ? gwy_serialize_stream_order(stream, nspec, spec) : NULL;
+    for (k = 0; k < nspec; k++) {
+        i = order ? order[k] : k;
         if (!spec[i].value) {
             gwy_debug("ignoring item `%s' with NULL value", spec[i].name);
             continue;
@@ -613,11 +989,16 @@ gwy_serialize_pack_object_struct(GByteArray *buffer,
                 continue;
             }
         }
-        gwy_serialize_spec(buffer, spec + i);
+        gwy_serialize_spec(buffer, spec + i, stream);
     }
+    g_free(order);
     gwy_debug("+body size: %u", buffer->len);
-    gwy_serialize_store_int32(buffer, before_obj - sizeof(guint32),
-                              buffer->len - before_obj);
+    if (stream)
+        gwy_serialize_stream_finish_object(stream, sizepos, expected_size);
+    else {
+        gwy_serialize_store_int32(buffer, before_obj - sizeof(guint32),
+                                  buffer->len - before_obj);
+    }
     return buffer;
 }
 
@@ -643,15 +1024,24 @@ gwy_serialize_object_items(GByteArray *buffer,
                            gsize nitems,
                            const GwySerializeItem *items)
 {
+    GwySerializeStream *stream;
     GwySerializeSpec sp;
-    gsize before_obj, i;
+    gsize before_obj, i, expected_size = 0;
+    guint64 sizepos = 0;
 
     g_return_val_if_fail(items || !nitems, buffer);
     g_return_val_if_fail(object_name && *object_name, buffer);
     gwy_debug("init size: %u, buffer = %p", buffer ? buffer->len : 0, buffer);
 
+    stream = gwy_serialize_find_stream(buffer);
     buffer = gwy_serialize_pack_object_header(buffer, object_name);
     before_obj = buffer->len;
+    if (stream) {
+        expected_size = (gwy_serialize_get_items_size(object_name, nitems, items)
+                         - (strlen(object_name) + 1 + sizeof(guint32)));
+        gwy_serialize_store_int32(buffer, before_obj - sizeof(guint32), expected_size);
+        sizepos = gwy_serialize_stream_position(stream) - sizeof(guint32);
+    }
     gwy_debug("+head size: %u", buffer->len);
 
     for (i = 0; i < nitems; i++) {
@@ -663,19 +1053,24 @@ gwy_serialize_object_items(GByteArray *buffer,
             gwy_debug("ignoring NULL object item `%s'", sp.name);
             continue;
         }
-        gwy_serialize_spec(buffer, &sp);
+        gwy_serialize_spec(buffer, &sp, stream);
     }
 
     gwy_debug("+body size: %u", buffer->len);
-    gwy_serialize_store_int32(buffer, before_obj - sizeof(guint32),
-                              buffer->len - before_obj);
+    if (stream)
+        gwy_serialize_stream_finish_object(stream, sizepos, expected_size);
+    else {
+        gwy_serialize_store_int32(buffer, before_obj - sizeof(guint32),
+                                  buffer->len - before_obj);
+    }
 
     return buffer;
 }
 
 static GByteArray*
 gwy_serialize_spec(GByteArray *buffer,
-                   const GwySerializeSpec *sp)
+                   const GwySerializeSpec *sp,
+                   GwySerializeStream *stream)
 {
     guint32 asize = 0, leasize;
     gsize j;
@@ -697,6 +1092,23 @@ gwy_serialize_spec(GByteArray *buffer,
     g_byte_array_append(buffer, sp->name, strlen(sp->name) + 1);
     g_byte_array_append(buffer, &sp->ctype, 1);
     gwy_debug("<%s> <%c> %u", sp->name, sp->ctype, buffer->len);
+
+    /* When streaming, write large arrays directly if they need no byte
+     * swapping. */
+    if (stream && asize) {
+        gsize s = ctype_size(g_ascii_tolower(sp->ctype));
+
+#if (G_BYTE_ORDER != G_LITTLE_ENDIAN)
+        if (s > 1)
+            s = 0;
+#endif
+        if (s && asize*s >= STREAM_DIRECT_WRITE_SIZE) {
+            g_byte_array_append(buffer, (guint8*)&leasize, sizeof(gint32));
+            gwy_serialize_stream_write_direct(stream, arr, asize*s);
+            return buffer;
+        }
+    }
+
     switch (sp->ctype) {
         case 'b': {
             /* store it as char */
@@ -837,6 +1249,9 @@ gwy_serialize_spec(GByteArray *buffer,
     }
 
     gwy_debug("after: %u", buffer->len);
+    if (stream)
+        gwy_serialize_stream_check_flush(stream);
+
     return buffer;
 }
 
@@ -1015,6 +1430,186 @@ gwy_serialize_spec_get_size(const GwySerializeSpec *sp)
     return size;
 }
 
+/****************************************************************************
+ *
+ * Borrowed arrays
+ *
+ ****************************************************************************/
+
+static GQuark
+gwy_serialize_borrowing_quark(void)
+{
+    static GQuark quark = 0;
+
+    if (G_UNLIKELY(!quark))
+        quark = g_quark_from_static_string("gwy-serializable-borrows-arrays");
+    return quark;
+}
+
+/**
+ * gwy_serialize_enable_borrowing:
+ * @type: A serializable object type.
+ *
+ * Declares that a class can deal with borrowed arrays.
+ *
+ * Large floating point arrays in objects of type @type can then point
+ * directly to the mapped file when deserialized with
+ * gwy_serializable_deserialize_mapped().  The class must free and reallocate
+ * all deserialized arrays using gwy_serialize_free_array() and
+ * gwy_serialize_realloc_array().
+ *
+ * Since: 2.62
+ **/
+void
+gwy_serialize_enable_borrowing(GType type)
+{
+    g_return_if_fail(g_type_is_a(type, GWY_TYPE_SERIALIZABLE));
+    g_type_set_qdata(type, gwy_serialize_borrowing_quark(), GUINT_TO_POINTER(TRUE));
+}
+
+/* Must be called with borrowed_arrays lock held. */
+static GwyDeserializeMapping*
+gwy_deserialize_find_mapping(const guchar *data, gsize size)
+{
+    GwyDeserializeMapping *mapping;
+    GSList *l;
+
+    for (l = deserialize_mappings; l; l = g_slist_next(l)) {
+        mapping = (GwyDeserializeMapping*)l->data;
+        if (data >= mapping->start && data + size <= mapping->start + mapping->size)
+            return mapping;
+    }
+    return NULL;
+}
+
+/* Set the type of object being deserialized from @buffer, returning the
+ * previous one. */
+static GType
+gwy_deserialize_enter_type(const guchar *buffer, GType type)
+{
+    GwyDeserializeMapping *mapping;
+    GType oldtype = 0;
+
+    G_LOCK(borrowed_arrays);
+    if (deserialize_mappings && (mapping = gwy_deserialize_find_mapping(buffer, 0))) {
+        oldtype = mapping->type;
+        mapping->type = type;
+    }
+    G_UNLOCK(borrowed_arrays);
+
+    return oldtype;
+}
+
+/* Try to use array data directly from a mapped file we are deserializing.
+ * Returns %NULL if it is not possible. */
+static gpointer
+gwy_deserialize_borrow_array(const guchar *data, gsize size)
+{
+    GwyDeserializeMapping *mapping;
+    GwyBorrowedArray *barray;
+
+    if (size < BORROW_MIN_SIZE || (guintptr)data % sizeof(gdouble))
+        return NULL;
+
+    G_LOCK(borrowed_arrays);
+    if (!deserialize_mappings
+        || !(mapping = gwy_deserialize_find_mapping(data, size))
+        || !mapping->type
+        || !g_type_get_qdata(mapping->type, gwy_serialize_borrowing_quark())) {
+        G_UNLOCK(borrowed_arrays);
+        return NULL;
+    }
+
+    if (!borrowed_arrays)
+        borrowed_arrays = g_hash_table_new(g_direct_hash, g_direct_equal);
+    barray = g_slice_new(GwyBorrowedArray);
+    barray->mfile = g_mapped_file_ref(mapping->mfile);
+    barray->size = size;
+    g_hash_table_insert(borrowed_arrays, (gpointer)data, barray);
+    G_UNLOCK(borrowed_arrays);
+
+    return (gpointer)data;
+}
+
+/* Forget a borrowed array.  Returns %NULL if @array is not borrowed. */
+static GwyBorrowedArray*
+gwy_serialize_steal_borrowed(gpointer array)
+{
+    GwyBorrowedArray *barray = NULL;
+
+    G_LOCK(borrowed_arrays);
+    if (borrowed_arrays && (barray = g_hash_table_lookup(borrowed_arrays, array)))
+        g_hash_table_remove(borrowed_arrays, array);
+    G_UNLOCK(borrowed_arrays);
+
+    return barray;
+}
+
+static void
+gwy_serialize_release_borrowed(GwyBorrowedArray *barray)
+{
+    g_mapped_file_unref(barray->mfile);
+    g_slice_free(GwyBorrowedArray, barray);
+}
+
+/**
+ * gwy_serialize_free_array:
+ * @array: An array created by deserialization (or %NULL).
+ *
+ * Frees an array created by deserialization.
+ *
+ * Arrays created by gwy_serializable_deserialize_mapped() can point to the
+ * mapped file.  This function releases the file for such arrays and frees
+ * normally allocated arrays with g_free().
+ *
+ * Since: 2.62
+ **/
+void
+gwy_serialize_free_array(gpointer array)
+{
+    GwyBorrowedArray *barray;
+
+    if (!array)
+        return;
+
+    if ((barray = gwy_serialize_steal_borrowed(array)))
+        gwy_serialize_release_borrowed(barray);
+    else
+        g_free(array);
+}
+
+/**
+ * gwy_serialize_realloc_array:
+ * @array: An array created by deserialization (or %NULL).
+ * @size: New size of the array in bytes.
+ *
+ * Reallocates an array created by deserialization.
+ *
+ * This is the equivalent of g_realloc() for arrays possibly pointing to
+ * mapped files, see gwy_serialize_free_array().  Such arrays are replaced
+ * with normally allocated memory, preserving the contents up to @size.
+ *
+ * Returns: The reallocated array.
+ *
+ * Since: 2.62
+ **/
+gpointer
+gwy_serialize_realloc_array(gpointer array,
+                            gsize size)
+{
+    GwyBorrowedArray *barray;
+    gpointer newarray;
+
+    if (!array || !(barray = gwy_serialize_steal_borrowed(array)))
+        return g_realloc(array, size);
+
+    newarray = g_malloc(size);
+    memcpy(newarray, array, MIN(size, barray->size));
+    gwy_serialize_release_borrowed(barray);
+
+    return newarray;
+}
+
 /****************************************************************************
  *
  * Deserialization
@@ -1743,7 +2338,8 @@ gwy_deserialize_double_array(const guchar *buffer,
     if (newasize > (size - *position)/sizeof(gdouble))
         return NULL;
 #if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-    value = g_memdup(buffer + *position, newasize*sizeof(gdouble));
+    if (!(value = gwy_deserialize_borrow_array(buffer + *position, newasize*sizeof(gdouble))))
+        value = g_memdup(buffer + *position, newasize*sizeof(gdouble));
 #else
     value = g_new(gdouble, newasize*sizeof(gdouble));
     gwy_memcpy_byte_swap(buffer + *position, (guint8*)value,
@@ -22,6 +22,7 @@
 #ifndef __GWY_SERIALIZABLE_H__
 #define __GWY_SERIALIZABLE_H__
 
+#include <stdio.h>
 #include <glib-object.h>
 #include <libgwyddion/gwyddionenums.h>
 
@@ -97,9 +98,13 @@ typedef struct {
 GType       gwy_serializable_get_type           (void) G_GNUC_CONST;
 GByteArray* gwy_serializable_serialize          (GObject *serializable,
                                                  GByteArray *buffer);
+gboolean    gwy_serializable_serialize_to_file  (GObject *serializable,
+                                                 FILE *fh);
 GObject*    gwy_serializable_deserialize        (const guchar *buffer,
                                                  gsize size,
                                                  gsize *position);
+GObject*    gwy_serializable_deserialize_mapped (GMappedFile *mfile,
+                                                 gsize *position);
 GObject*    gwy_serializable_duplicate          (GObject *object);
 void        gwy_serializable_clone              (GObject *source,
                                                  GObject *copy);
@@ -129,6 +134,10 @@ gsize       gwy_serialize_check_string          (const guchar *buffer,
                                                  gsize size,
                                                  gsize position,
                                                  const guchar *compare_to);
+void        gwy_serialize_enable_borrowing      (GType type);
+void        gwy_serialize_free_array            (gpointer array);
+gpointer    gwy_serialize_realloc_array         (gpointer array,
+                                                 gsize size);
 
 GByteArray*       gwy_serialize_object_items    (GByteArray *buffer,
                                                  const guchar *object_name,
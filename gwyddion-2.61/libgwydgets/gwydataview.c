@@ -626,27 +626,31 @@ static void
 gwy_data_view_paint(GwyDataView *data_view)
 {
     GdkPixbuf *apixbuf, *bpixbuf;
+    gint width, height;
 
     gwy_debug(" ");
     g_return_if_fail(GWY_IS_DATA_VIEW_LAYER(data_view->base_layer));
 
     /* Base layer is always present, however pixmap layers may return NULL if
-     * they do not have corresponding data fields */
+     * they do not have corresponding data fields.  They can paint reduced
+     * pixbufs because we scale them to the widget size anyway.  So the mask
+     * is composited at the widget size too. */
+    width = gdk_pixbuf_get_width(data_view->pixbuf);
+    height = gdk_pixbuf_get_height(data_view->pixbuf);
+    gwy_pixmap_layer_set_target_size(data_view->base_layer, width, height);
     bpixbuf = gwy_pixmap_layer_paint(data_view->base_layer);
-    if (data_view->alpha_layer)
+    if (data_view->alpha_layer) {
+        gwy_pixmap_layer_set_target_size(data_view->alpha_layer,
+                                         width, height);
         apixbuf = gwy_pixmap_layer_paint(data_view->alpha_layer);
+    }
     else
         apixbuf = NULL;
 
     if (bpixbuf) {
-        if (apixbuf) {
-            simple_gdk_pixbuf_scale_or_copy(bpixbuf, data_view->base_pixbuf);
-            simple_gdk_pixbuf_composite(apixbuf, data_view->base_pixbuf);
-            simple_gdk_pixbuf_scale_or_copy(data_view->base_pixbuf,
-                                            data_view->pixbuf);
-        }
-        else
-            simple_gdk_pixbuf_scale_or_copy(bpixbuf, data_view->pixbuf);
+        simple_gdk_pixbuf_scale_or_copy(bpixbuf, data_view->pixbuf);
+        if (apixbuf)
+            simple_gdk_pixbuf_composite(apixbuf, data_view->pixbuf);
     }
     else {
         gdk_pixbuf_fill(data_view->pixbuf, 0x00000000);
@@ -1617,7 +1621,9 @@ gwy_data_view_export_pixbuf(GwyDataView *data_view,
     pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, BITS_PER_SAMPLE,
                             width, height);
 
-    /* Pixmap layers */
+    /* Pixmap layers.  The base layer is painted for the export size;
+     * gwy_data_view_paint() sets the screen size again when it is needed. */
+    gwy_pixmap_layer_set_target_size(data_view->base_layer, width, height);
     bpixbuf = gwy_pixmap_layer_paint(data_view->base_layer);
     if (draw_alpha && data_view->alpha_layer)
         apixbuf = gwy_pixmap_layer_paint(data_view->alpha_layer);
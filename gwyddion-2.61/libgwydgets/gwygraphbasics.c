@@ -55,6 +55,22 @@ static const GwyRGBA nice_colors[] = {
 /* FIXME: use Gtk+ theme */
 static const GwyRGBA selection_color = { 0.82, 0.6, 0.75, 1.0 };
 
+/* Level-of-detail cache of a curve model for one particular active area.
+ * Consecutive points falling into the same pixel column are reduced to the
+ * first, last, topmost and bottommost ones (M4 decimation).  The line through
+ * them covers exactly the same pixels as the line through all the points, so
+ * the number of drawn vertices is a small multiple of the area width for
+ * curves with ordered abscissas.  Symbols are kept only once for each pixel
+ * of the area. */
+typedef struct {
+    GwyGraphActiveAreaSpecs specs;
+    gboolean valid;
+    gboolean useless;
+    GArray *points;
+    GArray *segments;
+    GArray *symbols;
+} GwyGraphCurveLOD;
+
 static gint
 x_data_to_pixel(GwyGraphActiveAreaSpecs *specs, gdouble data)
 {
@@ -291,6 +307,183 @@ gwy_graph_draw_curve_segment(const GdkPoint *points,
     }
 }
 
+static void
+curve_lod_free(gpointer p)
+{
+    GwyGraphCurveLOD *lod = (GwyGraphCurveLOD*)p;
+
+    g_array_free(lod->points, TRUE);
+    g_array_free(lod->segments, TRUE);
+    g_array_free(lod->symbols, TRUE);
+    g_free(lod);
+}
+
+static void
+curve_lod_invalidate(G_GNUC_UNUSED GwyGraphCurveModel *gcmodel,
+                     GwyGraphCurveLOD *lod)
+{
+    lod->valid = FALSE;
+}
+
+static gboolean
+specs_equal(const GwyGraphActiveAreaSpecs *a,
+            const GwyGraphActiveAreaSpecs *b)
+{
+    return (a->xmin == b->xmin && a->ymin == b->ymin
+            && a->width == b->width && a->height == b->height
+            && a->real_xmin == b->real_xmin && a->real_ymin == b->real_ymin
+            && a->real_width == b->real_width
+            && a->real_height == b->real_height
+            && !a->log_x == !b->log_x && !a->log_y == !b->log_y);
+}
+
+/* Emits the reduced pixel column group.  The extremes are put in the order
+ * in which they occur in the data. */
+static void
+curve_lod_flush_column(GwyGraphCurveLOD *lod, const GdkPoint *group,
+                       const gint *idx, guint *seglen)
+{
+    guint order[4] = { 0, 1, 2, 3 };
+    gint prev = -1;
+    guint k;
+
+    if (idx[0] < 0)
+        return;
+
+    if (idx[2] < idx[1]) {
+        order[1] = 2;
+        order[2] = 1;
+    }
+    for (k = 0; k < 4; k++) {
+        if (idx[order[k]] > prev) {
+            g_array_append_val(lod->points, group[order[k]]);
+            prev = idx[order[k]];
+            (*seglen)++;
+        }
+    }
+}
+
+static void
+curve_lod_end_segment(GwyGraphCurveLOD *lod, GdkPoint *group, gint *idx,
+                      guint *seglen)
+{
+    curve_lod_flush_column(lod, group, idx, seglen);
+    idx[0] = idx[1] = idx[2] = idx[3] = -1;
+    if (*seglen)
+        g_array_append_val(lod->segments, *seglen);
+    *seglen = 0;
+}
+
+static void
+curve_lod_update(GwyGraphCurveLOD *lod,
+                 GwyGraphActiveAreaSpecs *specs,
+                 GwyGraphCurveModel *gcmodel)
+{
+    /* Group points: first, top, bottom, last. */
+    GdkPoint group[4], pt;
+    gint idx[4] = { -1, -1, -1, -1 };
+    guint seglen = 0;
+    gint i, n = gcmodel->n, width = specs->width, height = specs->height;
+    guint32 *drawn;
+    guint k;
+
+    g_array_set_size(lod->points, 0);
+    g_array_set_size(lod->segments, 0);
+    g_array_set_size(lod->symbols, 0);
+    lod->specs = *specs;
+    lod->valid = TRUE;
+    /* Bitmap of area pixels which already have a symbol. */
+    drawn = g_new0(guint32, (MAX(width, 0)*MAX(height, 0) + 31)/32);
+
+    for (i = 0; i < n; i++) {
+        pt.x = x_data_to_pixel(specs, gcmodel->xdata[i]);
+        pt.y = y_data_to_pixel(specs, gcmodel->ydata[i]);
+        /* Split the line into segments that do not stick out of the area,
+         * exactly as when drawing the points directly. */
+        if (pt.x < -3*specs->width || pt.x > 4*specs->width
+            || pt.y < -3*specs->height || pt.y > 4*specs->height) {
+            curve_lod_end_segment(lod, group, idx, &seglen);
+            continue;
+        }
+
+        /* Drawing the same symbol repeatedly does not change anything.
+         * Symbols outside the area, which can still stick into it, are only
+         * compared to the previous one. */
+        if (pt.x >= specs->xmin && pt.x < specs->xmin + width
+            && pt.y >= specs->ymin && pt.y < specs->ymin + height) {
+            k = (pt.y - specs->ymin)*width + (pt.x - specs->xmin);
+            if (!(drawn[k/32] & (1u << (k % 32)))) {
+                drawn[k/32] |= 1u << (k % 32);
+                g_array_append_val(lod->symbols, pt);
+            }
+        }
+        else if (!lod->symbols->len
+                 || pt.x != g_array_index(lod->symbols, GdkPoint,
+                                          lod->symbols->len-1).x
+                 || pt.y != g_array_index(lod->symbols, GdkPoint,
+                                          lod->symbols->len-1).y)
+            g_array_append_val(lod->symbols, pt);
+
+        if (idx[0] >= 0 && pt.x == group[0].x) {
+            if (pt.y < group[1].y) {
+                group[1] = pt;
+                idx[1] = i;
+            }
+            if (pt.y > group[2].y) {
+                group[2] = pt;
+                idx[2] = i;
+            }
+            group[3] = pt;
+            idx[3] = i;
+        }
+        else {
+            curve_lod_flush_column(lod, group, idx, &seglen);
+            group[0] = group[1] = group[2] = group[3] = pt;
+            idx[0] = idx[1] = idx[2] = idx[3] = i;
+        }
+    }
+    curve_lod_end_segment(lod, group, idx, &seglen);
+    g_free(drawn);
+
+    /* Unordered data can have few points in the same column in a row and
+     * sparse data few points in the same pixel.  Do not keep a copy of the
+     * entire curve around then. */
+    if (lod->points->len > n/2 || lod->symbols->len > n/2) {
+        lod->useless = TRUE;
+        g_array_set_size(lod->points, 0);
+        g_array_set_size(lod->segments, 0);
+        g_array_set_size(lod->symbols, 0);
+    }
+    else
+        lod->useless = FALSE;
+}
+
+static GwyGraphCurveLOD*
+curve_lod_get(GwyGraphActiveAreaSpecs *specs, GwyGraphCurveModel *gcmodel)
+{
+    static GQuark lod_quark = 0;
+    GwyGraphCurveLOD *lod;
+
+    if (!lod_quark)
+        lod_quark = g_quark_from_static_string("gwy-graph-curve-lod");
+
+    if (!(lod = g_object_get_qdata(G_OBJECT(gcmodel), lod_quark))) {
+        lod = g_new0(GwyGraphCurveLOD, 1);
+        lod->points = g_array_new(FALSE, FALSE, sizeof(GdkPoint));
+        lod->segments = g_array_new(FALSE, FALSE, sizeof(guint));
+        lod->symbols = g_array_new(FALSE, FALSE, sizeof(GdkPoint));
+        g_object_set_qdata_full(G_OBJECT(gcmodel), lod_quark,
+                                lod, curve_lod_free);
+        g_signal_connect(gcmodel, "data-changed",
+                         G_CALLBACK(curve_lod_invalidate), lod);
+    }
+
+    if (!lod->valid || !specs_equal(&lod->specs, specs))
+        curve_lod_update(lod, specs, gcmodel);
+
+    return lod->useless ? NULL : lod;
+}
+
 /**
  * gwy_graph_draw_curve:
  * @drawable: A drawable.
@@ -300,6 +493,10 @@ gwy_graph_draw_curve_segment(const GdkPoint *points,
  * @gcmodel: Curve model of the curve to draw.
  *
  * Draws a single graph curve on a drawable.
+ *
+ * Curves with many more points than pixel columns of the area are drawn
+ * decimated.  The decimated points are kept with @gcmodel and reused as long
+ * as its data and @specs do not change.  The drawn line is the same.
  **/
 void
 gwy_graph_draw_curve(GdkDrawable *drawable,
@@ -307,8 +504,10 @@ gwy_graph_draw_curve(GdkDrawable *drawable,
                      GwyGraphActiveAreaSpecs *specs,
                      GwyGraphCurveModel *gcmodel)
 {
+    GwyGraphCurveLOD *lod;
     GdkPoint *points;
     gint i, n, symbol_size, line_width;
+    guint seglen;
 
     line_width = symbol_size = 0;
     if (gcmodel->mode == GWY_GRAPH_CURVE_LINE
@@ -322,6 +521,31 @@ gwy_graph_draw_curve(GdkDrawable *drawable,
         return;
 
     gwy_rgba_set_gdk_gc_fg(&gcmodel->color, gc);
+
+    /* Huge curves are decimated to a few points per pixel column.  The
+     * reduced data are cached until the data or the area changes. */
+    if (gcmodel->n > 4*specs->width
+        && (lod = curve_lod_get(specs, gcmodel))) {
+        if (line_width) {
+            points = (GdkPoint*)lod->points->data;
+            for (i = n = 0; i < lod->segments->len; i++) {
+                seglen = g_array_index(lod->segments, guint, i);
+                gwy_graph_draw_curve_segment(points + n, seglen,
+                                             drawable, gc,
+                                             gcmodel->line_style, line_width,
+                                             gcmodel->point_type, 0);
+                n += seglen;
+            }
+        }
+        if (symbol_size) {
+            gwy_graph_draw_curve_segment((GdkPoint*)lod->symbols->data,
+                                         lod->symbols->len, drawable, gc,
+                                         gcmodel->line_style, 0,
+                                         gcmodel->point_type, symbol_size);
+        }
+        return;
+    }
+
     points = g_new(GdkPoint, gcmodel->n);
 
     for (i = n = 0; i < gcmodel->n; i++) {
@@ -32,6 +32,11 @@
     g_signal_connect_object(obj, signal, G_CALLBACK(cb), data, \
                             G_CONNECT_SWAPPED | G_CONNECT_AFTER)
 
+#define BITS_PER_SAMPLE 8
+
+#define GWY_LAYER_BASIC_GET_PRIVATE(o) \
+   (G_TYPE_INSTANCE_GET_PRIVATE((o), GWY_TYPE_LAYER_BASIC, GwyLayerBasicPrivate))
+
 enum {
     PRESENTATION_SWITCHED,
     LAST_SIGNAL
@@ -46,6 +51,18 @@ enum {
     PROP_MIN_MAX_KEY
 };
 
+typedef struct _GwyLayerBasicPrivate GwyLayerBasicPrivate;
+
+/* Resolution pyramid of the displayed field, levels[i] is halved i+1 times,
+ * and the cumulative height distribution for adaptive colour mapping.  Both
+ * are created on demand and dropped when the field changes. */
+struct _GwyLayerBasicPrivate {
+    GwyDataField *pyramid_field;
+    gulong pyramid_id;
+    GPtrArray *levels;
+    GwyDataLine *cdh;
+};
+
 static void gwy_layer_basic_destroy              (GtkObject *object);
 static void gwy_layer_basic_set_property         (GObject *object,
                                                   guint prop_id,
@@ -80,6 +97,11 @@ static void gwy_layer_basic_show_changed         (GwyLayerBasic *basic_layer);
 static void gwy_layer_basic_range_type_changed   (GwyLayerBasic *basic_layer);
 static void gwy_layer_basic_min_max_changed      (GwyLayerBasic *basic_layer);
 static void gwy_layer_basic_changed              (GwyPixmapLayer *pixmap_layer);
+static GwyDataField* gwy_layer_basic_get_paint_field(GwyLayerBasic *basic_layer,
+                                                    GwyDataField *data_field);
+static void gwy_layer_basic_pyramid_connect      (GwyLayerBasic *basic_layer,
+                                                  GwyDataField *data_field);
+static void gwy_layer_basic_pyramid_clear        (GwyLayerBasic *basic_layer);
 static void gwy_layer_basic_set_default_range_type(GwyLayerBasic *basic_layer,
                                                    GwyLayerBasicRangeType range_type);
 
@@ -105,6 +127,8 @@ gwy_layer_basic_class_init(GwyLayerBasicClass *klass)
 
     pixmap_class->paint = gwy_layer_basic_paint;
 
+    g_type_class_add_private(klass, sizeof(GwyLayerBasicPrivate));
+
     /**
      * GwyLayerBasic:gradient-key:
      *
@@ -216,6 +240,7 @@ gwy_layer_basic_destroy(GtkObject *object)
         gwy_resource_release(GWY_RESOURCE(layer->gradient));
         layer->gradient = NULL;
     }
+    gwy_layer_basic_pyramid_clear(layer);
 
     GTK_OBJECT_CLASS(gwy_layer_basic_parent_class)->destroy(object);
 }
@@ -321,10 +346,11 @@ static GdkPixbuf*
 gwy_layer_basic_paint(GwyPixmapLayer *layer)
 {
     GwyLayerBasic *basic_layer;
-    GwyDataField *data_field;
+    GwyDataField *data_field, *paint_field;
     GwyLayerBasicRangeType range_type;
     GwyContainer *data;
     gdouble min, max;
+    gint xres, yres;
 
     basic_layer = GWY_LAYER_BASIC(layer);
     data = GWY_DATA_VIEW_LAYER(layer)->data;
@@ -334,40 +360,132 @@ gwy_layer_basic_paint(GwyPixmapLayer *layer)
         data_field = GWY_DATA_FIELD(basic_layer->show_field);
     g_return_val_if_fail(data && data_field, NULL);
 
-    /* Special-case full range, as gwy_pixbuf_draw_data_field() is simplier,
-     * it doesn't have to deal with outliers */
+    /* Large fields shown scaled down are painted from a reduced resolution
+     * level, so the cost is given by the widget size.  Colour ranges are
+     * always taken from the full data. */
+    paint_field = gwy_layer_basic_get_paint_field(basic_layer, data_field);
+    xres = gwy_data_field_get_xres(paint_field);
+    yres = gwy_data_field_get_yres(paint_field);
+    if (layer->pixbuf
+        && (gdk_pixbuf_get_width(layer->pixbuf) != xres
+            || gdk_pixbuf_get_height(layer->pixbuf) != yres))
+        GWY_OBJECT_UNREF(layer->pixbuf);
+    if (!layer->pixbuf)
+        layer->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE,
+                                       BITS_PER_SAMPLE, xres, yres);
+
     range_type = gwy_layer_basic_get_range_type(basic_layer);
-    gwy_pixmap_layer_make_pixbuf(layer, FALSE);
-    if (range_type == GWY_LAYER_BASIC_RANGE_FULL)
-        gwy_pixbuf_draw_data_field(layer->pixbuf, data_field,
-                                   basic_layer->gradient);
-    else if (range_type == GWY_LAYER_BASIC_RANGE_ADAPT)
-        gwy_pixbuf_draw_data_field_adaptive(layer->pixbuf, data_field,
-                                            basic_layer->gradient);
+    if (range_type == GWY_LAYER_BASIC_RANGE_FULL) {
+        gwy_data_field_get_min_max(data_field, &min, &max);
+        gwy_pixbuf_draw_data_field_with_range(layer->pixbuf, paint_field,
+                                              basic_layer->gradient,
+                                              min, max);
+    }
+    else if (range_type == GWY_LAYER_BASIC_RANGE_ADAPT) {
+        GwyLayerBasicPrivate *priv = GWY_LAYER_BASIC_GET_PRIVATE(basic_layer);
+
+        gwy_layer_basic_pyramid_connect(basic_layer, data_field);
+        if (!priv->cdh)
+            priv->cdh = gwy_draw_data_field_cdh(data_field);
+        gwy_pixbuf_draw_data_field_adaptive_with_cdh(layer->pixbuf,
+                                                     paint_field, priv->cdh,
+                                                     basic_layer->gradient);
+    }
     else {
         if (basic_layer->show_field) {
             /* Ignore fixed range in for presentations. */
             if (range_type == GWY_LAYER_BASIC_RANGE_FIXED)
-                gwy_pixbuf_draw_data_field(layer->pixbuf, data_field,
-                                           basic_layer->gradient);
-            else {
+                gwy_data_field_get_min_max(data_field, &min, &max);
+            else
                 gwy_data_field_get_autorange(data_field, &min, &max);
-                gwy_pixbuf_draw_data_field_with_range(layer->pixbuf, data_field,
-                                                      basic_layer->gradient,
-                                                      min, max);
-            }
         }
-        else {
+        else
             gwy_layer_basic_get_range(basic_layer, &min, &max);
-            gwy_pixbuf_draw_data_field_with_range(layer->pixbuf, data_field,
-                                                  basic_layer->gradient,
-                                                  min, max);
-        }
+        gwy_pixbuf_draw_data_field_with_range(layer->pixbuf, paint_field,
+                                              basic_layer->gradient,
+                                              min, max);
     }
 
     return layer->pixbuf;
 }
 
+static GwyDataField*
+gwy_layer_basic_get_paint_field(GwyLayerBasic *basic_layer,
+                                GwyDataField *data_field)
+{
+    GwyLayerBasicPrivate *priv;
+    GwyDataField *level_field;
+    gint xres, yres, width, height;
+    guint level;
+
+    gwy_pixmap_layer_get_target_size(GWY_PIXMAP_LAYER(basic_layer),
+                                     &width, &height);
+    if (width <= 0 || height <= 0)
+        return data_field;
+
+    /* Find the smallest level still at least as large as the target. */
+    xres = gwy_data_field_get_xres(data_field);
+    yres = gwy_data_field_get_yres(data_field);
+    level = 0;
+    while (xres >= 2*width && yres >= 2*height) {
+        xres = (xres + 1)/2;
+        yres = (yres + 1)/2;
+        level++;
+    }
+    if (!level)
+        return data_field;
+
+    priv = GWY_LAYER_BASIC_GET_PRIVATE(basic_layer);
+    gwy_layer_basic_pyramid_connect(basic_layer, data_field);
+    if (!priv->levels)
+        priv->levels = g_ptr_array_new();
+    while (priv->levels->len < level) {
+        if (priv->levels->len)
+            level_field = g_ptr_array_index(priv->levels, priv->levels->len-1);
+        else
+            level_field = data_field;
+        g_ptr_array_add(priv->levels, gwy_draw_data_field_halve(level_field));
+    }
+
+    return g_ptr_array_index(priv->levels, level-1);
+}
+
+/* Makes the cached pyramid and distribution belong to @data_field. */
+static void
+gwy_layer_basic_pyramid_connect(GwyLayerBasic *basic_layer,
+                                GwyDataField *data_field)
+{
+    GwyLayerBasicPrivate *priv;
+
+    priv = GWY_LAYER_BASIC_GET_PRIVATE(basic_layer);
+    if (priv->pyramid_field == data_field)
+        return;
+
+    gwy_layer_basic_pyramid_clear(basic_layer);
+    priv->pyramid_field = g_object_ref(data_field);
+    priv->pyramid_id = connect_swapped_after(data_field, "data-changed",
+                                             gwy_layer_basic_pyramid_clear,
+                                             basic_layer);
+}
+
+static void
+gwy_layer_basic_pyramid_clear(GwyLayerBasic *basic_layer)
+{
+    GwyLayerBasicPrivate *priv;
+    guint i;
+
+    priv = GWY_LAYER_BASIC_GET_PRIVATE(basic_layer);
+    if (priv->levels) {
+        for (i = 0; i < priv->levels->len; i++)
+            g_object_unref(g_ptr_array_index(priv->levels, i));
+        g_ptr_array_free(priv->levels, TRUE);
+        priv->levels = NULL;
+    }
+    GWY_OBJECT_UNREF(priv->cdh);
+    GWY_SIGNAL_HANDLER_DISCONNECT(priv->pyramid_field, priv->pyramid_id);
+    GWY_OBJECT_UNREF(priv->pyramid_field);
+}
+
 static void
 gwy_layer_basic_gradient_connect(GwyLayerBasic *basic_layer)
 {
@@ -442,6 +560,7 @@ gwy_layer_basic_unplugged(GwyDataViewLayer *layer)
     gwy_layer_basic_gradient_disconnect(basic_layer);
     GWY_SIGNAL_HANDLER_DISCONNECT(layer->data, basic_layer->show_item_id);
     gwy_layer_basic_show_field_disconnect(basic_layer);
+    gwy_layer_basic_pyramid_clear(basic_layer);
 
     GWY_OBJECT_UNREF(pixmap_layer->pixbuf);
     GWY_DATA_VIEW_LAYER_CLASS(gwy_layer_basic_parent_class)->unplugged(layer);
@@ -29,11 +29,27 @@
     g_signal_connect_object(obj, signal, G_CALLBACK(cb), data, \
                             G_CONNECT_SWAPPED | G_CONNECT_AFTER)
 
+#define BITS_PER_SAMPLE 8
+
+#define GWY_LAYER_MASK_GET_PRIVATE(o) \
+   (G_TYPE_INSTANCE_GET_PRIVATE((o), GWY_TYPE_LAYER_MASK, GwyLayerMaskPrivate))
+
 enum {
     PROP_0,
     PROP_COLOR_KEY
 };
 
+typedef struct _GwyLayerMaskPrivate GwyLayerMaskPrivate;
+
+/* Resolution pyramid of the mask, levels[i] is halved i+1 times.  Levels are
+ * created on demand and dropped when the mask changes. */
+struct _GwyLayerMaskPrivate {
+    GwyDataField *pyramid_field;
+    gulong pyramid_id;
+    GPtrArray *levels;
+};
+
+static void       gwy_layer_mask_destroy         (GtkObject *object);
 static void       gwy_layer_mask_set_property    (GObject *object,
                                                   guint prop_id,
                                                   const GValue *value,
@@ -48,6 +64,9 @@ static void       gwy_layer_mask_unplugged       (GwyDataViewLayer *layer);
 static void       gwy_layer_mask_connect_color   (GwyLayerMask *mask_layer);
 static void       gwy_layer_mask_disconnect_color(GwyLayerMask *mask_layer);
 static void       gwy_layer_mask_changed         (GwyPixmapLayer *pixmap_layer);
+static GwyDataField* gwy_layer_mask_get_paint_field(GwyLayerMask *mask_layer,
+                                                    GwyDataField *data_field);
+static void       gwy_layer_mask_pyramid_clear   (GwyLayerMask *mask_layer);
 
 G_DEFINE_TYPE(GwyLayerMask, gwy_layer_mask, GWY_TYPE_PIXMAP_LAYER)
 
@@ -55,17 +74,22 @@ static void
 gwy_layer_mask_class_init(GwyLayerMaskClass *klass)
 {
     GwyDataViewLayerClass *layer_class = GWY_DATA_VIEW_LAYER_CLASS(klass);
+    GtkObjectClass *object_class = GTK_OBJECT_CLASS(klass);
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
     GwyPixmapLayerClass *pixmap_class = GWY_PIXMAP_LAYER_CLASS(klass);
 
     gobject_class->set_property = gwy_layer_mask_set_property;
     gobject_class->get_property = gwy_layer_mask_get_property;
 
+    object_class->destroy = gwy_layer_mask_destroy;
+
     layer_class->plugged = gwy_layer_mask_plugged;
     layer_class->unplugged = gwy_layer_mask_unplugged;
 
     pixmap_class->paint = gwy_layer_mask_paint;
 
+    g_type_class_add_private(klass, sizeof(GwyLayerMaskPrivate));
+
     /**
      * GwyLayerMask:color-key:
      *
@@ -86,6 +110,13 @@ gwy_layer_mask_init(G_GNUC_UNUSED GwyLayerMask *layer)
 {
 }
 
+static void
+gwy_layer_mask_destroy(GtkObject *object)
+{
+    gwy_layer_mask_pyramid_clear(GWY_LAYER_MASK(object));
+    GTK_OBJECT_CLASS(gwy_layer_mask_parent_class)->destroy(object);
+}
+
 static void
 gwy_layer_mask_set_property(GObject *object,
                             guint prop_id,
@@ -147,10 +178,11 @@ gwy_layer_mask_new(void)
 static GdkPixbuf*
 gwy_layer_mask_paint(GwyPixmapLayer *layer)
 {
-    GwyDataField *data_field;
+    GwyDataField *data_field, *paint_field;
     GwyLayerMask *mask_layer;
     GwyContainer *data;
     GwyRGBA color = { 0, 0, 0, 0 };
+    gint xres, yres;
 
     mask_layer = GWY_LAYER_MASK(layer);
     data = GWY_DATA_VIEW_LAYER(layer)->data;
@@ -161,12 +193,88 @@ gwy_layer_mask_paint(GwyPixmapLayer *layer)
         gwy_rgba_get_from_container(&color,
                                     GWY_DATA_VIEW_LAYER(mask_layer)->data,
                                     g_quark_to_string(mask_layer->color_key));
-    gwy_pixmap_layer_make_pixbuf(layer, TRUE);
-    gwy_pixbuf_draw_data_field_as_mask(layer->pixbuf, data_field, &color);
+
+    /* Large masks shown scaled down are painted from a reduced resolution
+     * level, like the data below them. */
+    paint_field = gwy_layer_mask_get_paint_field(mask_layer, data_field);
+    xres = gwy_data_field_get_xres(paint_field);
+    yres = gwy_data_field_get_yres(paint_field);
+    if (layer->pixbuf
+        && (gdk_pixbuf_get_width(layer->pixbuf) != xres
+            || gdk_pixbuf_get_height(layer->pixbuf) != yres))
+        GWY_OBJECT_UNREF(layer->pixbuf);
+    if (!layer->pixbuf)
+        layer->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE,
+                                       BITS_PER_SAMPLE, xres, yres);
+    gwy_pixbuf_draw_data_field_as_mask(layer->pixbuf, paint_field, &color);
 
     return layer->pixbuf;
 }
 
+static GwyDataField*
+gwy_layer_mask_get_paint_field(GwyLayerMask *mask_layer,
+                               GwyDataField *data_field)
+{
+    GwyLayerMaskPrivate *priv;
+    GwyDataField *level_field;
+    gint xres, yres, width, height;
+    guint level;
+
+    gwy_pixmap_layer_get_target_size(GWY_PIXMAP_LAYER(mask_layer),
+                                     &width, &height);
+    if (width <= 0 || height <= 0)
+        return data_field;
+
+    /* Find the smallest level still at least as large as the target. */
+    xres = gwy_data_field_get_xres(data_field);
+    yres = gwy_data_field_get_yres(data_field);
+    level = 0;
+    while (xres >= 2*width && yres >= 2*height) {
+        xres = (xres + 1)/2;
+        yres = (yres + 1)/2;
+        level++;
+    }
+    if (!level)
+        return data_field;
+
+    priv = GWY_LAYER_MASK_GET_PRIVATE(mask_layer);
+    if (priv->pyramid_field != data_field) {
+        gwy_layer_mask_pyramid_clear(mask_layer);
+        priv->pyramid_field = g_object_ref(data_field);
+        priv->pyramid_id = connect_swapped_after(data_field, "data-changed",
+                                                 gwy_layer_mask_pyramid_clear,
+                                                 mask_layer);
+        priv->levels = g_ptr_array_new();
+    }
+
+    while (priv->levels->len < level) {
+        if (priv->levels->len)
+            level_field = g_ptr_array_index(priv->levels, priv->levels->len-1);
+        else
+            level_field = data_field;
+        g_ptr_array_add(priv->levels, gwy_draw_data_field_halve(level_field));
+    }
+
+    return g_ptr_array_index(priv->levels, level-1);
+}
+
+static void
+gwy_layer_mask_pyramid_clear(GwyLayerMask *mask_layer)
+{
+    GwyLayerMaskPrivate *priv;
+    guint i;
+
+    priv = GWY_LAYER_MASK_GET_PRIVATE(mask_layer);
+    if (priv->levels) {
+        for (i = 0; i < priv->levels->len; i++)
+            g_object_unref(g_ptr_array_index(priv->levels, i));
+        g_ptr_array_free(priv->levels, TRUE);
+        priv->levels = NULL;
+    }
+    GWY_SIGNAL_HANDLER_DISCONNECT(priv->pyramid_field, priv->pyramid_id);
+    GWY_OBJECT_UNREF(priv->pyramid_field);
+}
+
 /**
  * gwy_layer_mask_get_color:
  * @mask_layer: A mask layer.
@@ -216,6 +324,7 @@ gwy_layer_mask_unplugged(GwyDataViewLayer *layer)
     mask_layer = GWY_LAYER_MASK(layer);
 
     gwy_layer_mask_disconnect_color(mask_layer);
+    gwy_layer_mask_pyramid_clear(mask_layer);
 
     GWY_OBJECT_UNREF(pixmap_layer->pixbuf);
     GWY_DATA_VIEW_LAYER_CLASS(gwy_layer_mask_parent_class)->unplugged(layer);
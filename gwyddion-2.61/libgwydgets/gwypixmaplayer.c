@@ -28,6 +28,9 @@
 
 #define BITS_PER_SAMPLE 8
 
+#define GWY_PIXMAP_LAYER_GET_PRIVATE(o) \
+   (G_TYPE_INSTANCE_GET_PRIVATE((o), GWY_TYPE_PIXMAP_LAYER, GwyPixmapLayerPrivate))
+
 #define connect_swapped_after(obj, signal, cb, data) \
     g_signal_connect_object(obj, signal, G_CALLBACK(cb), data, \
                             G_CONNECT_SWAPPED | G_CONNECT_AFTER)
@@ -37,6 +40,13 @@ enum {
     PROP_DATA_KEY
 };
 
+typedef struct _GwyPixmapLayerPrivate GwyPixmapLayerPrivate;
+
+struct _GwyPixmapLayerPrivate {
+    gint target_width;
+    gint target_height;
+};
+
 static void gwy_pixmap_layer_set_property       (GObject *object,
                                                  guint prop_id,
                                                  const GValue *value,
@@ -71,6 +81,8 @@ gwy_pixmap_layer_class_init(GwyPixmapLayerClass *klass)
     layer_class->plugged = gwy_pixmap_layer_plugged;
     layer_class->unplugged = gwy_pixmap_layer_unplugged;
 
+    g_type_class_add_private(klass, sizeof(GwyPixmapLayerPrivate));
+
     /**
      * GwyPixmapLayer:data-key:
      *
@@ -405,6 +417,73 @@ gwy_pixmap_layer_make_pixbuf(GwyPixmapLayer *pixmap_layer,
                                           BITS_PER_SAMPLE, dwidth, dheight);
 }
 
+/**
+ * gwy_pixmap_layer_set_target_size:
+ * @pixmap_layer: A pixmap layer.
+ * @width: Width of the area the pixbuf will be scaled to, in pixels.
+ * @height: Height of the area the pixbuf will be scaled to, in pixels.
+ *
+ * Sets the size at which a pixmap layer will be displayed.
+ *
+ * Layers may use the target size to paint a pixbuf smaller than the data
+ * field if it is going to be scaled down anyway.  The pixbuf is never smaller
+ * than the target size.  Pass zero or negative dimensions to request the full
+ * data field resolution, which is also the default.
+ *
+ * Changing the target size makes the layer want repaint.  This method is
+ * normally called by #GwyDataView.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_pixmap_layer_set_target_size(GwyPixmapLayer *pixmap_layer,
+                                 gint width,
+                                 gint height)
+{
+    GwyPixmapLayerPrivate *priv;
+
+    g_return_if_fail(GWY_IS_PIXMAP_LAYER(pixmap_layer));
+
+    width = MAX(width, 0);
+    height = MAX(height, 0);
+    priv = GWY_PIXMAP_LAYER_GET_PRIVATE(pixmap_layer);
+    if (priv->target_width == width && priv->target_height == height)
+        return;
+
+    priv->target_width = width;
+    priv->target_height = height;
+    pixmap_layer->wants_repaint = TRUE;
+}
+
+/**
+ * gwy_pixmap_layer_get_target_size:
+ * @pixmap_layer: A pixmap layer.
+ * @width: Location to store the target width to, or %NULL.
+ * @height: Location to store the target height to, or %NULL.
+ *
+ * Gets the size at which a pixmap layer will be displayed.
+ *
+ * See gwy_pixmap_layer_set_target_size() for details.  Zero dimensions mean
+ * the full data field resolution.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_pixmap_layer_get_target_size(GwyPixmapLayer *pixmap_layer,
+                                 gint *width,
+                                 gint *height)
+{
+    GwyPixmapLayerPrivate *priv;
+
+    g_return_if_fail(GWY_IS_PIXMAP_LAYER(pixmap_layer));
+
+    priv = GWY_PIXMAP_LAYER_GET_PRIVATE(pixmap_layer);
+    if (width)
+        *width = priv->target_width;
+    if (height)
+        *height = priv->target_height;
+}
+
 /************************** Documentation ****************************/
 
 /**
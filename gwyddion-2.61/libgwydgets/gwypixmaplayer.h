@@ -71,6 +71,12 @@ void             gwy_pixmap_layer_set_data_key  (GwyPixmapLayer *pixmap_layer,
 const gchar*     gwy_pixmap_layer_get_data_key  (GwyPixmapLayer *pixmap_layer);
 void             gwy_pixmap_layer_make_pixbuf   (GwyPixmapLayer *pixmap_layer,
                                                  gboolean has_alpha);
+void             gwy_pixmap_layer_set_target_size(GwyPixmapLayer *pixmap_layer,
+                                                  gint width,
+                                                  gint height);
+void             gwy_pixmap_layer_get_target_size(GwyPixmapLayer *pixmap_layer,
+                                                  gint *width,
+                                                  gint *height);
 
 G_END_DECLS
 
@@ -33,6 +33,11 @@
 #include <libgwymodule/gwymodule-file.h>
 #include "gwymoduleinternal.h"
 
+/* Score of a good magic header.  When the module which recognised files with
+ * the same extension last time gives at least this score, other modules are
+ * not loaded for detection. */
+#define DETECT_HINT_SCORE 100
+
 /* The file function information. */
 typedef struct {
     const gchar *name;
@@ -41,7 +46,11 @@ typedef struct {
     GwyFileLoadFunc load;
     GwyFileSaveFunc save;
     GwyFileSaveFunc export_;
+    GwyFileLoadFunc preview;
     gboolean is_detectable;
+    /* Registered from the registry cache, the module is not loaded yet. */
+    gboolean is_cached;
+    GwyFileOperationType cached_operations;
 } GwyFileFuncInfo;
 
 /* Information about current file, passed around during detection */
@@ -51,6 +60,7 @@ typedef struct {
     gboolean only_name;
     GwyFileOperationType mode;
     GwyFileDetectInfo *fileinfo;
+    GPtrArray *cached;
 } FileDetectData;
 
 /* Information about successful loads and saves of a Container, kept in
@@ -74,6 +84,8 @@ static void     gwy_file_detect_free_info  (GwyFileDetectInfo *fileinfo);
 static void     file_detect_max_score_cb   (const gchar *key,
                                             GwyFileFuncInfo *func_info,
                                             FileDetectData *ddata);
+static void     file_detect_max_score      (FileDetectData *ddata);
+static GwyFileFuncInfo* ensure_loaded      (GwyFileFuncInfo *func_info);
 static GwyFileOperationType get_operations (const GwyFileFuncInfo *func_info);
 static void     gwy_file_type_info_set     (GwyContainer *data,
                                             const gchar *name,
@@ -87,6 +99,18 @@ static GHashTable *file_funcs = NULL;
 static GList *container_list = NULL;
 static GPtrArray *call_stack = NULL;
 
+static void
+file_funcs_init(void)
+{
+    if (file_funcs)
+        return;
+
+    gwy_debug("Initializing...");
+    file_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                       NULL, &g_free);
+    call_stack = g_ptr_array_new();
+}
+
 /**
  * gwy_file_func_register:
  * @name: Name of function to register.  It should be a valid identifier and
@@ -127,35 +151,28 @@ gwy_file_func_register(const gchar *name,
               "load = %p, save = %p, export = %p",
               name, description, detect, load, save, export_);
 
-    if (!file_funcs) {
-        gwy_debug("Initializing...");
-        file_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                           NULL, &g_free);
-        call_stack = g_ptr_array_new();
-    }
+    file_funcs_init();
 
     if (!gwy_strisident(name, "_-", NULL))
         g_warning("Function name `%s' is not a valid identifier. "
                   "It may be rejected in future.", name);
-    if (g_hash_table_lookup(file_funcs, name)) {
-        g_warning("Duplicate function %s, keeping only first", name);
+    func_info = _gwy_module_register_function_info(file_funcs,
+                                                   GWY_MODULE_PREFIX_FILE,
+                                                   name,
+                                                   sizeof(GwyFileFuncInfo));
+    if (!func_info)
         return FALSE;
-    }
-
-    func_info = g_new0(GwyFileFuncInfo, 1);
+    /* Keep is_detectable of functions registered from the registry cache,
+     * it may have been changed. */
+    if (!func_info->is_cached)
+        func_info->is_detectable = !!detect;
     func_info->name = name;
     func_info->description = description;
     func_info->detect = detect;
     func_info->load = load;
     func_info->save = save;
     func_info->export_ = export_;
-    func_info->is_detectable = !!func_info->detect;
-
-    g_hash_table_insert(file_funcs, (gpointer)func_info->name, func_info);
-    if (!_gwy_module_add_registered_function(GWY_MODULE_PREFIX_FILE, name)) {
-        g_hash_table_remove(file_funcs, func_info->name);
-        return FALSE;
-    }
+    func_info->is_cached = FALSE;
 
     return TRUE;
 }
@@ -191,6 +208,10 @@ gwy_file_func_run_detect(const gchar *name,
     g_return_val_if_fail(filename, 0);
     func_info = g_hash_table_lookup(file_funcs, name);
     g_return_val_if_fail(func_info, 0);
+    if (!(get_operations(func_info) & GWY_FILE_OPERATION_DETECT))
+        return 0;
+    func_info = ensure_loaded(func_info);
+    g_return_val_if_fail(func_info, 0);
     if (!func_info->detect)
         return 0;
 
@@ -229,7 +250,7 @@ gwy_file_func_run_load(const gchar *name,
 
     g_return_val_if_fail(!error || !*error, NULL);
     g_return_val_if_fail(filename, NULL);
-    func_info = g_hash_table_lookup(file_funcs, name);
+    func_info = ensure_loaded(g_hash_table_lookup(file_funcs, name));
     g_return_val_if_fail(func_info, NULL);
     g_return_val_if_fail(func_info->load, NULL);
 
@@ -275,7 +296,7 @@ gwy_file_func_run_save(const gchar *name,
     g_return_val_if_fail(!error || !*error, FALSE);
     g_return_val_if_fail(filename, FALSE);
     g_return_val_if_fail(GWY_IS_CONTAINER(data), FALSE);
-    func_info = g_hash_table_lookup(file_funcs, name);
+    func_info = ensure_loaded(g_hash_table_lookup(file_funcs, name));
     g_return_val_if_fail(func_info, FALSE);
     g_return_val_if_fail(func_info->save, FALSE);
 
@@ -323,7 +344,7 @@ gwy_file_func_run_export(const gchar *name,
     g_return_val_if_fail(!error || !*error, FALSE);
     g_return_val_if_fail(filename, FALSE);
     g_return_val_if_fail(GWY_IS_CONTAINER(data), FALSE);
-    func_info = g_hash_table_lookup(file_funcs, name);
+    func_info = ensure_loaded(g_hash_table_lookup(file_funcs, name));
     g_return_val_if_fail(func_info, FALSE);
     g_return_val_if_fail(func_info->export_, FALSE);
 
@@ -338,23 +359,32 @@ gwy_file_func_run_export(const gchar *name,
     return status;
 }
 
+/* Loads the module implementing a function registered from the registry
+ * cache.  Returns the function info with real functions, or %NULL if the
+ * module failed to load. */
+static GwyFileFuncInfo*
+ensure_loaded(GwyFileFuncInfo *func_info)
+{
+    const gchar *name;
+
+    if (!func_info || !func_info->is_cached)
+        return func_info;
+
+    name = func_info->name;
+    _gwy_module_load_function(GWY_MODULE_PREFIX_FILE, name);
+    func_info = g_hash_table_lookup(file_funcs, name);
+
+    return (func_info && !func_info->is_cached) ? func_info : NULL;
+}
+
 static void
-file_detect_max_score_cb(const gchar *key,
-                         GwyFileFuncInfo *func_info,
+file_detect_update_score(GwyFileFuncInfo *func_info,
                          FileDetectData *ddata)
 {
     gint score;
 
-    g_assert(gwy_strequal(key, func_info->name));
-
     if (!func_info->detect)
         return;
-    if ((ddata->mode & GWY_FILE_OPERATION_LOAD) && !func_info->load)
-        return;
-    if ((ddata->mode & GWY_FILE_OPERATION_SAVE) && !func_info->save)
-        return;
-    if ((ddata->mode & GWY_FILE_OPERATION_EXPORT) && !func_info->export_)
-        return;
 
     score = func_info->detect(ddata->fileinfo, ddata->only_name,
                                    func_info->name);
@@ -364,6 +394,107 @@ file_detect_max_score_cb(const gchar *key,
     }
 }
 
+static void
+file_detect_max_score_cb(const gchar *key,
+                         GwyFileFuncInfo *func_info,
+                         FileDetectData *ddata)
+{
+    GwyFileOperationType operations = get_operations(func_info);
+
+    g_assert(gwy_strequal(key, func_info->name));
+
+    if (!(operations & GWY_FILE_OPERATION_DETECT))
+        return;
+    if ((ddata->mode & GWY_FILE_OPERATION_LOAD)
+        && !(operations & GWY_FILE_OPERATION_LOAD))
+        return;
+    if ((ddata->mode & GWY_FILE_OPERATION_SAVE)
+        && !(operations & GWY_FILE_OPERATION_SAVE))
+        return;
+    if ((ddata->mode & GWY_FILE_OPERATION_EXPORT)
+        && !(operations & GWY_FILE_OPERATION_EXPORT))
+        return;
+
+    /* Do not load modules while iterating over the table.  A failed module
+     * would remove its functions from it. */
+    if (func_info->is_cached) {
+        g_ptr_array_add(ddata->cached, (gpointer)func_info->name);
+        return;
+    }
+
+    file_detect_update_score(func_info, ddata);
+}
+
+/* Finds the file name extension usable as a detection hint key.  Returns
+ * %NULL if there is no reasonable one. */
+static const gchar*
+file_detect_extension(const GwyFileDetectInfo *fileinfo)
+{
+    const gchar *ext, *p;
+
+    if (!(ext = strrchr(fileinfo->name_lowercase, '.')))
+        return NULL;
+
+    ext++;
+    if (!*ext || strlen(ext) > 16)
+        return NULL;
+    for (p = ext; *p; p++) {
+        if (!g_ascii_isalnum(*p) && *p != '_' && *p != '-' && *p != '+')
+            return NULL;
+    }
+
+    return ext;
+}
+
+/* Loads the module implementing cached function @name and updates the score
+ * with its detection. */
+static void
+file_detect_load_and_score(const gchar *name,
+                           FileDetectData *ddata)
+{
+    GwyFileFuncInfo *func_info;
+
+    func_info = ensure_loaded(g_hash_table_lookup(file_funcs, name));
+    if (func_info)
+        file_detect_update_score(func_info, ddata);
+}
+
+static void
+file_detect_max_score(FileDetectData *ddata)
+{
+    const gchar *ext = NULL, *hint = NULL;
+    guint i;
+
+    ddata->cached = g_ptr_array_new();
+    g_hash_table_foreach(file_funcs, (GHFunc)file_detect_max_score_cb, ddata);
+
+    /* Modules registered from the registry cache must be loaded to run their
+     * detection.  Try the module which recognised a file with the same
+     * extension last time first.  If it is sure, do not load the others. */
+    if (!ddata->only_name)
+        ext = file_detect_extension(ddata->fileinfo);
+    if (ext && ddata->cached->len)
+        hint = _gwy_module_get_detect_hint(ext);
+    for (i = 0; hint && i < ddata->cached->len; i++) {
+        if (gwy_strequal(g_ptr_array_index(ddata->cached, i), hint)) {
+            g_ptr_array_remove_index(ddata->cached, i);
+            file_detect_load_and_score(hint, ddata);
+            break;
+        }
+    }
+
+    if (ddata->score < DETECT_HINT_SCORE) {
+        for (i = 0; i < ddata->cached->len; i++)
+            file_detect_load_and_score(g_ptr_array_index(ddata->cached, i),
+                                       ddata);
+    }
+    if (ext && ddata->score >= DETECT_HINT_SCORE)
+        _gwy_module_set_detect_hint(ext, ddata->winner);
+
+    g_ptr_array_free(ddata->cached, TRUE);
+    ddata->cached = NULL;
+}
+
 /**
  * gwy_file_detect:
  * @filename: A file name to detect type of.
@@ -424,7 +555,7 @@ gwy_file_detect_with_score(const gchar *filename,
     ddata.score = 0;
     ddata.only_name = only_name;
     ddata.mode = operations;
-    g_hash_table_foreach(file_funcs, (GHFunc)file_detect_max_score_cb, &ddata);
+    file_detect_max_score(&ddata);
     gwy_file_detect_free_info(&fileinfo);
 
     if (score)
@@ -564,6 +695,68 @@ gwy_file_load_with_func(const gchar *filename,
     return gwy_file_func_run_load(winner, filename, mode, error);
 }
 
+/**
+ * gwy_file_load_preview:
+ * @filename: A file name to load data from, in GLib encoding.
+ * @error: Return location for a #GError (or %NULL).
+ *
+ * Loads data for a preview of a data file, autodetecting its type.
+ *
+ * If the file type module provides a preview function (see
+ * gwy_file_func_set_preview()), only the data necessary for a preview are
+ * loaded.  Otherwise the entire file is loaded non-interactively as with
+ * gwy_file_load().
+ *
+ * The returned container is intended for thumbnails and similar purposes.  It
+ * contains at least one channel, which should be the one best suited for a
+ * preview.  Other data may be missing and the channel may have reduced
+ * resolution.  In such case the original pixel dimensions are given by
+ * integers "/preview/xres" and "/preview/yres".
+ *
+ * Returns: A new #GwyContainer with preview data from @filename, or %NULL.
+ *
+ * Since: 2.62
+ **/
+GwyContainer*
+gwy_file_load_preview(const gchar *filename,
+                      GError **error)
+{
+    GwyFileFuncInfo *func_info;
+    GwyContainer *data;
+    const gchar *winner;
+    FILE *fh;
+
+    g_return_val_if_fail(filename, NULL);
+
+    if (!(fh = gwy_fopen(filename, "rb"))) {
+        g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_IO,
+                    _("Cannot open file for reading: %s."), g_strerror(errno));
+        return NULL;
+    }
+    fclose(fh);
+
+    winner = gwy_file_detect(filename, FALSE, GWY_FILE_OPERATION_LOAD);
+    if (!winner) {
+        g_set_error(error, GWY_MODULE_FILE_ERROR,
+                    GWY_MODULE_FILE_ERROR_UNIMPLEMENTED,
+                    _("No module can load this file type."));
+        return NULL;
+    }
+
+    func_info = ensure_loaded(g_hash_table_lookup(file_funcs, winner));
+    g_return_val_if_fail(func_info, NULL);
+    if (!func_info->preview)
+        return gwy_file_func_run_load(winner, filename, GWY_RUN_NONINTERACTIVE,
+                                      error);
+
+    g_ptr_array_add(call_stack, func_info);
+    data = func_info->preview(filename, GWY_RUN_NONINTERACTIVE, error, winner);
+    g_return_val_if_fail(call_stack->len, data);
+    g_ptr_array_set_size(call_stack, call_stack->len-1);
+
+    return data;
+}
+
 /**
  * gwy_file_save:
  * @data: A #GwyContainer to save.
@@ -632,7 +825,7 @@ gwy_file_save_with_func(GwyContainer *data,
     ddata.score = 0;
     ddata.only_name = TRUE;
     ddata.mode = GWY_FILE_OPERATION_SAVE;
-    g_hash_table_foreach(file_funcs, (GHFunc)file_detect_max_score_cb, &ddata);
+    file_detect_max_score(&ddata);
 
     if (ddata.winner) {
         if (name)
@@ -646,7 +839,7 @@ gwy_file_save_with_func(GwyContainer *data,
     }
 
     ddata.mode = GWY_FILE_OPERATION_EXPORT;
-    g_hash_table_foreach(file_funcs, (GHFunc)file_detect_max_score_cb, &ddata);
+    file_detect_max_score(&ddata);
     gwy_file_detect_free_info(&fileinfo);
 
     if (ddata.winner) {
@@ -742,6 +935,9 @@ get_operations(const GwyFileFuncInfo *func_info)
     if (!func_info)
         return capable;
 
+    if (func_info->is_cached)
+        return func_info->cached_operations;
+
     capable |= func_info->load ? GWY_FILE_OPERATION_LOAD : 0;
     capable |= func_info->save ? GWY_FILE_OPERATION_SAVE : 0;
     capable |= func_info->export_ ? GWY_FILE_OPERATION_EXPORT : 0;
@@ -831,6 +1027,37 @@ gwy_file_func_set_is_detectable(const gchar *name,
     func_info->is_detectable = is_detectable;
 }
 
+/**
+ * gwy_file_func_set_preview:
+ * @name: File type function name.
+ * @preview: Preview load function.
+ *
+ * Sets the preview function of a file format.
+ *
+ * The preview function has the same signature as the load function.  It
+ * should load only the data necessary for a preview of the file, typically
+ * one channel, possibly downsampled.  See gwy_file_load_preview() for what
+ * the returned container should contain.
+ *
+ * Modules can provide it for formats where reading the entire file is
+ * expensive, for instance formats containing large volume data.  It is
+ * optional, without a preview function the file is simply loaded.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_file_func_set_preview(const gchar *name,
+                          GwyFileLoadFunc preview)
+{
+    GwyFileFuncInfo *func_info;
+
+    g_return_if_fail(file_funcs);
+    func_info = g_hash_table_lookup(file_funcs, name);
+    g_return_if_fail(func_info);
+    g_return_if_fail(func_info->load);
+    func_info->preview = preview;
+}
+
 /**
  * gwy_file_func_current:
  *
@@ -860,6 +1087,31 @@ gwy_file_func_current(void)
     return func_info->name;
 }
 
+gboolean
+_gwy_file_func_register_cached(const gchar *name,
+                               const gchar *description,
+                               guint operations,
+                               gboolean is_detectable)
+{
+    GwyFileFuncInfo *func_info;
+
+    file_funcs_init();
+
+    func_info = _gwy_module_register_function_info(file_funcs,
+                                                   GWY_MODULE_PREFIX_FILE,
+                                                   name,
+                                                   sizeof(GwyFileFuncInfo));
+    if (!func_info)
+        return FALSE;
+    func_info->name = name;
+    func_info->description = description;
+    func_info->is_detectable = is_detectable;
+    func_info->is_cached = TRUE;
+    func_info->cached_operations = operations;
+
+    return TRUE;
+}
+
 gboolean
 _gwy_file_func_remove(const gchar *name)
 {
@@ -123,6 +123,10 @@ GwyFileOperationType gwy_file_save_with_func  (GwyContainer *data,
 gboolean            gwy_file_func_get_is_detectable(const gchar *name);
 void                gwy_file_func_set_is_detectable(const gchar *name,
                                                     gboolean is_detectable);
+void                gwy_file_func_set_preview (const gchar *name,
+                                               GwyFileLoadFunc preview);
+GwyContainer*       gwy_file_load_preview     (const gchar *filename,
+                                               GError **error);
 gboolean            gwy_file_get_data_info    (GwyContainer *data,
                                                const gchar **name,
                                                const gchar **filename_sys);
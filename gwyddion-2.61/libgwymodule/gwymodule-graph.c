@@ -47,6 +47,18 @@ typedef struct {
 static GHashTable *graph_funcs = NULL;
 static GPtrArray *call_stack = NULL;
 
+static void
+graph_funcs_init(void)
+{
+    if (graph_funcs)
+        return;
+
+    gwy_debug("Initializing...");
+    graph_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                        NULL, g_free);
+    call_stack = g_ptr_array_new();
+}
+
 /**
  * gwy_graph_func_register:
  * @name: Name of function to register.  It should be a valid identifier and
@@ -85,22 +97,17 @@ gwy_graph_func_register(const gchar *name,
     g_return_val_if_fail(menu_path, FALSE);
     gwy_debug("name = %s, menu path = %s, func = %p", name, menu_path, func);
 
-    if (!graph_funcs) {
-        gwy_debug("initializing...");
-        graph_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                            NULL, g_free);
-        call_stack = g_ptr_array_new();
-    }
+    graph_funcs_init();
 
     if (!gwy_strisident(name, "_-", NULL))
         g_warning("Function name `%s' is not a valid identifier. "
                   "It may be rejected in future.", name);
-    if (g_hash_table_lookup(graph_funcs, name)) {
-        g_warning("Duplicate function %s, keeping only first", name);
+    func_info = _gwy_module_register_function_info(graph_funcs,
+                                                   GWY_MODULE_PREFIX_GRAPH,
+                                                   name,
+                                                   sizeof(GwyGraphFuncInfo));
+    if (!func_info)
         return FALSE;
-    }
-
-    func_info = g_new0(GwyGraphFuncInfo, 1);
     func_info->name = name;
     func_info->func = func;
     func_info->menu_path = menu_path;
@@ -108,12 +115,6 @@ gwy_graph_func_register(const gchar *name,
     func_info->tooltip = tooltip;
     func_info->sens_mask = sens_mask;
 
-    g_hash_table_insert(graph_funcs, (gpointer)func_info->name, func_info);
-    if (!_gwy_module_add_registered_function(GWY_MODULE_PREFIX_GRAPH, name)) {
-        g_hash_table_remove(graph_funcs, func_info->name);
-        return FALSE;
-    }
-
     return TRUE;
 }
 
@@ -133,6 +134,11 @@ gwy_graph_func_run(const gchar *name,
     func_info = g_hash_table_lookup(graph_funcs, name);
     g_return_if_fail(func_info);
     g_return_if_fail(GWY_IS_GRAPH(graph));
+    if (!func_info->func) {
+        _gwy_module_load_function(GWY_MODULE_PREFIX_GRAPH, name);
+        func_info = g_hash_table_lookup(graph_funcs, name);
+        g_return_if_fail(func_info && func_info->func);
+    }
     g_ptr_array_add(call_stack, func_info);
     func_info->func(graph, name);
     g_return_if_fail(call_stack->len);
@@ -296,6 +302,32 @@ gwy_graph_func_current(void)
     return func_info->name;
 }
 
+gboolean
+_gwy_graph_func_register_cached(const gchar *name,
+                                const gchar *menu_path,
+                                const gchar *stock_id,
+                                guint sens_mask,
+                                const gchar *tooltip)
+{
+    GwyGraphFuncInfo *func_info;
+
+    graph_funcs_init();
+
+    func_info = _gwy_module_register_function_info(graph_funcs,
+                                                   GWY_MODULE_PREFIX_GRAPH,
+                                                   name,
+                                                   sizeof(GwyGraphFuncInfo));
+    if (!func_info)
+        return FALSE;
+    func_info->name = name;
+    func_info->menu_path = menu_path;
+    func_info->stock_id = stock_id;
+    func_info->tooltip = tooltip;
+    func_info->sens_mask = sens_mask;
+
+    return TRUE;
+}
+
 gboolean
 _gwy_graph_func_remove(const gchar *name)
 {
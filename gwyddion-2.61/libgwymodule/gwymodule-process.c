@@ -48,6 +48,18 @@ typedef struct {
 static GHashTable *process_funcs = NULL;
 static GPtrArray *call_stack = NULL;
 
+static void
+process_funcs_init(void)
+{
+    if (process_funcs)
+        return;
+
+    gwy_debug("Initializing...");
+    process_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          NULL, g_free);
+    call_stack = g_ptr_array_new();
+}
+
 /**
  * gwy_process_func_register:
  * @name: Name of function to register.  It should be a valid identifier and
@@ -92,22 +104,17 @@ gwy_process_func_register(const gchar *name,
     gwy_debug("name = %s, menu path = %s, run = %d, func = %p",
               name, menu_path, run, func);
 
-    if (!process_funcs) {
-        gwy_debug("Initializing...");
-        process_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                              NULL, g_free);
-        call_stack = g_ptr_array_new();
-    }
+    process_funcs_init();
 
     if (!gwy_strisident(name, "_-", NULL))
         g_warning("Function name `%s' is not a valid identifier. "
                   "It may be rejected in future.", name);
-    if (g_hash_table_lookup(process_funcs, name)) {
-        g_warning("Duplicate function `%s', keeping only first", name);
+    func_info = _gwy_module_register_function_info(process_funcs,
+                                                   GWY_MODULE_PREFIX_PROC,
+                                                   name,
+                                                   sizeof(GwyProcessFuncInfo));
+    if (!func_info)
         return FALSE;
-    }
-
-    func_info = g_new0(GwyProcessFuncInfo, 1);
     func_info->name = name;
     func_info->func = func;
     func_info->menu_path = menu_path;
@@ -116,12 +123,6 @@ gwy_process_func_register(const gchar *name,
     func_info->run = run;
     func_info->sens_mask = sens_mask;
 
-    g_hash_table_insert(process_funcs, (gpointer)func_info->name, func_info);
-    if (!_gwy_module_add_registered_function(GWY_MODULE_PREFIX_PROC, name)) {
-        g_hash_table_remove(process_funcs, func_info->name);
-        return FALSE;
-    }
-
     return TRUE;
 }
 
@@ -143,6 +144,11 @@ gwy_process_func_run(const gchar *name,
     func_info = g_hash_table_lookup(process_funcs, name);
     g_return_if_fail(func_info);
     g_return_if_fail(run & func_info->run);
+    if (!func_info->func) {
+        _gwy_module_load_function(GWY_MODULE_PREFIX_PROC, name);
+        func_info = g_hash_table_lookup(process_funcs, name);
+        g_return_if_fail(func_info && func_info->func);
+    }
     g_ptr_array_add(call_stack, func_info);
     func_info->func(data, run, name);
     g_return_if_fail(call_stack->len);
@@ -324,6 +330,34 @@ gwy_process_func_current(void)
     return func_info->name;
 }
 
+gboolean
+_gwy_process_func_register_cached(const gchar *name,
+                                  const gchar *menu_path,
+                                  const gchar *stock_id,
+                                  guint run,
+                                  guint sens_mask,
+                                  const gchar *tooltip)
+{
+    GwyProcessFuncInfo *func_info;
+
+    process_funcs_init();
+
+    func_info = _gwy_module_register_function_info(process_funcs,
+                                                   GWY_MODULE_PREFIX_PROC,
+                                                   name,
+                                                   sizeof(GwyProcessFuncInfo));
+    if (!func_info)
+        return FALSE;
+    func_info->name = name;
+    func_info->menu_path = menu_path;
+    func_info->stock_id = stock_id;
+    func_info->tooltip = tooltip;
+    func_info->run = run;
+    func_info->sens_mask = sens_mask;
+
+    return TRUE;
+}
+
 gboolean
 _gwy_process_func_remove(const gchar *name)
 {
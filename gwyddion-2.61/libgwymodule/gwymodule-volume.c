@@ -48,6 +48,18 @@ typedef struct {
 static GHashTable *volume_funcs = NULL;
 static GPtrArray *call_stack = NULL;
 
+static void
+volume_funcs_init(void)
+{
+    if (volume_funcs)
+        return;
+
+    gwy_debug("Initializing...");
+    volume_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          NULL, g_free);
+    call_stack = g_ptr_array_new();
+}
+
 /**
  * gwy_volume_func_register:
  * @name: Name of function to register.  It should be a valid identifier and
@@ -94,22 +106,17 @@ gwy_volume_func_register(const gchar *name,
     gwy_debug("name = %s, menu path = %s, run = %d, func = %p",
               name, menu_path, run, func);
 
-    if (!volume_funcs) {
-        gwy_debug("Initializing...");
-        volume_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                              NULL, g_free);
-        call_stack = g_ptr_array_new();
-    }
+    volume_funcs_init();
 
     if (!gwy_strisident(name, "_-", NULL))
         g_warning("Function name `%s' is not a valid identifier. "
                   "It may be rejected in future.", name);
-    if (g_hash_table_lookup(volume_funcs, name)) {
-        g_warning("Duplicate function `%s', keeping only first", name);
+    func_info = _gwy_module_register_function_info(volume_funcs,
+                                                   GWY_MODULE_PREFIX_VOLUME,
+                                                   name,
+                                                   sizeof(GwyVolumeFuncInfo));
+    if (!func_info)
         return FALSE;
-    }
-
-    func_info = g_new0(GwyVolumeFuncInfo, 1);
     func_info->name = name;
     func_info->func = func;
     func_info->menu_path = menu_path;
@@ -118,12 +125,6 @@ gwy_volume_func_register(const gchar *name,
     func_info->run = run;
     func_info->sens_mask = sens_mask;
 
-    g_hash_table_insert(volume_funcs, (gpointer)func_info->name, func_info);
-    if (!_gwy_module_add_registered_function(GWY_MODULE_PREFIX_VOLUME, name)) {
-        g_hash_table_remove(volume_funcs, func_info->name);
-        return FALSE;
-    }
-
     return TRUE;
 }
 
@@ -147,6 +148,11 @@ gwy_volume_func_run(const gchar *name,
     func_info = g_hash_table_lookup(volume_funcs, name);
     g_return_if_fail(func_info);
     g_return_if_fail(run & func_info->run);
+    if (!func_info->func) {
+        _gwy_module_load_function(GWY_MODULE_PREFIX_VOLUME, name);
+        func_info = g_hash_table_lookup(volume_funcs, name);
+        g_return_if_fail(func_info && func_info->func);
+    }
     g_ptr_array_add(call_stack, func_info);
     func_info->func(data, run, name);
     g_return_if_fail(call_stack->len);
@@ -344,6 +350,34 @@ gwy_volume_func_current(void)
     return func_info->name;
 }
 
+gboolean
+_gwy_volume_func_register_cached(const gchar *name,
+                                 const gchar *menu_path,
+                                 const gchar *stock_id,
+                                 guint run,
+                                 guint sens_mask,
+                                 const gchar *tooltip)
+{
+    GwyVolumeFuncInfo *func_info;
+
+    volume_funcs_init();
+
+    func_info = _gwy_module_register_function_info(volume_funcs,
+                                                   GWY_MODULE_PREFIX_VOLUME,
+                                                   name,
+                                                   sizeof(GwyVolumeFuncInfo));
+    if (!func_info)
+        return FALSE;
+    func_info->name = name;
+    func_info->menu_path = menu_path;
+    func_info->stock_id = stock_id;
+    func_info->tooltip = tooltip;
+    func_info->run = run;
+    func_info->sens_mask = sens_mask;
+
+    return TRUE;
+}
+
 gboolean
 _gwy_volume_func_remove(const gchar *name)
 {
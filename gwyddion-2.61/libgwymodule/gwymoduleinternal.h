@@ -43,7 +43,8 @@ typedef struct {
     const GwyModuleInfo *mod_info;
     gchar *name;
     gchar *file;
-    gboolean loaded;
+    gboolean loaded;     /* FALSE if registered from the registry cache and not loaded yet. */
+    gboolean in_bundle;
     GSList *funcs;
 } _GwyModuleInfoInternal;
 
@@ -63,6 +64,23 @@ G_GNUC_INTERNAL
 gboolean _gwy_module_add_registered_function(const gchar *prefix,
                                              const gchar *name);
 
+G_GNUC_INTERNAL
+gboolean _gwy_module_load_function          (const gchar *prefix,
+                                             const gchar *name);
+
+G_GNUC_INTERNAL
+gpointer _gwy_module_register_function_info (GHashTable *functions,
+                                             const gchar *prefix,
+                                             const gchar *name,
+                                             gsize size);
+
+G_GNUC_INTERNAL
+const gchar* _gwy_module_get_detect_hint    (const gchar *extension);
+
+G_GNUC_INTERNAL
+void     _gwy_module_set_detect_hint        (const gchar *extension,
+                                             const gchar *name);
+
 G_GNUC_INTERNAL
 gboolean _gwy_file_func_remove              (const gchar *name);
 
@@ -87,6 +105,52 @@ gboolean _gwy_xyz_func_remove               (const gchar *name);
 G_GNUC_INTERNAL
 gboolean _gwy_cmap_func_remove              (const gchar *name);
 
+/* Registration of functions from the registry cache, without the module being loaded. */
+G_GNUC_INTERNAL
+gboolean _gwy_file_func_register_cached     (const gchar *name,
+                                             const gchar *description,
+                                             guint operations,
+                                             gboolean is_detectable);
+
+G_GNUC_INTERNAL
+gboolean _gwy_process_func_register_cached  (const gchar *name,
+                                             const gchar *menu_path,
+                                             const gchar *stock_id,
+                                             guint run,
+                                             guint sens_mask,
+                                             const gchar *tooltip);
+
+G_GNUC_INTERNAL
+gboolean _gwy_graph_func_register_cached    (const gchar *name,
+                                             const gchar *menu_path,
+                                             const gchar *stock_id,
+                                             guint sens_mask,
+                                             const gchar *tooltip);
+
+G_GNUC_INTERNAL
+gboolean _gwy_volume_func_register_cached   (const gchar *name,
+                                             const gchar *menu_path,
+                                             const gchar *stock_id,
+                                             guint run,
+                                             guint sens_mask,
+                                             const gchar *tooltip);
+
+G_GNUC_INTERNAL
+gboolean _gwy_xyz_func_register_cached      (const gchar *name,
+                                             const gchar *menu_path,
+                                             const gchar *stock_id,
+                                             guint run,
+                                             guint sens_mask,
+                                             const gchar *tooltip);
+
+G_GNUC_INTERNAL
+gboolean _gwy_cmap_func_register_cached     (const gchar *name,
+                                             const gchar *menu_path,
+                                             const gchar *stock_id,
+                                             guint run,
+                                             guint sens_mask,
+                                             const gchar *tooltip);
+
 G_END_DECLS
 
 #endif /* __GWY_MODULE_INTERNAL_H__ */
@@ -17,8 +17,16 @@
 
 #include "config.h"
 #include <string.h>
+#include <glib/gstdio.h>
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyversion.h>
+#include <libgwymodule/gwymodule-cmap.h>
+#include <libgwymodule/gwymodule-file.h>
+#include <libgwymodule/gwymodule-graph.h>
+#include <libgwymodule/gwymodule-process.h>
+#include <libgwymodule/gwymodule-volume.h>
+#include <libgwymodule/gwymodule-xyz.h>
 
 #include "gwymoduleinternal.h"
 
@@ -31,6 +39,9 @@
 
 #undef GWY_MODULE_PEDANTIC_CHECK
 
+/* Bump when the registry cache format changes. */
+#define REGISTRY_CACHE_FORMAT 1
+
 typedef struct {
     GHFunc func;
     gpointer data;
@@ -41,6 +52,13 @@ typedef struct {
     gpointer data;
 } GwyModuleFailForeachData;
 
+typedef struct {
+    gint64 mtime;
+    gint64 size;
+    gboolean from_cache;   /* Modules were registered from the cache and the cache entry is still valid. */
+    gboolean incomplete;   /* Some modules of a bundle were blocked so we do not know all of them. */
+} ModuleFileStat;
+
 static gboolean             check_python_availability     (void);
 static void                 gwy_load_modules_in_dir       (GDir *gdir,
                                                            const gchar *dirname,
@@ -68,12 +86,30 @@ static void                 gwy_module_register_fail      (GError *myerr,
 static GHashTable*          gwy_module_get_blocking_table (gboolean do_create);
 static gboolean             gwy_module_filename_is_blocked(const gchar *filename);
 static gboolean             gwy_module_name_is_blocked    (const gchar *modname);
+static gboolean             register_cached_module_file   (const gchar *filename,
+                                                           GHashTable *mods);
+static gboolean             load_cached_module            (_GwyModuleInfoInternal *iinfo);
+static gboolean             cached_module_file_is_current (const gchar *filename,
+                                                           ModuleFileStat *fstat);
+static void                 copy_cached_module_file       (GKeyFile *keyfile,
+                                                           const gchar *filename);
+static gboolean             save_module_file              (GKeyFile *keyfile,
+                                                           const gchar *filename,
+                                                           const ModuleFileStat *fstat);
 
 static GHashTable *modules = NULL;
 static GHashTable *failures = NULL;
 static gboolean modules_initialized = FALSE;
 static gchar *currenly_registered_module = NULL;
 
+/* Registry cache.  It is only used if gwy_module_load_registry_cache() was called. */
+static GKeyFile *registry_cache = NULL;
+static GHashTable *registry_files = NULL;
+static GHashTable *lazy_functions = NULL;
+static GStringChunk *cached_strings = NULL;
+static GHashTable *detect_hints = NULL;
+static gboolean detect_hints_changed = FALSE;
+
 /**
  * gwy_module_error_quark:
  *
@@ -132,21 +168,272 @@ gwy_module_register_modules(const gchar **paths)
     }
 }
 
+/**
+ * gwy_module_load_registry_cache:
+ * @filename: Name of the module registry cache file.
+ *
+ * Loads module registry cache from a file.
+ *
+ * The registry cache remembers which functions modules register.  When it is loaded, gwy_module_register_modules()
+ * does not load modules whose files have the same modification time and size as when they were cached.  Their
+ * functions are registered from the cache and each module is loaded only when one of its functions is actually used.
+ * This makes application startup considerably faster.  Modules registering tools or layers and modules whose set of
+ * functions depends on the environment are always loaded.
+ *
+ * File type detection needs to run the detection functions of file modules.  The cache remembers which function
+ * recognised files with given extension last time.  Detection loads and tries its module first and other file
+ * modules are loaded only if it does not recognise the file with a good magic header score.
+ *
+ * The cache must be loaded before any modules are registered.  A missing or outdated cache file is not an error as
+ * such.  The cache is then filled during module registration and can be written with
+ * gwy_module_save_registry_cache().
+ *
+ * Returns: %TRUE if the cache was read and is usable, %FALSE if it could not be read or was made by a different
+ *          Gwyddion version.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_module_load_registry_cache(const gchar *filename)
+{
+    gchar **keys;
+    gchar *version, *value;
+    gboolean ok;
+    guint i;
+
+    g_return_val_if_fail(filename, FALSE);
+    g_return_val_if_fail(!registry_cache, FALSE);
+    g_return_val_if_fail(!modules_initialized || !g_hash_table_size(modules), FALSE);
+
+    registry_cache = g_key_file_new();
+    registry_files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    lazy_functions = g_hash_table_new(g_str_hash, g_str_equal);
+    cached_strings = g_string_chunk_new(4096);
+    detect_hints = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    if (!(ok = g_key_file_load_from_file(registry_cache, filename, G_KEY_FILE_NONE, NULL)))
+        return FALSE;
+
+    version = g_key_file_get_string(registry_cache, "registry", "version", NULL);
+    ok = (g_key_file_get_integer(registry_cache, "registry", "format", NULL) == REGISTRY_CACHE_FORMAT
+          && g_key_file_get_integer(registry_cache, "registry", "abi", NULL) == GWY_MODULE_ABI_VERSION
+          && version && gwy_strequal(version, GWY_VERSION_STRING));
+    g_free(version);
+    if (!ok) {
+        gwy_debug("Registry cache %s is from a different version, ignoring it.", filename);
+        g_key_file_free(registry_cache);
+        registry_cache = g_key_file_new();
+        return FALSE;
+    }
+
+    if ((keys = g_key_file_get_keys(registry_cache, "detect", NULL, NULL))) {
+        for (i = 0; keys[i]; i++) {
+            if ((value = g_key_file_get_string(registry_cache, "detect", keys[i], NULL)))
+                g_hash_table_insert(detect_hints, g_strdup(keys[i]), value);
+        }
+        g_strfreev(keys);
+    }
+
+    return TRUE;
+}
+
+/**
+ * gwy_module_save_registry_cache:
+ * @filename: Name of the module registry cache file.
+ *
+ * Saves module registry cache to a file.
+ *
+ * This function can be only used after gwy_module_load_registry_cache().  It should be called after registering
+ * modules.  The file is only written if the cache has changed.
+ *
+ * Cache entries for module files which were not registered in this session are kept as long as the files exist and
+ * did not change.  Hence, programs registering different sets of modules can share one cache file.
+ *
+ * Returns: %TRUE if the cache was saved or did not need saving, %FALSE on failure.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_module_save_registry_cache(const gchar *filename)
+{
+    GKeyFile *keyfile;
+    GHashTableIter iter;
+    ModuleFileStat *fstat;
+    gpointer key, value;
+    gchar **groups;
+    gchar *buffer, *group;
+    gsize i, len;
+    gboolean changed = FALSE, ok;
+
+    g_return_val_if_fail(filename, FALSE);
+    g_return_val_if_fail(registry_cache, FALSE);
+
+    keyfile = g_key_file_new();
+    g_key_file_set_integer(keyfile, "registry", "format", REGISTRY_CACHE_FORMAT);
+    g_key_file_set_integer(keyfile, "registry", "abi", GWY_MODULE_ABI_VERSION);
+    g_key_file_set_string(keyfile, "registry", "version", GWY_VERSION_STRING);
+
+    /* Module files registered in this session. */
+    g_hash_table_iter_init(&iter, registry_files);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        fstat = (ModuleFileStat*)value;
+        if (fstat->from_cache) {
+            copy_cached_module_file(keyfile, (const gchar*)key);
+            continue;
+        }
+        /* Changed if we have a new entry or are dropping an outdated one. */
+        group = g_strconcat("file ", (const gchar*)key, NULL);
+        if (save_module_file(keyfile, (const gchar*)key, fstat) || g_key_file_has_group(registry_cache, group))
+            changed = TRUE;
+        g_free(group);
+    }
+
+    /* Module files we did not see.  Keep them if they did not change. */
+    groups = g_key_file_get_groups(registry_cache, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (!g_str_has_prefix(groups[i], "file ") || g_hash_table_lookup(registry_files, groups[i] + 5))
+            continue;
+        if (cached_module_file_is_current(groups[i] + 5, NULL))
+            copy_cached_module_file(keyfile, groups[i] + 5);
+        else
+            changed = TRUE;
+    }
+    g_strfreev(groups);
+
+    /* File type detection hints. */
+    g_hash_table_iter_init(&iter, detect_hints);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        g_key_file_set_string(keyfile, "detect", (const gchar*)key, (const gchar*)value);
+    if (detect_hints_changed)
+        changed = TRUE;
+
+    ok = TRUE;
+    if (changed) {
+        gwy_debug("Saving registry cache %s.", filename);
+        buffer = g_key_file_to_data(keyfile, &len, NULL);
+        if ((ok = g_file_set_contents(filename, buffer, len, NULL)))
+            detect_hints_changed = FALSE;
+        g_free(buffer);
+    }
+    g_key_file_free(keyfile);
+
+    return ok;
+}
+
 gboolean
 _gwy_module_add_registered_function(const gchar *prefix,
                                     const gchar *name)
 {
     _GwyModuleInfoInternal *info;
+    gchar *canonname;
 
     g_return_val_if_fail(modules_initialized, FALSE);
     g_return_val_if_fail(currenly_registered_module, FALSE);
     info = g_hash_table_lookup(modules, currenly_registered_module);
     g_return_val_if_fail(info, FALSE);
 
-    info->funcs = g_slist_append(info->funcs, g_strconcat(prefix, name, NULL));
+    canonname = g_strconcat(prefix, name, NULL);
+    /* When a module registered from the cache is loaded it registers the same functions again. */
+    if (g_slist_find_custom(info->funcs, canonname, (GCompareFunc)strcmp)) {
+        g_free(canonname);
+        return TRUE;
+    }
+    info->funcs = g_slist_append(info->funcs, canonname);
     return TRUE;
 }
 
+/* Detection hints remember which file type function recognised files with given extension last time.  File type
+ * detection can then load and try the module implementing this function first.  They are also kept in the registry
+ * cache, so they are available only if it is used. */
+const gchar*
+_gwy_module_get_detect_hint(const gchar *extension)
+{
+    if (!detect_hints || !extension)
+        return NULL;
+    return g_hash_table_lookup(detect_hints, extension);
+}
+
+void
+_gwy_module_set_detect_hint(const gchar *extension,
+                            const gchar *name)
+{
+    const gchar *hint;
+
+    if (!detect_hints || !extension || !name)
+        return;
+    if ((hint = g_hash_table_lookup(detect_hints, extension)) && gwy_strequal(hint, name))
+        return;
+
+    g_hash_table_replace(detect_hints, g_strdup(extension), g_strdup(name));
+    detect_hints_changed = TRUE;
+}
+
+/* Finds or creates the info of function @name of type @prefix in @functions when the function is being registered.
+ * Functions registered from the registry cache get their real data when the module is loaded, so their existing
+ * info is returned for filling in.  New info of @size bytes is zero-filled, inserted to @functions and added to the
+ * functions of the current module.  Returns %NULL if the function cannot be registered. */
+gpointer
+_gwy_module_register_function_info(GHashTable *functions,
+                                   const gchar *prefix,
+                                   const gchar *name,
+                                   gsize size)
+{
+    _GwyModuleInfoInternal *owner = NULL;
+    gpointer func_info;
+    gchar *canonname;
+
+    g_return_val_if_fail(functions, NULL);
+    g_return_val_if_fail(currenly_registered_module, NULL);
+
+    if (lazy_functions) {
+        canonname = g_strconcat(prefix, name, NULL);
+        owner = g_hash_table_lookup(lazy_functions, canonname);
+        g_free(canonname);
+    }
+    if (owner) {
+        if (gwy_strequal(owner->name, currenly_registered_module))
+            return g_hash_table_lookup(functions, name);
+        g_warning("Function %s%s of module %s is already registered by module %s from the registry cache, "
+                  "keeping only first", prefix, name, currenly_registered_module, owner->name);
+        return NULL;
+    }
+
+    if (g_hash_table_lookup(functions, name)) {
+        g_warning("Duplicate function %s%s, keeping only first", prefix, name);
+        return NULL;
+    }
+
+    func_info = g_malloc0(size);
+    g_hash_table_insert(functions, (gpointer)name, func_info);
+    if (!_gwy_module_add_registered_function(prefix, name)) {
+        g_hash_table_remove(functions, name);
+        return NULL;
+    }
+
+    return func_info;
+}
+
+gboolean
+_gwy_module_load_function(const gchar *prefix,
+                          const gchar *name)
+{
+    _GwyModuleInfoInternal *iinfo;
+    gchar *canonname;
+
+    if (!lazy_functions)
+        return FALSE;
+
+    canonname = g_strconcat(prefix, name, NULL);
+    iinfo = g_hash_table_lookup(lazy_functions, canonname);
+    g_free(canonname);
+    if (!iinfo)
+        return FALSE;
+    if (iinfo->loaded)
+        return TRUE;
+
+    return load_cached_module(iinfo);
+}
+
 static void
 gwy_module_failure_foreach_one(G_GNUC_UNUSED const gchar *key,
                                _GwyModuleFailureInfoInternal *finfo,
@@ -380,6 +667,7 @@ register_module_bundle(GHashTable *mods, const GwyModuleInfo *bundle_info,
     GwyModuleQueryFunc query;
     const GwyModuleRecord *records;
     GwyModuleBundleRegisterFunc register_bundle;
+    ModuleFileStat *fstat;
     GError *err = NULL;
     gchar *modname;
     guint i, nok = 0;
@@ -402,8 +690,11 @@ register_module_bundle(GHashTable *mods, const GwyModuleInfo *bundle_info,
 
     for (i = 0; records[i].query && records[i].name; i++) {
         gwy_debug("bundle module record for %s", records[i].name);
-        if (gwy_module_name_is_blocked(records[i].name))
+        if (gwy_module_name_is_blocked(records[i].name)) {
+            if (registry_files && (fstat = g_hash_table_lookup(registry_files, filename)))
+                fstat->incomplete = TRUE;
             continue;
+        }
 
         err = NULL;
         if (!gwy_module_check_module_name(records[i].name, mods, &err)) {
@@ -500,6 +791,7 @@ register_module_with_info(GHashTable *mods, const GwyModuleInfo *mod_info,
         iinfo->name = modname;
         iinfo->file = g_strdup(filename);
         iinfo->loaded = TRUE;
+        iinfo->in_bundle = in_bundle;
         iinfo->funcs = NULL;
         g_hash_table_insert(mods, (gpointer)iinfo->name, iinfo);
         if (!(ok = mod_info->register_func())) {
@@ -645,12 +937,538 @@ gwy_load_modules_in_dir(GDir *gdir,
          * get out of some hairy situations. */
         if (!gwy_module_filename_is_blocked(filename)) {
             modulename = g_build_filename(dirname, filename, NULL);
-            gwy_module_do_register_module(modulename, mods, NULL);
+            if (!register_cached_module_file(modulename, mods))
+                gwy_module_do_register_module(modulename, mods, NULL);
             g_free(modulename);
         }
     }
 }
 
+static const gchar*
+get_cached_string(const gchar *group,
+                  const gchar *key)
+{
+    const gchar *retval;
+    gchar *s;
+
+    if (!(s = g_key_file_get_string(registry_cache, group, key, NULL)))
+        return NULL;
+
+    retval = g_string_chunk_insert_const(cached_strings, s);
+    g_free(s);
+    return retval;
+}
+
+static void
+set_cached_string(GKeyFile *keyfile,
+                  const gchar *group,
+                  const gchar *key,
+                  const gchar *value)
+{
+    if (value)
+        g_key_file_set_string(keyfile, group, key, value);
+}
+
+/* GKeyFile has 64bit integer functions only since GLib 2.26. */
+static gint64
+get_cached_int64(const gchar *group,
+                 const gchar *key)
+{
+    gchar *s;
+    gint64 value;
+
+    if (!(s = g_key_file_get_value(registry_cache, group, key, NULL)))
+        return -1;
+
+    value = g_ascii_strtoll(s, NULL, 10);
+    g_free(s);
+    return value;
+}
+
+static void
+set_cached_int64(GKeyFile *keyfile,
+                 const gchar *group,
+                 const gchar *key,
+                 gint64 value)
+{
+    gchar buf[24];
+
+    g_snprintf(buf, sizeof(buf), "%" G_GINT64_FORMAT, value);
+    g_key_file_set_value(keyfile, group, key, buf);
+}
+
+static const gchar*
+function_name_from_canonical(const gchar *canonname,
+                             const gchar *prefix)
+{
+    if (!g_str_has_prefix(canonname, prefix))
+        return NULL;
+    return g_string_chunk_insert_const(cached_strings, canonname + strlen(prefix));
+}
+
+static gboolean
+cached_module_file_is_current(const gchar *filename,
+                              ModuleFileStat *fstat)
+{
+    GStatBuf st;
+    gchar *group;
+    gboolean ok;
+
+    group = g_strconcat("file ", filename, NULL);
+    if (fstat)
+        ok = (get_cached_int64(group, "mtime") == fstat->mtime && get_cached_int64(group, "size") == fstat->size);
+    else {
+        ok = (g_stat(filename, &st) == 0
+              && get_cached_int64(group, "mtime") == (gint64)st.st_mtime
+              && get_cached_int64(group, "size") == (gint64)st.st_size);
+    }
+    g_free(group);
+
+    return ok;
+}
+
+/* Checks whether all groups describing modules and functions in a module file are present in the cache, i.e. the
+ * file entry can be used as a whole. */
+static gboolean
+cached_module_file_is_complete(gchar **modnames)
+{
+    gchar **funcs;
+    gchar *group;
+    gboolean ok = TRUE;
+    guint i, j;
+
+    for (i = 0; ok && modnames[i]; i++) {
+        group = g_strconcat("module ", modnames[i], NULL);
+        funcs = g_key_file_get_string_list(registry_cache, group, "functions", NULL, NULL);
+        g_free(group);
+        ok = funcs && funcs[0];
+        for (j = 0; ok && funcs[j]; j++)
+            ok = g_key_file_has_group(registry_cache, funcs[j]);
+        g_strfreev(funcs);
+    }
+
+    return ok;
+}
+
+static gboolean
+register_cached_function(const gchar *canonname)
+{
+    const gchar *name, *menu_path, *stock_id, *tooltip;
+    guint run, sens_mask;
+
+    if ((name = function_name_from_canonical(canonname, GWY_MODULE_PREFIX_FILE))) {
+        return _gwy_file_func_register_cached(name, get_cached_string(canonname, "description"),
+                                              g_key_file_get_integer(registry_cache, canonname, "operations", NULL),
+                                              g_key_file_get_boolean(registry_cache, canonname, "detectable", NULL));
+    }
+
+    menu_path = get_cached_string(canonname, "menu-path");
+    stock_id = get_cached_string(canonname, "stock-id");
+    tooltip = get_cached_string(canonname, "tooltip");
+    run = g_key_file_get_integer(registry_cache, canonname, "run", NULL);
+    sens_mask = g_key_file_get_integer(registry_cache, canonname, "sensitivity", NULL);
+    if ((name = function_name_from_canonical(canonname, GWY_MODULE_PREFIX_PROC)))
+        return _gwy_process_func_register_cached(name, menu_path, stock_id, run, sens_mask, tooltip);
+    if ((name = function_name_from_canonical(canonname, GWY_MODULE_PREFIX_GRAPH)))
+        return _gwy_graph_func_register_cached(name, menu_path, stock_id, sens_mask, tooltip);
+    if ((name = function_name_from_canonical(canonname, GWY_MODULE_PREFIX_VOLUME)))
+        return _gwy_volume_func_register_cached(name, menu_path, stock_id, run, sens_mask, tooltip);
+    if ((name = function_name_from_canonical(canonname, GWY_MODULE_PREFIX_XYZ)))
+        return _gwy_xyz_func_register_cached(name, menu_path, stock_id, run, sens_mask, tooltip);
+    if ((name = function_name_from_canonical(canonname, GWY_MODULE_PREFIX_CMAP)))
+        return _gwy_cmap_func_register_cached(name, menu_path, stock_id, run, sens_mask, tooltip);
+
+    g_warning("Cannot register cached function %s of unknown type.", canonname);
+    return FALSE;
+}
+
+static void
+register_cached_module(GHashTable *mods,
+                       const gchar *filename,
+                       const gchar *modname,
+                       gboolean in_bundle)
+{
+    _GwyModuleInfoInternal *iinfo;
+    GwyModuleInfo *mod_info;
+    GError *err = NULL;
+    gchar **funcs;
+    gchar *group;
+    GSList *l;
+    guint i;
+
+    if (!gwy_module_check_module_name(modname, mods, &err)) {
+        gwy_module_register_fail(err, NULL, modname, filename);
+        return;
+    }
+
+    /* The info is replaced by the real one when the module is loaded. */
+    group = g_strconcat("module ", modname, NULL);
+    mod_info = g_new0(GwyModuleInfo, 1);
+    mod_info->abi_version = GWY_MODULE_ABI_VERSION;
+    mod_info->blurb = get_cached_string(group, "blurb");
+    mod_info->author = get_cached_string(group, "author");
+    mod_info->version = get_cached_string(group, "version");
+    mod_info->copyright = get_cached_string(group, "copyright");
+    mod_info->date = get_cached_string(group, "date");
+    funcs = g_key_file_get_string_list(registry_cache, group, "functions", NULL, NULL);
+    g_free(group);
+
+    iinfo = g_new0(_GwyModuleInfoInternal, 1);
+    iinfo->mod_info = mod_info;
+    iinfo->name = g_strdup(modname);
+    iinfo->file = g_strdup(filename);
+    iinfo->loaded = FALSE;
+    iinfo->in_bundle = in_bundle;
+    g_hash_table_insert(mods, (gpointer)iinfo->name, iinfo);
+
+    currenly_registered_module = iinfo->name;
+    for (i = 0; funcs && funcs[i]; i++)
+        register_cached_function(funcs[i]);
+    currenly_registered_module = NULL;
+    g_strfreev(funcs);
+
+    if (!iinfo->funcs) {
+        gwy_module_get_rid_of(iinfo->name);
+        return;
+    }
+    for (l = iinfo->funcs; l; l = g_slist_next(l))
+        g_hash_table_insert(lazy_functions, l->data, iinfo);
+}
+
+/* Registers modules in @filename using the registry cache if the file has not changed since it was cached.  Returns
+ * %FALSE if the file has to be loaded and registered normally. */
+static gboolean
+register_cached_module_file(const gchar *filename,
+                            GHashTable *mods)
+{
+    ModuleFileStat *fstat;
+    GStatBuf st;
+    gchar **modnames = NULL;
+    gchar *group;
+    gboolean in_bundle;
+    guint i;
+
+    if (!registry_cache || g_stat(filename, &st) != 0)
+        return FALSE;
+
+    fstat = g_new0(ModuleFileStat, 1);
+    fstat->mtime = st.st_mtime;
+    fstat->size = st.st_size;
+    g_hash_table_replace(registry_files, g_strdup(filename), fstat);
+    if (!cached_module_file_is_current(filename, fstat))
+        return FALSE;
+
+    group = g_strconcat("file ", filename, NULL);
+    modnames = g_key_file_get_string_list(registry_cache, group, "modules", NULL, NULL);
+    in_bundle = g_key_file_get_boolean(registry_cache, group, "bundle", NULL);
+    g_free(group);
+    if (!modnames || !modnames[0] || !cached_module_file_is_complete(modnames)) {
+        g_strfreev(modnames);
+        return FALSE;
+    }
+
+    gwy_debug("Registering modules from file `%s' using the registry cache.", filename);
+    for (i = 0; modnames[i]; i++) {
+        if (!in_bundle || !gwy_module_name_is_blocked(modnames[i]))
+            register_cached_module(mods, filename, modnames[i], in_bundle);
+    }
+    g_strfreev(modnames);
+    fstat->from_cache = TRUE;
+
+    return TRUE;
+}
+
+/* Loads a module registered from the registry cache and runs its registration function, which updates the cached
+ * function infos with the real ones. */
+static gboolean
+load_cached_module(_GwyModuleInfoInternal *iinfo)
+{
+    const GwyModuleInfo *mod_info = NULL;
+    const GwyModuleRecord *records = NULL;
+    GwyModuleQueryFunc query;
+    ModuleFileStat *fstat;
+    GModule *mod;
+    GError *err = NULL;
+    GSList *l;
+    guint i;
+
+    gwy_debug("Loading module `%s' from file `%s' on demand.", iinfo->name, iinfo->file);
+    mod = g_module_open(iinfo->file, G_MODULE_BIND_LAZY);
+    if (!mod) {
+        g_set_error(&err, GWY_MODULE_ERROR, GWY_MODULE_ERROR_OPEN, "Cannot open module: %s", g_module_error());
+        goto fail;
+    }
+    if (!g_module_symbol(mod, "_gwy_module_query", (gpointer)&query) || !query) {
+        g_set_error(&err, GWY_MODULE_ERROR, GWY_MODULE_ERROR_QUERY, "Module contains no query function");
+        goto fail;
+    }
+
+    mod_info = query();
+    if (iinfo->in_bundle) {
+        if (mod_info && mod_info->abi_version == (GWY_MODULE_ABI_VERSION | GWY_MODULE_BUNDLE_FLAG)
+            && mod_info->register_func)
+            records = ((GwyModuleBundleRegisterFunc)mod_info->register_func)();
+        mod_info = NULL;
+        for (i = 0; records && records[i].query && records[i].name; i++) {
+            if (gwy_strequal(records[i].name, iinfo->name)) {
+                mod_info = records[i].query();
+                break;
+            }
+        }
+    }
+    if (!mod_info || mod_info->abi_version != GWY_MODULE_ABI_VERSION || !mod_info->register_func) {
+        g_set_error(&err, GWY_MODULE_ERROR, GWY_MODULE_ERROR_ABI, "Module info does not match the registry cache");
+        goto fail;
+    }
+
+    g_module_make_resident(mod);
+    g_free((gpointer)iinfo->mod_info);
+    iinfo->mod_info = mod_info;
+    iinfo->loaded = TRUE;
+    currenly_registered_module = iinfo->name;
+    if (mod_info->register_func()) {
+        currenly_registered_module = NULL;
+        /* The functions are now registered for real and their names can be taken by another module only as
+         * duplicates. */
+        for (l = iinfo->funcs; l; l = g_slist_next(l))
+            g_hash_table_remove(lazy_functions, l->data);
+        return TRUE;
+    }
+    currenly_registered_module = NULL;
+    g_set_error(&err, GWY_MODULE_ERROR, GWY_MODULE_ERROR_REGISTER, "Module feature registration failed");
+    mod = NULL;
+
+fail:
+    g_warning("Cannot load module `%s' registered from the registry cache: %s", iinfo->name, err->message);
+    if (mod && !g_module_close(mod)) {
+        g_critical("Cannot unload module `%s': %s", iinfo->file, g_module_error());
+    }
+    /* Make the module file register normally next time. */
+    if ((fstat = g_hash_table_lookup(registry_files, iinfo->file)))
+        fstat->from_cache = FALSE;
+    gwy_module_register_fail(err, NULL, iinfo->name, iinfo->file);
+    gwy_module_get_rid_of(iinfo->name);
+
+    return FALSE;
+}
+
+static gboolean
+module_file_has_failures(const gchar *filename)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    if (!failures)
+        return FALSE;
+
+    g_hash_table_iter_init(&iter, failures);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        if (gwy_strequal(((_GwyModuleFailureInfoInternal*)value)->filename, filename))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Modules registering tools and layers are always loaded because they need to provide GTypes.  Some modules
+ * register functions depending on the environment, for instance available Python or GdkPixbuf loaders. */
+static gboolean
+module_is_cacheable(const _GwyModuleInfoInternal *iinfo)
+{
+    static const gchar *const uncacheable_modules[] = { "imgexport", "pixmap", "plugin-proxy", "pygwy", };
+    static const gchar *const cacheable_prefixes[] = {
+        GWY_MODULE_PREFIX_PROC, GWY_MODULE_PREFIX_FILE, GWY_MODULE_PREFIX_GRAPH,
+        GWY_MODULE_PREFIX_VOLUME, GWY_MODULE_PREFIX_XYZ, GWY_MODULE_PREFIX_CMAP,
+    };
+    GSList *l;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(uncacheable_modules); i++) {
+        if (gwy_strequal(iinfo->name, uncacheable_modules[i]))
+            return FALSE;
+    }
+    if (!iinfo->funcs)
+        return FALSE;
+    for (l = iinfo->funcs; l; l = g_slist_next(l)) {
+        for (i = 0; i < G_N_ELEMENTS(cacheable_prefixes); i++) {
+            if (g_str_has_prefix((const gchar*)l->data, cacheable_prefixes[i]))
+                break;
+        }
+        if (i == G_N_ELEMENTS(cacheable_prefixes))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+save_function(GKeyFile *keyfile,
+              const gchar *canonname)
+{
+    const gchar *name;
+
+    if (g_str_has_prefix(canonname, GWY_MODULE_PREFIX_FILE)) {
+        name = canonname + strlen(GWY_MODULE_PREFIX_FILE);
+        set_cached_string(keyfile, canonname, "description", gwy_file_func_get_description(name));
+        g_key_file_set_integer(keyfile, canonname, "operations", gwy_file_func_get_operations(name));
+        g_key_file_set_boolean(keyfile, canonname, "detectable", gwy_file_func_get_is_detectable(name));
+    }
+    else if (g_str_has_prefix(canonname, GWY_MODULE_PREFIX_PROC)) {
+        name = canonname + strlen(GWY_MODULE_PREFIX_PROC);
+        set_cached_string(keyfile, canonname, "menu-path", gwy_process_func_get_menu_path(name));
+        set_cached_string(keyfile, canonname, "stock-id", gwy_process_func_get_stock_id(name));
+        set_cached_string(keyfile, canonname, "tooltip", gwy_process_func_get_tooltip(name));
+        g_key_file_set_integer(keyfile, canonname, "run", gwy_process_func_get_run_types(name));
+        g_key_file_set_integer(keyfile, canonname, "sensitivity", gwy_process_func_get_sensitivity_mask(name));
+    }
+    else if (g_str_has_prefix(canonname, GWY_MODULE_PREFIX_GRAPH)) {
+        name = canonname + strlen(GWY_MODULE_PREFIX_GRAPH);
+        set_cached_string(keyfile, canonname, "menu-path", gwy_graph_func_get_menu_path(name));
+        set_cached_string(keyfile, canonname, "stock-id", gwy_graph_func_get_stock_id(name));
+        set_cached_string(keyfile, canonname, "tooltip", gwy_graph_func_get_tooltip(name));
+        g_key_file_set_integer(keyfile, canonname, "sensitivity", gwy_graph_func_get_sensitivity_mask(name));
+    }
+    else if (g_str_has_prefix(canonname, GWY_MODULE_PREFIX_VOLUME)) {
+        name = canonname + strlen(GWY_MODULE_PREFIX_VOLUME);
+        set_cached_string(keyfile, canonname, "menu-path", gwy_volume_func_get_menu_path(name));
+        set_cached_string(keyfile, canonname, "stock-id", gwy_volume_func_get_stock_id(name));
+        set_cached_string(keyfile, canonname, "tooltip", gwy_volume_func_get_tooltip(name));
+        g_key_file_set_integer(keyfile, canonname, "run", gwy_volume_func_get_run_types(name));
+        g_key_file_set_integer(keyfile, canonname, "sensitivity", gwy_volume_func_get_sensitivity_mask(name));
+    }
+    else if (g_str_has_prefix(canonname, GWY_MODULE_PREFIX_XYZ)) {
+        name = canonname + strlen(GWY_MODULE_PREFIX_XYZ);
+        set_cached_string(keyfile, canonname, "menu-path", gwy_xyz_func_get_menu_path(name));
+        set_cached_string(keyfile, canonname, "stock-id", gwy_xyz_func_get_stock_id(name));
+        set_cached_string(keyfile, canonname, "tooltip", gwy_xyz_func_get_tooltip(name));
+        g_key_file_set_integer(keyfile, canonname, "run", gwy_xyz_func_get_run_types(name));
+        g_key_file_set_integer(keyfile, canonname, "sensitivity", gwy_xyz_func_get_sensitivity_mask(name));
+    }
+    else if (g_str_has_prefix(canonname, GWY_MODULE_PREFIX_CMAP)) {
+        name = canonname + strlen(GWY_MODULE_PREFIX_CMAP);
+        set_cached_string(keyfile, canonname, "menu-path", gwy_curve_map_func_get_menu_path(name));
+        set_cached_string(keyfile, canonname, "stock-id", gwy_curve_map_func_get_stock_id(name));
+        set_cached_string(keyfile, canonname, "tooltip", gwy_curve_map_func_get_tooltip(name));
+        g_key_file_set_integer(keyfile, canonname, "run", gwy_curve_map_func_get_run_types(name));
+        g_key_file_set_integer(keyfile, canonname, "sensitivity", gwy_curve_map_func_get_sensitivity_mask(name));
+    }
+    else {
+        g_assert_not_reached();
+    }
+}
+
+/* Saves modules loaded from @filename in this session.  Returns %TRUE if the file was cacheable. */
+static gboolean
+save_module_file(GKeyFile *keyfile,
+                 const gchar *filename,
+                 const ModuleFileStat *fstat)
+{
+    const GwyModuleInfo *mod_info;
+    _GwyModuleInfoInternal *iinfo;
+    GHashTableIter iter;
+    GPtrArray *infos;
+    gpointer value;
+    const gchar **names, **funcs;
+    gchar *group;
+    gboolean ok;
+    GSList *l;
+    guint i, n;
+
+    if (fstat->incomplete || module_file_has_failures(filename))
+        return FALSE;
+
+    infos = g_ptr_array_new();
+    g_hash_table_iter_init(&iter, modules);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        if (gwy_strequal(((_GwyModuleInfoInternal*)value)->file, filename))
+            g_ptr_array_add(infos, value);
+    }
+    ok = (infos->len > 0);
+    for (i = 0; ok && i < infos->len; i++)
+        ok = module_is_cacheable(g_ptr_array_index(infos, i));
+    if (!ok) {
+        g_ptr_array_free(infos, TRUE);
+        return FALSE;
+    }
+
+    names = g_new(const gchar*, infos->len);
+    for (i = 0; i < infos->len; i++) {
+        iinfo = g_ptr_array_index(infos, i);
+        mod_info = iinfo->mod_info;
+        group = g_strconcat("module ", iinfo->name, NULL);
+        set_cached_string(keyfile, group, "blurb", mod_info->blurb);
+        set_cached_string(keyfile, group, "author", mod_info->author);
+        set_cached_string(keyfile, group, "version", mod_info->version);
+        set_cached_string(keyfile, group, "copyright", mod_info->copyright);
+        set_cached_string(keyfile, group, "date", mod_info->date);
+        funcs = g_new(const gchar*, g_slist_length(iinfo->funcs));
+        for (l = iinfo->funcs, n = 0; l; l = g_slist_next(l), n++) {
+            save_function(keyfile, (const gchar*)l->data);
+            funcs[n] = (const gchar*)l->data;
+        }
+        g_key_file_set_string_list(keyfile, group, "functions", funcs, n);
+        g_free(funcs);
+        g_free(group);
+        names[i] = iinfo->name;
+    }
+
+    group = g_strconcat("file ", filename, NULL);
+    set_cached_int64(keyfile, group, "mtime", fstat->mtime);
+    set_cached_int64(keyfile, group, "size", fstat->size);
+    iinfo = g_ptr_array_index(infos, 0);
+    g_key_file_set_boolean(keyfile, group, "bundle", iinfo->in_bundle);
+    g_key_file_set_string_list(keyfile, group, "modules", names, infos->len);
+    g_free(group);
+    g_free(names);
+    g_ptr_array_free(infos, TRUE);
+
+    return TRUE;
+}
+
+static void
+copy_cached_group(GKeyFile *keyfile,
+                  const gchar *group)
+{
+    gchar **keys;
+    gchar *value;
+    guint i;
+
+    if (!(keys = g_key_file_get_keys(registry_cache, group, NULL, NULL)))
+        return;
+
+    for (i = 0; keys[i]; i++) {
+        if ((value = g_key_file_get_value(registry_cache, group, keys[i], NULL))) {
+            g_key_file_set_value(keyfile, group, keys[i], value);
+            g_free(value);
+        }
+    }
+    g_strfreev(keys);
+}
+
+/* Copies the cache entry of @filename with all its modules and functions. */
+static void
+copy_cached_module_file(GKeyFile *keyfile,
+                        const gchar *filename)
+{
+    gchar **modnames, **funcs;
+    gchar *group;
+    guint i, j;
+
+    group = g_strconcat("file ", filename, NULL);
+    copy_cached_group(keyfile, group);
+    modnames = g_key_file_get_string_list(registry_cache, group, "modules", NULL, NULL);
+    g_free(group);
+
+    for (i = 0; modnames && modnames[i]; i++) {
+        group = g_strconcat("module ", modnames[i], NULL);
+        copy_cached_group(keyfile, group);
+        funcs = g_key_file_get_string_list(registry_cache, group, "functions", NULL, NULL);
+        for (j = 0; funcs && funcs[j]; j++)
+            copy_cached_group(keyfile, funcs[j]);
+        g_strfreev(funcs);
+        g_free(group);
+    }
+    g_strfreev(modnames);
+}
+
 #ifdef GWY_MODULE_PEDANTIC_CHECK
 static gboolean
 gwy_module_pedantic_check(_GwyModuleInfoInternal *iinfo)
@@ -740,7 +1558,10 @@ gwy_module_get_rid_of(const gchar *modname)
     /* FIXME: this is quite crude, it can remove functions of the same name
      * in different module type */
     for (l = iinfo->funcs; l; l = g_slist_next(l)) {
-        gchar *canon_name = (gchar*)iinfo->funcs->data;
+        gchar *canon_name = (gchar*)l->data;
+
+        if (lazy_functions)
+            g_hash_table_remove(lazy_functions, canon_name);
 
         for (i = 0; i < G_N_ELEMENTS(gro_funcs); i++) {
             if (g_str_has_prefix(canon_name, gro_funcs[i].prefix)
@@ -755,6 +1576,9 @@ gwy_module_get_rid_of(const gchar *modname)
     g_slist_free(iinfo->funcs);
     iinfo->funcs = NULL;
     g_hash_table_remove(modules, (gpointer)iinfo->name);
+    /* Module info of modules registered from the cache is ours. */
+    if (!iinfo->loaded)
+        g_free((gpointer)iinfo->mod_info);
     g_free(iinfo->name);
     g_free(iinfo->file);
     g_free(iinfo);
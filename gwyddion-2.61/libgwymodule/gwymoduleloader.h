@@ -104,6 +104,8 @@ const GwyModuleInfo* gwy_module_register_module     (const gchar *name,
 void                 gwy_module_disable_registration(const gchar *name);
 void                 gwy_module_enable_registration (const gchar *name);
 gboolean             gwy_module_is_enabled          (const gchar *name);
+gboolean             gwy_module_load_registry_cache (const gchar *filename);
+gboolean             gwy_module_save_registry_cache (const gchar *filename);
 
 G_END_DECLS
 
@@ -0,0 +1,827 @@
+/*
+ *  $Id$
+ *  Copyright (C) 2022 David Necas (Yeti).
+ *  E-mail: yeti@gwyddion.net.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any
+ *  later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with this program; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <libgwyddion/gwymacros.h>
+#include <libprocess/bitmask.h>
+#include "libgwyddion/gwyomp.h"
+#include "gwyprocessinternal.h"
+
+#define WORD_BITS 64
+#define ALL_SET G_GUINT64_CONSTANT(0xffffffffffffffff)
+#define BIT(j) (G_GUINT64_CONSTANT(1) << ((j) % WORD_BITS))
+
+/* Rows are stored as whole 64bit words, column j being bit j % 64 of word j/64 (least significant bit first).
+ * Padding bits beyond xres in the last word of each row are always zero. */
+struct _GwyBitMask {
+    guint xres;
+    guint yres;
+    guint stride;
+    guint64 tail;
+    guint64 *data;
+};
+
+GType
+gwy_bit_mask_get_type(void)
+{
+    static GType bit_mask_type = 0;
+
+    if (G_UNLIKELY(!bit_mask_type)) {
+        bit_mask_type = g_boxed_type_register_static("GwyBitMask",
+                                                     (GBoxedCopyFunc)gwy_bit_mask_copy,
+                                                     (GBoxedFreeFunc)gwy_bit_mask_free);
+    }
+
+    return bit_mask_type;
+}
+
+static inline guint
+popcount64(guint64 x)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+    x = (x & G_GUINT64_CONSTANT(0x3333333333333333)) + ((x >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+    x = (x + (x >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+    return (x*G_GUINT64_CONSTANT(0x0101010101010101)) >> 56;
+#endif
+}
+
+static GwyBitMask*
+bit_mask_new_raw(guint xres, guint yres, gboolean clear)
+{
+    GwyBitMask *mask = g_slice_new(GwyBitMask);
+    guint r = xres % WORD_BITS;
+
+    mask->xres = xres;
+    mask->yres = yres;
+    mask->stride = (xres + WORD_BITS-1)/WORD_BITS;
+    mask->tail = r ? BIT(r) - 1 : ALL_SET;
+    if (clear)
+        mask->data = g_new0(guint64, mask->stride*yres);
+    else
+        mask->data = g_new(guint64, mask->stride*yres);
+
+    return mask;
+}
+
+static gboolean
+bit_mask_check_compatibility(const GwyBitMask *mask, const GwyBitMask *operand)
+{
+    g_return_val_if_fail(mask, FALSE);
+    g_return_val_if_fail(operand, FALSE);
+    g_return_val_if_fail(operand->xres == mask->xres, FALSE);
+    g_return_val_if_fail(operand->yres == mask->yres, FALSE);
+    return TRUE;
+}
+
+/**
+ * gwy_bit_mask_new:
+ * @xres: Number of columns.
+ * @yres: Number of rows.
+ *
+ * Creates a new empty bit mask.
+ *
+ * Returns: A newly created bit mask with all pixels unset.
+ *
+ * Since: 2.62
+ **/
+GwyBitMask*
+gwy_bit_mask_new(guint xres, guint yres)
+{
+    g_return_val_if_fail(xres && yres, NULL);
+    return bit_mask_new_raw(xres, yres, TRUE);
+}
+
+/**
+ * gwy_bit_mask_new_from_field:
+ * @field: A data field representing a mask.
+ *
+ * Creates a new bit mask from a data field representing a mask.
+ *
+ * Pixels with positive values in @field are set in the bit mask; all other pixels are unset.
+ *
+ * Returns: A newly created bit mask with the same dimensions as @field.
+ *
+ * Since: 2.62
+ **/
+GwyBitMask*
+gwy_bit_mask_new_from_field(GwyDataField *field)
+{
+    GwyBitMask *mask;
+
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(field), NULL);
+    mask = bit_mask_new_raw(field->xres, field->yres, FALSE);
+    gwy_bit_mask_set_from_field(mask, field);
+
+    return mask;
+}
+
+/**
+ * gwy_bit_mask_copy:
+ * @mask: A bit mask.
+ *
+ * Creates an identical copy of a bit mask.
+ *
+ * Returns: A newly created bit mask.
+ *
+ * Since: 2.62
+ **/
+GwyBitMask*
+gwy_bit_mask_copy(const GwyBitMask *mask)
+{
+    GwyBitMask *copy;
+
+    g_return_val_if_fail(mask, NULL);
+    copy = bit_mask_new_raw(mask->xres, mask->yres, FALSE);
+    gwy_assign(copy->data, mask->data, mask->stride*mask->yres);
+
+    return copy;
+}
+
+/**
+ * gwy_bit_mask_free:
+ * @mask: A bit mask.
+ *
+ * Frees a bit mask and all associated resources.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_free(GwyBitMask *mask)
+{
+    g_return_if_fail(mask);
+    g_free(mask->data);
+    g_slice_free(GwyBitMask, mask);
+}
+
+/**
+ * gwy_bit_mask_get_xres:
+ * @mask: A bit mask.
+ *
+ * Gets the number of columns of a bit mask.
+ *
+ * Returns: The number of columns.
+ *
+ * Since: 2.62
+ **/
+guint
+gwy_bit_mask_get_xres(const GwyBitMask *mask)
+{
+    g_return_val_if_fail(mask, 0);
+    return mask->xres;
+}
+
+/**
+ * gwy_bit_mask_get_yres:
+ * @mask: A bit mask.
+ *
+ * Gets the number of rows of a bit mask.
+ *
+ * Returns: The number of rows.
+ *
+ * Since: 2.62
+ **/
+guint
+gwy_bit_mask_get_yres(const GwyBitMask *mask)
+{
+    g_return_val_if_fail(mask, 0);
+    return mask->yres;
+}
+
+/**
+ * gwy_bit_mask_set_from_field:
+ * @mask: A bit mask.
+ * @field: A data field representing a mask.  It must have the same dimensions as @mask.
+ *
+ * Sets the pixels of a bit mask from a data field representing a mask.
+ *
+ * Pixels with positive values in @field are set in the bit mask; all other pixels are unset.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_set_from_field(GwyBitMask *mask, GwyDataField *field)
+{
+    const gdouble *d;
+    guint64 *m;
+    guint xres, yres, stride, i;
+
+    g_return_if_fail(mask);
+    g_return_if_fail(GWY_IS_DATA_FIELD(field));
+    g_return_if_fail(field->xres == mask->xres && field->yres == mask->yres);
+
+    xres = mask->xres;
+    yres = mask->yres;
+    stride = mask->stride;
+    d = field->data;
+    m = mask->data;
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(d,m,xres,yres,stride)
+#endif
+    for (i = 0; i < yres; i++) {
+        const gdouble *drow = d + i*xres;
+        guint64 *mrow = m + i*stride;
+        guint j, k;
+
+        for (k = 0; k < stride; k++) {
+            guint jto = MIN(xres - k*WORD_BITS, WORD_BITS);
+            guint64 w = 0;
+
+            for (j = 0; j < jto; j++)
+                w |= (guint64)(drow[j] > 0.0) << j;
+            mrow[k] = w;
+            drow += WORD_BITS;
+        }
+    }
+}
+
+/**
+ * gwy_bit_mask_to_field:
+ * @mask: A bit mask.
+ * @field: A data field to fill.  It must have the same dimensions as @mask.
+ *
+ * Fills a data field representing a mask with the pixels of a bit mask.
+ *
+ * Set pixels become 1.0 and unset pixels become 0.0.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_to_field(const GwyBitMask *mask, GwyDataField *field)
+{
+    const guint64 *m;
+    gdouble *d;
+    guint xres, yres, stride, i;
+
+    g_return_if_fail(mask);
+    g_return_if_fail(GWY_IS_DATA_FIELD(field));
+    g_return_if_fail(field->xres == mask->xres && field->yres == mask->yres);
+
+    xres = mask->xres;
+    yres = mask->yres;
+    stride = mask->stride;
+    d = field->data;
+    m = mask->data;
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(d,m,xres,yres,stride)
+#endif
+    for (i = 0; i < yres; i++) {
+        gdouble *drow = d + i*xres;
+        const guint64 *mrow = m + i*stride;
+        guint j, k;
+
+        for (k = 0; k < stride; k++) {
+            guint jto = MIN(xres - k*WORD_BITS, WORD_BITS);
+            guint64 w = mrow[k];
+
+            if (!w)
+                gwy_clear(drow, jto);
+            else {
+                for (j = 0; j < jto; j++)
+                    drow[j] = (w >> j) & 1;
+            }
+            drow += WORD_BITS;
+        }
+    }
+    gwy_data_field_invalidate(field);
+}
+
+/* Writes the bit mask to a mask data field modifying only some pixels: set pixels become 1.0 if @set is TRUE and
+ * unset pixels become 0.0 if @set is FALSE.  The other pixels keep their values (they need not be zeroes and ones).
+ * Grain growing and shrinking use this to only touch pixels the morphological operation could affect. */
+void
+_gwy_bit_mask_merge_to_field(const GwyBitMask *mask, GwyDataField *field, gboolean set)
+{
+    const guint64 *m;
+    gdouble *d;
+    guint xres, yres, stride, i;
+
+    g_return_if_fail(field->xres == mask->xres && field->yres == mask->yres);
+
+    xres = mask->xres;
+    yres = mask->yres;
+    stride = mask->stride;
+    d = field->data;
+    m = mask->data;
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(d,m,xres,yres,stride,set)
+#endif
+    for (i = 0; i < yres; i++) {
+        gdouble *drow = d + i*xres;
+        const guint64 *mrow = m + i*stride;
+        guint j, k;
+
+        for (k = 0; k < stride; k++) {
+            guint jto = MIN(xres - k*WORD_BITS, WORD_BITS);
+            /* Bits of pixels to modify. */
+            guint64 w = set ? mrow[k] : ~mrow[k];
+
+            if (jto < WORD_BITS)
+                w &= BIT(jto) - 1;
+            if (w) {
+                for (j = 0; j < jto; j++) {
+                    if ((w >> j) & 1)
+                        drow[j] = set ? 1.0 : 0.0;
+                }
+            }
+            drow += WORD_BITS;
+        }
+    }
+    gwy_data_field_invalidate(field);
+}
+
+/**
+ * gwy_bit_mask_get:
+ * @mask: A bit mask.
+ * @col: Column index.
+ * @row: Row index.
+ *
+ * Gets the state of one bit mask pixel.
+ *
+ * Returns: %TRUE if the pixel is set, %FALSE if it is unset.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_bit_mask_get(const GwyBitMask *mask, guint col, guint row)
+{
+    g_return_val_if_fail(mask, FALSE);
+    g_return_val_if_fail(col < mask->xres && row < mask->yres, FALSE);
+    return !!(mask->data[row*mask->stride + col/WORD_BITS] & BIT(col));
+}
+
+/**
+ * gwy_bit_mask_set:
+ * @mask: A bit mask.
+ * @col: Column index.
+ * @row: Row index.
+ * @value: %TRUE to set the pixel, %FALSE to unset it.
+ *
+ * Sets the state of one bit mask pixel.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_set(GwyBitMask *mask, guint col, guint row, gboolean value)
+{
+    guint64 *w;
+
+    g_return_if_fail(mask);
+    g_return_if_fail(col < mask->xres && row < mask->yres);
+    w = mask->data + row*mask->stride + col/WORD_BITS;
+    if (value)
+        *w |= BIT(col);
+    else
+        *w &= ~BIT(col);
+}
+
+/* Restore the invariant of zero padding bits after whole-word operations. */
+static void
+bit_mask_clear_padding(GwyBitMask *mask)
+{
+    guint i, stride = mask->stride;
+
+    if (mask->tail == ALL_SET)
+        return;
+
+    for (i = 0; i < mask->yres; i++)
+        mask->data[(i + 1)*stride - 1] &= mask->tail;
+}
+
+/**
+ * gwy_bit_mask_fill:
+ * @mask: A bit mask.
+ * @value: %TRUE to set all pixels, %FALSE to unset all pixels.
+ *
+ * Sets all pixels of a bit mask to the same state.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_fill(GwyBitMask *mask, gboolean value)
+{
+    guint k, n;
+
+    g_return_if_fail(mask);
+    n = mask->stride*mask->yres;
+    if (!value) {
+        gwy_clear(mask->data, n);
+        return;
+    }
+    for (k = 0; k < n; k++)
+        mask->data[k] = ALL_SET;
+    bit_mask_clear_padding(mask);
+}
+
+/**
+ * gwy_bit_mask_invert:
+ * @mask: A bit mask.
+ *
+ * Inverts all pixels of a bit mask.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_invert(GwyBitMask *mask)
+{
+    guint k, n;
+
+    g_return_if_fail(mask);
+    n = mask->stride*mask->yres;
+    for (k = 0; k < n; k++)
+        mask->data[k] = ~mask->data[k];
+    bit_mask_clear_padding(mask);
+}
+
+/**
+ * gwy_bit_mask_and:
+ * @mask: A bit mask to modify.
+ * @operand: Another bit mask of the same dimensions.
+ *
+ * Performs logical conjunction of two bit masks.
+ *
+ * Only pixels set in both masks are kept set in @mask.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_and(GwyBitMask *mask, const GwyBitMask *operand)
+{
+    guint k, n;
+
+    if (!bit_mask_check_compatibility(mask, operand))
+        return;
+    n = mask->stride*mask->yres;
+    for (k = 0; k < n; k++)
+        mask->data[k] &= operand->data[k];
+}
+
+/**
+ * gwy_bit_mask_or:
+ * @mask: A bit mask to modify.
+ * @operand: Another bit mask of the same dimensions.
+ *
+ * Performs logical disjunction of two bit masks.
+ *
+ * Pixels set in any of the masks become set in @mask.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_or(GwyBitMask *mask, const GwyBitMask *operand)
+{
+    guint k, n;
+
+    if (!bit_mask_check_compatibility(mask, operand))
+        return;
+    n = mask->stride*mask->yres;
+    for (k = 0; k < n; k++)
+        mask->data[k] |= operand->data[k];
+}
+
+/**
+ * gwy_bit_mask_xor:
+ * @mask: A bit mask to modify.
+ * @operand: Another bit mask of the same dimensions.
+ *
+ * Performs exclusive disjunction of two bit masks.
+ *
+ * Pixels set in exactly one of the masks become set in @mask.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_xor(GwyBitMask *mask, const GwyBitMask *operand)
+{
+    guint k, n;
+
+    if (!bit_mask_check_compatibility(mask, operand))
+        return;
+    n = mask->stride*mask->yres;
+    for (k = 0; k < n; k++)
+        mask->data[k] ^= operand->data[k];
+}
+
+/**
+ * gwy_bit_mask_subtract:
+ * @mask: A bit mask to modify.
+ * @operand: Another bit mask of the same dimensions.
+ *
+ * Subtracts one bit mask from another.
+ *
+ * Pixels set in @operand become unset in @mask.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_subtract(GwyBitMask *mask, const GwyBitMask *operand)
+{
+    guint k, n;
+
+    if (!bit_mask_check_compatibility(mask, operand))
+        return;
+    n = mask->stride*mask->yres;
+    for (k = 0; k < n; k++)
+        mask->data[k] &= ~operand->data[k];
+}
+
+/**
+ * gwy_bit_mask_count:
+ * @mask: A bit mask.
+ *
+ * Counts set pixels in a bit mask.
+ *
+ * Returns: The number of set pixels.
+ *
+ * Since: 2.62
+ **/
+guint
+gwy_bit_mask_count(const GwyBitMask *mask)
+{
+    const guint64 *m;
+    guint k, n, count = 0;
+
+    g_return_val_if_fail(mask, 0);
+    n = mask->stride*mask->yres;
+    m = mask->data;
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            reduction(+:count) \
+            private(k) \
+            shared(m,n)
+#endif
+    for (k = 0; k < n; k++)
+        count += popcount64(m[k]);
+
+    return count;
+}
+
+/* Shift one row by @shift bits towards higher column indices (negative values shift towards lower ones), filling
+ * the vacated bits with zeroes. */
+static void
+shift_row(const guint64 *src, guint64 *dest, guint stride, gint shift)
+{
+    guint q, r, k;
+
+    if (shift >= 0) {
+        q = shift/WORD_BITS;
+        r = shift % WORD_BITS;
+        for (k = 0; k < stride; k++) {
+            guint64 w = 0;
+
+            if (k >= q) {
+                w = src[k - q] << r;
+                if (r && k > q)
+                    w |= src[k - q - 1] >> (WORD_BITS - r);
+            }
+            dest[k] = w;
+        }
+    }
+    else {
+        q = (-shift)/WORD_BITS;
+        r = (-shift) % WORD_BITS;
+        for (k = 0; k < stride; k++) {
+            guint64 w = 0;
+
+            if (k + q < stride) {
+                w = src[k + q] >> r;
+                if (r && k + q + 1 < stride)
+                    w |= src[k + q + 1] << (WORD_BITS - r);
+            }
+            dest[k] = w;
+        }
+    }
+}
+
+/**
+ * gwy_bit_mask_shift:
+ * @mask: A bit mask.
+ * @xshift: Horizontal shift, positive values move the pixels to the right.
+ * @yshift: Vertical shift, positive values move the pixels down.
+ *
+ * Shifts the contents of a bit mask.
+ *
+ * Pixels shifted outside are lost; pixels shifted in are unset.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_shift(GwyBitMask *mask, gint xshift, gint yshift)
+{
+    guint64 *src, *m;
+    guint xres, yres, stride, i;
+
+    g_return_if_fail(mask);
+    xres = mask->xres;
+    yres = mask->yres;
+    stride = mask->stride;
+    if ((guint)ABS(xshift) >= xres || (guint)ABS(yshift) >= yres) {
+        gwy_bit_mask_fill(mask, FALSE);
+        return;
+    }
+    if (!xshift && !yshift)
+        return;
+
+    m = mask->data;
+    src = g_memdup(m, stride*yres*sizeof(guint64));
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(m,src,yres,stride,xshift,yshift)
+#endif
+    for (i = 0; i < yres; i++) {
+        gint isrc = (gint)i - yshift;
+
+        if (isrc < 0 || isrc >= (gint)yres)
+            gwy_clear(m + i*stride, stride);
+        else
+            shift_row(src + isrc*stride, m + i*stride, stride, xshift);
+    }
+    g_free(src);
+    bit_mask_clear_padding(mask);
+}
+
+/* One step of dilation (@dilate = TRUE) or erosion by the 3×3 cross (@conn8 = FALSE) or the 3×3 square.  Pixels
+ * outside the mask are considered set if @outside is TRUE.  The horizontal part is done with word shifts; the
+ * vertical is just combination of whole rows.  Buffer @buf must have room for two masks.  Returns %TRUE if any
+ * pixel changed. */
+static gboolean
+bit_mask_step(GwyBitMask *mask, guint64 *buf, gboolean dilate, gboolean conn8, gboolean outside)
+{
+    guint64 *m = mask->data, *orig = buf, *horiz = buf + mask->stride*mask->yres;
+    guint64 tail = mask->tail, outword = outside ? ALL_SET : 0;
+    guint stride = mask->stride, yres = mask->yres, i;
+    gint changed = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(m,orig,horiz,tail,outword,stride,yres,dilate)
+#endif
+    for (i = 0; i < yres; i++) {
+        const guint64 *mrow = m + i*stride;
+        guint64 *orow = orig + i*stride, *hrow = horiz + i*stride;
+        guint k;
+
+        /* Set padding to the outside value, so the last column sees the right neighbour correctly. */
+        gwy_assign(orow, mrow, stride);
+        orow[stride-1] |= outword & ~tail;
+        for (k = 0; k < stride; k++) {
+            guint64 w = orow[k];
+            guint64 left = (w << 1) | (k ? orow[k-1] >> (WORD_BITS-1) : outword >> (WORD_BITS-1));
+            guint64 right = (w >> 1) | ((k+1 < stride ? orow[k+1] : outword) << (WORD_BITS-1));
+
+            hrow[k] = dilate ? (w | left | right) : (w & left & right);
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            reduction(|:changed) \
+            private(i) \
+            shared(m,orig,horiz,tail,outword,stride,yres,dilate,conn8)
+#endif
+    for (i = 0; i < yres; i++) {
+        const guint64 *vert = conn8 ? horiz : orig;
+        const guint64 *hrow = horiz + i*stride, *orow = orig + i*stride;
+        const guint64 *urow = i ? vert + (i-1)*stride : NULL;
+        const guint64 *drow = i+1 < yres ? vert + (i+1)*stride : NULL;
+        guint64 *mrow = m + i*stride;
+        guint64 diff = 0;
+        guint k;
+
+        for (k = 0; k < stride; k++) {
+            guint64 up = urow ? urow[k] : outword, down = drow ? drow[k] : outword;
+
+            mrow[k] = dilate ? (hrow[k] | up | down) : (hrow[k] & up & down);
+            diff |= (mrow[k] ^ orow[k]) & (k+1 < stride ? ALL_SET : tail);
+        }
+        changed |= (diff != 0);
+    }
+
+    bit_mask_clear_padding(mask);
+
+    return changed;
+}
+
+static void
+bit_mask_morph(GwyBitMask *mask, guint amount, GwyDistanceTransformType dtype, gboolean dilate, gboolean outside)
+{
+    guint64 *buf;
+    gboolean conn8;
+    guint s;
+
+    /* No pixel is farther than xres+yres in any of the distances, so more steps cannot change anything. */
+    amount = MIN(amount, mask->xres + mask->yres);
+    if (!amount)
+        return;
+
+    buf = g_new(guint64, 2*mask->stride*mask->yres);
+    for (s = 0; s < amount; s++) {
+        if (dtype == GWY_DISTANCE_TRANSFORM_CONN8)
+            conn8 = TRUE;
+        else if (dtype == GWY_DISTANCE_TRANSFORM_OCTAGONAL48)
+            conn8 = s % 2;
+        else if (dtype == GWY_DISTANCE_TRANSFORM_OCTAGONAL84)
+            conn8 = !(s % 2);
+        else
+            conn8 = FALSE;
+        /* If a step changes nothing, the mask is empty or full and stays so whatever the remaining steps are. */
+        if (!bit_mask_step(mask, buf, dilate, conn8, outside))
+            break;
+    }
+    g_free(buf);
+}
+
+/**
+ * gwy_bit_mask_grow:
+ * @mask: A bit mask.
+ * @amount: How much the set areas should be expanded, in pixels.
+ * @dtype: Type of simple distance to use.  Only %GWY_DISTANCE_TRANSFORM_CONN4, %GWY_DISTANCE_TRANSFORM_CONN8,
+ *         %GWY_DISTANCE_TRANSFORM_OCTAGONAL48 and %GWY_DISTANCE_TRANSFORM_OCTAGONAL84 are supported.
+ *
+ * Dilates a bit mask by specified amount using a simple distance.
+ *
+ * Unset pixels which are not farther than @amount from a set pixel become set.  Octagonal distances are realised by
+ * alternating 4-connected and 8-connected steps.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_grow(GwyBitMask *mask, guint amount, GwyDistanceTransformType dtype)
+{
+    g_return_if_fail(mask);
+    g_return_if_fail(dtype <= GWY_DISTANCE_TRANSFORM_OCTAGONAL84);
+    bit_mask_morph(mask, amount, dtype, TRUE, FALSE);
+}
+
+/**
+ * gwy_bit_mask_shrink:
+ * @mask: A bit mask.
+ * @amount: How much the set areas should be reduced, in pixels.
+ * @dtype: Type of simple distance to use.  Only %GWY_DISTANCE_TRANSFORM_CONN4, %GWY_DISTANCE_TRANSFORM_CONN8,
+ *         %GWY_DISTANCE_TRANSFORM_OCTAGONAL48 and %GWY_DISTANCE_TRANSFORM_OCTAGONAL84 are supported.
+ * @from_border: %TRUE to consider image edges to be boundaries of set areas.  %FALSE to reduce areas touching field
+ *               boundaries only along the boundaries.
+ *
+ * Erodes a bit mask by specified amount using a simple distance.
+ *
+ * Set pixels which are not farther than @amount from an unset pixel become unset.  Octagonal distances are realised
+ * by alternating 4-connected and 8-connected steps.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_bit_mask_shrink(GwyBitMask *mask, guint amount, GwyDistanceTransformType dtype, gboolean from_border)
+{
+    g_return_if_fail(mask);
+    g_return_if_fail(dtype <= GWY_DISTANCE_TRANSFORM_OCTAGONAL84);
+    bit_mask_morph(mask, amount, dtype, FALSE, !from_border);
+}
+
+/************************** Documentation ****************************/
+
+/**
+ * SECTION:bitmask
+ * @title: GwyBitMask
+ * @short_description: Compact two-dimensional bit masks
+ *
+ * #GwyBitMask is a compact representation of a two-dimensional mask, storing one bit per pixel.  Masks attached to
+ * channels are data fields with values 1.0 and 0.0, occupying 64 times more memory.  Bit masks can be created from
+ * such mask data fields using gwy_bit_mask_new_from_field() and written back using gwy_bit_mask_to_field().
+ *
+ * Logical operations, counting and morphological operations act on whole 64bit words, i.e. on 64 pixels at once.
+ **/
+
+/**
+ * GwyBitMask:
+ *
+ * #GwyBitMask is an opaque data structure and should be only manipulated with the functions below.
+ *
+ * Since: 2.62
+ **/
+
+/* vim: set cin columns=120 tw=118 et ts=4 sw=4 cino=>1s,e0,n0,f0,{0,}0,^0,\:1s,=0,g1s,h0,t0,+1s,c3,(0,u0 : */
@@ -0,0 +1,77 @@
+/*
+ *  $Id$
+ *  Copyright (C) 2022 David Necas (Yeti).
+ *  E-mail: yeti@gwyddion.net.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any
+ *  later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with this program; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GWY_BIT_MASK_H__
+#define __GWY_BIT_MASK_H__
+
+#include <glib.h>
+#include <libprocess/gwyprocessenums.h>
+#include <libprocess/datafield.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GwyBitMask GwyBitMask;
+
+#define GWY_TYPE_BIT_MASK (gwy_bit_mask_get_type())
+
+GType       gwy_bit_mask_get_type      (void)                     G_GNUC_CONST;
+GwyBitMask* gwy_bit_mask_new           (guint xres,
+                                        guint yres)               G_GNUC_MALLOC;
+GwyBitMask* gwy_bit_mask_new_from_field(GwyDataField *field)      G_GNUC_MALLOC;
+GwyBitMask* gwy_bit_mask_copy          (const GwyBitMask *mask)   G_GNUC_MALLOC;
+void        gwy_bit_mask_free          (GwyBitMask *mask);
+guint       gwy_bit_mask_get_xres      (const GwyBitMask *mask);
+guint       gwy_bit_mask_get_yres      (const GwyBitMask *mask);
+void        gwy_bit_mask_set_from_field(GwyBitMask *mask,
+                                        GwyDataField *field);
+void        gwy_bit_mask_to_field      (const GwyBitMask *mask,
+                                        GwyDataField *field);
+gboolean    gwy_bit_mask_get           (const GwyBitMask *mask,
+                                        guint col,
+                                        guint row);
+void        gwy_bit_mask_set           (GwyBitMask *mask,
+                                        guint col,
+                                        guint row,
+                                        gboolean value);
+void        gwy_bit_mask_fill          (GwyBitMask *mask,
+                                        gboolean value);
+void        gwy_bit_mask_invert        (GwyBitMask *mask);
+void        gwy_bit_mask_and           (GwyBitMask *mask,
+                                        const GwyBitMask *operand);
+void        gwy_bit_mask_or            (GwyBitMask *mask,
+                                        const GwyBitMask *operand);
+void        gwy_bit_mask_xor           (GwyBitMask *mask,
+                                        const GwyBitMask *operand);
+void        gwy_bit_mask_subtract      (GwyBitMask *mask,
+                                        const GwyBitMask *operand);
+guint       gwy_bit_mask_count         (const GwyBitMask *mask);
+void        gwy_bit_mask_shift         (GwyBitMask *mask,
+                                        gint xshift,
+                                        gint yshift);
+void        gwy_bit_mask_grow          (GwyBitMask *mask,
+                                        guint amount,
+                                        GwyDistanceTransformType dtype);
+void        gwy_bit_mask_shrink        (GwyBitMask *mask,
+                                        guint amount,
+                                        GwyDistanceTransformType dtype,
+                                        gboolean from_border);
+
+G_END_DECLS
+
+#endif /* __GWY_BIT_MASK_H__ */
+
+/* vim: set cin columns=120 tw=118 et ts=4 sw=4 cino=>1s,e0,n0,f0,{0,}0,^0,\:1s,=0,g1s,h0,t0,+1s,c3,(0,u0 : */
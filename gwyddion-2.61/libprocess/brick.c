@@ -33,8 +33,12 @@
 
 #define GWY_BRICK_TYPE_NAME "GwyBrick"
 
+enum { BLOCK_SIZE = 64 };
+
 typedef struct {
     GwyDataLine *zcalibration;
+    /* Spectrum-major copy of data, built on demand. */
+    gdouble *curves;
 } GwyBrickPrivate;
 
 enum {
@@ -76,6 +80,7 @@ gwy_brick_class_init(GwyBrickClass *klass)
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
 
     gobject_class->finalize = gwy_brick_finalize;
+    gwy_serialize_enable_borrowing(G_TYPE_FROM_CLASS(klass));
 
     g_type_class_add_private(klass, sizeof(GwyBrickPrivate));
 
@@ -107,6 +112,7 @@ gwy_brick_init(GwyBrick *brick)
                                                      GWY_TYPE_BRICK,
                                                      GwyBrickPrivate);
     priv->zcalibration = NULL;
+    priv->curves = NULL;
 }
 
 static void
@@ -118,7 +124,8 @@ gwy_brick_finalize(GObject *object)
     GWY_OBJECT_UNREF(brick->si_unit_y);
     GWY_OBJECT_UNREF(brick->si_unit_z);
     GWY_OBJECT_UNREF(brick->si_unit_w);
-    g_free(brick->data);
+    gwy_serialize_free_array(brick->data);
+    g_free(((GwyBrickPrivate*)brick->priv)->curves);
 
     G_OBJECT_CLASS(gwy_brick_parent_class)->finalize(object);
 }
@@ -454,7 +461,7 @@ gwy_brick_deserialize(const guchar *buffer,
     if (!gwy_serialize_unpack_object_struct(buffer, size, position,
                                             GWY_BRICK_TYPE_NAME,
                                             G_N_ELEMENTS(spec), spec)) {
-        g_free(data);
+        gwy_serialize_free_array(data);
         GWY_OBJECT_UNREF(si_unit_x);
         GWY_OBJECT_UNREF(si_unit_y);
         GWY_OBJECT_UNREF(si_unit_z);
@@ -466,7 +473,7 @@ gwy_brick_deserialize(const guchar *buffer,
     if (datasize != (guint)(xres * yres * zres)) {
         g_critical("Serialized %s size mismatch %u != %u",
                    GWY_BRICK_TYPE_NAME, datasize, xres*yres*zres);
-        g_free(data);
+        gwy_serialize_free_array(data);
         GWY_OBJECT_UNREF(si_unit_x);
         GWY_OBJECT_UNREF(si_unit_y);
         GWY_OBJECT_UNREF(si_unit_z);
@@ -544,6 +551,7 @@ gwy_brick_clone_real(GObject *source, GObject *copy)
 
     brick = GWY_BRICK(source);
     clone = GWY_BRICK(copy);
+    gwy_brick_invalidate(clone);
 
     if (clone->xres != brick->xres
         || clone->yres != brick->yres
@@ -551,8 +559,8 @@ gwy_brick_clone_real(GObject *source, GObject *copy)
         clone->xres = brick->xres;
         clone->yres = brick->yres;
         clone->zres = brick->zres;
-        clone->data = g_renew(gdouble, clone->data,
-                              clone->xres * clone->yres * clone->zres);
+        clone->data = gwy_serialize_realloc_array(clone->data,
+                                                  clone->xres * clone->yres * clone->zres * sizeof(gdouble));
     }
     clone->xreal = brick->xreal;
     clone->yreal = brick->yreal;
@@ -579,6 +587,7 @@ gwy_brick_clone_real(GObject *source, GObject *copy)
 void
 gwy_brick_data_changed(GwyBrick *brick)
 {
+    gwy_brick_invalidate(brick);
     g_signal_emit(brick, brick_signals[DATA_CHANGED], 0);
 }
 
@@ -613,12 +622,13 @@ gwy_brick_resample(GwyBrick *brick,
     if ((xres == brick->xres) && (yres == brick->yres) && (zres == brick->zres))
         return;
     g_return_if_fail(xres > 1 && yres > 1 && zres > 1);
+    gwy_brick_invalidate(brick);
 
     if (interpolation == GWY_INTERPOLATION_NONE) {
         brick->xres = xres;
         brick->yres = yres;
         brick->zres = zres;
-        brick->data = g_renew(gdouble, brick->data, xres*yres*zres);
+        brick->data = gwy_serialize_realloc_array(brick->data, xres*yres*zres*sizeof(gdouble));
         return;
     }
 
@@ -652,7 +662,7 @@ gwy_brick_resample(GwyBrick *brick,
         }
     }
 
-    g_free(brick->data);
+    gwy_serialize_free_array(brick->data);
     brick->data = bdata;
     brick->xres = xres;
     brick->yres = yres;
@@ -683,6 +693,7 @@ gwy_brick_copy(GwyBrick *src,
     if (src == dest)
         return;
 
+    gwy_brick_invalidate(dest);
     gwy_assign(dest->data, src->data, src->xres*src->yres*src->zres);
 
     dest->xreal = src->xreal;
@@ -831,6 +842,7 @@ gdouble*
 gwy_brick_get_data(GwyBrick *brick)
 {
     g_return_val_if_fail(GWY_IS_BRICK(brick), NULL);
+    gwy_brick_invalidate(brick);
     return brick->data;
 }
 
@@ -857,6 +869,141 @@ gwy_brick_get_data_const(GwyBrick *brick)
     return (const gdouble*)brick->data;
 }
 
+/**
+ * gwy_brick_invalidate:
+ * @brick: A data brick.
+ *
+ * Invalidates cached data brick information.
+ *
+ * This function is called by all #GwyBrick methods that change the data and
+ * by gwy_brick_get_data() and gwy_brick_data_changed().  You only need to
+ * call it explicitly if you keep the pointer returned by
+ * gwy_brick_get_data() and modify the data later, or if you no longer need
+ * the spectrum-major view created by gwy_brick_get_curves_const() and want
+ * to free its memory.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_brick_invalidate(GwyBrick *brick)
+{
+    GwyBrickPrivate *priv;
+
+    g_return_if_fail(GWY_IS_BRICK(brick));
+    priv = (GwyBrickPrivate*)brick->priv;
+    GWY_FREE(priv->curves);
+}
+
+/* Transposes the zres-by-n matrix of planes to the n-by-zres matrix of curves,
+ * working in square tiles. */
+static void
+build_curves(const gdouble *data, gdouble *curves, guint n, guint zres)
+{
+    guint kb;
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(kb) \
+            shared(data,curves,n,zres)
+#endif
+    for (kb = 0; kb < n; kb += BLOCK_SIZE) {
+        guint kend = MIN(kb + BLOCK_SIZE, n);
+        guint lb, k, l;
+
+        for (lb = 0; lb < zres; lb += BLOCK_SIZE) {
+            guint lend = MIN(lb + BLOCK_SIZE, zres);
+
+            for (k = kb; k < kend; k++) {
+                const gdouble *s = data + lb*n + k;
+                gdouble *d = curves + k*zres + lb;
+
+                for (l = lend - lb; l; l--, d++, s += n)
+                    *d = *s;
+            }
+        }
+    }
+}
+
+/**
+ * gwy_brick_get_curves_const:
+ * @brick: A data brick.
+ *
+ * Gets the data of a data brick in spectrum-major order, read-only.
+ *
+ * The raw data buffer of a brick is plane-major, i.e. consecutive values
+ * belong to the same XY plane and values along the z axis are @xres*@yres
+ * items apart.  Functions processing individual curves (spectra) in a loop
+ * can use this function to obtain a copy of the data with each curve stored
+ * contiguously instead.  The value at column @col, row @row and level @lev
+ * is at index (@row*@xres + @col)*@zres + @lev.
+ *
+ * The view is created on the first call and then kept until the data change.
+ * It has the same size as the data, so call gwy_brick_invalidate() to free
+ * it when you do not need it any more.
+ *
+ * The view is created without any locking, so the first call must not run
+ * concurrently with other calls for the same brick, including
+ * gwy_brick_get_curve_const().  Call this function before starting parallel
+ * processing; the returned data can then be read from any number of threads.
+ *
+ * The returned buffer is not guaranteed to be valid through whole data brick
+ * life time.  It is freed when the data brick data are modified by any
+ * #GwyBrick method, or by gwy_brick_get_data(), gwy_brick_data_changed() and
+ * gwy_brick_invalidate().
+ *
+ * Returns: The data as an array of doubles of length @xres*@yres*@zres.
+ *
+ * Since: 2.62
+ **/
+const gdouble*
+gwy_brick_get_curves_const(GwyBrick *brick)
+{
+    GwyBrickPrivate *priv;
+    guint n;
+
+    g_return_val_if_fail(GWY_IS_BRICK(brick), NULL);
+    priv = (GwyBrickPrivate*)brick->priv;
+    if (!priv->curves) {
+        n = brick->xres*brick->yres;
+        priv->curves = g_new(gdouble, n*brick->zres);
+        build_curves(brick->data, priv->curves, n, brick->zres);
+    }
+    return (const gdouble*)priv->curves;
+}
+
+/**
+ * gwy_brick_get_curve_const:
+ * @brick: A data brick.
+ * @col: Column index.
+ * @row: Row index.
+ *
+ * Gets the data of one curve (spectrum) of a data brick as a contiguous
+ * array, read-only.
+ *
+ * The curve is taken from the spectrum-major view of the data, creating it
+ * if necessary.  See gwy_brick_get_curves_const() for the validity of the
+ * returned buffer and thread safety.  It is more efficient to call this
+ * function than to extract individual curves with gwy_brick_extract_line()
+ * when all curves are processed.
+ *
+ * Returns: The curve as an array of doubles of length @zres.
+ *
+ * Since: 2.62
+ **/
+const gdouble*
+gwy_brick_get_curve_const(GwyBrick *brick,
+                          gint col,
+                          gint row)
+{
+    const gdouble *curves;
+
+    g_return_val_if_fail(GWY_IS_BRICK(brick), NULL);
+    g_return_val_if_fail(col >= 0 && col < brick->xres, NULL);
+    g_return_val_if_fail(row >= 0 && row < brick->yres, NULL);
+    curves = gwy_brick_get_curves_const(brick);
+    return curves + (row*(gsize)brick->xres + col)*brick->zres;
+}
+
 /**
  * gwy_brick_get_xres:
  * @brick: A data brick.
@@ -1836,6 +1983,7 @@ gwy_brick_set_val(GwyBrick *brick,
                      && row >= 0 && row < brick->yres
                      && lev >= 0 && lev < brick->zres);
 
+    gwy_brick_invalidate(brick);
     brick->data[col + brick->xres*row + brick->xres*brick->yres*lev] = value;
 }
 
@@ -1904,6 +2052,7 @@ gwy_brick_set_val_real(GwyBrick *brick,
                      && row >= 0 && row < brick->yres
                      && lev >= 0 && lev < brick->zres);
 
+    gwy_brick_invalidate(brick);
     brick->data[col + brick->xres*row + brick->xres*brick->yres*lev] = value;
 }
 
@@ -1923,6 +2072,7 @@ gwy_brick_fill(GwyBrick *brick,
     gint i;
 
     g_return_if_fail(GWY_IS_BRICK(brick));
+    gwy_brick_invalidate(brick);
     for (i = 0; i < (brick->xres*brick->yres*brick->zres); i++)
         brick->data[i] = value;
 }
@@ -1939,6 +2089,7 @@ void
 gwy_brick_clear(GwyBrick *brick)
 {
     g_return_if_fail(GWY_IS_BRICK(brick));
+    gwy_brick_invalidate(brick);
     gwy_clear(brick->data, brick->xres*brick->yres*brick->zres);
 }
 
@@ -1958,6 +2109,7 @@ gwy_brick_add(GwyBrick *brick,
     gint i, n;
 
     g_return_if_fail(GWY_IS_BRICK(brick));
+    gwy_brick_invalidate(brick);
     n = brick->xres * brick->yres * brick->zres;
     for (i = 0; i < n; i++)
         brick->data[i] += value;
@@ -1979,6 +2131,7 @@ gwy_brick_multiply(GwyBrick *brick,
     gint i, n;
 
     g_return_if_fail(GWY_IS_BRICK(brick));
+    gwy_brick_invalidate(brick);
     n = brick->xres * brick->yres * brick->zres;
     for (i = 0; i < n; i++)
         brick->data[i] *= value;
@@ -3191,6 +3344,7 @@ gwy_brick_extract_line(const GwyBrick *brick, GwyDataLine *target,
 {
     gint col, row, lev, xres, yres, zres;
     gdouble *bdata, *ddata;
+    const gdouble *curve;
     GwySIUnit *si_unit = NULL;
 
     g_return_if_fail(GWY_IS_BRICK(brick));
@@ -3256,9 +3410,17 @@ gwy_brick_extract_line(const GwyBrick *brick, GwyDataLine *target,
 
         col = istart;
         row = jstart;
+        /* Use the spectrum-major view if someone has already created it. */
+        curve = ((GwyBrickPrivate*)brick->priv)->curves;
         if (kend >= kstart) {
-            for (lev = 0; lev < (kend - kstart); lev++)
-                ddata[lev] = bdata[col + xres*row + xres*yres*(lev + kstart)];
+            if (curve) {
+                curve += (row*(gsize)xres + col)*zres + kstart;
+                gwy_assign(ddata, curve, kend - kstart);
+            }
+            else {
+                for (lev = 0; lev < (kend - kstart); lev++)
+                    ddata[lev] = bdata[col + xres*row + xres*yres*(lev + kstart)];
+            }
         }
         else {
             for (lev = 0; lev < (kstart - kend); lev++)
@@ -3602,6 +3764,7 @@ gwy_brick_transpose(GwyBrick *brick,
     target->xreal = xreal;
     target->yreal = yreal;
     target->zreal = zreal;
+    gwy_brick_invalidate(target);
     rdata = target->data;
 
     /* There are 48 different combinations, which is way too much.  Implement
@@ -3774,6 +3937,7 @@ gwy_brick_invert(GwyBrick *brick,
     zres = brick->zres;
     data = brick->data;
     priv = brick->priv;
+    gwy_brick_invalidate(brick);
 
     if (!xflipped && !yflipped && !zflipped) {
         /* Do nothing. */
@@ -3907,6 +4071,7 @@ gwy_brick_set_plane(GwyBrick *brick,
     g_return_if_fail(istart >= 0 && istart < xres
                      && jstart >= 0 && jstart < yres
                      && kstart >= 0 && kstart < zres);
+    gwy_brick_invalidate(brick);
     bdata = brick->data;
     ddata = plane->data;
 
@@ -3993,6 +4158,7 @@ gwy_brick_add_to_xy_planes(GwyBrick *brick,
     g_return_if_fail(plane->xres == brick->xres);
     g_return_if_fail(plane->yres == brick->yres);
 
+    gwy_brick_invalidate(brick);
     n = brick->xres * brick->yres;
     for (lev = 0; lev < brick->zres; lev++) {
         gdouble *d = brick->data + n*lev;
@@ -4023,6 +4189,7 @@ gwy_brick_add_to_z_lines(GwyBrick *brick,
     g_return_if_fail(GWY_IS_DATA_LINE(line));
     g_return_if_fail(line->res == brick->zres);
 
+    gwy_brick_invalidate(brick);
     n = brick->xres * brick->yres;
     for (lev = 0; lev < brick->zres; lev++) {
         gdouble *d = brick->data + n*lev;
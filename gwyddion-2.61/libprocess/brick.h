@@ -129,6 +129,11 @@ gdouble           gwy_brick_get_xoffset       (GwyBrick *brick);
 gdouble           gwy_brick_get_yoffset       (GwyBrick *brick);
 gdouble           gwy_brick_get_zoffset       (GwyBrick *brick);
 const gdouble*    gwy_brick_get_data_const    (GwyBrick *brick);
+const gdouble*    gwy_brick_get_curves_const  (GwyBrick *brick);
+const gdouble*    gwy_brick_get_curve_const   (GwyBrick *brick,
+                                               gint col,
+                                               gint row);
+void              gwy_brick_invalidate        (GwyBrick *brick);
 void              gwy_brick_set_xreal         (GwyBrick *brick,
                                                gdouble xreal);
 void              gwy_brick_set_yreal         (GwyBrick *brick,
@@ -0,0 +1,656 @@
+/*
+ *  $Id$
+ *  Copyright (C) 2022 David Necas (Yeti).
+ *  E-mail: yeti@gwyddion.net.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any
+ *  later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with this program; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <libgwyddion/gwymacros.h>
+#include <libgwyddion/gwymath.h>
+#include <libprocess/clustering.h>
+#include "libgwyddion/gwyomp.h"
+
+/* Number of pixels whose spectra are transposed together to a contiguous block.  Brick planes are read by whole
+ * cache lines this way. */
+#define CLUSTER_BLOCK 8
+
+/* Random seed for k-means++ seeding; clustering the same data always gives the same result. */
+#define CLUSTER_SEED 42
+
+/* Points are brick pixels, point coordinates are the values along z.  Spectrum of pixel i is data[l*n + i] for
+ * l = 0, …, zres-1.  Bounds are kept for Hamerly's algorithm: upper[i] is an upper bound of the distance of point i
+ * to its centre and lower[i] a lower bound of the distance to any other centre. */
+typedef struct {
+    const gdouble *data;
+    gsize n;
+    guint zres;
+    guint k;
+    gdouble *centres;
+    gdouble *oldcentres;
+    gint *assignment;
+    gdouble *upper;
+    gdouble *lower;
+    gdouble *halfsep;
+    gdouble *moved;
+    gdouble *sums;
+    guint *counts;
+} ClusterState;
+
+static inline gdouble
+spectrum_dist2(const gdouble *x, const gdouble *c, guint zres)
+{
+    gdouble s = 0.0;
+    guint l;
+
+    for (l = 0; l < zres; l++) {
+        gdouble d = x[l] - c[l];
+        s += d*d;
+    }
+    return s;
+}
+
+static void
+load_block(const gdouble *data, gsize n, guint zres, gsize from, guint len, gdouble *block)
+{
+    guint l, b;
+
+    for (l = 0; l < zres; l++) {
+        const gdouble *p = data + l*n + from;
+        for (b = 0; b < len; b++)
+            block[b*zres + l] = p[b];
+    }
+}
+
+static void
+copy_spectrum(const gdouble *data, gsize n, guint zres, gsize i, gdouble *spectrum)
+{
+    guint l;
+
+    for (l = 0; l < zres; l++)
+        spectrum[l] = data[l*n + i];
+}
+
+/* k-means++: each next centre is chosen randomly with probability proportional to the squared distance to the
+ * nearest centre already chosen. */
+static void
+seed_centres(ClusterState *state)
+{
+    const gdouble *data = state->data;
+    gdouble *centres = state->centres, *mind = state->lower;
+    gsize i, n = state->n, nblocks = (n + CLUSTER_BLOCK-1)/CLUSTER_BLOCK;
+    guint c, zres = state->zres, k = state->k;
+    const gdouble *prev;
+    gdouble total, r;
+    GRand *rng;
+
+    rng = g_rand_new_with_seed(CLUSTER_SEED);
+    for (i = 0; i < n; i++)
+        mind[i] = G_MAXDOUBLE;
+
+    i = g_rand_int_range(rng, 0, n);
+    copy_spectrum(data, n, zres, i, centres);
+    for (c = 1; c < k; c++) {
+        prev = centres + (c-1)*zres;
+        total = 0.0;
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(data,mind,prev,n,zres,nblocks) \
+            reduction(+:total)
+#endif
+        {
+            gdouble *block = g_new(gdouble, CLUSTER_BLOCK*zres);
+            gsize ibfrom = gwy_omp_chunk_start(nblocks), ibto = gwy_omp_chunk_end(nblocks);
+            gsize ib, from;
+            guint b, len;
+            gdouble d;
+
+            for (ib = ibfrom; ib < ibto; ib++) {
+                from = ib*CLUSTER_BLOCK;
+                len = MIN(CLUSTER_BLOCK, n - from);
+                load_block(data, n, zres, from, len, block);
+                for (b = 0; b < len; b++) {
+                    d = spectrum_dist2(block + b*zres, prev, zres);
+                    if (d < mind[from + b])
+                        mind[from + b] = d;
+                    total += mind[from + b];
+                }
+            }
+            g_free(block);
+        }
+
+        i = n;
+        if (total > 0.0) {
+            r = g_rand_double(rng)*total;
+            for (i = 0; i < n; i++) {
+                if ((r -= mind[i]) < 0.0)
+                    break;
+            }
+        }
+        /* All points coincide with existing centres (or rounding errors brought us to the end). */
+        if (i == n)
+            i = g_rand_int_range(rng, 0, n);
+        copy_spectrum(data, n, zres, i, centres + c*zres);
+    }
+
+    g_rand_free(rng);
+}
+
+/* Assigns points to the nearest centres.  Points whose bounds show they cannot change the assignment are skipped
+ * without reading their data (unless @full is %TRUE).  Counts are always updated, sums only if @update_sums is
+ * %TRUE; both incrementally, using per-thread partial sums of the changes. */
+static void
+assign_points(ClusterState *state, gboolean full, gboolean update_sums)
+{
+    const gdouble *data = state->data, *centres = state->centres, *halfsep = state->halfsep;
+    gdouble *upper = state->upper, *lower = state->lower, *sums = state->sums;
+    gint *assignment = state->assignment;
+    guint *counts = state->counts;
+    gsize n = state->n, nblocks = (n + CLUSTER_BLOCK-1)/CLUSTER_BLOCK;
+    guint zres = state->zres, k = state->k;
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(data,centres,halfsep,upper,lower,sums,assignment,counts,n,zres,k,nblocks,full,update_sums)
+#endif
+    {
+        gdouble *block = g_new(gdouble, CLUSTER_BLOCK*zres);
+        gdouble *tsums = update_sums ? gwy_omp_if_threads_new0(sums, k*zres) : NULL;
+        guint *tcounts = gwy_omp_if_threads_new0(counts, k);
+        gsize ibfrom = gwy_omp_chunk_start(nblocks), ibto = gwy_omp_chunk_end(nblocks);
+        guint todo[CLUSTER_BLOCK];
+        gsize ib, from, i;
+        guint b, j, m, len, c, l;
+        gint a, a0;
+        gdouble d, d1, d2, bound;
+        const gdouble *x;
+
+        for (ib = ibfrom; ib < ibto; ib++) {
+            from = ib*CLUSTER_BLOCK;
+            len = MIN(CLUSTER_BLOCK, n - from);
+            for (b = m = 0; b < len; b++) {
+                i = from + b;
+                if (full || upper[i] > MAX(halfsep[assignment[i]], lower[i]))
+                    todo[m++] = b;
+            }
+            if (!m)
+                continue;
+
+            load_block(data, n, zres, from, len, block);
+            for (j = 0; j < m; j++) {
+                b = todo[j];
+                i = from + b;
+                x = block + b*zres;
+                a0 = assignment[i];
+                if (!full) {
+                    bound = MAX(halfsep[a0], lower[i]);
+                    upper[i] = sqrt(spectrum_dist2(x, centres + a0*zres, zres));
+                    if (upper[i] <= bound)
+                        continue;
+                }
+
+                a = 0;
+                d1 = d2 = G_MAXDOUBLE;
+                for (c = 0; c < k; c++) {
+                    d = spectrum_dist2(x, centres + c*zres, zres);
+                    if (d < d1) {
+                        d2 = d1;
+                        d1 = d;
+                        a = c;
+                    }
+                    else if (d < d2)
+                        d2 = d;
+                }
+                upper[i] = sqrt(d1);
+                lower[i] = sqrt(d2);
+                if (a == a0)
+                    continue;
+
+                assignment[i] = a;
+                tcounts[a]++;
+                if (update_sums) {
+                    for (l = 0; l < zres; l++)
+                        tsums[a*zres + l] += x[l];
+                }
+                if (a0 < 0)
+                    continue;
+                /* Unsigned arithmetic; the per-thread differences sum up correctly modulo 2^32. */
+                tcounts[a0]--;
+                if (update_sums) {
+                    for (l = 0; l < zres; l++)
+                        tsums[a0*zres + l] -= x[l];
+                }
+            }
+        }
+
+        if (update_sums)
+            gwy_omp_if_threads_sum_double(sums, tsums, k*zres);
+        gwy_omp_if_threads_sum_uint(counts, tcounts, k);
+        g_free(block);
+    }
+}
+
+/* Calculates the distance of each point to its centre and optionally the sums of squared distances in clusters. */
+static void
+calculate_distances(ClusterState *state, gdouble *dist, gdouble *sumdist2)
+{
+    const gdouble *data = state->data, *centres = state->centres;
+    const gint *assignment = state->assignment;
+    gsize n = state->n, nblocks = (n + CLUSTER_BLOCK-1)/CLUSTER_BLOCK;
+    guint zres = state->zres, k = state->k;
+
+    if (sumdist2)
+        gwy_clear(sumdist2, k);
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(data,centres,assignment,dist,sumdist2,n,zres,k,nblocks)
+#endif
+    {
+        gdouble *block = g_new(gdouble, CLUSTER_BLOCK*zres);
+        gdouble *tsumdist2 = sumdist2 ? gwy_omp_if_threads_new0(sumdist2, k) : NULL;
+        gsize ibfrom = gwy_omp_chunk_start(nblocks), ibto = gwy_omp_chunk_end(nblocks);
+        gsize ib, from;
+        guint b, len;
+        gint a;
+        gdouble d;
+
+        for (ib = ibfrom; ib < ibto; ib++) {
+            from = ib*CLUSTER_BLOCK;
+            len = MIN(CLUSTER_BLOCK, n - from);
+            load_block(data, n, zres, from, len, block);
+            for (b = 0; b < len; b++) {
+                a = assignment[from + b];
+                d = spectrum_dist2(block + b*zres, centres + a*zres, zres);
+                dist[from + b] = sqrt(d);
+                if (tsumdist2)
+                    tsumdist2[a] += d;
+            }
+        }
+
+        if (sumdist2)
+            gwy_omp_if_threads_sum_double(sumdist2, tsumdist2, k);
+        g_free(block);
+    }
+}
+
+static void
+update_means(ClusterState *state)
+{
+    gdouble *centres = state->centres;
+    const gdouble *sums = state->sums;
+    const guint *counts = state->counts;
+    guint c, l, zres = state->zres;
+
+    /* Empty clusters keep their centres. */
+    for (c = 0; c < state->k; c++) {
+        if (!counts[c])
+            continue;
+        for (l = 0; l < zres; l++)
+            centres[c*zres + l] = sums[c*zres + l]/counts[c];
+    }
+}
+
+/* Points farther from their centre than @threshold times the cluster rms distance do not contribute to the means. */
+static void
+update_means_without_outliers(ClusterState *state, gdouble threshold, gdouble *dist)
+{
+    const gdouble *data = state->data;
+    const gint *assignment = state->assignment;
+    gdouble *sums = state->sums, *limits;
+    guint *counts;
+    gsize n = state->n, nblocks = (n + CLUSTER_BLOCK-1)/CLUSTER_BLOCK;
+    guint c, l, zres = state->zres, k = state->k;
+
+    limits = g_new(gdouble, k);
+    counts = g_new0(guint, k);
+    calculate_distances(state, dist, limits);
+    for (c = 0; c < k; c++)
+        limits[c] = state->counts[c] ? threshold*sqrt(limits[c]/state->counts[c]) : 0.0;
+    gwy_clear(sums, k*zres);
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(data,assignment,dist,limits,sums,counts,n,zres,k,nblocks)
+#endif
+    {
+        gdouble *block = g_new(gdouble, CLUSTER_BLOCK*zres);
+        gdouble *tsums = gwy_omp_if_threads_new0(sums, k*zres);
+        guint *tcounts = gwy_omp_if_threads_new0(counts, k);
+        gsize ibfrom = gwy_omp_chunk_start(nblocks), ibto = gwy_omp_chunk_end(nblocks);
+        gsize ib, from;
+        guint b, len, ll;
+        const gdouble *x;
+        gint a;
+
+        for (ib = ibfrom; ib < ibto; ib++) {
+            from = ib*CLUSTER_BLOCK;
+            len = MIN(CLUSTER_BLOCK, n - from);
+            load_block(data, n, zres, from, len, block);
+            for (b = 0; b < len; b++) {
+                a = assignment[from + b];
+                if (dist[from + b] >= limits[a])
+                    continue;
+                x = block + b*zres;
+                for (ll = 0; ll < zres; ll++)
+                    tsums[a*zres + ll] += x[ll];
+                tcounts[a]++;
+            }
+        }
+
+        gwy_omp_if_threads_sum_double(sums, tsums, k*zres);
+        gwy_omp_if_threads_sum_uint(counts, tcounts, k);
+        g_free(block);
+    }
+
+    for (c = 0; c < k; c++) {
+        if (!counts[c])
+            continue;
+        for (l = 0; l < zres; l++)
+            state->centres[c*zres + l] = sums[c*zres + l]/counts[c];
+    }
+
+    g_free(counts);
+    g_free(limits);
+}
+
+/* Coordinate-wise medians.  Parallelised over planes which are read contiguously; each thread gathers the values
+ * of one plane sorted by cluster into its own buffer. */
+static void
+update_medians(ClusterState *state)
+{
+    const gdouble *data = state->data;
+    const gint *assignment = state->assignment;
+    const guint *counts = state->counts;
+    gdouble *centres = state->centres;
+    gsize n = state->n, *offsets;
+    guint c, zres = state->zres, k = state->k;
+
+    offsets = g_new(gsize, k);
+    offsets[0] = 0;
+    for (c = 1; c < k; c++)
+        offsets[c] = offsets[c-1] + counts[c-1];
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(data,assignment,counts,centres,offsets,n,zres,k)
+#endif
+    {
+        guint lfrom = gwy_omp_chunk_start(zres), lto = gwy_omp_chunk_end(zres);
+        gdouble *buf = (lto > lfrom) ? g_new(gdouble, n) : NULL;
+        gsize *pos = g_new(gsize, k);
+        const gdouble *plane;
+        guint l, cc;
+        gsize i;
+
+        for (l = lfrom; l < lto; l++) {
+            plane = data + l*n;
+            memcpy(pos, offsets, k*sizeof(gsize));
+            for (i = 0; i < n; i++)
+                buf[pos[assignment[i]]++] = plane[i];
+            for (cc = 0; cc < k; cc++) {
+                if (counts[cc])
+                    centres[cc*zres + l] = gwy_math_median(counts[cc], buf + offsets[cc]);
+            }
+        }
+        g_free(pos);
+        g_free(buf);
+    }
+
+    g_free(offsets);
+}
+
+/* Updates the bounds and centre separations after centres have moved, returns whether the movement was within
+ * @epsilon in all coordinates. */
+static gboolean
+finish_iteration(ClusterState *state, gdouble epsilon)
+{
+    const gdouble *centres = state->centres;
+    const gint *assignment = state->assignment;
+    gdouble *oldcentres = state->oldcentres, *moved = state->moved, *halfsep = state->halfsep;
+    gdouble *upper = state->upper, *lower = state->lower;
+    gsize i, n = state->n;
+    guint c, cc, l, zres = state->zres, k = state->k, cmax = 0;
+    gdouble d, max1 = 0.0, max2 = 0.0;
+    gboolean converged = TRUE;
+
+    for (c = 0; c < k; c++) {
+        for (l = 0; l < zres; l++) {
+            if (fabs(oldcentres[c*zres + l] - centres[c*zres + l]) > epsilon) {
+                converged = FALSE;
+                break;
+            }
+        }
+        moved[c] = sqrt(spectrum_dist2(oldcentres + c*zres, centres + c*zres, zres));
+        if (moved[c] > max1) {
+            max2 = max1;
+            max1 = moved[c];
+            cmax = c;
+        }
+        else if (moved[c] > max2)
+            max2 = moved[c];
+    }
+    memcpy(oldcentres, centres, k*zres*sizeof(gdouble));
+
+    for (c = 0; c < k; c++) {
+        d = G_MAXDOUBLE;
+        for (cc = 0; cc < k; cc++) {
+            if (cc != c)
+                d = MIN(d, spectrum_dist2(centres + c*zres, centres + cc*zres, zres));
+        }
+        halfsep[c] = 0.5*sqrt(d);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(assignment,upper,lower,moved,n,cmax,max1,max2)
+#endif
+    for (i = 0; i < n; i++) {
+        gint a = assignment[i];
+
+        upper[i] += moved[a];
+        lower[i] -= (a == (gint)cmax) ? max2 : max1;
+    }
+
+    return converged;
+}
+
+static gboolean
+brick_cluster(GwyBrick *brick, guint k, gboolean medians,
+              gdouble epsilon, guint max_iterations, gdouble outliers_threshold,
+              gdouble *centres, GwyDataField *clusters, GwyDataField *errormap,
+              GwySetFractionFunc set_fraction)
+{
+    ClusterState state;
+    gdouble *d;
+    gsize i, n;
+    guint iter = 0;
+    gboolean converged, without_outliers = FALSE, cancelled = FALSE;
+
+    state.n = n = (gsize)gwy_brick_get_xres(brick)*gwy_brick_get_yres(brick);
+    state.zres = gwy_brick_get_zres(brick);
+    state.k = k;
+    state.data = gwy_brick_get_data_const(brick);
+    state.centres = centres;
+    state.oldcentres = g_new(gdouble, k*state.zres);
+    state.assignment = g_new(gint, n);
+    state.upper = g_new(gdouble, n);
+    state.lower = g_new(gdouble, n);
+    state.halfsep = g_new(gdouble, k);
+    state.moved = g_new(gdouble, k);
+    state.sums = g_new0(gdouble, k*state.zres);
+    state.counts = g_new0(guint, k);
+
+    seed_centres(&state);
+    memcpy(state.oldcentres, centres, k*state.zres*sizeof(gdouble));
+    for (i = 0; i < n; i++)
+        state.assignment[i] = -1;
+
+    while (TRUE) {
+        if (set_fraction && !set_fraction(MIN((gdouble)iter/MAX(max_iterations, 1), 1.0))) {
+            cancelled = TRUE;
+            break;
+        }
+
+        assign_points(&state, !iter, !medians && !without_outliers);
+        if (medians)
+            update_medians(&state);
+        else if (without_outliers)
+            update_means_without_outliers(&state, outliers_threshold, state.upper);
+        else
+            update_means(&state);
+
+        /* Outlier removal overwrites the upper bounds with exact distances, which are also valid bounds. */
+        converged = finish_iteration(&state, epsilon);
+        iter++;
+        if (!converged && iter < max_iterations)
+            continue;
+        /* Second pass not counting outliers, starting from the converged clustering. */
+        if (outliers_threshold > 0.0 && !without_outliers) {
+            without_outliers = TRUE;
+            continue;
+        }
+        break;
+    }
+
+    if (!cancelled) {
+        d = gwy_data_field_get_data(clusters);
+        for (i = 0; i < n; i++)
+            d[i] = state.assignment[i];
+        gwy_data_field_invalidate(clusters);
+        if (errormap) {
+            calculate_distances(&state, gwy_data_field_get_data(errormap), NULL);
+            gwy_data_field_invalidate(errormap);
+        }
+    }
+
+    g_free(state.counts);
+    g_free(state.sums);
+    g_free(state.moved);
+    g_free(state.halfsep);
+    g_free(state.lower);
+    g_free(state.upper);
+    g_free(state.assignment);
+    g_free(state.oldcentres);
+
+    return !cancelled;
+}
+
+/**
+ * gwy_brick_kmeans:
+ * @brick: A volume data brick.
+ * @k: Number of clusters.  It must not exceed the number of spectra, i.e. the number of image pixels.
+ * @epsilon: Convergence criterion; the iteration stops when no centre coordinate changes more than @epsilon.
+ * @max_iterations: Maximum number of iterations.
+ * @outliers_threshold: If positive, the clustering is refined by additional iterations in which points farther from
+ *                      their centre than @outliers_threshold times the root mean square distance in the cluster are
+ *                      not counted when calculating the centres.  Pass zero to disable.
+ * @centres: Array of size @k times z-resolution of @brick to store the cluster centres to.
+ * @clusters: Data field with the same pixel dimensions as @brick to fill with cluster numbers, from 0 to @k-1.
+ * @errormap: Data field with the same pixel dimensions as @brick to fill with the distances of the spectra from
+ *            their cluster centres.  It may be %NULL.
+ * @set_fraction: Function that sets fraction to output (or %NULL).
+ *
+ * Performs k-means clustering of brick spectra.
+ *
+ * Each image pixel is considered a point in a space of dimension equal to the z-resolution of @brick.  The initial
+ * centres are chosen using k-means++, with a fixed random seed so that the results are reproducible.  The iteration
+ * uses Hamerly's bounds to avoid most distance calculations once the clusters settle.
+ *
+ * Returns: %TRUE if the clustering finished, %FALSE if it was cancelled by @set_fraction.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_brick_kmeans(GwyBrick *brick,
+                 guint k,
+                 gdouble epsilon,
+                 guint max_iterations,
+                 gdouble outliers_threshold,
+                 gdouble *centres,
+                 GwyDataField *clusters,
+                 GwyDataField *errormap,
+                 GwySetFractionFunc set_fraction)
+{
+    g_return_val_if_fail(GWY_IS_BRICK(brick), FALSE);
+    g_return_val_if_fail(k > 0 && k <= (gsize)brick->xres*brick->yres, FALSE);
+    g_return_val_if_fail(centres, FALSE);
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(clusters), FALSE);
+    g_return_val_if_fail(clusters->xres == brick->xres && clusters->yres == brick->yres, FALSE);
+    g_return_val_if_fail(!errormap || GWY_IS_DATA_FIELD(errormap), FALSE);
+    g_return_val_if_fail(!errormap || (errormap->xres == brick->xres && errormap->yres == brick->yres), FALSE);
+
+    return brick_cluster(brick, k, FALSE, epsilon, max_iterations, outliers_threshold,
+                         centres, clusters, errormap, set_fraction);
+}
+
+/**
+ * gwy_brick_kmedians:
+ * @brick: A volume data brick.
+ * @k: Number of clusters.  It must not exceed the number of spectra, i.e. the number of image pixels.
+ * @epsilon: Convergence criterion; the iteration stops when no centre coordinate changes more than @epsilon.
+ * @max_iterations: Maximum number of iterations.
+ * @centres: Array of size @k times z-resolution of @brick to store the cluster centres to.
+ * @clusters: Data field with the same pixel dimensions as @brick to fill with cluster numbers, from 0 to @k-1.
+ * @errormap: Data field with the same pixel dimensions as @brick to fill with the distances of the spectra from
+ *            their cluster centres.  It may be %NULL.
+ * @set_fraction: Function that sets fraction to output (or %NULL).
+ *
+ * Performs k-medians clustering of brick spectra.
+ *
+ * The clustering differs from gwy_brick_kmeans() by calculating the centre coordinates as medians of the
+ * corresponding coordinates of the cluster points, instead of means.  Points are still assigned to centres by
+ * Euclidean distance.
+ *
+ * Returns: %TRUE if the clustering finished, %FALSE if it was cancelled by @set_fraction.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_brick_kmedians(GwyBrick *brick,
+                   guint k,
+                   gdouble epsilon,
+                   guint max_iterations,
+                   gdouble *centres,
+                   GwyDataField *clusters,
+                   GwyDataField *errormap,
+                   GwySetFractionFunc set_fraction)
+{
+    g_return_val_if_fail(GWY_IS_BRICK(brick), FALSE);
+    g_return_val_if_fail(k > 0 && k <= (gsize)brick->xres*brick->yres, FALSE);
+    g_return_val_if_fail(centres, FALSE);
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(clusters), FALSE);
+    g_return_val_if_fail(clusters->xres == brick->xres && clusters->yres == brick->yres, FALSE);
+    g_return_val_if_fail(!errormap || GWY_IS_DATA_FIELD(errormap), FALSE);
+    g_return_val_if_fail(!errormap || (errormap->xres == brick->xres && errormap->yres == brick->yres), FALSE);
+
+    return brick_cluster(brick, k, TRUE, epsilon, max_iterations, 0.0,
+                         centres, clusters, errormap, set_fraction);
+}
+
+/************************** Documentation ****************************/
+
+/**
+ * SECTION:clustering
+ * @title: clustering
+ * @short_description: Clustering of volume data
+ *
+ * Functions in this section classify spectra in volume data (bricks) into clusters of similar spectra.
+ *
+ * The computation is parallelised over blocks of pixels.  The spectra of a few neighbour pixels are copied together
+ * to a contiguous block before calculating distances, so that brick planes are read sequentially.
+ **/
+
+/* vim: set cin columns=120 tw=118 et ts=4 sw=4 cino=>1s,e0,n0,f0,{0,}0,^0,\:1s,=0,g1s,h0,t0,+1s,c3,(0,u0 : */
@@ -24,6 +24,7 @@
 #include <libprocess/inttrans.h>
 #include <libprocess/filters.h>
 #include <libprocess/correlation.h>
+#include "libgwyddion/gwyomp.h"
 #include "gwyprocessinternal.h"
 #include "gwyfftw.h"
 
@@ -421,33 +422,57 @@ gwy_data_field_get_weighted_correlation_score(GwyDataField *data_field,
     return score/(rms1*rms2);
 }
 
-/* Note: rms and avg must be identical and contain a copy of the original data
- * field */
+/* Local averages and rms of data_field in kernel-sized rectangles around each pixel.  Near the edges only the part of
+ * the rectangle inside the field is used.  Summed-area tables make it independent on the kernel size. */
 static void
-calculate_normalization(GwyDataField *avg,
+calculate_normalization(GwyDataField *data_field,
+                        GwyDataField *avg,
                         GwyDataField *rms,
                         gint kernel_width,
                         gint kernel_height)
 {
-    GwyDataField *buffer;
-    gint xres, yres, i;
+    AreaSums *asums, *tmpsums = NULL;
+    gint xres, yres, hs2m, hs2p, vs2m, vs2p, i;
 
-    g_return_if_fail(rms->xres == avg->xres && rms->yres == avg->yres);
-    xres = avg->xres;
-    yres = avg->yres;
-
-    for (i = 0; i < xres*yres; i++)
-        rms->data[i] *= rms->data[i];
-
-    buffer = gwy_data_field_new_alike(avg, FALSE);
-    gwy_data_field_area_gather(rms, rms, buffer, kernel_width, kernel_height, TRUE, 0, 0, xres, yres);
-    gwy_data_field_area_gather(avg, avg, buffer, kernel_width, kernel_height, TRUE, 0, 0, xres, yres);
-    g_object_unref(buffer);
-
-    for (i = 0; i < xres*yres; i++) {
-        rms->data[i] -= avg->data[i]*avg->data[i];
-        rms->data[i] = sqrt(MAX(rms->data[i], 0.0));
+    xres = data_field->xres;
+    yres = data_field->yres;
+    g_return_if_fail(avg->xres == xres && avg->yres == yres);
+    g_return_if_fail(rms->xres == xres && rms->yres == yres);
+
+    if (!(asums = _gwy_data_field_get_area_sums(data_field)))
+        asums = tmpsums = _gwy_area_sums_new(data_field);
+
+    /* The same extension as in gwy_data_field_area_gather(). */
+    hs2m = (kernel_width - 1)/2;
+    hs2p = kernel_width/2;
+    vs2m = (kernel_height - 1)/2;
+    vs2p = kernel_height/2;
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(i) \
+            shared(asums,avg,rms,xres,yres,hs2m,hs2p,vs2m,vs2p)
+#endif
+    for (i = 0; i < yres; i++) {
+        gint row = MAX(i - vs2m, 0), height = MIN(i + vs2p + 1, yres) - row;
+        gdouble *arow = avg->data + i*xres, *rrow = rms->data + i*xres;
+        gdouble s, s2, n;
+        gint j, col, width;
+
+        for (j = 0; j < xres; j++) {
+            col = MAX(j - hs2m, 0);
+            width = MIN(j + hs2p + 1, xres) - col;
+            _gwy_area_sums_query(asums, col, row, width, height, &s, &s2);
+            n = width*height;
+            s /= n;
+            arow[j] = s + asums->offset;
+            rrow[j] = sqrt(fmax(s2/n - s*s, 0.0));
+        }
     }
+
+    _gwy_area_sums_free(tmpsums);
+    gwy_data_field_invalidate(avg);
+    gwy_data_field_invalidate(rms);
 }
 
 /**
@@ -504,9 +529,9 @@ gwy_data_field_correlate(GwyDataField *data_field, GwyDataField *kernel_field,
             yoff = (kyres - 1)/2;
             kavg = gwy_data_field_get_avg(kernel_field);
             krms = gwy_data_field_get_rms(kernel_field);
-            avg = gwy_data_field_duplicate(data_field);
-            rms = gwy_data_field_duplicate(data_field);
-            calculate_normalization(avg, rms, kxres, kyres);
+            avg = gwy_data_field_new_alike(data_field, FALSE);
+            rms = gwy_data_field_new_alike(data_field, FALSE);
+            calculate_normalization(data_field, avg, rms, kxres, kyres);
             for (i = yoff; i + kyres - yoff <= yres; i++) {
                 for (j = xoff; j + kxres - xoff <= xres; j++) {
                     k = i*xres + j;
@@ -640,9 +665,9 @@ gwy_data_field_correlate_iteration(GwyComputationState *cstate)
         gwy_data_field_fill(state->score, -1);
         state->kavg = gwy_data_field_get_avg(state->kernel_field);
         state->krms = gwy_data_field_get_rms(state->kernel_field);
-        state->avg = gwy_data_field_duplicate(state->data_field);
-        state->rms = gwy_data_field_duplicate(state->data_field);
-        calculate_normalization(state->avg, state->rms, kxres, kyres);
+        state->avg = gwy_data_field_new_alike(state->data_field, FALSE);
+        state->rms = gwy_data_field_new_alike(state->data_field, FALSE);
+        calculate_normalization(state->data_field, state->avg, state->rms, kxres, kyres);
         state->cs.state = GWY_COMPUTATION_STATE_ITERATE;
         state->cs.fraction = 0.0;
         state->i = yoff;
@@ -726,6 +751,7 @@ gwy_data_field_crosscorrelate(GwyDataField *data_field1,
     gint imax, jmax;
     gdouble cormax, lscore;
     gdouble zm, zp, z0, ipos, jpos;
+    gboolean cached1, cached2;
 
     g_return_if_fail(data_field1 != NULL && data_field2 != NULL);
 
@@ -734,6 +760,12 @@ gwy_data_field_crosscorrelate(GwyDataField *data_field1,
 
     g_return_if_fail(xres == data_field2->xres && yres == data_field2->yres);
 
+    /* The correlation scores need area avg and rms for a huge number of overlapping rectangles. */
+    cached1 = gwy_data_field_get_area_sums_cached(data_field1);
+    cached2 = gwy_data_field_get_area_sums_cached(data_field2);
+    gwy_data_field_set_area_sums_cached(data_field1, TRUE);
+    gwy_data_field_set_area_sums_cached(data_field2, TRUE);
+
     gwy_data_field_clear(x_dist);
     gwy_data_field_clear(y_dist);
     gwy_data_field_clear(score);
@@ -791,6 +823,8 @@ gwy_data_field_crosscorrelate(GwyDataField *data_field1,
         }
     }
 
+    gwy_data_field_set_area_sums_cached(data_field1, cached1);
+    gwy_data_field_set_area_sums_cached(data_field2, cached2);
     gwy_data_field_invalidate(score);
     gwy_data_field_invalidate(x_dist);
     gwy_data_field_invalidate(y_dist);
@@ -1378,27 +1412,27 @@ gwy_data_field_correlation_search(GwyDataField *dfield,
     cbufB = gwy_fftw_new_complex(cstride*ysize);
     extdata = gwy_fftw_new_real(xsize*ysize);
     t = target->data;
-    fplan = gwy_fftw_plan_dft_r2c_2d(ysize, xsize, extdata, cbufB, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
-    bplan = gwy_fftw_plan_dft_c2r_2d(ysize, xsize, cbufB, extdata, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
+    fplan = gwy_fftw_plan_cached_dft_r2c_2d(ysize, xsize, extdata, cbufB, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
+    bplan = gwy_fftw_plan_cached_dft_c2r_2d(ysize, xsize, cbufB, extdata, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
 
     extend_rect(dfield->data, xres, extdata, xsize,
                 0, 0, xres, yres, xres, yres,
                 extend_left, extend_right, extend_up, extend_down,
                 fill_value);
-    gwy_fftw_execute(fplan);
+    gwy_fftw_execute_dft_r2c(fplan, extdata, cbufB);
     gwy_assign(cbufA, cbufB, cstride*ysize);
     extend_kernel_rect(kappa->data, kxres, kyres, extdata, xsize, ysize, xsize);
-    gwy_fftw_execute(fplan);
+    gwy_fftw_execute_dft_r2c(fplan, extdata, cbufB);
     complex_conj_multiply_with(cbufB, cbufA, cstride*ysize);
-    gwy_fftw_execute(bplan);
+    gwy_fftw_execute_dft_c2r(bplan, cbufB, extdata);
     extract_result(extdata, xsize, extend_left, extend_up, t, xres, yres, wq/(xsize*ysize));
 
     if (is_score || method == GWY_CORR_SEARCH_HEIGHT_DIFF) {
         /* We need σ²[j] and, therefore, also μ[j]. */
         extend_kernel_rect(kernel_weight->data, kxres, kyres, extdata, xsize, ysize, xsize);
-        gwy_fftw_execute(fplan);
+        gwy_fftw_execute_dft_r2c(fplan, extdata, cbufB);
         complex_conj_multiply_with_swap(cbufB, cbufA, cstride*ysize);
-        gwy_fftw_execute(bplan);
+        gwy_fftw_execute_dft_c2r(bplan, cbufB, extdata);
         u = g_new(gdouble, xres*yres);
         extract_result(extdata, xsize, extend_left, extend_up, u, xres, yres, wq/(xsize*ysize));
         extend_rect(dfield->data, xres, extdata, xsize,
@@ -1406,9 +1440,9 @@ gwy_data_field_correlation_search(GwyDataField *dfield,
                     extend_left, extend_right, extend_up, extend_down,
                     fill_value);
         square_values(extdata, xsize*ysize);
-        gwy_fftw_execute(fplan);
+        gwy_fftw_execute_dft_r2c(fplan, extdata, cbufB);
         complex_multiply_with_conj(cbufB, cbufA, cstride*ysize);
-        gwy_fftw_execute(bplan);
+        gwy_fftw_execute_dft_c2r(bplan, cbufB, extdata);
         S2 = extract_sigma2_result(extdata, xsize, extend_left, extend_up, u, xres, yres, wq/(xsize*ysize));
         gwy_debug("S %g", sqrt(S2));
         S2 *= regcoeff;
@@ -1435,12 +1469,12 @@ gwy_data_field_correlation_search(GwyDataField *dfield,
                     extend_left, extend_right, extend_up, extend_down,
                     fill_value);
         square_values(extdata, xsize*ysize);
-        gwy_fftw_execute(fplan);
+        gwy_fftw_execute_dft_r2c(fplan, extdata, cbufB);
         gwy_assign(cbufA, cbufB, cstride*ysize);
         extend_kernel_rect(kernel_weight->data, kxres, kyres, extdata, xsize, ysize, xsize);
-        gwy_fftw_execute(fplan);
+        gwy_fftw_execute_dft_r2c(fplan, extdata, cbufB);
         complex_conj_multiply_with(cbufB, cbufA, cstride*ysize);
-        gwy_fftw_execute(bplan);
+        gwy_fftw_execute_dft_c2r(bplan, cbufB, extdata);
         u = g_new(gdouble, xres*yres);
         extract_result(extdata, xsize, extend_left, extend_up, u, xres, yres, wq/(xsize*ysize));
         for (i = 0; i < xres*yres; i++)
@@ -1451,8 +1485,8 @@ gwy_data_field_correlation_search(GwyDataField *dfield,
     fftw_free(cbufB);
     fftw_free(cbufA);
     fftw_free(extdata);
-    fftw_destroy_plan(bplan);
-    fftw_destroy_plan(fplan);
+    gwy_fftw_release_plan(bplan);
+    gwy_fftw_release_plan(fplan);
 
     g_object_unref(kernel_weight);
     g_object_unref(kappa);
@@ -83,6 +83,7 @@ gwy_data_field_class_init(GwyDataFieldClass *klass)
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
 
     gobject_class->finalize = gwy_data_field_finalize;
+    gwy_serialize_enable_borrowing(G_TYPE_FROM_CLASS(klass));
 
 /**
  * GwyDataField::data-changed:
@@ -114,7 +115,8 @@ gwy_data_field_finalize(GObject *object)
 
     GWY_OBJECT_UNREF(data_field->si_unit_xy);
     GWY_OBJECT_UNREF(data_field->si_unit_z);
-    g_free(data_field->data);
+    gwy_serialize_free_array(data_field->data);
+    _gwy_area_sums_free((AreaSums*)data_field->reserved1);
 
     G_OBJECT_CLASS(gwy_data_field_parent_class)->finalize(object);
 }
@@ -348,7 +350,7 @@ gwy_data_field_deserialize(const guchar *buffer,
     if (!gwy_serialize_unpack_object_struct(buffer, size, position,
                                             GWY_DATA_FIELD_TYPE_NAME,
                                             G_N_ELEMENTS(spec), spec)) {
-        g_free(data);
+        gwy_serialize_free_array(data);
         GWY_OBJECT_UNREF(si_unit_xy);
         GWY_OBJECT_UNREF(si_unit_z);
         return NULL;
@@ -356,7 +358,7 @@ gwy_data_field_deserialize(const guchar *buffer,
     if (datasize != (gsize)(xres*yres)) {
         g_critical("Serialized %s size mismatch %u != %u",
                    GWY_DATA_FIELD_TYPE_NAME, datasize, xres*yres);
-        g_free(data);
+        gwy_serialize_free_array(data);
         GWY_OBJECT_UNREF(si_unit_xy);
         GWY_OBJECT_UNREF(si_unit_z);
         return NULL;
@@ -407,7 +409,7 @@ gwy_data_field_duplicate_real(GObject *object)
     duplicate = gwy_data_field_new_alike(data_field, FALSE);
     gwy_assign(duplicate->data, data_field->data,
                data_field->xres*data_field->yres);
-    duplicate->cached = data_field->cached;
+    duplicate->cached = data_field->cached & ~CBIT(SAT);
     gwy_assign(duplicate->cache, data_field->cache, GWY_DATA_FIELD_CACHE_SIZE);
 
     return (GObject*)duplicate;
@@ -427,7 +429,7 @@ gwy_data_field_clone_real(GObject *source, GObject *copy)
 
     n = data_field->xres*data_field->yres;
     if (clone->xres*clone->yres != n)
-        clone->data = g_renew(gdouble, clone->data, n);
+        clone->data = gwy_serialize_realloc_array(clone->data, n*sizeof(gdouble));
     clone->xres = data_field->xres;
     clone->yres = data_field->yres;
 
@@ -475,7 +477,7 @@ gwy_data_field_copy(GwyDataField *src,
     dest->xreal = src->xreal;
     dest->yreal = src->yreal;
 
-    dest->cached = src->cached;
+    dest->cached = src->cached & ~CBIT(SAT);
     gwy_assign(dest->cache, src->cache, GWY_DATA_FIELD_CACHE_SIZE);
 
     if (!nondata_too)
@@ -588,8 +590,8 @@ gwy_data_field_resample(GwyDataField *data_field,
         gwy_data_field_invalidate(data_field);
         data_field->xres = xres;
         data_field->yres = yres;
-        data_field->data = g_renew(gdouble, data_field->data,
-                                   data_field->xres*data_field->yres);
+        data_field->data = gwy_serialize_realloc_array(data_field->data,
+                                                       data_field->xres*data_field->yres*sizeof(gdouble));
         return;
     }
 
@@ -598,8 +600,8 @@ gwy_data_field_resample(GwyDataField *data_field,
     if (data_field_is_constant(data_field, &z)) {
         data_field->xres = xres;
         data_field->yres = yres;
-        data_field->data = g_renew(gdouble, data_field->data,
-                                   data_field->xres*data_field->yres);
+        data_field->data = gwy_serialize_realloc_array(data_field->data,
+                                                       data_field->xres*data_field->yres*sizeof(gdouble));
         gwy_data_field_fill(data_field, z);
         return;
     }
@@ -610,7 +612,7 @@ gwy_data_field_resample(GwyDataField *data_field,
                                         data_field->xres, data_field->data,
                                         xres, yres, xres, bdata,
                                         interpolation, FALSE);
-    g_free(data_field->data);
+    gwy_serialize_free_array(data_field->data);
     data_field->data = bdata;
     data_field->xres = xres;
     data_field->yres = yres;
@@ -3058,6 +3060,118 @@ gwy_data_field_bin(GwyDataField *data_field,
     gwy_data_field_invalidate(target);
 }
 
+/* Source pixel j covers [jq, (j+1)q) in target pixel coordinates, q ≤ 1.
+ * So it contributes to at most two target pixels, k[j] with weight w[j] and
+ * k[j]+1 with weight 1-w[j]. */
+static void
+box_downsample_weights(gint res, gint newres, gint *k, gdouble *w)
+{
+    gdouble q = (gdouble)newres/res, x0;
+    gint j;
+
+    for (j = 0; j < res; j++) {
+        x0 = j*q;
+        k[j] = MIN((gint)floor(x0), newres-1);
+        if (x0 + q > k[j] + 1 && k[j] + 1 < newres)
+            w[j] = (k[j] + 1 - x0)/q;
+        else
+            w[j] = 1.0;
+    }
+}
+
+/**
+ * gwy_data_field_new_downsampled:
+ * @data_field: A data field.
+ * @xres: Desired X resolution.  It must not be larger than the resolution of
+ *        @data_field.
+ * @yres: Desired Y resolution.  It must not be larger than the resolution of
+ *        @data_field.
+ *
+ * Creates a new data field by downsampling an existing one using box
+ * averaging.
+ *
+ * Each pixel of the new data field is the average of all values of
+ * @data_field in the corresponding rectangle, pixels only partially inside
+ * contributing proportionally to the covered area.  Unlike
+ * gwy_data_field_new_binned(), the resolution ratio does not have to be an
+ * integer.  Unlike gwy_data_field_new_resampled(), no values are ignored,
+ * which makes the result suitable for previews of large fields.  The data are
+ * processed in one pass.
+ *
+ * Returns: A newly created data field.
+ *
+ * Since: 2.62
+ **/
+GwyDataField*
+gwy_data_field_new_downsampled(GwyDataField *data_field,
+                               gint xres, gint yres)
+{
+    GwyDataField *result;
+    gint *kx, *ky;
+    gdouble *wx, *wy, *rrow, *rrow2;
+    const gdouble *d;
+    gdouble q, z, w, v;
+    gint oldxres, oldyres, i, j;
+
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(data_field), NULL);
+    oldxres = data_field->xres;
+    oldyres = data_field->yres;
+    g_return_val_if_fail(xres > 0 && xres <= oldxres, NULL);
+    g_return_val_if_fail(yres > 0 && yres <= oldyres, NULL);
+    if (xres == oldxres && yres == oldyres)
+        return gwy_data_field_duplicate(data_field);
+
+    result = gwy_data_field_new(xres, yres,
+                                data_field->xreal, data_field->yreal,
+                                TRUE);
+    result->xoff = data_field->xoff;
+    result->yoff = data_field->yoff;
+    gwy_data_field_copy_units(data_field, result);
+
+    /* Prevent rounding errors from introducing different values in constants
+     * field during resampling. */
+    if (data_field_is_constant(data_field, &z)) {
+        gwy_data_field_fill(result, z);
+        return result;
+    }
+
+    kx = g_new(gint, oldxres + oldyres);
+    ky = kx + oldxres;
+    wx = g_new(gdouble, oldxres + oldyres);
+    wy = wx + oldxres;
+    box_downsample_weights(oldxres, xres, kx, wx);
+    box_downsample_weights(oldyres, yres, ky, wy);
+
+    /* Accumulate source rows into one or two result rows, splitting each
+     * value between one or two columns. */
+    d = data_field->data;
+    for (i = 0; i < oldyres; i++, d += oldxres) {
+        rrow = result->data + ky[i]*xres;
+        rrow2 = (wy[i] < 1.0) ? rrow + xres : NULL;
+        w = wy[i];
+        for (j = 0; j < oldxres; j++) {
+            v = d[j]*wx[j];
+            rrow[kx[j]] += w*v;
+            if (rrow2)
+                rrow2[kx[j]] += (1.0 - w)*v;
+            if (wx[j] < 1.0) {
+                v = d[j] - v;
+                rrow[kx[j] + 1] += w*v;
+                if (rrow2)
+                    rrow2[kx[j] + 1] += (1.0 - w)*v;
+            }
+        }
+    }
+
+    q = (gdouble)xres*yres/((gdouble)oldxres*oldyres);
+    gwy_data_field_multiply(result, q);
+
+    g_free(kx);
+    g_free(wx);
+
+    return result;
+}
+
 /**
  * gwy_data_field_get_xder:
  * @data_field: A data field.
@@ -119,6 +119,9 @@ GwyDataField*  gwy_data_field_new_binned   (GwyDataField *data_field,
                                             gint yoff,
                                             gint trimlowest,
                                             gint trimhighest);
+GwyDataField*  gwy_data_field_new_downsampled(GwyDataField *data_field,
+                                              gint xres,
+                                              gint yres);
 void              gwy_data_field_resize              (GwyDataField *data_field,
                                                       gint ulcol,
                                                       gint ulrow,
@@ -86,6 +86,22 @@ typedef void (*MinMaxPrecomputedRowFill)(const MinMaxPrecomputedReq *req,
 static void find_required_lengths_recursive(MinMaxPrecomputedReq *req,
                                             guint blocklen,
                                             gboolean is_even);
+static void area_median_filter_direct      (const gdouble *data,
+                                            gint xres,
+                                            gint width,
+                                            gint height,
+                                            gint size,
+                                            gint ifrom,
+                                            gint ito,
+                                            gdouble *buffer);
+static void area_median_filter_radixtree   (const gdouble *data,
+                                            gint xres,
+                                            gint width,
+                                            gint height,
+                                            gint size,
+                                            gint ifrom,
+                                            gint ito,
+                                            gdouble *buffer);
 
 /* K-th rank filter tree.  Number of levels with special storage; the rest
  * is in ucount[][]. */
@@ -1679,12 +1695,14 @@ gwy_data_field_area_filter_median(GwyDataField *data_field,
                                   gint width, gint height)
 {
 
-    gint xres, i, j;
+    gint xres, i;
     gdouble *buffer, *data;
 
     if (!_gwy_data_field_check_area(data_field, col, row, width, height))
         return;
     g_return_if_fail(size > 0);
+    if (size == 1)
+        return;
 
     buffer = g_new(gdouble, width*height);
     xres = data_field->xres;
@@ -1692,33 +1710,17 @@ gwy_data_field_area_filter_median(GwyDataField *data_field,
 
 #ifdef _OPENMP
 #pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
-            private(i,j) \
             shared(data,buffer,xres,width,height,size)
 #endif
     {
         gint ifrom = gwy_omp_chunk_start(height);
         gint ito = gwy_omp_chunk_end(height);
-        gdouble *kernel = g_new(gdouble, size*size);
-        gint k;
-
-        for (i = ifrom; i < ito; i++) {
-            gint yfrom = MAX(0, i - (size-1)/2);
-            gint yto = MIN(height-1, i + size/2);
 
-            for (j = 0; j < width; j++) {
-                gint xfrom = MAX(0, j - (size-1)/2);
-                gint xto = MIN(width-1, j + size/2);
-                gint len = xto - xfrom + 1;
-                for (k = yfrom; k <= yto; k++) {
-                    gwy_assign(kernel + len*(k - yfrom),
-                               data + k*xres + xfrom,
-                               len);
-                }
-                buffer[i*width + j] = gwy_math_median(len*(yto - yfrom + 1),
-                                                      kernel);
-            }
-        }
-        g_free(kernel);
+        /* The direct method should be fast for tiny kernels. */
+        if (size*size <= 25)
+            area_median_filter_direct(data, xres, width, height, size, ifrom, ito, buffer);
+        else
+            area_median_filter_radixtree(data, xres, width, height, size, ifrom, ito, buffer);
     }
 
     for (i = 0; i < height; i++)
@@ -2102,6 +2104,152 @@ median_radix_tree_kth_erank(const MedianRadixTree *mrtree, guint k)
     return median_radix_tree_kth_rank(mrtree, mrtree->len-1 - k);
 }
 
+static void
+area_median_filter_direct(const gdouble *data, gint xres,
+                          gint width, gint height, gint size,
+                          gint ifrom, gint ito,
+                          gdouble *buffer)
+{
+    gdouble *kernel = g_new(gdouble, size*size);
+    gint i, j, k;
+
+    for (i = ifrom; i < ito; i++) {
+        gint yfrom = MAX(0, i - (size-1)/2);
+        gint yto = MIN(height-1, i + size/2);
+
+        for (j = 0; j < width; j++) {
+            gint xfrom = MAX(0, j - (size-1)/2);
+            gint xto = MIN(width-1, j + size/2);
+            gint len = xto - xfrom + 1;
+            for (k = yfrom; k <= yto; k++)
+                gwy_assign(kernel + len*(k - yfrom), data + k*xres + xfrom, len);
+            buffer[i*width + j] = gwy_math_median(len*(yto - yfrom + 1), kernel);
+        }
+    }
+    g_free(kernel);
+}
+
+static inline void
+median_radix_tree_add_block(MedianRadixTree *mrtree, const guint *ranks, gint width,
+                            gint xfrom, gint xto, gint yfrom, gint yto)
+{
+    gint i, j;
+
+    for (i = yfrom; i <= yto; i++) {
+        for (j = xfrom; j <= xto; j++)
+            median_radix_tree_add(mrtree, ranks[i*width + j]);
+    }
+}
+
+static inline void
+median_radix_tree_remove_block(MedianRadixTree *mrtree, const guint *ranks, gint width,
+                               gint xfrom, gint xto, gint yfrom, gint yto)
+{
+    gint i, j;
+
+    for (i = yfrom; i <= yto; i++) {
+        for (j = xfrom; j <= xto; j++)
+            median_radix_tree_remove(mrtree, ranks[i*width + j]);
+    }
+}
+
+/* Median filter with a square kernel clipped to the area, i.e. the same as area_median_filter_direct(), for output
+ * rows from ifrom to ito-1.  The rows the windows can reach are rank-transformed and we slide the window in a
+ * serpentine over the rows, only adding and removing the entering and leaving columns or rows.  So the cost per pixel
+ * is proportional to the kernel size, not its area. */
+static void
+area_median_filter_radixtree(const gdouble *data, gint xres,
+                             gint width, gint height, gint size,
+                             gint ifrom, gint ito,
+                             gdouble *buffer)
+{
+    gint before = (size - 1)/2, after = size/2;
+    gint rfrom, rto, n, i, j, xfrom, xto, yfrom, yto;
+    MedianRadixTree mrtree;
+    guint *revindex, *ranks;
+    gdouble *values;
+
+    if (ito <= ifrom)
+        return;
+
+    /* Rank-transform the rows we need, with row indices relative to rfrom. */
+    rfrom = MAX(0, ifrom - before);
+    rto = MIN(height-1, ito-1 + after);
+    n = (rto - rfrom + 1)*width;
+    values = g_new(gdouble, n);
+    for (i = rfrom; i <= rto; i++)
+        gwy_assign(values + (i - rfrom)*width, data + i*xres, width);
+
+    revindex = g_new(guint, n);
+    for (i = 0; i < n; i++)
+        revindex[i] = i;
+    gwy_math_sort_with_index(n, values, revindex);
+
+    ranks = g_new(guint, n);
+    for (i = 0; i < n; i++)
+        ranks[revindex[i]] = i;
+    g_free(revindex);
+
+    median_radix_tree_alloc(&mrtree, n);
+
+    /* The initial window in the top left corner of the strip. */
+    i = ifrom;
+    j = 0;
+    yfrom = MAX(0, i - before) - rfrom;
+    yto = MIN(height-1, i + after) - rfrom;
+    xfrom = 0;
+    xto = MIN(width-1, after);
+    median_radix_tree_add_block(&mrtree, ranks, width, xfrom, xto, yfrom, yto);
+
+    while (TRUE) {
+        if ((i - ifrom) % 2 == 0) {
+            /* Rightward pass. */
+            while (TRUE) {
+                buffer[i*width + j] = values[median_radix_tree_kth_rank(&mrtree, mrtree.len/2)];
+                if (j == width-1)
+                    break;
+                if (j - before >= 0)
+                    median_radix_tree_remove_block(&mrtree, ranks, width, xfrom, xfrom, yfrom, yto);
+                j++;
+                xfrom = MAX(0, j - before);
+                if (j + after < width)
+                    median_radix_tree_add_block(&mrtree, ranks, width, j + after, j + after, yfrom, yto);
+                xto = MIN(width-1, j + after);
+            }
+        }
+        else {
+            /* Leftward pass. */
+            while (TRUE) {
+                buffer[i*width + j] = values[median_radix_tree_kth_rank(&mrtree, mrtree.len/2)];
+                if (j == 0)
+                    break;
+                if (j + after < width)
+                    median_radix_tree_remove_block(&mrtree, ranks, width, xto, xto, yfrom, yto);
+                j--;
+                xto = MIN(width-1, j + after);
+                if (j - before >= 0)
+                    median_radix_tree_add_block(&mrtree, ranks, width, j - before, j - before, yfrom, yto);
+                xfrom = MAX(0, j - before);
+            }
+        }
+
+        /* Move down. */
+        if (i == ito-1)
+            break;
+        if (i - before >= 0)
+            median_radix_tree_remove_block(&mrtree, ranks, width, xfrom, xto, yfrom, yfrom);
+        i++;
+        yfrom = MAX(0, i - before) - rfrom;
+        if (i + after < height)
+            median_radix_tree_add_block(&mrtree, ranks, width, xfrom, xto, i + after - rfrom, i + after - rfrom);
+        yto = MIN(height-1, i + after) - rfrom;
+    }
+
+    median_radix_tree_free(&mrtree);
+    g_free(ranks);
+    g_free(values);
+}
+
 static void
 filter_kernel_boundaries_create(GwyDataField *kernel,
                                 FilterKernelBoundaries *kbound,
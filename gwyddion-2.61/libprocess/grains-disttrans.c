@@ -25,6 +25,7 @@
 #include <libgwyddion/gwymath.h>
 #include <libprocess/arithmetic.h>
 #include <libprocess/grains.h>
+#include <libprocess/bitmask.h>
 #include "gwyprocessinternal.h"
 
 enum {
@@ -610,6 +611,18 @@ gwy_data_field_grains_shrink(GwyDataField *data_field,
     if (amount < 0.5)
         return;
 
+    /* Simple 4- and 8-connectivity distances are integers and reduce to repeated single-pixel erosions. */
+    if (dtype == GWY_DISTANCE_TRANSFORM_CONN4 || dtype == GWY_DISTANCE_TRANSFORM_CONN8) {
+        GwyBitMask *mask = gwy_bit_mask_new_from_field(data_field);
+
+        /* Clamp before the conversion; the bit mask operation clamps the number of steps further anyway. */
+        amount = MIN(amount + 1e-9, (gdouble)(data_field->xres + data_field->yres));
+        gwy_bit_mask_shrink(mask, (guint)floor(amount), dtype, from_border);
+        _gwy_bit_mask_merge_to_field(mask, data_field, FALSE);
+        gwy_bit_mask_free(mask);
+        return;
+    }
+
     xres = data_field->xres;
     yres = data_field->yres;
     edt = gwy_data_field_duplicate(data_field);
@@ -735,6 +748,17 @@ gwy_data_field_grains_grow(GwyDataField *data_field,
         return;
 
     amount += 1e-9;
+    if (!prevent_merging
+        && (dtype == GWY_DISTANCE_TRANSFORM_CONN4 || dtype == GWY_DISTANCE_TRANSFORM_CONN8)) {
+        GwyBitMask *mask = gwy_bit_mask_new_from_field(data_field);
+
+        amount = MIN(amount, (gdouble)(data_field->xres + data_field->yres));
+        gwy_bit_mask_grow(mask, (guint)floor(amount), dtype);
+        _gwy_bit_mask_merge_to_field(mask, data_field, TRUE);
+        gwy_bit_mask_free(mask);
+        return;
+    }
+
     xres = data_field->xres;
     yres = data_field->yres;
     edt = gwy_data_field_duplicate(data_field);
@@ -33,6 +33,13 @@ enum {
     BACKGROUND_FLAG = 0,
 };
 
+enum {
+    /* Images smaller than this are numbered serially. */
+    PARALLEL_NUMBERING_MIN_SIZE = 1 << 16,
+    /* Do not let strips become thinner than this. */
+    PARALLEL_NUMBERING_MIN_ROWS = 16,
+};
+
 static gdouble  class_weight                 (GwyDataLine *hist,
                                               gint t,
                                               gint flag);
@@ -798,12 +805,193 @@ finalise_grain_numbering(gint *m, gint max_id,
     g_free(mm);
 
     /* Renumber grains (we make use of the fact m[0] = 0) */
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled() && n >= PARALLEL_NUMBERING_MIN_SIZE) default(none) \
+            private(i) \
+            shared(grains,m,n)
+#endif
     for (i = 0; i < n; i++)
         grains[i] = m[grains[i]];
 
     return id;
 }
 
+/* Number grains in rows [ifrom, ito) with simple unidirectional grain number propagation, ignoring anything above
+ * ifrom.  Map m is filled with fully resolved links between the provisional numbers.  Returns the largest provisional
+ * number used. */
+static gint
+number_grains_in_strip(gint *grains, gint xres, gint ifrom, gint ito, IntList *m)
+{
+    gint i, j, k, grain_id, max_id, id;
+
+    m->len = 0;
+    int_list_add(m, 0);
+
+    max_id = 0;
+    k = ifrom*xres;
+    for (i = ifrom; i < ito; i++) {
+        grain_id = 0;
+        for (j = 0; j < xres; j++, k++) {
+            if (grains[k]) {
+                if (i > ifrom && (id = grains[k-xres])) {
+                    if (!grain_id)
+                        grain_id = id;
+                    else if (id != grain_id) {
+                        resolve_grain_map(m->data, id, grain_id);
+                        grain_id = m->data[id];
+                    }
+                }
+                if (!grain_id) {
+                    grain_id = ++max_id;
+                    int_list_add(m, grain_id);
+                }
+                grains[k] = grain_id;
+            }
+            else
+                grain_id = 0;
+        }
+    }
+
+    for (i = 1; i <= max_id; i++)
+        m->data[i] = m->data[m->data[i]];
+
+    return max_id;
+}
+
+static inline gint
+find_grain_root(const gint *parent, gint i)
+{
+    gint p;
+
+    while ((p = g_atomic_int_get(parent + i)) != i)
+        i = p;
+    return i;
+}
+
+/* Lock-free union.  Roots are only ever linked to smaller roots, so the root of each grain is its smallest number. */
+static inline void
+merge_grain_roots(gint *parent, gint i, gint j)
+{
+    while (TRUE) {
+        i = find_grain_root(parent, i);
+        j = find_grain_root(parent, j);
+        if (i == j)
+            return;
+        if (i < j)
+            GWY_SWAP(gint, i, j);
+        if (g_atomic_int_compare_and_exchange(parent + i, i, j))
+            return;
+    }
+}
+
+/* Parallel version of renumber_grains().  The image is split to horizontal strips which are numbered independently.
+ * The provisional numbers are then made globally unique, grains touching across strip boundaries are merged and the
+ * final numbers assigned.
+ *
+ * The result is identical to the serial version.  In both, the final numbers are assigned in the order of the first
+ * pixel of each grain in the image.  The first pixel of a grain always receives a new provisional number and
+ * provisional numbers grow in the raster order (strip by strip), so the smallest provisional number of each grain –
+ * which is its root – corresponds to its first pixel. */
+static gint
+renumber_grains_parallel(gint *grains, gint xres, gint yres, gint nstrips)
+{
+    gint *offsets, *parent;
+    IntList **maps;
+    gint s, i, l, total, id;
+
+    offsets = g_new(gint, nstrips+1);
+    maps = g_new(IntList*, nstrips);
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(s) \
+            shared(grains,xres,yres,nstrips,offsets,maps)
+#endif
+    for (s = 0; s < nstrips; s++) {
+        gint ifrom = s*yres/nstrips, ito = (s + 1)*yres/nstrips;
+
+        maps[s] = int_list_new(xres);
+        offsets[s+1] = number_grains_in_strip(grains, xres, ifrom, ito, maps[s]);
+    }
+
+    offsets[0] = 0;
+    for (s = 0; s < nstrips; s++)
+        offsets[s+1] += offsets[s];
+    total = offsets[nstrips];
+
+    parent = g_new(gint, total+1);
+    parent[0] = 0;
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(s) \
+            shared(nstrips,offsets,maps,parent)
+#endif
+    for (s = 0; s < nstrips; s++) {
+        const gint *m = maps[s]->data;
+        gint off = offsets[s], n = offsets[s+1] - off, k;
+
+        for (k = 1; k <= n; k++)
+            parent[off + k] = off + m[k];
+        int_list_free(maps[s]);
+    }
+    g_free(maps);
+
+    /* Merge grains across strip boundaries. */
+    for (s = 1; s < nstrips; s++) {
+        gint r = s*yres/nstrips;
+        const gint *above = grains + (r - 1)*xres, *below = grains + r*xres;
+        gint offa = offsets[s-1], offb = offsets[s], j;
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(j) \
+            shared(above,below,xres,offa,offb,parent)
+#endif
+        for (j = 0; j < xres; j++) {
+            if (above[j] && below[j])
+                merge_grain_roots(parent, offa + above[j], offb + below[j]);
+        }
+    }
+
+    /* Resolve all links to roots. */
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(l) \
+            shared(parent,total)
+#endif
+    for (l = 1; l <= total; l++)
+        parent[l] = find_grain_root(parent, l);
+
+    /* Compactify grain numbers.  Roots are smaller than all other numbers in their grains, so going upwards we always
+     * see the root first and can replace numbers with final ids in place. */
+    id = 0;
+    for (l = 1; l <= total; l++) {
+        if (parent[l] == l)
+            parent[l] = ++id;
+        else
+            parent[l] = parent[parent[l]];
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            private(s,i) \
+            shared(grains,xres,yres,nstrips,offsets,parent)
+#endif
+    for (s = 0; s < nstrips; s++) {
+        gint kfrom = (s*yres/nstrips)*xres, kto = ((s + 1)*yres/nstrips)*xres, off = offsets[s];
+
+        for (i = kfrom; i < kto; i++) {
+            if (grains[i])
+                grains[i] = parent[off + grains[i]];
+        }
+    }
+
+    g_free(parent);
+    g_free(offsets);
+
+    return id;
+}
+
 /* Given an image of integers, with zeros corresponding to non-grains and any non-zero values to grains, number
  * grains.  In other words, the non-zero values become grain numbers while zeros are untouched. */
 static gint
@@ -815,6 +1003,11 @@ renumber_grains(gint *grains, gint xres, gint yres, IntList *m)
     g_return_val_if_fail(grains, 0);
 
     if (!m) {
+        gint nstrips = MIN(gwy_omp_max_threads(), yres/PARALLEL_NUMBERING_MIN_ROWS);
+
+        if (nstrips > 1 && xres*yres >= PARALLEL_NUMBERING_MIN_SIZE)
+            return renumber_grains_parallel(grains, xres, yres, nstrips);
+
         m = int_list_new(xres + yres);
         must_free = TRUE;
     }
@@ -823,8 +1016,8 @@ renumber_grains(gint *grains, gint xres, gint yres, IntList *m)
 
     int_list_add(m, 0);
 
-    /* Number grains with simple unidirectional grain number propagation, updating map m for later full grain join */
-    /* OpenMP: This seems too simple and fast to parallelise reasonably. */
+    /* Number grains with simple unidirectional grain number propagation, updating map m for later full grain join.
+     * This is the serial version; large images are handled by renumber_grains_parallel(). */
     max_id = 0;
     grain_id = 0;
     k = 0;
@@ -80,6 +80,15 @@ typedef void (*GwyFFTAreaFunc)(fftw_plan plan,
  * GLib (possibly with some subtle threading mismatch).
  */
 G_GNUC_INTERNAL void      gwy_fftw_execute                (fftw_plan plan);
+G_GNUC_INTERNAL void      gwy_fftw_execute_dft            (fftw_plan plan,
+                                                           fftw_complex *in,
+                                                           fftw_complex *out);
+G_GNUC_INTERNAL void      gwy_fftw_execute_dft_r2c        (fftw_plan plan,
+                                                           double *in,
+                                                           fftw_complex *out);
+G_GNUC_INTERNAL void      gwy_fftw_execute_dft_c2r        (fftw_plan plan,
+                                                           fftw_complex *in,
+                                                           double *out);
 G_GNUC_INTERNAL void      gwy_fftw_plan_maybe_with_threads(void);
 G_GNUC_INTERNAL void      gwy_fftw_plan_without_threads   (void);
 G_GNUC_INTERNAL fftw_plan gwy_fftw_plan_dft_1d            (int n,
@@ -134,6 +143,30 @@ G_GNUC_INTERNAL fftw_plan gwy_fftw_plan_guru_split_dft_r2c(int rank,
                                                            double *io,
                                                            unsigned int flags);
 
+/*
+ * Cached plans, shared among all callers and kept between calls.  They are created only once for each combination
+ * of transform size, type, direction, flags, thread count and array alignment, and planning does not touch the
+ * arrays.  Execute them with the new-array functions above (always passing the arrays explicitly) and give them back
+ * with gwy_fftw_release_plan().  Never destroy them using fftw_destroy_plan().
+ */
+G_GNUC_INTERNAL fftw_plan gwy_fftw_plan_cached_dft_2d     (int n0,
+                                                           int n1,
+                                                           fftw_complex *in,
+                                                           fftw_complex *out,
+                                                           int sign,
+                                                           unsigned int flags);
+G_GNUC_INTERNAL fftw_plan gwy_fftw_plan_cached_dft_r2c_2d (int n0,
+                                                           int n1,
+                                                           double *in,
+                                                           fftw_complex *out,
+                                                           unsigned int flags);
+G_GNUC_INTERNAL fftw_plan gwy_fftw_plan_cached_dft_c2r_2d (int n0,
+                                                           int n1,
+                                                           fftw_complex *in,
+                                                           double *out,
+                                                           unsigned int flags);
+G_GNUC_INTERNAL void      gwy_fftw_release_plan           (fftw_plan plan);
+
 G_GNUC_UNUSED
 static inline void
 do_fft_acf(fftw_plan plan,
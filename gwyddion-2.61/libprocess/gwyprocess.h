@@ -26,8 +26,10 @@
 #include <libprocess/gwyprocesstypes.h>
 
 #include <libprocess/arithmetic.h>
+#include <libprocess/bitmask.h>
 #include <libprocess/brick.h>
 #include <libprocess/cdline.h>
+#include <libprocess/clustering.h>
 #include <libprocess/correct.h>
 #include <libprocess/correlation.h>
 #include <libprocess/cwt.h>
@@ -55,6 +57,7 @@
 #include <libprocess/surface.h>
 #include <libprocess/peaks.h>
 #include <libprocess/triangulation.h>
+#include <libprocess/pointindex.h>
 #include <libprocess/gwyshapefitpreset.h>
 #include <libprocess/gwycalibration.h>
 #include <libprocess/gwycaldata.h>
@@ -439,6 +439,8 @@ gwy_masking_type_get_enum(void)
  * @GWY_DATA_FIELD_CACHE_VAR: Variation.
  * @GWY_DATA_FIELD_CACHE_ENT: Entropy.
  * @GWY_DATA_FIELD_CACHE_MSQ: Mean square.
+ * @GWY_DATA_FIELD_CACHE_SAT: Summed-area tables.  This bit has no corresponding value in the cache; it only marks
+ *                             the tables as valid.  (Since 2.62)
  * @GWY_DATA_FIELD_CACHE_SIZE: The size of statistics cache.
  *
  * Cached data field quantity type.
@@ -87,6 +87,7 @@ typedef enum {
     GWY_DATA_FIELD_CACHE_VAR,
     GWY_DATA_FIELD_CACHE_ENT,
     GWY_DATA_FIELD_CACHE_MSQ,
+    GWY_DATA_FIELD_CACHE_SAT,
     GWY_DATA_FIELD_CACHE_SIZE = 30
 } GwyDataFieldCached;
 
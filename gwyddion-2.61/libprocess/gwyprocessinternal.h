@@ -26,6 +26,7 @@
 
 #include <libprocess/gwyprocessenums.h>
 #include <libprocess/datafield.h>
+#include <libprocess/bitmask.h>
 
 /* Cache operations */
 #define CVAL(datafield, b)  ((datafield)->cache[GWY_DATA_FIELD_CACHE_##b])
@@ -106,6 +107,51 @@ typedef struct {
     guint height;
 } GwyDataFieldPart;
 
+/* Summed-area tables of values and squared values, interleaved.  The tables
+ * have (xres+1)×(yres+1) entries, the first row and column are zeros.  Values
+ * are summed relative to offset (the mean value) to limit cancellation. */
+typedef struct {
+    gint xres;
+    gint yres;
+    gdouble offset;
+    gdouble *sums;
+} AreaSums;
+
+G_GNUC_INTERNAL
+AreaSums* _gwy_area_sums_new(GwyDataField *data_field);
+
+G_GNUC_INTERNAL
+void _gwy_area_sums_update(AreaSums *asums,
+                           GwyDataField *data_field);
+
+G_GNUC_INTERNAL
+void _gwy_area_sums_free(AreaSums *asums);
+
+G_GNUC_INTERNAL
+AreaSums* _gwy_data_field_get_area_sums(GwyDataField *data_field);
+
+/* Sums of z-offset and (z-offset)² in the rectangle.  The rectangle must be
+ * inside the field. */
+static inline void
+_gwy_area_sums_query(const AreaSums *asums,
+                     gint col, gint row,
+                     gint width, gint height,
+                     gdouble *sum, gdouble *sum2)
+{
+    guint rowstride = 2*(asums->xres + 1);
+    const gdouble *top = asums->sums + row*rowstride + 2*col;
+    const gdouble *bottom = top + height*rowstride;
+    guint w = 2*width;
+
+    *sum = (bottom[w] - top[w]) - (bottom[0] - top[0]);
+    *sum2 = (bottom[w+1] - top[w+1]) - (bottom[1] - top[1]);
+}
+
+G_GNUC_INTERNAL
+void _gwy_bit_mask_merge_to_field(const GwyBitMask *mask,
+                                  GwyDataField *field,
+                                  gboolean set);
+
 typedef struct {
     gint i;
     gint j;
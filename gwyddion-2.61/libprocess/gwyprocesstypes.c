@@ -175,6 +175,7 @@ gwy_data_field_cached_get_type(void)
             { GWY_DATA_FIELD_CACHE_VAR, "GWY_DATA_FIELD_CACHE_VAR", "var" },
             { GWY_DATA_FIELD_CACHE_ENT, "GWY_DATA_FIELD_CACHE_ENT", "ent" },
             { GWY_DATA_FIELD_CACHE_MSQ, "GWY_DATA_FIELD_CACHE_MSQ", "msq" },
+            { GWY_DATA_FIELD_CACHE_SAT, "GWY_DATA_FIELD_CACHE_SAT", "sat" },
             { GWY_DATA_FIELD_CACHE_SIZE, "GWY_DATA_FIELD_CACHE_SIZE", "size" },
             { 0, NULL, NULL }
         };
@@ -665,13 +665,13 @@ field_fft_2d_c2c(GwyDataField *rin, GwyDataField *iin,
     n = xres*yres;
     in = gwy_fftw_new_complex(n);
     out = gwy_fftw_new_complex(n);
-    plan = gwy_fftw_plan_dft_2d(yres, xres, in, out, sign, flags);
+    plan = gwy_fftw_plan_cached_dft_2d(yres, xres, in, out, sign, flags);
     for (i = 0; i < n; i++) {
         in[i][0] = rindata[i];
         in[i][1] = iindata[i];
     }
-    gwy_fftw_execute(plan);
-    fftw_destroy_plan(plan);
+    gwy_fftw_execute_dft(plan, in, out);
+    gwy_fftw_release_plan(plan);
     fftw_free(in);
     q = 1.0/sqrt(n);
     for (i = 0; i < n; i++) {
@@ -702,10 +702,10 @@ field_fft_2d_r2c(GwyDataField *rin,
     /* The planner may destroy input.  Use rout as a temporary input buffer. */
     in = routdata;
     out = gwy_fftw_new_complex(cstride*yres);
-    plan = gwy_fftw_plan_dft_r2c_2d(yres, xres, in, out, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
+    plan = gwy_fftw_plan_cached_dft_r2c_2d(yres, xres, in, out, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
     gwy_assign(in, rin->data, xres*yres);
-    gwy_fftw_execute(plan);
-    fftw_destroy_plan(plan);
+    gwy_fftw_execute_dft_r2c(plan, in, out);
+    gwy_fftw_release_plan(plan);
 
     /* Expand the R2C data to full-sized fields using the Hermitean symmetry. The zeroth row and column are not
      * mirrored; the central row and column might be (sort of), depending on parity.
@@ -799,8 +799,7 @@ field_fft_2d_c2r(GwyDataField *rin, GwyDataField *iin,
         qi = qr;
 
     in = gwy_fftw_new_complex(cstride*yres);
-    plan = gwy_fftw_plan_dft_c2r_2d(yres, xres, in, routdata, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
-    g_assert(plan);
+    plan = gwy_fftw_plan_cached_dft_c2r_2d(yres, xres, in, routdata, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
     /* Use half of input fields, assuming the Hermitean symmetry.  Do not
      * attempt to enforce zeros in imaginary parts either.  */
     for (i = 0; i < yres; i++) {
@@ -812,8 +811,8 @@ field_fft_2d_c2r(GwyDataField *rin, GwyDataField *iin,
             crow[j][1] = -qi*irow[j];
         }
     }
-    gwy_fftw_execute(plan);
-    fftw_destroy_plan(plan);
+    gwy_fftw_execute_dft_c2r(plan, in, routdata);
+    gwy_fftw_release_plan(plan);
     fftw_free(in);
 
     gwy_data_field_invalidate(rout);
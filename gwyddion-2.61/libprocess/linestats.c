@@ -487,6 +487,61 @@ gwy_data_line_get_kurtosis(GwyDataLine *a)
     return gwy_data_line_part_get_kurtosis(a, 0, a->res);
 }
 
+/**
+ * gwy_data_line_get_stats:
+ * @data_line: A data line.
+ * @avg: Where average value should be stored, or %NULL.
+ * @ra: Where mean absolute deviation should be stored, or %NULL.
+ * @rms: Where root mean square deviation should be stored, or %NULL.
+ * @skew: Where skew should be stored, or %NULL.
+ * @kurtosis: Where excess kurtosis should be stored, or %NULL.
+ *
+ * Computes basic statistical quantities of a data line.
+ *
+ * The quantities are the same as returned by gwy_data_line_get_avg(),
+ * gwy_data_line_get_ra(), gwy_data_line_get_rms(), gwy_data_line_get_skew()
+ * and gwy_data_line_get_kurtosis().  However, they are all calculated
+ * together in two passes over the data.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_data_line_get_stats(GwyDataLine *data_line,
+                        gdouble *avg,
+                        gdouble *ra,
+                        gdouble *rms,
+                        gdouble *skew,
+                        gdouble *kurtosis)
+{
+    gdouble myavg, sa = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0;
+    gint i, n;
+
+    g_return_if_fail(GWY_IS_DATA_LINE(data_line));
+
+    n = data_line->res;
+    myavg = gwy_data_line_get_avg(data_line);
+    for (i = 0; i < n; i++) {
+        gdouble d = data_line->data[i] - myavg, d2 = d*d;
+        sa += fabs(d);
+        s2 += d2;
+        s3 += d2*d;
+        s4 += d2*d2;
+    }
+
+    if (avg)
+        *avg = myavg;
+    if (ra)
+        *ra = sa/n;
+    if (rms)
+        *rms = sqrt(s2/n);
+    /* Keep the normalisation of gwy_data_line_part_get_skew() and
+     * gwy_data_line_part_get_kurtosis(). */
+    if (skew)
+        *skew = s2 ? s3*sqrt(n+1)/pow(s2, 1.5) : 0.0;
+    if (kurtosis)
+        *kurtosis = s2 ? s4*(n+1)/(s2*s2) - 3.0 : 0.0;
+}
+
 /**
  * gwy_data_line_part_get_ra:
  * @data_line: A data line.
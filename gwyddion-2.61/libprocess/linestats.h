@@ -43,6 +43,12 @@ gdouble gwy_data_line_get_sum           (GwyDataLine *data_line);
 gdouble gwy_data_line_get_ra            (GwyDataLine *data_line);
 gdouble gwy_data_line_get_skew          (GwyDataLine *data_line);
 gdouble gwy_data_line_get_kurtosis      (GwyDataLine *data_line);
+void    gwy_data_line_get_stats         (GwyDataLine *data_line,
+                                         gdouble *avg,
+                                         gdouble *ra,
+                                         gdouble *rms,
+                                         gdouble *skew,
+                                         gdouble *kurtosis);
 gdouble gwy_data_line_part_get_max      (GwyDataLine *data_line,
                                          gint from,
                                          gint to);
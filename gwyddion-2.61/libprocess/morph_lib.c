@@ -27,6 +27,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <libgwyddion/gwymacros.h>
+#include <libgwyddion/gwymath.h>
 #include "libgwyddion/gwyomp.h"
 #include "gwyprocessinternal.h"
 #include "morph_lib.h"
@@ -146,86 +147,249 @@ _gwy_morph_lib_ireflect(const gint *const *image, gint xres, gint yres)
     return result;
 }
 
+/* Running maximum of @n values with stride @stride, for window [k-before, k+after] clipped to the data.  This is the
+ * van Herk/Gil-Werman algorithm, taking three comparisons per value independently on the window size.  Buffers @g and
+ * @h must have space for n+before+after values. */
+static void
+running_max_1d(const gdouble *src, gint n, gint stride,
+               gint before, gint after,
+               gdouble *dest, gint dstride,
+               gdouble *g, gdouble *h)
+{
+    gint w = before + after + 1, len = n + w - 1;
+    gint k, m;
+
+    for (k = 0; k < len; k++)
+        g[k] = (k < before || k >= before + n) ? -G_MAXDOUBLE : src[(k - before)*stride];
+    gwy_assign(h, g, len);
+
+    /* Forward maxima from block starts in g[], backward maxima from block ends in h[]. */
+    for (k = 0; k < len; k += w) {
+        gint kend = MIN(k + w, len);
+
+        for (m = k+1; m < kend; m++)
+            g[m] = MAX(g[m], g[m-1]);
+        for (m = kend-2; m >= k; m--)
+            h[m] = MAX(h[m], h[m+1]);
+    }
+
+    for (k = 0; k < n; k++)
+        dest[k*dstride] = MAX(h[k], g[k + w-1]);
+}
+
 /**
- * gwy_morph_lib_idilation:
- * @image: Surface array.
- * @im_xsiz: Number of columns.
- * @im_ysiz: Number of rows.
- * @tip: Tip array.
- * @tip_xsiz: Number of columns.
- * @tip_ysiz: Number of rows.
+ * _gwy_morph_lib_dilation:
+ * @image: Surface data, @xres*@yres values.
+ * @xres: Number of columns.
+ * @yres: Number of rows.
+ * @tip: Tip data, @txres*@tyres values.
+ * @txres: Number of tip columns.
+ * @tyres: Number of tip rows.
  * @xc: Tip apex column coordinate.
  * @yc: Tip apex row coordinate.
+ * @clamp_border: %TRUE to extend the surface by border values, %FALSE to use only tip points lying within the
+ *                surface.
+ * @result: Array where to store the result, @xres*@yres values.
  * @set_fraction: Function that sets fraction to output (or %NULL).
- * @set_message: Function that sets message to output (or %NULL).
  *
- * Performs dilation algorithm (for integer arrays).
+ * Performs grey-scale dilation of real-valued data.
  *
- * Returns: Dilated data (newly allocated).  May return %NULL if aborted.
+ * The result is the maximum of image[i+ti-yc][j+tj-xc] + tip[ti][tj] over all tip points.  It is exact, but instead
+ * of evaluating the full tip at each pixel, the tip points are visited in descending order of height and the search is
+ * stopped once no remaining point can increase the maximum.  The bound is the maximum of the surface over the tip
+ * rectangle, which is computed for all pixels by separable running maxima.  So for a flat tip the cost is the same as
+ * the naive evaluation, but for tips with realistic slopes only a small fraction of the tip is visited.
+ *
+ * Erosion can be obtained as the negated dilation of negated data.
+ *
+ * Returns: %TRUE if the operation finished, %FALSE if it was aborted.
  **/
-static gint**
-gwy_morph_lib_idilation(const gint *const *image, gint xres, gint yres,
-                        const gint *const *tip, gint txres, gint tyres,
+gboolean
+_gwy_morph_lib_dilation(const gdouble *image, gint xres, gint yres,
+                        const gdouble *tip, gint txres, gint tyres,
                         gint xc, gint yc,
-                        GwySetMessageFunc set_message,
+                        gboolean clamp_border,
+                        gdouble *result,
                         GwySetFractionFunc set_fraction)
 {
-    gint **result;
+    gint tn = txres*tyres, k;
+    gdouble *bound, *tvalues;
+    gint *tindex, *ti, *tj, *toff;
     gboolean cancelled = FALSE, *pcancelled = &cancelled;
 
-    if ((set_message && !set_message(_("Dilation...")))
-        || (set_fraction && !set_fraction(0.0)))
-        return NULL;
+    g_return_val_if_fail(xc >= 0 && xc < txres && yc >= 0 && yc < tyres, FALSE);
+
+    /* Sort tip points by height, in descending order. */
+    tvalues = g_new(gdouble, tn);
+    tindex = g_new(gint, 4*tn);
+    ti = tindex + tn;
+    tj = ti + tn;
+    toff = tj + tn;
+    for (k = 0; k < tn; k++) {
+        tvalues[k] = -tip[k];
+        tindex[k] = k;
+    }
+    gwy_math_sort_with_index(tn, tvalues, (guint*)tindex);
+    for (k = 0; k < tn; k++) {
+        tvalues[k] = -tvalues[k];
+        ti[k] = tindex[k]/txres - yc;
+        tj[k] = tindex[k] % txres - xc;
+        toff[k] = ti[k]*xres + tj[k];
+    }
 
-    /* create output array of appropriate size */
-    result = _gwy_morph_lib_iallocmatrix(yres, xres);
+    /* Maxima of image over the tip rectangle: first rows into result[], then columns into bound[]. */
+    bound = g_new(gdouble, xres*yres);
+#ifdef _OPENMP
+#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
+            shared(image,result,xres,yres,txres,xc)
+#endif
+    {
+        gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
+        gdouble *g = g_new(gdouble, 2*(xres + txres)), *h = g + xres + txres;
+        gint i;
+
+        for (i = ifrom; i < ito; i++)
+            running_max_1d(image + i*xres, xres, 1, xc, txres-1 - xc, result + i*xres, 1, g, h);
+        g_free(g);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
+            shared(result,bound,xres,yres,tyres,yc)
+#endif
+    {
+        gint jfrom = gwy_omp_chunk_start(xres), jto = gwy_omp_chunk_end(xres);
+        gdouble *g = g_new(gdouble, 2*(yres + tyres)), *h = g + yres + tyres;
+        gint j;
+
+        for (j = jfrom; j < jto; j++)
+            running_max_1d(result + j, yres, xres, yc, tyres-1 - yc, bound + j, xres, g, h);
+        g_free(g);
+    }
 
 #ifdef _OPENMP
 #pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
-            shared(image,tip,result,xres,yres,txres,tyres,xc,yc,set_fraction,pcancelled)
+            shared(image,result,bound,xres,yres,txres,tyres,xc,yc,clamp_border,tn,tvalues,ti,tj,toff, \
+                   set_fraction,pcancelled)
 #endif
     {
         gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
-        gint i, j;
+        gint i, j, m;
 
-        /* Loop over all points in output array */
         for (i = ifrom; i < ito; i++) {
-            /* Compute the allowed range of py. This may be different from
-             * the full range of the tip due to edge overlaps. */
-            gint pymin = MAX(i - yres + 1, -yc);
-            gint pymax = MIN(tyres - yc - 1, i);
+            gboolean row_inside = (i >= yc && i + tyres-yc <= yres);
+
             for (j = 0; j < xres; j++) {
-                /* Compute the allowed range of px. This may be different from
-                * the full range of the tip due to edge overlaps. */
-                gint pxmin = MAX(j - xres + 1, -xc);
-                gint pxmax = MIN(txres - xc - 1, j);
-                gint max, px, py;
-
-                max = image[i - pymin][j - pxmin] + tip[pymin + yc][pxmin + xc];
-                /* Loop over points in tip */
-                for (px = pxmin; px <= pxmax; px++) {
-                    for (py = pymin; py <= pymax; py++) {
-                        gint temp = image[i - py][j - px] + tip[py + yc][px + xc];
-                        max = MAX(temp, max);
+                gboolean col_inside = (j >= xc && j + txres-xc <= xres);
+                const gdouble *src = image + i*xres + j;
+                gdouble b = bound[i*xres + j], hmax = -G_MAXDOUBLE, h;
+
+                if (row_inside && col_inside) {
+                    for (m = 0; m < tn && tvalues[m] + b > hmax; m++) {
+                        h = src[toff[m]] + tvalues[m];
+                        if (h > hmax)
+                            hmax = h;
+                    }
+                }
+                else {
+                    for (m = 0; m < tn && tvalues[m] + b > hmax; m++) {
+                        gint isrc = i + ti[m], jsrc = j + tj[m];
+
+                        if (clamp_border) {
+                            isrc = CLAMP(isrc, 0, yres-1);
+                            jsrc = CLAMP(jsrc, 0, xres-1);
+                        }
+                        else if (isrc < 0 || isrc >= yres || jsrc < 0 || jsrc >= xres)
+                            continue;
+                        h = image[isrc*xres + jsrc] + tvalues[m];
+                        if (h > hmax)
+                            hmax = h;
                     }
                 }
-                result[i][j] = max;
+                result[i*xres + j] = hmax;
             }
 
-            if (gwy_omp_set_fraction_check_cancel(set_fraction, i, ifrom, ito,
-                                                  pcancelled))
+            if (gwy_omp_set_fraction_check_cancel(set_fraction, i, ifrom, ito, pcancelled))
                 break;
         }
     }
 
-    if (cancelled) {
-        _gwy_morph_lib_ifreematrix(result);
-        return NULL;
+    g_free(bound);
+    g_free(tindex);
+    g_free(tvalues);
+
+    return !cancelled;
+}
+
+/* Run _gwy_morph_lib_dilation() on integer arrays.  Sums of two integers are exactly representable as doubles, so the
+ * result is the same as if computed in integers.  For erosion, pass @negate = %TRUE. */
+static gint**
+idilation_real(const gint *const *image, gint xres, gint yres,
+               const gint *const *tip, gint txres, gint tyres,
+               gint xc, gint yc, gboolean reflect_tip, gboolean negate,
+               GwySetFractionFunc set_fraction)
+{
+    gint n = xres*yres, tn = txres*tyres, k;
+    gdouble *dimage, *dtip, *dresult;
+    const gint *t = tip[0], *d = image[0];
+    gint **result = NULL;
+    gint *r;
+
+    dimage = g_new(gdouble, 2*n + tn);
+    dresult = dimage + n;
+    dtip = dresult + n;
+    for (k = 0; k < n; k++)
+        dimage[k] = negate ? -d[k] : d[k];
+    for (k = 0; k < tn; k++)
+        dtip[k] = reflect_tip ? t[tn-1 - k] : t[k];
+    if (reflect_tip) {
+        xc = txres-1 - xc;
+        yc = tyres-1 - yc;
     }
 
+    if (_gwy_morph_lib_dilation(dimage, xres, yres, dtip, txres, tyres, xc, yc, FALSE, dresult, set_fraction)) {
+        result = _gwy_morph_lib_iallocmatrix(yres, xres);
+        r = result[0];
+        for (k = 0; k < n; k++)
+            r[k] = negate ? -(gint)dresult[k] : (gint)dresult[k];
+    }
+    g_free(dimage);
+
     return result;
 }
 
+/**
+ * gwy_morph_lib_idilation:
+ * @image: Surface array.
+ * @im_xsiz: Number of columns.
+ * @im_ysiz: Number of rows.
+ * @tip: Tip array.
+ * @tip_xsiz: Number of columns.
+ * @tip_ysiz: Number of rows.
+ * @xc: Tip apex column coordinate.
+ * @yc: Tip apex row coordinate.
+ * @set_fraction: Function that sets fraction to output (or %NULL).
+ * @set_message: Function that sets message to output (or %NULL).
+ *
+ * Performs dilation algorithm (for integer arrays).
+ *
+ * Returns: Dilated data (newly allocated).  May return %NULL if aborted.
+ **/
+static gint**
+gwy_morph_lib_idilation(const gint *const *image, gint xres, gint yres,
+                        const gint *const *tip, gint txres, gint tyres,
+                        gint xc, gint yc,
+                        GwySetMessageFunc set_message,
+                        GwySetFractionFunc set_fraction)
+{
+    if ((set_message && !set_message(_("Dilation...")))
+        || (set_fraction && !set_fraction(0.0)))
+        return NULL;
+
+    /* The tip is applied reflected: result[i][j] = max(image[i-py][j-px] + tip[py+yc][px+xc]). */
+    return idilation_real(image, xres, yres, tip, txres, tyres, xc, yc, TRUE, FALSE, set_fraction);
+}
+
 /**
  * _gwy_morph_lib_ierosion:
  * @surface: Surface array.
@@ -250,62 +414,12 @@ _gwy_morph_lib_ierosion(const gint *const *image, gint xres, gint yres,
                         GwySetMessageFunc set_message,
                         GwySetFractionFunc set_fraction)
 {
-    gint **result;
-    gboolean cancelled = FALSE, *pcancelled = &cancelled;
-
     if ((set_message && !set_message(_("Erosion...")))
         || (set_fraction && !set_fraction(0.0)))
         return NULL;
 
-    /* create output array of appropriate size */
-    result = _gwy_morph_lib_iallocmatrix(yres, xres);
-
-#ifdef _OPENMP
-#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
-            shared(image,tip,result,xres,yres,txres,tyres,xc,yc,set_fraction,pcancelled)
-#endif
-    {
-        gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
-        gint i, j;
-
-        /* Loop over all points in output array */
-        for (i = ifrom; i < ito; i++) {
-            /* Compute the allowed range of py. This may be different from
-             * the full range of the tip due to edge overlaps. */
-            gint pymin = MAX(-i, -yc);
-            gint pymax = MIN(tyres - yc, yres - i) - 1;
-
-            for (j = 0; j < xres; j++) {
-                /* Compute the allowed range of px. This may be different from
-                 * the full range of the tip due to edge overlaps. */
-                gint pxmin = MAX(-xc, -j);
-                gint pxmax = MIN(txres - xc, xres - j) - 1;
-                gint min, px, py;
-
-                min = image[i + pymin][j + pxmin] - tip[pymin + yc][pxmin + xc];
-                /* Loop over points in tip */
-                for (py = pymin; py <= pymax; py++) {
-                    for (px = pxmin; px <= pxmax; px++) {
-                        gint temp = image[i + py][j + px] - tip[py + yc][px + xc];
-                        if (min > temp)
-                            min = temp;
-                    }
-                }
-                result[i][j] = min;
-            }
-
-            if (gwy_omp_set_fraction_check_cancel(set_fraction, i, ifrom, ito,
-                                                  pcancelled))
-                break;
-        }
-    }
-
-    if (cancelled) {
-        _gwy_morph_lib_ifreematrix(result);
-        return NULL;
-    }
-
-    return result;
+    /* min(image[i+py][j+px] - tip[py+yc][px+xc]) = -max(-image[i+py][j+px] + tip[py+yc][px+xc]) */
+    return idilation_real(image, xres, yres, tip, txres, tyres, xc, yc, FALSE, TRUE, set_fraction);
 }
 
 /**
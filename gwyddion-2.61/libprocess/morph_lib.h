@@ -39,6 +39,14 @@ G_GNUC_INTERNAL
 gint **_gwy_morph_lib_ireflect(const gint *const *image,
                                gint xres, gint yres);
 
+G_GNUC_INTERNAL
+gboolean _gwy_morph_lib_dilation(const gdouble *image, gint xres, gint yres,
+                                 const gdouble *tip, gint txres, gint tyres,
+                                 gint xc, gint yc,
+                                 gboolean clamp_border,
+                                 gdouble *result,
+                                 GwySetFractionFunc set_fraction);
+
 G_GNUC_INTERNAL
 gint **_gwy_morph_lib_ierosion(const gint *const *image, gint xres, gint yres,
                                const gint *const *tip, gint txres, gint tyres,
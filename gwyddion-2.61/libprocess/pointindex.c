@@ -0,0 +1,657 @@
+/*
+ *  $Id$
+ *  Copyright (C) 2022 David Necas (Yeti).
+ *  E-mail: yeti@gwyddion.net.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any
+ *  later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with this program; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <libgwyddion/gwymacros.h>
+#include <libgwyddion/gwymath.h>
+#include <libprocess/pointindex.h>
+#include "libgwyddion/gwyomp.h"
+
+/* Average number of points in one cell.  A few points per cell keep both the number of visited empty cells and the
+ * number of distance evaluations low. */
+#define POINTS_PER_CELL 2.0
+
+/* Neighbour counts up to this use stack buffers in gwy_point_index_find_nearest(). */
+#define STACK_NEIGHBOURS 64
+
+/* Square cells of a uniform grid covering the bounding box of the points.  The points are not copied.  Their indices
+ * are sorted by cell in ids[] so each cell is a contiguous block [cellstart[c], cellstart[c+1]) of ids[]. */
+struct _GwyPointIndex {
+    guint npoints;
+    guint xcells;
+    guint ycells;
+    gdouble xmin;
+    gdouble ymin;
+    gdouble cellsize;
+    guint *cellstart;
+    const GwyXYZ *points;
+    guint *ids;
+};
+
+static inline guint
+cell_coord(gdouble t, gdouble cellsize, guint ncells)
+{
+    t = floor(t/cellsize);
+    /* Also catches NaNs. */
+    if (!(t >= 0.0))
+        return 0;
+    if (t >= ncells)
+        return ncells-1;
+    return (guint)t;
+}
+
+static inline guint
+point_cell(const GwyPointIndex *pindex, gdouble x, gdouble y)
+{
+    return (cell_coord(y - pindex->ymin, pindex->cellsize, pindex->ycells)*pindex->xcells
+            + cell_coord(x - pindex->xmin, pindex->cellsize, pindex->xcells));
+}
+
+/**
+ * gwy_point_index_new:
+ * @points: Array of XYZ points.  Only the XY coordinates are used for indexing.  It must exist and must not be
+ *          modified as long as the index exists.
+ * @npoints: Number of points in @points.
+ *
+ * Creates a spatial index of points in the plane.
+ *
+ * The index does not copy the points; it refers to @points and only stores one point index per point, plus a few
+ * numbers per cell.  It is built by a counting sort which reads @points sequentially in three passes and needs no
+ * other temporary per-point storage.  The construction time and memory are linear in @npoints.
+ *
+ * Returns: A newly created point index.
+ *
+ * Since: 2.62
+ **/
+GwyPointIndex*
+gwy_point_index_new(const GwyXYZ *points, guint npoints)
+{
+    GwyPointIndex *pindex;
+    gdouble xmin = G_MAXDOUBLE, xmax = -G_MAXDOUBLE, ymin = G_MAXDOUBLE, ymax = -G_MAXDOUBLE;
+    gdouble xlen, ylen, ncells, cellsize;
+    guint *cellstart;
+    guint i, c, n;
+
+    g_return_val_if_fail(points || !npoints, NULL);
+
+    pindex = g_slice_new0(GwyPointIndex);
+    pindex->npoints = npoints;
+
+    for (i = 0; i < npoints; i++) {
+        xmin = fmin(xmin, points[i].x);
+        xmax = fmax(xmax, points[i].x);
+        ymin = fmin(ymin, points[i].y);
+        ymax = fmax(ymax, points[i].y);
+    }
+    if (!npoints)
+        xmin = xmax = ymin = ymax = 0.0;
+
+    /* Choose square cells with about POINTS_PER_CELL points per cell for uniformly distributed points.  If the
+     * points lie on a line use the line length instead of the area.  If they all coincide a single cell will do. */
+    xlen = xmax - xmin;
+    ylen = ymax - ymin;
+    ncells = MAX(npoints/POINTS_PER_CELL, 1.0);
+    if (xlen > 0.0 && ylen > 0.0)
+        cellsize = sqrt(xlen*ylen/ncells);
+    else if (xlen > 0.0 || ylen > 0.0)
+        cellsize = MAX(xlen, ylen)/ncells;
+    else
+        cellsize = 1.0;
+    /* Thin strips can still produce too many cells along the long side. */
+    if ((xlen/cellsize + 1.0)*(ylen/cellsize + 1.0) > 4.0*ncells)
+        cellsize = MAX(xlen, ylen)/ncells;
+
+    pindex->xmin = xmin;
+    pindex->ymin = ymin;
+    pindex->cellsize = cellsize;
+    pindex->xcells = (guint)floor(xlen/cellsize) + 1;
+    pindex->ycells = (guint)floor(ylen/cellsize) + 1;
+    n = pindex->xcells*pindex->ycells;
+    gwy_debug("%u points, %ux%u cells", npoints, pindex->xcells, pindex->ycells);
+
+    /* Count points in cells and turn the counts to block ends, shifted by one cell.  Then fill the blocks
+     * backwards, which keeps points in each cell in their original order. */
+    pindex->cellstart = cellstart = g_new0(guint, n+1);
+    for (i = 0; i < npoints; i++)
+        cellstart[point_cell(pindex, points[i].x, points[i].y) + 1]++;
+    for (c = 1; c <= n; c++)
+        cellstart[c] += cellstart[c-1];
+
+    pindex->points = points;
+    pindex->ids = g_new(guint, npoints);
+    for (i = npoints; i; i--) {
+        c = point_cell(pindex, points[i-1].x, points[i-1].y);
+        n = --cellstart[c+1];
+        pindex->ids[n] = i-1;
+    }
+    /* Now cellstart[c+1] is the start of block c. */
+    memmove(cellstart, cellstart + 1, pindex->xcells*pindex->ycells*sizeof(guint));
+    cellstart[pindex->xcells*pindex->ycells] = npoints;
+
+    return pindex;
+}
+
+/**
+ * gwy_point_index_new_from_surface:
+ * @surface: A surface.
+ *
+ * Creates a spatial index of points of a surface.
+ *
+ * Point indices reported by queries correspond to the surface points.  The index refers to the surface data, so
+ * @surface must not be modified or destroyed as long as the index exists.  See gwy_point_index_new() for details.
+ *
+ * Returns: A newly created point index.
+ *
+ * Since: 2.62
+ **/
+GwyPointIndex*
+gwy_point_index_new_from_surface(GwySurface *surface)
+{
+    g_return_val_if_fail(GWY_IS_SURFACE(surface), NULL);
+    return gwy_point_index_new(gwy_surface_get_data_const(surface), gwy_surface_get_npoints(surface));
+}
+
+/**
+ * gwy_point_index_free:
+ * @pindex: A point index.
+ *
+ * Frees a point index.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_point_index_free(GwyPointIndex *pindex)
+{
+    g_return_if_fail(pindex);
+    g_free(pindex->cellstart);
+    g_free(pindex->ids);
+    g_slice_free(GwyPointIndex, pindex);
+}
+
+/**
+ * gwy_point_index_get_npoints:
+ * @pindex: A point index.
+ *
+ * Gets the number of points in a point index.
+ *
+ * Returns: The number of indexed points.
+ *
+ * Since: 2.62
+ **/
+guint
+gwy_point_index_get_npoints(const GwyPointIndex *pindex)
+{
+    g_return_val_if_fail(pindex, 0);
+    return pindex->npoints;
+}
+
+/* Inserts a candidate into the list of the n best neighbours sorted by distance, with capacity k. */
+static inline guint
+insert_neighbour(guint *ids, gdouble *d2s, guint n, guint k, guint id, gdouble d2)
+{
+    guint m;
+
+    if (n == k) {
+        if (d2 >= d2s[k-1])
+            return n;
+        n--;
+    }
+    for (m = n; m && d2s[m-1] > d2; m--) {
+        ids[m] = ids[m-1];
+        d2s[m] = d2s[m-1];
+    }
+    ids[m] = id;
+    d2s[m] = d2;
+
+    return n+1;
+}
+
+/* Finds the k nearest points by searching rings of cells around the query point.  Fills point indices and squared
+ * distances. */
+static guint
+find_nearest(const GwyPointIndex *pindex, gdouble x, gdouble y, guint k, guint *pos, gdouble *d2s)
+{
+    const GwyXYZ *points = pindex->points;
+    const guint *cellstart = pindex->cellstart, *ids = pindex->ids;
+    gint xcells = pindex->xcells, ycells = pindex->ycells;
+    gdouble cs = pindex->cellsize, x0 = pindex->xmin, y0 = pindex->ymin;
+    gint ci, cj, r, i, j, jstep;
+    gdouble bound, b;
+    guint n = 0, m;
+
+    if (!k || !pindex->npoints)
+        return 0;
+
+    k = MIN(k, pindex->npoints);
+    cj = cell_coord(x - x0, cs, xcells);
+    ci = cell_coord(y - y0, cs, ycells);
+    for (r = 0; ; r++) {
+        for (i = MAX(ci - r, 0); i <= MIN(ci + r, ycells-1); i++) {
+            /* Inner rows only have the two boundary cells of the ring. */
+            jstep = (i == ci - r || i == ci + r) ? 1 : 2*r;
+            for (j = cj - r; j <= cj + r; j += jstep) {
+                if (j < 0 || j >= xcells)
+                    continue;
+                for (m = cellstart[i*xcells + j]; m < cellstart[i*xcells + j + 1]; m++) {
+                    const GwyXYZ *pt = points + ids[m];
+                    gdouble dx = pt->x - x, dy = pt->y - y;
+                    n = insert_neighbour(pos, d2s, n, k, ids[m], dx*dx + dy*dy);
+                }
+            }
+        }
+
+        /* Everything has been searched. */
+        if (ci - r <= 0 && cj - r <= 0 && ci + r >= ycells-1 && cj + r >= xcells-1)
+            break;
+        if (n < k)
+            continue;
+
+        /* All points not searched yet are farther than the distance to the boundary of the searched cells. */
+        bound = G_MAXDOUBLE;
+        if (cj - r > 0 && (b = x - (x0 + (cj - r)*cs)) < bound)
+            bound = b;
+        if (cj + r < xcells-1 && (b = x0 + (cj + r + 1)*cs - x) < bound)
+            bound = b;
+        if (ci - r > 0 && (b = y - (y0 + (ci - r)*cs)) < bound)
+            bound = b;
+        if (ci + r < ycells-1 && (b = y0 + (ci + r + 1)*cs - y) < bound)
+            bound = b;
+        if (bound > 0.0 && bound*bound >= d2s[k-1])
+            break;
+    }
+
+    return n;
+}
+
+/**
+ * gwy_point_index_find_nearest:
+ * @pindex: A point index.
+ * @x: X-coordinate of the query point.
+ * @y: Y-coordinate of the query point.
+ * @k: Number of neighbours to find.
+ * @indices: Array of length at least @k to fill with indices of the nearest points.
+ * @distances: Array of length at least @k to fill with distances of the nearest points, or %NULL.
+ *
+ * Finds the nearest points to a given point in the plane.
+ *
+ * The neighbours are sorted by increasing distance.  Points at exactly the same distance are found in an
+ * unspecified order.
+ *
+ * The index is not modified by queries so they can be run concurrently from multiple threads.
+ *
+ * Returns: The number of points found, which is @k unless the index has fewer points.
+ *
+ * Since: 2.62
+ **/
+guint
+gwy_point_index_find_nearest(const GwyPointIndex *pindex,
+                             gdouble x, gdouble y,
+                             guint k,
+                             guint *indices, gdouble *distances)
+{
+    gdouble d2buf[STACK_NEIGHBOURS];
+    gdouble *d2s = d2buf;
+    guint i, n;
+
+    g_return_val_if_fail(pindex, 0);
+    g_return_val_if_fail(indices || !k, 0);
+
+    if (distances)
+        d2s = distances;
+    else if (k > STACK_NEIGHBOURS)
+        d2s = g_new(gdouble, k);
+
+    n = find_nearest(pindex, x, y, k, indices, d2s);
+    if (distances) {
+        for (i = 0; i < n; i++)
+            distances[i] = sqrt(distances[i]);
+    }
+    else if (d2s != d2buf)
+        g_free(d2s);
+
+    return n;
+}
+
+/* Finds points within radius.  Fills point indices and squared distances. */
+static guint
+gather_within(const GwyPointIndex *pindex, gdouble x, gdouble y, gdouble radius, GArray *pos, GArray *d2s)
+{
+    const GwyXYZ *points = pindex->points;
+    const guint *ids = pindex->ids;
+    guint ifrom, ito, jfrom, jto, i, j, m, xcells = pindex->xcells;
+    gdouble r2 = radius*radius;
+
+    g_array_set_size(pos, 0);
+    if (d2s)
+        g_array_set_size(d2s, 0);
+
+    jfrom = cell_coord(x - radius - pindex->xmin, pindex->cellsize, xcells);
+    jto = cell_coord(x + radius - pindex->xmin, pindex->cellsize, xcells);
+    ifrom = cell_coord(y - radius - pindex->ymin, pindex->cellsize, pindex->ycells);
+    ito = cell_coord(y + radius - pindex->ymin, pindex->cellsize, pindex->ycells);
+    for (i = ifrom; i <= ito; i++) {
+        for (j = jfrom; j <= jto; j++) {
+            for (m = pindex->cellstart[i*xcells + j]; m < pindex->cellstart[i*xcells + j + 1]; m++) {
+                const GwyXYZ *pt = points + ids[m];
+                gdouble dx = pt->x - x, dy = pt->y - y, d2 = dx*dx + dy*dy;
+
+                if (d2 <= r2) {
+                    g_array_append_val(pos, ids[m]);
+                    if (d2s)
+                        g_array_append_val(d2s, d2);
+                }
+            }
+        }
+    }
+
+    return pos->len;
+}
+
+/**
+ * gwy_point_index_find_within:
+ * @pindex: A point index.
+ * @x: X-coordinate of the query point.
+ * @y: Y-coordinate of the query point.
+ * @radius: Search radius.
+ * @indices: Array of #guint to fill with indices of the points found.
+ *
+ * Finds all points within given distance from a given point in the plane.
+ *
+ * The array @indices is resized to the number of points found.  Their order is unspecified.
+ *
+ * Returns: The number of points found.
+ *
+ * Since: 2.62
+ **/
+guint
+gwy_point_index_find_within(const GwyPointIndex *pindex,
+                            gdouble x, gdouble y,
+                            gdouble radius,
+                            GArray *indices)
+{
+    g_return_val_if_fail(pindex, 0);
+    g_return_val_if_fail(indices, 0);
+
+    if (!(radius >= 0.0) || !pindex->npoints) {
+        g_array_set_size(indices, 0);
+        return 0;
+    }
+
+    return gather_within(pindex, x, y, radius, indices, NULL);
+}
+
+/**
+ * gwy_point_index_rasterize_nearest:
+ * @pindex: A point index.
+ * @field: A data field to fill.  Its dimensions and offsets determine the rasterised area.
+ * @set_fraction: Function that sets fraction to output (or %NULL).
+ *
+ * Fills a data field with values of nearest points.
+ *
+ * Each pixel gets the value of the point nearest to its centre, i.e. the result is the rasterised Voronoi
+ * tessellation of the points.
+ *
+ * Returns: %TRUE if the computation finished; %FALSE if it was cancelled by @set_fraction.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_point_index_rasterize_nearest(const GwyPointIndex *pindex,
+                                  GwyDataField *field,
+                                  GwySetFractionFunc set_fraction)
+{
+    gboolean cancelled = FALSE, *pcancelled = &cancelled;
+    gdouble xoff, yoff, dx, dy;
+    gint xres, yres;
+    gdouble *d;
+
+    g_return_val_if_fail(pindex, FALSE);
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(field), FALSE);
+
+    if (!pindex->npoints) {
+        gwy_data_field_clear(field);
+        return TRUE;
+    }
+
+    xres = field->xres;
+    yres = field->yres;
+    xoff = field->xoff;
+    yoff = field->yoff;
+    dx = field->xreal/xres;
+    dy = field->yreal/yres;
+    d = field->data;
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(pindex,d,xres,yres,xoff,yoff,dx,dy,set_fraction,pcancelled)
+#endif
+    {
+        gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
+        gint i, j;
+        guint pos;
+        gdouble d2;
+
+        for (i = ifrom; i < ito; i++) {
+            gdouble y = yoff + dy*(i + 0.5);
+
+            for (j = 0; j < xres; j++) {
+                find_nearest(pindex, xoff + dx*(j + 0.5), y, 1, &pos, &d2);
+                d[i*xres + j] = pindex->points[pos].z;
+            }
+            if (gwy_omp_set_fraction_check_cancel(set_fraction, i, ifrom, ito, pcancelled))
+                break;
+        }
+    }
+
+    gwy_data_field_invalidate(field);
+    return !cancelled;
+}
+
+/* Shepard interpolation from all points (the classic global method). */
+static gdouble
+idw_global(const GwyXYZ *points, guint npoints, gdouble x, gdouble y)
+{
+    gdouble w = 0.0, s = 0.0;
+    guint k;
+
+    for (k = 0; k < npoints; k++) {
+        gdouble dx = x - points[k].x, dy = y - points[k].y;
+        gdouble r2 = dx*dx + dy*dy;
+
+        r2 *= r2;
+        if (G_UNLIKELY(r2 == 0.0))
+            return points[k].z;
+
+        r2 = 1.0/r2;
+        w += r2;
+        s += r2*points[k].z;
+    }
+
+    return s/w;
+}
+
+/* Shepard interpolation from given points, with weights going smoothly to zero at distance R.  Points at distances
+ * R or larger are ignored.  If R is infinite the weights are the plain inverse fourth powers of distance. */
+static gdouble
+idw_local(const GwyXYZ *points, const guint *pos, const gdouble *d2s, guint n, gdouble R)
+{
+    gdouble w = 0.0, s = 0.0, v;
+    guint k, kmin = 0;
+
+    for (k = 0; k < n; k++) {
+        gdouble r = sqrt(d2s[k]);
+
+        if (G_UNLIKELY(r == 0.0))
+            return points[pos[k]].z;
+        if (d2s[k] < d2s[kmin])
+            kmin = k;
+        if (r >= R)
+            continue;
+
+        v = (R == G_MAXDOUBLE) ? 1.0/r : (R - r)/(R*r);
+        v *= v;
+        v *= v;
+        w += v;
+        s += v*points[pos[k]].z;
+    }
+
+    /* There is nothing inside R.  Use the nearest point. */
+    if (!(w > 0.0))
+        return points[pos[kmin]].z;
+
+    return s/w;
+}
+
+/**
+ * gwy_point_index_rasterize_idw:
+ * @pindex: A point index.
+ * @field: A data field to fill.  Its dimensions and offsets determine the rasterised area.
+ * @nneighbours: Number of nearest neighbours to use for each pixel.  Pass zero to use all points within @cutoff
+ *               (or all points if @cutoff is not positive).
+ * @cutoff: Maximum distance of points used for each pixel.  Pass zero to not limit the distance.
+ * @set_fraction: Function that sets fraction to output (or %NULL).
+ *
+ * Fills a data field using inverse distance weighting interpolation.
+ *
+ * Each pixel value is a weighted average of point values, with weights decreasing with the fourth power of the
+ * distance from the pixel centre.  When both @nneighbours and @cutoff are zero this is the classic global Shepard
+ * interpolation, which takes time proportional to the number of pixels times the number of points.
+ *
+ * Otherwise, the local modified Shepard method is used.  Only the nearest points are taken into account and the
+ * weights are modified to vanish continuously at the distance of the first point which is not included (or at
+ * @cutoff), avoiding discontinuities where the set of neighbours changes.  Pixels without any points within @cutoff
+ * get the value of the nearest point.  The computation time is then roughly proportional to the number of pixels
+ * times @nneighbours and does not grow with the number of points.
+ *
+ * Returns: %TRUE if the computation finished; %FALSE if it was cancelled by @set_fraction.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_point_index_rasterize_idw(const GwyPointIndex *pindex,
+                              GwyDataField *field,
+                              guint nneighbours,
+                              gdouble cutoff,
+                              GwySetFractionFunc set_fraction)
+{
+    gboolean cancelled = FALSE, *pcancelled = &cancelled;
+    gdouble xoff, yoff, dx, dy;
+    gint xres, yres;
+    gdouble *d;
+
+    g_return_val_if_fail(pindex, FALSE);
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(field), FALSE);
+
+    if (!pindex->npoints) {
+        gwy_data_field_clear(field);
+        return TRUE;
+    }
+
+    xres = field->xres;
+    yres = field->yres;
+    xoff = field->xoff;
+    yoff = field->yoff;
+    dx = field->xreal/xres;
+    dy = field->yreal/yres;
+    d = field->data;
+    if (!(cutoff > 0.0))
+        cutoff = 0.0;
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(pindex,d,xres,yres,xoff,yoff,dx,dy,nneighbours,cutoff,set_fraction,pcancelled)
+#endif
+    {
+        gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
+        const GwyXYZ *points = pindex->points;
+        GArray *pos = NULL, *d2s = NULL;
+        gint i, j;
+        guint n;
+        gdouble R;
+
+        pos = g_array_sized_new(FALSE, FALSE, sizeof(guint), nneighbours+1);
+        d2s = g_array_sized_new(FALSE, FALSE, sizeof(gdouble), nneighbours+1);
+        if (nneighbours) {
+            g_array_set_size(pos, nneighbours+1);
+            g_array_set_size(d2s, nneighbours+1);
+        }
+
+        for (i = ifrom; i < ito; i++) {
+            gdouble y = yoff + dy*(i + 0.5);
+            gdouble *drow = d + i*xres;
+
+            for (j = 0; j < xres; j++) {
+                gdouble x = xoff + dx*(j + 0.5);
+                guint *p = (guint*)pos->data;
+                gdouble *q = (gdouble*)d2s->data;
+
+                if (nneighbours) {
+                    /* The one extra neighbour only defines the radius where weights vanish. */
+                    n = find_nearest(pindex, x, y, nneighbours+1, p, q);
+                    R = (n > nneighbours) ? sqrt(q[nneighbours]) : G_MAXDOUBLE;
+                    if (cutoff)
+                        R = MIN(R, cutoff);
+                    drow[j] = idw_local(points, p, q, MIN(n, nneighbours), R);
+                }
+                else if (cutoff) {
+                    if (!(n = gather_within(pindex, x, y, cutoff, pos, d2s))) {
+                        g_array_set_size(pos, 1);
+                        g_array_set_size(d2s, 1);
+                        n = find_nearest(pindex, x, y, 1, (guint*)pos->data, (gdouble*)d2s->data);
+                    }
+                    drow[j] = idw_local(points, (guint*)pos->data, (gdouble*)d2s->data, n, cutoff);
+                }
+                else
+                    drow[j] = idw_global(points, pindex->npoints, x, y);
+            }
+            if (gwy_omp_set_fraction_check_cancel(set_fraction, i, ifrom, ito, pcancelled))
+                break;
+        }
+
+        g_array_free(pos, TRUE);
+        g_array_free(d2s, TRUE);
+    }
+
+    gwy_data_field_invalidate(field);
+    return !cancelled;
+}
+
+/************************** Documentation ****************************/
+
+/**
+ * SECTION:pointindex
+ * @title: GwyPointIndex
+ * @short_description: Spatial index of points in the plane
+ *
+ * #GwyPointIndex sorts scattered XY points into a uniform grid of square cells, with a few points per cell on
+ * average.  It answers nearest neighbour and fixed radius queries in time proportional to the number of points
+ * found, rather than the total number of points.
+ *
+ * The index does not change after construction so it can be queried from multiple threads at once.  Rasterisation
+ * functions gwy_point_index_rasterize_nearest() and gwy_point_index_rasterize_idw() run the queries in parallel.
+ **/
+
+/**
+ * GwyPointIndex:
+ *
+ * #GwyPointIndex is an opaque data structure and should be only manipulated with the functions below.
+ *
+ * Since: 2.62
+ **/
+
+/* vim: set cin columns=120 tw=118 et ts=4 sw=4 cino=>1s,e0,n0,f0,{0,}0,^0,\:1s,=0,g1s,h0,t0,+1s,c3,(0,u0 : */
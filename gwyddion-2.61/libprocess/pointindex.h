@@ -0,0 +1,60 @@
+/*
+ *  $Id$
+ *  Copyright (C) 2022 David Necas (Yeti).
+ *  E-mail: yeti@gwyddion.net.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any
+ *  later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with this program; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GWY_POINT_INDEX_H__
+#define __GWY_POINT_INDEX_H__
+
+#include <glib.h>
+#include <libgwyddion/gwymath.h>
+#include <libgwyddion/gwyutils.h>
+#include <libprocess/datafield.h>
+#include <libprocess/surface.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GwyPointIndex GwyPointIndex;
+
+GwyPointIndex* gwy_point_index_new                (const GwyXYZ *points,
+                                                   guint npoints)                       G_GNUC_MALLOC;
+GwyPointIndex* gwy_point_index_new_from_surface   (GwySurface *surface)                 G_GNUC_MALLOC;
+void           gwy_point_index_free               (GwyPointIndex *pindex);
+guint          gwy_point_index_get_npoints        (const GwyPointIndex *pindex);
+guint          gwy_point_index_find_nearest       (const GwyPointIndex *pindex,
+                                                   gdouble x,
+                                                   gdouble y,
+                                                   guint k,
+                                                   guint *indices,
+                                                   gdouble *distances);
+guint          gwy_point_index_find_within        (const GwyPointIndex *pindex,
+                                                   gdouble x,
+                                                   gdouble y,
+                                                   gdouble radius,
+                                                   GArray *indices);
+gboolean       gwy_point_index_rasterize_nearest  (const GwyPointIndex *pindex,
+                                                   GwyDataField *field,
+                                                   GwySetFractionFunc set_fraction);
+gboolean       gwy_point_index_rasterize_idw      (const GwyPointIndex *pindex,
+                                                   GwyDataField *field,
+                                                   guint nneighbours,
+                                                   gdouble cutoff,
+                                                   GwySetFractionFunc set_fraction);
+
+G_END_DECLS
+
+#endif /* __GWY_POINT_INDEX_H__ */
+
+/* vim: set cin columns=120 tw=118 et ts=4 sw=4 cino=>1s,e0,n0,f0,{0,}0,^0,\:1s,=0,g1s,h0,t0,+1s,c3,(0,u0 : */
@@ -15,6 +15,7 @@
  *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <stdlib.h>
 #include <fftw3.h>
 #include <libgwyddion/gwymath.h>
 #include <libprocess/simplefft.h>
@@ -34,7 +35,46 @@ static gdouble gwy_fft_window_nuttall  (gint i, gint n);
 static gdouble gwy_fft_window_flat_top (gint i, gint n);
 static gdouble gwy_fft_window_kaiser25 (gint i, gint n);
 
+typedef enum {
+    FFTW_PLAN_DFT_2D     = 0,
+    FFTW_PLAN_DFT_R2C_2D = 1,
+    FFTW_PLAN_DFT_C2R_2D = 2,
+} FFTWPlanType;
+
+/* Everything a plan depends on, except the actual array addresses.  Plans can be executed with the new-array execute
+ * functions on any arrays with identical alignment and in-placeness.  We cannot use fftw_alignment_of() which needs
+ * FFTW 3.3, so we remember the addresses modulo PLAN_ALIGNMENT, which is a multiple of any SIMD alignment FFTW uses. */
+typedef struct {
+    FFTWPlanType type;
+    gint n0;
+    gint n1;
+    gint sign;
+    guint flags;
+    gint nthreads;
+    gboolean inplace;
+    guint in_align;
+    guint out_align;
+} FFTWPlanKey;
+
+typedef struct {
+    FFTWPlanKey key;
+    fftw_plan plan;
+    guint refcount;
+    guint64 last_used;
+} FFTWPlanCacheEntry;
+
+enum {
+    /* Unused plans above this count are destroyed, the least recently used first. */
+    PLAN_CACHE_SIZE = 24,
+    PLAN_ALIGNMENT = 64,
+};
+
 static GRWLock gwy_fftw_lock;
+static GMutex plan_cache_lock;
+static GHashTable *plan_cache = NULL;        /* FFTWPlanKey → FFTWPlanCacheEntry */
+static GHashTable *plan_cache_plans = NULL;  /* fftw_plan → FFTWPlanCacheEntry */
+static guint64 plan_cache_clock = 0;
+static gint measure_planning = FALSE;
 
 /* The order must match GwyWindowingType enum */
 static const GwyFFTWindowingFunc windowings[] = {
@@ -407,17 +447,49 @@ gwy_fftw_execute(fftw_plan plan)
     gwy_fftw_unlock_execute();
 }
 
-/* This must be called with the planner lock already held. */
 void
-gwy_fftw_plan_maybe_with_threads(void)
+gwy_fftw_execute_dft(fftw_plan plan, fftw_complex *in, fftw_complex *out)
 {
-#if (defined(_OPENMP) && defined(HAVE_FFTW_WITH_OPENMP))
-    guint nthreads = 1;
+    gwy_fftw_lock_execute();
+    fftw_execute_dft(plan, in, out);
+    gwy_fftw_unlock_execute();
+}
+
+void
+gwy_fftw_execute_dft_r2c(fftw_plan plan, double *in, fftw_complex *out)
+{
+    gwy_fftw_lock_execute();
+    fftw_execute_dft_r2c(plan, in, out);
+    gwy_fftw_unlock_execute();
+}
+
+void
+gwy_fftw_execute_dft_c2r(fftw_plan plan, fftw_complex *in, double *out)
+{
+    gwy_fftw_lock_execute();
+    fftw_execute_dft_c2r(plan, in, out);
+    gwy_fftw_unlock_execute();
+}
+
+static gint
+gwy_fftw_planning_nthreads(void)
+{
+    gint nthreads = 1;
 
+#if (defined(_OPENMP) && defined(HAVE_FFTW_WITH_OPENMP))
     if (!omp_get_active_level() && gwy_threads_are_enabled())
         nthreads = gwy_omp_max_threads();
+#endif
 
-    fftw_plan_with_nthreads(nthreads);
+    return nthreads;
+}
+
+/* This must be called with the planner lock already held. */
+void
+gwy_fftw_plan_maybe_with_threads(void)
+{
+#if (defined(_OPENMP) && defined(HAVE_FFTW_WITH_OPENMP))
+    fftw_plan_with_nthreads(gwy_fftw_planning_nthreads());
 #endif
 }
 
@@ -585,6 +657,365 @@ gwy_fftw_plan_guru_split_dft_r2c(int rank, const fftw_iodim *dims,
     return plan;
 }
 
+static guint
+plan_key_hash(gconstpointer p)
+{
+    const FFTWPlanKey *key = (const FFTWPlanKey*)p;
+    guint h = key->type;
+
+    h = 31*h + key->n0;
+    h = 31*h + key->n1;
+    h = 31*h + key->sign;
+    h = 31*h + key->flags;
+    h = 31*h + key->nthreads;
+    h = 2*h + !!key->inplace;
+    h = 31*h + key->in_align;
+    h = 31*h + key->out_align;
+
+    return h;
+}
+
+static gboolean
+plan_key_equal(gconstpointer pa, gconstpointer pb)
+{
+    const FFTWPlanKey *a = (const FFTWPlanKey*)pa, *b = (const FFTWPlanKey*)pb;
+
+    return (a->type == b->type && a->n0 == b->n0 && a->n1 == b->n1 && a->sign == b->sign && a->flags == b->flags
+            && a->nthreads == b->nthreads && !a->inplace == !b->inplace
+            && a->in_align == b->in_align && a->out_align == b->out_align);
+}
+
+/* Must be called with plan_cache_lock held.  Unlinks the least recently used unreferenced plans exceeding the cache
+ * size and returns them in a list; the caller destroys them after releasing the lock. */
+static GSList*
+plan_cache_trim(guint maxsize)
+{
+    GHashTableIter iter;
+    FFTWPlanCacheEntry *entry, *oldest;
+    GSList *victims = NULL;
+
+    while (g_hash_table_size(plan_cache) > maxsize) {
+        oldest = NULL;
+        g_hash_table_iter_init(&iter, plan_cache);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&entry)) {
+            if (!entry->refcount && (!oldest || entry->last_used < oldest->last_used))
+                oldest = entry;
+        }
+        if (!oldest)
+            break;
+
+        g_hash_table_remove(plan_cache_plans, oldest->plan);
+        g_hash_table_remove(plan_cache, &oldest->key);
+        victims = g_slist_prepend(victims, oldest);
+    }
+
+    return victims;
+}
+
+static void
+plan_cache_destroy_entries(GSList *victims)
+{
+    GSList *l;
+
+    if (!victims)
+        return;
+
+    /* Destroying plans is not thread-safe in FFTW, do it as the planner. */
+    gwy_fftw_lock_planner();
+    for (l = victims; l; l = g_slist_next(l)) {
+        FFTWPlanCacheEntry *entry = (FFTWPlanCacheEntry*)l->data;
+
+        fftw_destroy_plan(entry->plan);
+        g_slice_free(FFTWPlanCacheEntry, entry);
+    }
+    gwy_fftw_unlock_planner();
+    g_slist_free(victims);
+}
+
+/* Returns a pointer into @buffer with the same address residue modulo PLAN_ALIGNMENT as the caller's array. */
+static gpointer
+align_scratch_like(gpointer buffer, guint residue)
+{
+    guint offset = (residue + PLAN_ALIGNMENT - GPOINTER_TO_SIZE(buffer) % PLAN_ALIGNMENT) % PLAN_ALIGNMENT;
+
+    return (guchar*)buffer + offset;
+}
+
+/* Creates a new plan for @key.  When measuring, the planner overwrites the arrays, so it is run on scratch arrays
+ * instead of the caller's ones. */
+static fftw_plan
+plan_cache_create_plan(const FFTWPlanKey *key, gpointer in, gpointer out)
+{
+    gint n0 = key->n0, n1 = key->n1;
+    gsize size;
+    gpointer scratch_in = NULL, scratch_out = NULL;
+    fftw_plan plan = NULL;
+
+    if (!(key->flags & FFTW_ESTIMATE)) {
+        /* In-place real transforms need the real array padded to the complex size anyway. */
+        if (key->type == FFTW_PLAN_DFT_2D)
+            size = n0*n1*sizeof(fftw_complex);
+        else
+            size = n0*(n1/2 + 1)*sizeof(fftw_complex);
+        scratch_in = g_malloc(size + PLAN_ALIGNMENT);
+        in = align_scratch_like(scratch_in, key->in_align);
+        if (key->inplace)
+            out = in;
+        else {
+            scratch_out = g_malloc(size + PLAN_ALIGNMENT);
+            out = align_scratch_like(scratch_out, key->out_align);
+        }
+    }
+
+    gwy_fftw_lock_planner();
+#if (defined(_OPENMP) && defined(HAVE_FFTW_WITH_OPENMP))
+    fftw_plan_with_nthreads(key->nthreads);
+#endif
+    if (key->type == FFTW_PLAN_DFT_2D)
+        plan = fftw_plan_dft_2d(n0, n1, (fftw_complex*)in, (fftw_complex*)out, key->sign, key->flags);
+    else if (key->type == FFTW_PLAN_DFT_R2C_2D)
+        plan = fftw_plan_dft_r2c_2d(n0, n1, (double*)in, (fftw_complex*)out, key->flags);
+    else if (key->type == FFTW_PLAN_DFT_C2R_2D)
+        plan = fftw_plan_dft_c2r_2d(n0, n1, (fftw_complex*)in, (double*)out, key->flags);
+    gwy_fftw_unlock_planner();
+    g_assert(plan);
+
+    g_free(scratch_out);
+    g_free(scratch_in);
+
+    return plan;
+}
+
+static fftw_plan
+gwy_fftw_plan_cached(FFTWPlanType type, int n0, int n1, gpointer in, gpointer out, int sign, unsigned int flags)
+{
+    FFTWPlanCacheEntry *entry, *other;
+    FFTWPlanKey key;
+    GSList *victims;
+
+    gwy_clear(&key, 1);
+    key.type = type;
+    key.n0 = n0;
+    key.n1 = n1;
+    key.sign = sign;
+    key.nthreads = gwy_fftw_planning_nthreads();
+    key.inplace = (in == out);
+    key.in_align = GPOINTER_TO_SIZE(in) % PLAN_ALIGNMENT;
+    key.out_align = GPOINTER_TO_SIZE(out) % PLAN_ALIGNMENT;
+    /* The effort is a global setting, overriding whatever the caller asked for. */
+    if (g_atomic_int_get(&measure_planning))
+        flags &= ~FFTW_ESTIMATE;
+    else
+        flags |= FFTW_ESTIMATE;
+    key.flags = flags;
+
+    g_mutex_lock(&plan_cache_lock);
+    if (!plan_cache) {
+        plan_cache = g_hash_table_new(plan_key_hash, plan_key_equal);
+        plan_cache_plans = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+    if ((entry = g_hash_table_lookup(plan_cache, &key))) {
+        entry->refcount++;
+        entry->last_used = ++plan_cache_clock;
+        g_mutex_unlock(&plan_cache_lock);
+        return entry->plan;
+    }
+    g_mutex_unlock(&plan_cache_lock);
+
+    /* Plan outside the cache lock so that cache hits of other threads are not blocked by the planner. */
+    entry = g_slice_new0(FFTWPlanCacheEntry);
+    entry->key = key;
+    entry->plan = plan_cache_create_plan(&key, in, out);
+    entry->refcount = 1;
+
+    g_mutex_lock(&plan_cache_lock);
+    if ((other = g_hash_table_lookup(plan_cache, &key))) {
+        /* Someone else created the same plan meanwhile.  Use theirs. */
+        other->refcount++;
+        other->last_used = ++plan_cache_clock;
+        g_mutex_unlock(&plan_cache_lock);
+        entry->refcount = 0;
+        plan_cache_destroy_entries(g_slist_prepend(NULL, entry));
+        return other->plan;
+    }
+    entry->last_used = ++plan_cache_clock;
+    g_hash_table_insert(plan_cache, &entry->key, entry);
+    g_hash_table_insert(plan_cache_plans, entry->plan, entry);
+    victims = plan_cache_trim(PLAN_CACHE_SIZE);
+    g_mutex_unlock(&plan_cache_lock);
+    plan_cache_destroy_entries(victims);
+
+    return entry->plan;
+}
+
+/*
+ * The cached planners return plans shared by all callers.  They must be executed using the new-array execute
+ * functions gwy_fftw_execute_dft(), gwy_fftw_execute_dft_r2c() and gwy_fftw_execute_dft_c2r() – even for the arrays
+ * passed to the planner, since the plan may have been created for different ones – and released using
+ * gwy_fftw_release_plan() instead of fftw_destroy_plan().  The contents of the arrays are preserved by planning.
+ */
+fftw_plan
+gwy_fftw_plan_cached_dft_2d(int n0, int n1,
+                            fftw_complex *in, fftw_complex *out,
+                            int sign, unsigned int flags)
+{
+    return gwy_fftw_plan_cached(FFTW_PLAN_DFT_2D, n0, n1, in, out, sign, flags);
+}
+
+fftw_plan
+gwy_fftw_plan_cached_dft_r2c_2d(int n0, int n1,
+                                double *in, fftw_complex *out,
+                                unsigned int flags)
+{
+    return gwy_fftw_plan_cached(FFTW_PLAN_DFT_R2C_2D, n0, n1, in, out, 0, flags);
+}
+
+fftw_plan
+gwy_fftw_plan_cached_dft_c2r_2d(int n0, int n1,
+                                fftw_complex *in, double *out,
+                                unsigned int flags)
+{
+    return gwy_fftw_plan_cached(FFTW_PLAN_DFT_C2R_2D, n0, n1, in, out, 0, flags);
+}
+
+void
+gwy_fftw_release_plan(fftw_plan plan)
+{
+    FFTWPlanCacheEntry *entry;
+
+    g_mutex_lock(&plan_cache_lock);
+    entry = plan_cache ? g_hash_table_lookup(plan_cache_plans, plan) : NULL;
+    if (entry) {
+        g_assert(entry->refcount);
+        entry->refcount--;
+    }
+    g_mutex_unlock(&plan_cache_lock);
+    g_return_if_fail(entry);
+}
+
+/**
+ * gwy_fft_clear_plan_cache:
+ *
+ * Destroys all currently unused cached FFT plans.
+ *
+ * Plans for frequently used transform sizes are kept between calls of functions such as gwy_data_field_2dfft_raw()
+ * or gwy_data_field_area_2dacf().  This function releases the memory occupied by them.  Plans currently in use are
+ * not affected.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_fft_clear_plan_cache(void)
+{
+    GSList *victims = NULL;
+
+    g_mutex_lock(&plan_cache_lock);
+    if (plan_cache)
+        victims = plan_cache_trim(0);
+    g_mutex_unlock(&plan_cache_lock);
+    plan_cache_destroy_entries(victims);
+}
+
+/**
+ * gwy_fft_set_measure_planning:
+ * @measure: %TRUE to measure the speed of transforms when planning them, %FALSE to only estimate it.
+ *
+ * Sets the planning effort for cached FFT plans.
+ *
+ * Measuring makes the first transform of each size considerably slower, but subsequent transforms usually faster.
+ * It pays off in long-running or batch processing, in particular when the measurements are saved with
+ * gwy_fft_save_wisdom() and reused in later runs.  The default is to only estimate.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_fft_set_measure_planning(gboolean measure)
+{
+    g_atomic_int_set(&measure_planning, !!measure);
+}
+
+/**
+ * gwy_fft_get_measure_planning:
+ *
+ * Reports whether cached FFT plans are created by measuring.
+ *
+ * Returns: %TRUE if transforms are measured when planning; %FALSE if their speed is only estimated.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_fft_get_measure_planning(void)
+{
+    return g_atomic_int_get(&measure_planning);
+}
+
+/**
+ * gwy_fft_load_wisdom:
+ * @filename: Name of file with saved FFTW wisdom.
+ *
+ * Imports FFTW wisdom from a file.
+ *
+ * The wisdom is merged with the wisdom accumulated so far (including system wisdom).  A nonexistent file is not
+ * considered an error, it just means there is nothing to load.
+ *
+ * Returns: %TRUE if the file was read and imported successfully, %FALSE on failure.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_fft_load_wisdom(const gchar *filename)
+{
+    gchar *buffer = NULL;
+    gboolean ok;
+
+    g_return_val_if_fail(filename, FALSE);
+
+    if (!g_file_get_contents(filename, &buffer, NULL, NULL))
+        return FALSE;
+
+    gwy_fftw_lock_planner();
+    ok = fftw_import_wisdom_from_string(buffer);
+    gwy_fftw_unlock_planner();
+    g_free(buffer);
+    gwy_debug("FFTW3 wisdom imported from %s: %d", filename, ok);
+
+    return ok;
+}
+
+/**
+ * gwy_fft_save_wisdom:
+ * @filename: Name of file to save FFTW wisdom to.
+ *
+ * Exports accumulated FFTW wisdom to a file.
+ *
+ * The file is replaced atomically so concurrently running programs never see it partially written.
+ *
+ * Returns: %TRUE if the file was written successfully, %FALSE on failure.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_fft_save_wisdom(const gchar *filename)
+{
+    gchar *buffer;
+    gboolean ok;
+
+    g_return_val_if_fail(filename, FALSE);
+
+    gwy_fftw_lock_planner();
+    buffer = fftw_export_wisdom_to_string();
+    gwy_fftw_unlock_planner();
+    if (!buffer)
+        return FALSE;
+
+    ok = g_file_set_contents(filename, buffer, -1, NULL);
+    /* FFTW allocates the string with malloc(), not fftw_malloc(). */
+    free(buffer);
+    gwy_debug("FFTW3 wisdom exported to %s: %d", filename, ok);
+
+    return ok;
+}
+
 /************************** Documentation ****************************/
 
 /**
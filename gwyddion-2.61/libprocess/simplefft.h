@@ -45,6 +45,12 @@ void gwy_fft_window_data_field(GwyDataField *dfield,
                                GwyOrientation orientation,
                                GwyWindowingType windowing);
 
+void     gwy_fft_set_measure_planning(gboolean measure);
+gboolean gwy_fft_get_measure_planning(void);
+gboolean gwy_fft_load_wisdom         (const gchar *filename);
+gboolean gwy_fft_save_wisdom         (const gchar *filename);
+void     gwy_fft_clear_plan_cache    (void);
+
 G_END_DECLS
 
 #endif /* __GWY_PROCESS_SIMPLEFFT__ */
@@ -514,7 +514,7 @@ execute_2d_acf(GwyDataField *extfield,
 
     gwy_data_field_area_clear(extfield, width, 0, xsize - width, height);
     gwy_data_field_area_clear(extfield, 0, height, xsize, ysize - height);
-    gwy_fftw_execute(plan);
+    gwy_fftw_execute_dft_r2c(plan, extdata, cbuf);
 
     c = cbuf;
     for (i = 0; i < ysize; i++) {
@@ -530,7 +530,7 @@ execute_2d_acf(GwyDataField *extfield,
             c++;
         }
     }
-    gwy_fftw_execute(plan);
+    gwy_fftw_execute_dft_r2c(plan, extdata, cbuf);
 }
 
 static void
@@ -635,7 +635,7 @@ gwy_data_field_area_2dacf_mask(GwyDataField *field,
 
     cbuf = gwy_fftw_new_complex(cstride*ysize);
     extfield = gwy_data_field_new(xsize, ysize, 1.0, 1.0, FALSE);
-    plan = gwy_fftw_plan_dft_r2c_2d(ysize, xsize, extfield->data, cbuf, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
+    plan = gwy_fftw_plan_cached_dft_r2c_2d(ysize, xsize, extfield->data, cbuf, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
 
     if (mask) {
         /* Calculate unnormalised ACF of the mask, i.e. the denominators. */
@@ -690,7 +690,7 @@ gwy_data_field_area_2dacf_mask(GwyDataField *field,
     extract_2d_acf_real(target, cbuf, cstride, ysize);
     gwy_data_field_multiply(target, 1.0/(xsize*ysize));
 
-    fftw_destroy_plan(plan);
+    gwy_fftw_release_plan(plan);
     fftw_free(cbuf);
 
     if (mask) {
@@ -794,7 +794,7 @@ gwy_data_field_2dacf(GwyDataField *data_field,
     gwy_data_field_area_2dacf(data_field, target_field, 0, 0, data_field->xres, data_field->yres, 0, 0);
 }
 
-/* Assumes @plan acts on buf->data. */
+/* Assumes @plan is an R2C plan from buf->data to @cbuf. */
 static void
 execute_2d_cacf(GwyDataField *buf, GwyDataField *target,
                 fftw_plan plan, fftw_complex *cbuf, guint cstride)
@@ -804,7 +804,7 @@ execute_2d_cacf(GwyDataField *buf, GwyDataField *target,
     fftw_complex *c;
     gdouble re;
 
-    gwy_fftw_execute(plan);
+    gwy_fftw_execute_dft_r2c(plan, buf->data, cbuf);
     c = cbuf;
     data = buf->data;
     for (i = 0; i < yres; i++) {
@@ -821,7 +821,7 @@ execute_2d_cacf(GwyDataField *buf, GwyDataField *target,
         }
     }
 
-    gwy_fftw_execute(plan);
+    gwy_fftw_execute_dft_r2c(plan, buf->data, cbuf);
     c = cbuf;
     data = target->data;
     for (i = 0; i < yres; i++) {
@@ -841,7 +841,7 @@ execute_2d_cacf(GwyDataField *buf, GwyDataField *target,
 
 /* Extract real parts.  Callers might not like negative PSDF much but it is the unbiased estimate. */
 static void
-extract_2d_fft_real(GwyDataField *target,
+extract_2d_fft_real(GwyDataField *target, gdouble *in,
                     fftw_plan plan, fftw_complex *cbuf, guint cstride)
 {
     guint i, j, xres = target->xres, yres = target->yres;
@@ -849,7 +849,7 @@ extract_2d_fft_real(GwyDataField *target,
     fftw_complex *c;
     gdouble re;
 
-    gwy_fftw_execute(plan);
+    gwy_fftw_execute_dft_r2c(plan, in, cbuf);
     c = cbuf;
     data = target->data;
     for (i = 0; i < yres; i++) {
@@ -870,7 +870,7 @@ extract_2d_fft_real(GwyDataField *target,
 /* Ensure we produce non-negative output even in the presence of rounding errors.  Callers might not like negative
  * PSDF much. */
 static void
-extract_2d_fft_cnorm(GwyDataField *target,
+extract_2d_fft_cnorm(GwyDataField *target, gdouble *in,
                      fftw_plan plan, fftw_complex *cbuf, guint cstride)
 {
     guint i, j, xres = target->xres, yres = target->yres;
@@ -878,7 +878,7 @@ extract_2d_fft_cnorm(GwyDataField *target,
     fftw_complex *c;
     gdouble re;
 
-    gwy_fftw_execute(plan);
+    gwy_fftw_execute_dft_r2c(plan, in, cbuf);
     c = cbuf;
     data = target->data;
     for (i = 0; i < yres; i++) {
@@ -956,7 +956,7 @@ gwy_data_field_area_2dpsdf_mask(GwyDataField *field,
     if (mask) {
         buf = gwy_data_field_new_alike(target, FALSE);
         b = buf->data;
-        plan = gwy_fftw_plan_dft_r2c_2d(height, width, b, cbuf, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
+        plan = gwy_fftw_plan_cached_dft_r2c_2d(height, width, b, cbuf, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
 
         /* Level and window the area. */
         gwy_data_field_area_copy(field, target, col, row, width, height, 0, 0);
@@ -1012,13 +1012,13 @@ gwy_data_field_area_2dpsdf_mask(GwyDataField *field,
         }
         gwy_data_field_laplace_solve(buf, weights, -1, 1.0);
 
-        extract_2d_fft_real(target, plan, cbuf, cstride);
+        extract_2d_fft_real(target, b, plan, cbuf, cstride);
         g_object_unref(weights);
         g_object_unref(buf);
     }
     else {
         t = target->data;
-        plan = gwy_fftw_plan_dft_r2c_2d(height, width, t, cbuf, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
+        plan = gwy_fftw_plan_cached_dft_r2c_2d(height, width, t, cbuf, FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
 
         /* Level and window the area. */
         gwy_data_field_area_copy(field, target, col, row, width, height, 0, 0);
@@ -1040,12 +1040,12 @@ gwy_data_field_area_2dpsdf_mask(GwyDataField *field,
             gwy_data_field_multiply(target, rms/newrms);
 
         /* Do the FFT and gather squared Fourier coeffs. */
-        extract_2d_fft_cnorm(target, plan, cbuf, cstride);
+        extract_2d_fft_cnorm(target, t, plan, cbuf, cstride);
         gwy_data_field_multiply(target, 1.0/n);
     }
     gwy_data_field_2dfft_humanize(target);
 
-    fftw_destroy_plan(plan);
+    gwy_fftw_release_plan(plan);
     fftw_free(cbuf);
 
     gwy_si_unit_power(gwy_data_field_get_si_unit_xy(field), -1, gwy_data_field_get_si_unit_xy(target));
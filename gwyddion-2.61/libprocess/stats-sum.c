@@ -1754,6 +1754,311 @@ gwy_data_field_area_get_volume(GwyDataField *data_field,
 }
 
 
+static inline gboolean
+summary_weight(const gdouble *m, GwyMaskingType mode)
+{
+    if (!m)
+        return TRUE;
+    return mode == GWY_MASK_INCLUDE ? (*m > 0.0) : (*m < 1.0);
+}
+
+/* Quantities which are summed over all rows of the area. */
+typedef struct {
+    guint n;
+    guint nslope;
+    gdouble min;
+    gdouble max;
+    gdouble sum;
+    gdouble sum2;
+    gdouble sumh;
+    gdouble sumv;
+    gdouble area;
+    gdouble var;
+    gdouble vol;
+} SummaryRowSums;
+
+/* Process vertex row @i of the area (if @i < @height) together with all
+ * quads between vertex rows @i-1 and @i.  Values of unmasked pixels are
+ * gathered to @buffer and their number is returned.
+ *
+ * Vertices outside the area have zero weight and take values of the nearest
+ * pixel inside the field, which is what the half-pixel border stripes in
+ * calculate_surface_area() and friends do.  Corner quads only have one vertex
+ * inside and are taken as flat. */
+static guint
+summary_row(const GwyDataField *dfield, const GwyDataField *mask,
+            GwyMaskingType mode,
+            gint col, gint row, gint width, gint height, gint i,
+            gdouble *buffer, SummaryRowSums *sums)
+{
+    gint xres = dfield->xres, yres = dfield->yres, j, cl, cr;
+    gboolean tin = (i > 0), bin = (i < height), lin, rin, corner;
+    const gdouble *dt, *db, *mt = NULL, *mb = NULL;
+    gdouble dx, dy, x, y, z1, z2, z3, z4, z, c;
+    gint w1, w2, w3, w4;
+    guint n = 0;
+
+    dx = dfield->xreal/xres;
+    dy = dfield->yreal/yres;
+    x = dx*dx;
+    y = dy*dy;
+    dt = dfield->data + CLAMP(row + i-1, 0, yres-1)*xres;
+    db = dfield->data + CLAMP(row + i, 0, yres-1)*xres;
+    if (mask) {
+        mt = mask->data + CLAMP(row + i-1, 0, yres-1)*xres;
+        mb = mask->data + CLAMP(row + i, 0, yres-1)*xres;
+    }
+
+    if (bin) {
+        for (j = col; j < col + width; j++) {
+            if (!summary_weight(mb ? mb + j : NULL, mode))
+                continue;
+            z = db[j];
+            buffer[n++] = z;
+            sums->sum += z;
+            sums->sum2 += z*z;
+            if (z < sums->min)
+                sums->min = z;
+            if (z > sums->max)
+                sums->max = z;
+        }
+    }
+
+    for (j = -1; j < width; j++) {
+        lin = (j >= 0);
+        rin = (j+1 < width);
+        cl = CLAMP(col + j, 0, xres-1);
+        cr = CLAMP(col + j+1, 0, xres-1);
+        w1 = tin && lin && summary_weight(mt ? mt + cl : NULL, mode);
+        w2 = tin && rin && summary_weight(mt ? mt + cr : NULL, mode);
+        w3 = bin && rin && summary_weight(mb ? mb + cr : NULL, mode);
+        w4 = bin && lin && summary_weight(mb ? mb + cl : NULL, mode);
+        if (!(w1 || w2 || w3 || w4))
+            continue;
+
+        z1 = dt[cl];
+        z2 = dt[cr];
+        z3 = db[cr];
+        z4 = db[cl];
+        corner = (!tin || !bin) && (!lin || !rin);
+        if (corner) {
+            z = w1 ? z1 : (w2 ? z2 : (w3 ? z3 : z4));
+            z1 = z2 = z3 = z4 = z;
+        }
+
+        /* Sdq is calculated from pixel pairs, i.e. quad edges.  Each pair
+         * is the bottom or left edge of exactly one quad. */
+        if (w3 && w4) {
+            sums->sumh += (z3 - z4)*(z3 - z4);
+            sums->nslope++;
+        }
+        if (w1 && w4) {
+            sums->sumv += (z4 - z1)*(z4 - z1);
+            sums->nslope++;
+        }
+
+        sums->area += square_area2w(z1, z2, z3, z4, w1, w2, w3, w4, x, y);
+        sums->var += square_var2w(z1, z2, z3, z4, w1, w2, w3, w4, x, y);
+        c = (z1 + z2 + z3 + z4)/4.0;
+        sums->vol += (w1*(3.0*z1 + z2 + z4 + c)
+                      + w2*(3.0*z2 + z1 + z3 + c)
+                      + w3*(3.0*z3 + z2 + z4 + c)
+                      + w4*(3.0*z4 + z3 + z1 + c))/24.0;
+    }
+    sums->n += n;
+
+    return n;
+}
+
+/**
+ * GwyStatsSummary:
+ * @n: Number of pixels in the area, not counting masked-out ones.
+ * @min: Minimum value.
+ * @max: Maximum value.
+ * @avg: Average value.
+ * @median: Median value.
+ * @ra: Mean absolute deviation from the average (Sa).
+ * @rms: Root mean square deviation from the average (Sq).
+ * @skew: Skew of the value distribution.
+ * @kurtosis: Excess kurtosis of the value distribution.
+ * @mean_square: Mean square value, without subtracting the average.
+ * @slope: Root mean square surface slope (Sdq).
+ * @surface_area: Surface area.
+ * @variation: Total variation.
+ * @volume: Volume, measured from zero.
+ *
+ * Summary of statistical quantities of a data field area.
+ *
+ * See gwy_data_field_area_get_stats_summary().
+ *
+ * Since: 2.62
+ **/
+
+/**
+ * gwy_data_field_area_get_stats_summary:
+ * @data_field: A data field.
+ * @mask: Mask specifying which values to take into account/exclude, or %NULL.
+ * @mode: Masking mode to use.  See the introduction for description of
+ *        masking modes.
+ * @col: Upper-left column coordinate.
+ * @row: Upper-left row coordinate.
+ * @width: Area width (number of columns).
+ * @height: Area height (number of rows).
+ * @summary: Location to store the quantities to.
+ *
+ * Computes many statistical quantities of a rectangular part of a data field
+ * at once.
+ *
+ * The quantities are defined as in the corresponding individual functions,
+ * such as gwy_data_field_area_get_stats_mask(),
+ * gwy_data_field_area_get_median_mask(),
+ * gwy_data_field_area_get_surface_area_mask(),
+ * gwy_data_field_area_get_surface_slope_mask() or
+ * gwy_data_field_area_get_variation().  The volume is the same as calculated
+ * by gwy_data_field_area_get_volume() with no basis, except that @mode is
+ * honoured.  The results can differ from the individual functions by
+ * rounding errors.
+ *
+ * All the quantities are obtained in one sweep over the area, which is
+ * considerably faster than calling the individual functions.  Quantities
+ * which make sense only if the lateral dimensions and values are the same
+ * physical quantities, such as surface area, are calculated regardless.  The
+ * caller should disregard them if they are meaningless.
+ *
+ * If there are no unmasked pixels in the area, all fields of @summary are set
+ * to zeros.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_data_field_area_get_stats_summary(GwyDataField *data_field,
+                                      GwyDataField *mask,
+                                      GwyMaskingType mode,
+                                      gint col, gint row,
+                                      gint width, gint height,
+                                      GwyStatsSummary *summary)
+{
+    SummaryRowSums total;
+    gdouble *buffer;
+    guint *rowcounts;
+    gdouble c_abs1, c_sz2, c_sz3, c_sz4, avg, rms2, dx, dy;
+    guint n, k;
+    gint i;
+
+    g_return_if_fail(summary);
+    gwy_clear(summary, 1);
+    if (!_gwy_data_field_check_area(data_field, col, row, width, height)
+        || !_gwy_data_field_check_mask(data_field, &mask, &mode))
+        return;
+
+    gwy_clear(&total, 1);
+    total.min = G_MAXDOUBLE;
+    total.max = -G_MAXDOUBLE;
+    /* Each row gathers its values to its own segment of the buffer.  They are
+     * then compacted for the median and central moments. */
+    buffer = g_new(gdouble, width*height);
+    rowcounts = g_new(guint, height);
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(data_field,mask,mode,col,row,width,height, \
+                   buffer,rowcounts,total)
+#endif
+    {
+        SummaryRowSums tsums;
+        gint ifrom = gwy_omp_chunk_start(height+1);
+        gint ito = gwy_omp_chunk_end(height+1);
+        gint ii;
+        guint rn;
+
+        gwy_clear(&tsums, 1);
+        tsums.min = G_MAXDOUBLE;
+        tsums.max = -G_MAXDOUBLE;
+        for (ii = ifrom; ii < ito; ii++) {
+            rn = summary_row(data_field, mask, mode,
+                             col, row, width, height, ii,
+                             buffer + ii*width, &tsums);
+            if (ii < height)
+                rowcounts[ii] = rn;
+        }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        {
+            total.n += tsums.n;
+            total.nslope += tsums.nslope;
+            total.sum += tsums.sum;
+            total.sum2 += tsums.sum2;
+            total.sumh += tsums.sumh;
+            total.sumv += tsums.sumv;
+            total.area += tsums.area;
+            total.var += tsums.var;
+            total.vol += tsums.vol;
+            total.min = MIN(total.min, tsums.min);
+            total.max = MAX(total.max, tsums.max);
+        }
+    }
+
+    n = total.n;
+    if (!n) {
+        g_free(rowcounts);
+        g_free(buffer);
+        return;
+    }
+
+    /* Rows are usually full without masking, so this is mostly no-op. */
+    for (i = 1, k = rowcounts[0]; i < height; i++) {
+        if (k != i*width)
+            memmove(buffer + k, buffer + i*width, rowcounts[i]*sizeof(gdouble));
+        k += rowcounts[i];
+    }
+
+    avg = total.sum/n;
+    c_sz2 = c_sz3 = c_sz4 = c_abs1 = 0.0;
+#ifdef _OPENMP
+#pragma omp parallel for if(gwy_threads_are_enabled()) default(none) \
+            reduction(+:c_abs1,c_sz2,c_sz3,c_sz4) \
+            private(k) \
+            shared(buffer,n,avg)
+#endif
+    for (k = 0; k < n; k++) {
+        gdouble dif = buffer[k] - avg;
+        c_abs1 += fabs(dif);
+        c_sz2 += dif*dif;
+        c_sz3 += dif*dif*dif;
+        c_sz4 += dif*dif*dif*dif;
+    }
+
+    dx = gwy_data_field_get_dx(data_field);
+    dy = gwy_data_field_get_dy(data_field);
+    rms2 = c_sz2/n;
+    summary->n = n;
+    summary->min = total.min;
+    summary->max = total.max;
+    summary->avg = avg;
+    summary->ra = c_abs1/n;
+    summary->rms = sqrt(rms2);
+    if (rms2 > 0.0) {
+        summary->skew = c_sz3/pow(rms2, 1.5)/n;
+        summary->kurtosis = c_sz4/(rms2*rms2)/n - 3;
+    }
+    summary->mean_square = total.sum2/n;
+    if (total.nslope) {
+        summary->slope = sqrt(2.0*(total.sumh/(dx*dx) + total.sumv/(dy*dy))
+                              /total.nslope);
+    }
+    summary->surface_area = total.area*dx*dy/4.0;
+    summary->variation = total.var*dx*dy/4.0;
+    summary->volume = total.vol*dx*dy;
+    /* This must be last, it shuffles the buffer. */
+    summary->median = gwy_math_median(n, buffer);
+
+    g_free(rowcounts);
+    g_free(buffer);
+}
+
+
 /**
  * gwy_data_field_area_get_dispersion:
  * @data_field: A data field.
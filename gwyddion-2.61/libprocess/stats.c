@@ -472,6 +472,156 @@ gwy_data_field_get_sum(GwyDataField *data_field)
     return CVAL(data_field, SUM);
 }
 
+static inline void
+kahan_add(gdouble *s, gdouble *c, gdouble x)
+{
+    gdouble y = x - *c, t = *s + y;
+
+    *c = (t - *s) - y;
+    *s = t;
+}
+
+AreaSums*
+_gwy_area_sums_new(GwyDataField *data_field)
+{
+    AreaSums *asums = g_new0(AreaSums, 1);
+
+    _gwy_area_sums_update(asums, data_field);
+    return asums;
+}
+
+void
+_gwy_area_sums_update(AreaSums *asums, GwyDataField *data_field)
+{
+    gint xres = data_field->xres, yres = data_field->yres, rowstride, i, j;
+    gdouble *s, *comp;
+    gdouble offset;
+
+    rowstride = 2*(xres + 1);
+    if (asums->xres != xres || asums->yres != yres || !asums->sums) {
+        g_free(asums->sums);
+        asums->sums = g_new(gdouble, rowstride*(yres + 1));
+        asums->xres = xres;
+        asums->yres = yres;
+    }
+    asums->offset = offset = gwy_data_field_get_avg(data_field);
+
+    /* Both the row prefix sums and the accumulation along columns are
+     * compensated so that the absolute error of all table entries stays at
+     * the level of a few ulps of the largest entry. */
+    s = asums->sums;
+    gwy_clear(s, rowstride);
+    comp = g_new0(gdouble, rowstride);
+    for (i = 0; i < yres; i++) {
+        const gdouble *drow = data_field->data + i*xres;
+        const gdouble *prev = s + i*rowstride;
+        gdouble *srow = s + (i + 1)*rowstride;
+        gdouble r = 0.0, rc = 0.0, r2 = 0.0, r2c = 0.0;
+
+        srow[0] = srow[1] = 0.0;
+        for (j = 0; j < xres; j++) {
+            gdouble z = drow[j] - offset;
+            gint k = 2*(j + 1);
+
+            kahan_add(&r, &rc, z);
+            kahan_add(&r2, &r2c, z*z);
+            srow[k] = prev[k];
+            kahan_add(srow + k, comp + k, r - rc);
+            srow[k+1] = prev[k+1];
+            kahan_add(srow + k+1, comp + k+1, r2 - r2c);
+        }
+    }
+    g_free(comp);
+}
+
+void
+_gwy_area_sums_free(AreaSums *asums)
+{
+    if (!asums)
+        return;
+
+    g_free(asums->sums);
+    g_free(asums);
+}
+
+AreaSums*
+_gwy_data_field_get_area_sums(GwyDataField *data_field)
+{
+    AreaSums *asums = (AreaSums*)data_field->reserved1;
+
+    if (asums && !CTEST(data_field, SAT)) {
+        _gwy_area_sums_update(asums, data_field);
+        data_field->cached |= CBIT(SAT);
+    }
+
+    return asums;
+}
+
+/**
+ * gwy_data_field_set_area_sums_cached:
+ * @data_field: A data field.
+ * @setting: %TRUE to keep summed-area tables for the data field, %FALSE to
+ *           free them.
+ *
+ * Enables or disables caching of summed-area tables for a data field.
+ *
+ * Summed-area tables hold sums of values and squared values over all
+ * rectangles with the upper left corner at the field origin.  When they are
+ * enabled, unmasked area sums, averages, root mean square and mean square
+ * values are calculated from four table entries, independently on the area
+ * size.  This pays off when many such rectangular statistics are requested
+ * for a field which does not change, for instance in correlation searches.
+ *
+ * The tables are built on demand after each invalidation of the data field
+ * and occupy twice the memory of the data.  They are neither copied nor
+ * serialised.
+ *
+ * The rebuild happens inside the first statistics function called after the
+ * invalidation, even though such functions otherwise only read the field.  So
+ * if you request area statistics of the same field from several threads,
+ * make the tables up to date first, for instance by calling
+ * gwy_data_field_area_get_avg() for a single pixel (not the entire field,
+ * which is calculated without the tables) before starting the threads.
+ *
+ * Since: 2.62
+ **/
+void
+gwy_data_field_set_area_sums_cached(GwyDataField *data_field,
+                                    gboolean setting)
+{
+    g_return_if_fail(GWY_IS_DATA_FIELD(data_field));
+
+    if (!setting == !data_field->reserved1)
+        return;
+
+    data_field->cached &= ~CBIT(SAT);
+    if (setting)
+        data_field->reserved1 = g_new0(AreaSums, 1);
+    else {
+        _gwy_area_sums_free((AreaSums*)data_field->reserved1);
+        data_field->reserved1 = NULL;
+    }
+}
+
+/**
+ * gwy_data_field_get_area_sums_cached:
+ * @data_field: A data field.
+ *
+ * Reports whether summed-area tables are cached for a data field.
+ *
+ * See gwy_data_field_set_area_sums_cached() for details.
+ *
+ * Returns: %TRUE if the tables are enabled for @data_field.
+ *
+ * Since: 2.62
+ **/
+gboolean
+gwy_data_field_get_area_sums_cached(GwyDataField *data_field)
+{
+    g_return_val_if_fail(GWY_IS_DATA_FIELD(data_field), FALSE);
+    return !!data_field->reserved1;
+}
+
 /**
  * gwy_data_field_area_get_sum:
  * @data_field: A data field.
@@ -523,8 +673,9 @@ gwy_data_field_area_get_sum_mask(GwyDataField *dfield,
                                  gint width, gint height)
 {
     gint i, j, xres;
-    gdouble sum = 0.0;
+    gdouble sum = 0.0, sum2;
     const gdouble *datapos, *mpos;
+    AreaSums *asums;
 
     if (!_gwy_data_field_check_area(dfield, col, row, width, height)
         || !_gwy_data_field_check_mask(dfield, &mask, &mode))
@@ -561,6 +712,11 @@ gwy_data_field_area_get_sum_mask(GwyDataField *dfield,
         && row == 0 && height == dfield->yres)
         return gwy_data_field_get_sum(dfield);
 
+    if ((asums = _gwy_data_field_get_area_sums(dfield))) {
+        _gwy_area_sums_query(asums, col, row, width, height, &sum, &sum2);
+        return sum + width*height*asums->offset;
+    }
+
     datapos = dfield->data + row*xres + col;
     /* Too trivial to parallelise. */
     for (i = 0; i < height; i++) {
@@ -783,6 +939,7 @@ gwy_data_field_area_get_rms_mask(GwyDataField *dfield,
     gint i, j, xres;
     gdouble sum, sum2 = 0.0;
     const gdouble *datapos, *mpos;
+    AreaSums *asums;
     guint nn;
 
     if (!width || !height)                               /* Compatibility */
@@ -830,6 +987,12 @@ gwy_data_field_area_get_rms_mask(GwyDataField *dfield,
         && row == 0 && height == dfield->yres)
         return gwy_data_field_get_rms(dfield);
 
+    nn = width*height;
+    if ((asums = _gwy_data_field_get_area_sums(dfield))) {
+        _gwy_area_sums_query(asums, col, row, width, height, &sum, &sum2);
+        return sqrt(fabs(sum2 - sum*sum/nn)/nn);
+    }
+
     sum = gwy_data_field_area_get_sum(dfield, NULL, col, row, width, height);
     datapos = dfield->data + row*xres + col;
     /* Too trivial to parallelise. */
@@ -839,7 +1002,6 @@ gwy_data_field_area_get_rms_mask(GwyDataField *dfield,
         for (j = 0; j < width; j++)
             sum2 += drow[j]*drow[j];
     }
-    nn = width*height;
 
     return sqrt(fabs(sum2 - sum*sum/nn)/nn);
 }
@@ -1027,6 +1189,7 @@ gwy_data_field_area_get_mean_square(GwyDataField *dfield,
 {
     gdouble msq = 0.0;
     const gdouble *datapos, *mpos;
+    AreaSums *asums;
     gint i, j, xres;
     guint nn;
 
@@ -1079,6 +1242,13 @@ gwy_data_field_area_get_mean_square(GwyDataField *dfield,
         && row == 0 && height == dfield->yres)
         return gwy_data_field_get_mean_square(dfield);
 
+    if ((asums = _gwy_data_field_get_area_sums(dfield))) {
+        gdouble sum, sum2, offset = asums->offset;
+
+        _gwy_area_sums_query(asums, col, row, width, height, &sum, &sum2);
+        return (sum2 + 2.0*offset*sum)/(width*height) + offset*offset;
+    }
+
     /* Too trivial to parallelise. */
     for (i = 0; i < height; i++) {
         const gdouble *drow = datapos + i*xres;
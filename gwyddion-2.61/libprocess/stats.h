@@ -26,6 +26,23 @@
 
 G_BEGIN_DECLS
 
+typedef struct {
+    guint n;
+    gdouble min;
+    gdouble max;
+    gdouble avg;
+    gdouble median;
+    gdouble ra;
+    gdouble rms;
+    gdouble skew;
+    gdouble kurtosis;
+    gdouble mean_square;
+    gdouble slope;
+    gdouble surface_area;
+    gdouble variation;
+    gdouble volume;
+} GwyStatsSummary;
+
 gdouble gwy_data_field_get_max              (GwyDataField *data_field);
 gdouble gwy_data_field_get_min              (GwyDataField *data_field);
 void    gwy_data_field_get_min_max          (GwyDataField *data_field,
@@ -502,6 +519,17 @@ gdouble      gwy_data_field_area_get_dispersion     (GwyDataField *data_field,
 gdouble      gwy_data_field_get_dispersion          (GwyDataField *data_field,
                                                      gdouble *xcenter,
                                                      gdouble *ycenter);
+void         gwy_data_field_area_get_stats_summary  (GwyDataField *data_field,
+                                                     GwyDataField *mask,
+                                                     GwyMaskingType mode,
+                                                     gint col,
+                                                     gint row,
+                                                     gint width,
+                                                     gint height,
+                                                     GwyStatsSummary *summary);
+void         gwy_data_field_set_area_sums_cached    (GwyDataField *data_field,
+                                                     gboolean setting);
+gboolean     gwy_data_field_get_area_sums_cached    (GwyDataField *data_field);
 void         gwy_data_field_slope_distribution      (GwyDataField *data_field,
                                                      GwyDataLine *derdist,
                                                      gint kernel_size);
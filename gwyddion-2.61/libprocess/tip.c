@@ -1019,45 +1019,6 @@ get_right_tip_field(GwyDataField *tip,
                                         GWY_INTERPOLATION_BSPLINE);
 }
 
-static inline gdouble
-tip_convolve_interior(const gdouble *src, gint xres,
-                      const gdouble *tip, gint txres, gint tyres)
-{
-    gdouble hmax = -G_MAXDOUBLE;
-    gint i, j;
-
-    for (i = 0; i < tyres; i++) {
-        const gdouble *srcrow = src + i*xres;
-        for (j = txres; j; j--) {
-            gdouble h = *(srcrow++) + *(tip++);
-            if (h > hmax)
-                hmax = h;
-        }
-    }
-    return hmax;
-}
-
-static inline gdouble
-tip_convolve_border(const gdouble *src, gint xres, gint yres,
-                    const gdouble *tip, gint txres, gint tyres,
-                    gint j, gint i)
-{
-    gint ioff = tyres/2, joff = txres/2;
-    gdouble hmax = -G_MAXDOUBLE;
-    gint ii, jj;
-
-    for (ii = 0; ii < tyres; ii++) {
-        gint isrc = CLAMP(i + ii - ioff, 0, yres-1);
-        for (jj = 0; jj < txres; jj++) {
-            gint jsrc = CLAMP(j + jj - joff, 0, xres-1);
-            gdouble h = src[isrc*xres + jsrc] + *(tip++);
-            if (h > hmax)
-                hmax = h;
-        }
-    }
-    return hmax;
-}
-
 /**
  * gwy_tip_dilation:
  * @tip: Tip data.
@@ -1082,11 +1043,9 @@ gwy_tip_dilation(GwyDataField *tip,
                  GwySetFractionFunc set_fraction,
                  GwySetMessageFunc set_message)
 {
-    gint txres, tyres, xres, yres, ioff, joff;
-    const gdouble *sdata, *tdata;
-    gdouble *data;
     GwyDataField *mytip;
-    gboolean cancelled = FALSE, *pcancelled = &cancelled;
+    gint xres, yres;
+    gboolean ok;
 
     g_return_val_if_fail(GWY_IS_DATA_FIELD(tip), NULL);
     g_return_val_if_fail(GWY_IS_DATA_FIELD(surface), NULL);
@@ -1105,88 +1064,11 @@ gwy_tip_dilation(GwyDataField *tip,
     mytip = gwy_data_field_duplicate(tip);
     gwy_data_field_add(mytip, -gwy_data_field_get_max(mytip));
 
-    txres = tip->xres;
-    tyres = tip->yres;
-    sdata = surface->data;
-    tdata = mytip->data;
-    data = result->data;
-    ioff = tyres/2;
-    joff = txres/2;
-
-#ifdef _OPENMP
-#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
-            shared(sdata,data,tdata,xres,yres,txres,tyres,ioff,joff,set_fraction,pcancelled)
-#endif
-    {
-        gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
-        gint i, j;
-
-        for (i = ifrom; i < ito; i++) {
-            gboolean row_inside = (i >= ioff && i + tyres-ioff <= yres);
-
-            for (j = 0; j < xres; j++) {
-                gboolean col_inside = (j >= joff && j + txres-joff <= xres);
-                gint k = i*xres + j;
-
-                if (row_inside && col_inside) {
-                    const gdouble *src = sdata + (i - ioff)*xres + (j - joff);
-                    data[k] = tip_convolve_interior(src, xres,
-                                                    tdata, txres, tyres);
-                }
-                else {
-                    data[k] = tip_convolve_border(sdata, xres, yres,
-                                                  tdata, txres, tyres,
-                                                  j, i);
-                }
-            }
-
-            if (gwy_omp_set_fraction_check_cancel(set_fraction, i, ifrom, ito,
-                                                  pcancelled))
-                break;
-        }
-    }
+    ok = _gwy_morph_lib_dilation(surface->data, xres, yres, mytip->data, mytip->xres, mytip->yres,
+                                 mytip->xres/2, mytip->yres/2, TRUE, result->data, set_fraction);
 
     g_object_unref(mytip);
-    return cancelled ? NULL : result;
-}
-
-static inline gdouble
-tip_erode_interior(const gdouble *src, gint xres,
-                   const gdouble *tip, gint txres, gint tyres)
-{
-    gdouble hmin = G_MAXDOUBLE;
-    gint i, j;
-
-    for (i = 0; i < tyres; i++) {
-        const gdouble *srcrow = src + i*xres;
-        for (j = txres; j; j--) {
-            gdouble h = *(srcrow++) - *(tip++);
-            if (h < hmin)
-                hmin = h;
-        }
-    }
-    return hmin;
-}
-
-static inline gdouble
-tip_erode_border(const gdouble *src, gint xres, gint yres,
-                 const gdouble *tip, gint txres, gint tyres,
-                 gint j, gint i)
-{
-    gint ioff = tyres/2, joff = txres/2;
-    gdouble hmin = G_MAXDOUBLE;
-    gint ii, jj;
-
-    for (ii = 0; ii < tyres; ii++) {
-        gint isrc = CLAMP(i + ii - ioff, 0, yres-1);
-        for (jj = 0; jj < txres; jj++) {
-            gint jsrc = CLAMP(j + jj - joff, 0, xres-1);
-            gdouble h = src[isrc*xres + jsrc] - *(tip++);
-            if (h < hmin)
-                hmin = h;
-        }
-    }
-    return hmin;
+    return ok ? result : NULL;
 }
 
 /**
@@ -1213,11 +1095,9 @@ gwy_tip_erosion(GwyDataField *tip,
                 GwySetFractionFunc set_fraction,
                 GwySetMessageFunc set_message)
 {
-    gint txres, tyres, xres, yres, ioff, joff;
-    const gdouble *sdata, *tdata;
-    GwyDataField *mytip;
-    gdouble *data;
-    gboolean cancelled = FALSE, *pcancelled = &cancelled;
+    GwyDataField *mytip, *negsurface;
+    gint xres, yres;
+    gboolean ok;
 
     g_return_val_if_fail(GWY_IS_DATA_FIELD(tip), NULL);
     g_return_val_if_fail(GWY_IS_DATA_FIELD(surface), NULL);
@@ -1236,49 +1116,19 @@ gwy_tip_erosion(GwyDataField *tip,
     gwy_data_field_invert(mytip, TRUE, TRUE, FALSE);
     gwy_data_field_add(mytip, -gwy_data_field_get_max(mytip));
 
-    txres = tip->xres;
-    tyres = tip->yres;
-    sdata = surface->data;
-    tdata = mytip->data;
-    data = result->data;
-    ioff = tyres/2;
-    joff = txres/2;
-
-#ifdef _OPENMP
-#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
-            shared(sdata,data,tdata,xres,yres,txres,tyres,ioff,joff,set_fraction,pcancelled)
-#endif
-    {
-        gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
-        gint i, j;
-
-        for (i = ifrom; i < ito; i++) {
-            gboolean row_inside = (i >= ioff && i + tyres-ioff <= yres);
-
-            for (j = 0; j < xres; j++) {
-                gboolean col_inside = (j >= joff && j + txres-joff <= xres);
-                gint k = i*xres + j;
-
-                if (row_inside && col_inside) {
-                    const gdouble *src = sdata + (i - ioff)*xres + (j - joff);
-                    data[k] = tip_erode_interior(src, xres,
-                                                 tdata, txres, tyres);
-                }
-                else {
-                    data[k] = tip_erode_border(sdata, xres, yres,
-                                               tdata, txres, tyres,
-                                               j, i);
-                }
-            }
-
-            if (gwy_omp_set_fraction_check_cancel(set_fraction, i, ifrom, ito,
-                                                  pcancelled))
-                break;
-        }
-    }
+    /* Erosion is the negated dilation of the negated surface. */
+    negsurface = gwy_data_field_duplicate(surface);
+    gwy_data_field_multiply(negsurface, -1.0);
+    ok = _gwy_morph_lib_dilation(negsurface->data, xres, yres, mytip->data, mytip->xres, mytip->yres,
+                                 mytip->xres/2, mytip->yres/2, TRUE, result->data, set_fraction);
+    if (ok)
+        gwy_data_field_multiply(result, -1.0);
+    else
+        gwy_data_field_invalidate(result);
 
+    g_object_unref(negsurface);
     g_object_unref(mytip);
-    return cancelled ? NULL : result;
+    return ok ? result : NULL;
 }
 
 /**
@@ -24,6 +24,7 @@
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwymath.h>
 #include <libprocess/triangulation.h>
+#include "libgwyddion/gwyomp.h"
 
 /*
  * Some identities for planar triangulations
@@ -49,9 +50,18 @@ enum {
     NEIGHBOURS = 8,   /* Must be at least 3. */
     LINE_13 = 1,
     LINE_02 = 2,
+    /* Number of flip decisions remembered before the cache is cleared. */
+    TETRAGON_CACHE = 4096,
+    /* Minimum number of points in the first insertion round. */
+    BRIO_ROUND = 64,
 };
 
-#define CELL_SIDE 6.0
+/* Average number of points in a cell when sorting the points. */
+#define CELL_POINTS 2.0
+
+/* Seed for the random point order.  The order does not affect the result in
+ * non-degenerate cases, but we still want it reproducible. */
+#define BRIO_SEED 42
 
 #define get_point(points, point_size, i) \
     ((const GwyXY*)((const gchar*)(points) + (i)*(point_size)))
@@ -100,6 +110,16 @@ typedef struct {
     guint *orig_index;      /* Map from our ids to original point numbers. */
 } PointList;
 
+/* State of the Hilbert curve traversal of grid cells. */
+typedef struct {
+    gint xres;
+    gint yres;
+    guint *cell_index;         /* Block start positions in cell_points[]. */
+    guint *cell_points;        /* Point ids sorted by cell. */
+    guint *order;              /* Output, point ids in the curve order. */
+    guint len;                 /* Number of point ids in order[]. */
+} HilbertWalk;
+
 /* Information about blocks of neighbours in Voronoi point merging.  The size
  * field is redundant. */
 typedef struct {
@@ -247,17 +267,13 @@ coords_to_grid_index(guint xres,
 {
     guint ix, iy;
 
-    ix = (gint)floor(x/step);
-    if (G_UNLIKELY(ix == xres))
-        ix--;
+    ix = (guint)floor(x/step);
+    if (G_UNLIKELY(ix >= xres))
+        ix = xres-1;
 
-    iy = (gint)floor(y/step);
-    if (G_UNLIKELY(iy == yres))
-        iy--;
-
-    /* Go zig-zag through the cells */
-    if (iy % 2)
-        ix = xres-1 - ix;
+    iy = (guint)floor(y/step);
+    if (G_UNLIKELY(iy >= yres))
+        iy = yres-1;
 
     return iy*xres + ix;
 }
@@ -283,10 +299,46 @@ index_rewind(guint *index_array,
     index_array[0] = 0;
 }
 
-/* Try to increase locality of the point list by sorting it to grid cells
- * and then taking the points cell-by-cell.  Also reduces the workind set size
- * by constructing a list of plain Points instead of whatever might the
- * caller's representation be. */
+/* Visit grid cells in the order of a Hilbert curve.  The curve is defined on
+ * the smallest power-of-two square enclosing the xres×yres grid.  The current
+ * square has corner (x0,y0) and sides (ax,ay) and (bx,by); the curve enters it
+ * at the corner and leaves at the end of the first side.  Squares outside the
+ * grid are skipped so the cost is proportional to the number of cells. */
+static void
+hilbert_walk(HilbertWalk *walk,
+             gint x0, gint y0,
+             gint ax, gint ay,
+             gint bx, gint by)
+{
+    gint xlo = x0 + MIN(ax, 0) + MIN(bx, 0);
+    gint ylo = y0 + MIN(ay, 0) + MIN(by, 0);
+    gint ax2 = ax/2, ay2 = ay/2, bx2 = bx/2, by2 = by/2;
+    guint k, ig;
+
+    if (xlo >= walk->xres || ylo >= walk->yres)
+        return;
+
+    if (ABS(ax) + ABS(ay) == 1) {
+        ig = ylo*walk->xres + xlo;
+        for (k = walk->cell_index[ig]; k < walk->cell_index[ig+1]; k++)
+            walk->order[walk->len++] = walk->cell_points[k];
+        return;
+    }
+
+    hilbert_walk(walk, x0, y0, bx2, by2, ax2, ay2);
+    hilbert_walk(walk, x0 + ax2, y0 + ay2, ax2, ay2, bx2, by2);
+    hilbert_walk(walk, x0 + ax2 + bx2, y0 + ay2 + by2, ax2, ay2, bx2, by2);
+    hilbert_walk(walk, x0 + ax2 + bx, y0 + ay2 + by, -bx2, -by2, -ax2, -ay2);
+}
+
+/* Determine the insertion order of points.  We use biased randomised
+ * insertion order: points are randomly split to rounds, each round being
+ * about twice as large as the previous one, and in each round they are sorted
+ * along a Hilbert curve.  So the triangulation grows more or less uniformly
+ * over the entire area, new points are close to the previous ones (and so is
+ * the search for the containing triangle) and memory is accessed with good
+ * locality.  Also reduces the working set size by constructing a list of plain
+ * Points instead of whatever might the caller's representation be. */
 static void
 build_compact_point_list(PointList *pointlist,
                          guint npoints,
@@ -294,9 +346,13 @@ build_compact_point_list(PointList *pointlist,
                          gsize point_size)
 {
     const GwyXY *pt;
-    gdouble xmin, xmax, ymin, ymax, xreal, yreal, step, xr, yr;
-    guint i, xres, yres, ncells, ig, pos;
-    guint *cell_index;
+    HilbertWalk walk;
+    GRand *rng;
+    gdouble xmin, xmax, ymin, ymax, xreal, yreal, step;
+    guint i, ig, pos, ncells, nlevels, side;
+    guint level_index[33];
+    guint *cell_index, *order;
+    guchar *level;
 
     pointlist->npoints = npoints;
     pointlist->points = g_new(GwyXY, npoints);
@@ -319,44 +375,87 @@ build_compact_point_list(PointList *pointlist,
             ymax = pt->y;
     }
 
+    /* Choose square cells containing a few points on average. */
     xreal = xmax - xmin;
     yreal = ymax - ymin;
-    xr = xreal/sqrt(npoints)*CELL_SIDE;
-    yr = yreal/sqrt(npoints)*CELL_SIDE;
-
-    if (xr <= yr) {
-        xres = (guint)ceil(xreal/xr);
-        step = xreal/xres;
-        yres = (guint)ceil(yreal/step);
-    }
-    else {
-        yres = (guint)ceil(yreal/yr);
-        step = yreal/yres;
-        xres = (guint)ceil(xreal/step);
-    }
+    step = sqrt(xreal*yreal*CELL_POINTS/npoints);
+    if (!(step > 0.0))
+        step = MAX(xreal, yreal)*CELL_POINTS/npoints;
+    if (!(step > 0.0))
+        step = 1.0;
+
+    walk.xres = MAX((guint)ceil(xreal/step), 1);
+    walk.yres = MAX((guint)ceil(yreal/step), 1);
+    ncells = walk.xres*walk.yres;
+    for (side = 1; side < MAX(walk.xres, walk.yres); side <<= 1)
+        ;
 
-    ncells = xres*yres;
+    /* Sort the points to cells. */
     cell_index = g_new0(guint, ncells + 1);
-
     for (i = 0; i < npoints; i++) {
         pt = get_point(points, point_size, i);
-        ig = coords_to_grid_index(xres, yres, step, pt->x - xmin, pt->y - ymin);
+        ig = coords_to_grid_index(walk.xres, walk.yres, step,
+                                  pt->x - xmin, pt->y - ymin);
         cell_index[ig]++;
     }
 
-    index_accumulate(cell_index, xres*yres);
-    index_rewind(cell_index, xres*yres);
+    index_accumulate(cell_index, ncells);
+    index_rewind(cell_index, ncells);
 
+    walk.cell_points = g_new(guint, npoints);
     for (i = 0; i < npoints; i++) {
         pt = get_point(points, point_size, i);
-        ig = coords_to_grid_index(xres, yres, step, pt->x - xmin, pt->y - ymin);
-        pos = cell_index[ig];
-        pointlist->orig_index[pos] = i;
-        pointlist->points[pos] = *pt;
-        cell_index[ig]++;
+        ig = coords_to_grid_index(walk.xres, walk.yres, step,
+                                  pt->x - xmin, pt->y - ymin);
+        walk.cell_points[cell_index[ig]++] = i;
     }
 
+    index_rewind(cell_index, ncells);
+    walk.cell_index = cell_index;
+
+    /* Take the cells along the Hilbert curve. */
+    order = walk.order = g_new(guint, npoints);
+    walk.len = 0;
+    hilbert_walk(&walk, 0, 0, side, 0, 0, side);
+    g_assert(walk.len == npoints);
+    g_free(walk.cell_points);
     g_free(cell_index);
+
+    /* Assign points to rounds.  Each point is moved to the preceding round
+     * with probability 1/2, so the rounds roughly double in size.  The number
+     * of rounds is chosen to make the first one about BRIO_ROUND points
+     * large. */
+    for (nlevels = 1; nlevels < 32 && (npoints >> nlevels) >= BRIO_ROUND; )
+        nlevels++;
+
+    gwy_clear(level_index, nlevels+1);
+    level = g_new(guchar, npoints);
+    rng = g_rand_new_with_seed(BRIO_SEED);
+    for (i = 0; i < npoints; i++) {
+        guint32 r = g_rand_int(rng);
+        guint l = 0;
+
+        while ((r & 1) && l+1 < nlevels) {
+            r >>= 1;
+            l++;
+        }
+        level[i] = nlevels-1 - l;
+        level_index[level[i]]++;
+    }
+    g_rand_free(rng);
+
+    index_accumulate(level_index, nlevels);
+    index_rewind(level_index, nlevels);
+
+    for (i = 0; i < npoints; i++) {
+        pos = level_index[level[i]]++;
+        pt = get_point(points, point_size, order[i]);
+        pointlist->orig_index[pos] = order[i];
+        pointlist->points[pos] = *pt;
+    }
+
+    g_free(level);
+    g_free(order);
 }
 
 static inline void
@@ -1137,15 +1236,35 @@ tetragon_decision_cache_append_block(TetragonDecisionCache *cache)
 }
 
 static void
-tetragon_decision_cache_init(TetragonDecisionCache *cache,
-                             guint npoints)
+tetragon_decision_cache_init(TetragonDecisionCache *cache)
 {
     cache->map = g_hash_table_new(tetragon_hash, tetragon_equal);
-    cache->size = npoints;
+    cache->size = TETRAGON_CACHE;
     cache->storage = NULL;
     tetragon_decision_cache_append_block(cache);
 }
 
+/* Forget all decisions, keeping one storage block, if the cache has grown
+ * large.  Flips can only cycle while we are updating the neighbourhood of
+ * a single new point so decisions do not need to be kept for long.  Clearing
+ * the cache only occasionally keeps the cost of the reset negligible. */
+static void
+tetragon_decision_cache_reset(TetragonDecisionCache *cache)
+{
+    GSList *l;
+
+    if (g_hash_table_size(cache->map) < TETRAGON_CACHE)
+        return;
+
+    for (l = g_slist_next(cache->storage); l; l = g_slist_next(l))
+        g_free(l->data);
+    g_slist_free(g_slist_next(cache->storage));
+    cache->storage->next = NULL;
+    cache->currblock = cache->storage->data;
+    cache->currlen = 0;
+    g_hash_table_remove_all(cache->map);
+}
+
 static void
 tetragon_decision_cache_free(TetragonDecisionCache *cache)
 {
@@ -2003,12 +2122,40 @@ handle_point_on_line_inside_triangle(Triangulator *triangulator,
     return TRUE;
 }
 
+/* Assuming abc is a ccw triangle nearest to an outside point @i which cannot
+ * see any of its boundary sides because it lies almost exactly on one of them,
+ * rotate abc cyclically to make a--b this boundary side.  Fail if there is no
+ * such side. */
+static gboolean
+make_ab_boundary_edge_on_line(const Triangulator *triangulator,
+                              const GwyXY *points,
+                              guint *ia, guint *ib, guint *ic, guint i)
+{
+    gdouble eps = 3.0*triangulator->eps;
+    guint k, t;
+
+    for (k = 0; k < 3; k++) {
+        if (point_lies_on_line(points, *ia, *ib, i, eps)
+            && line_is_on_boundary_ccw(triangulator, *ia, *ib))
+            return TRUE;
+        t = *ia;
+        *ia = *ib;
+        *ib = *ic;
+        *ic = t;
+    }
+    return FALSE;
+}
+
 /* Find some initial neighbours for point @i it should be provisionally
  * connected to and fill them in the queue.  If @inside is returned as %FALSE
  * then the first and last point in @queue must be the first and last
  * *boundary* point (this occurs naturally except when splitting a boundary
  * line, then we connect to both boundary and non-boundary points at once).
  *
+ * The search for the triangle starts from point @start.  Upon return, it is
+ * set to a vertex of the triangle found, which is a good starting point if
+ * the caller needs to retry later.
+ *
  * XXX: The function must not change anything in the triangulator if it returns
  * FALSE because the caller can then just postpone point @i and try another
  * point. */
@@ -2016,6 +2163,7 @@ static inline gboolean
 find_provisional_neighbours(Triangulator *triangulator,
                             const GwyXY *points,
                             guint i,
+                            guint *start,
                             UIntQueue *queue,
                             gboolean *inside)
 {
@@ -2024,10 +2172,8 @@ find_provisional_neighbours(Triangulator *triangulator,
 
     uint_queue_clear(queue);
 
-    /* Start from any valid triangle containing the last inserted point.
-     * We count on the list with improved locality to make it a reasonable
-     * start. */
-    ia = i-1;
+    /* Start from any valid triangle containing the start point. */
+    ia = *start;
     if (!make_any_triangle_with_point(triangulator, ia, &ib, &ic))
         return FALSE;
 
@@ -2037,6 +2183,7 @@ find_provisional_neighbours(Triangulator *triangulator,
                                           points + i);
     if (G_UNLIKELY(ia == UNDEF))
         return FALSE;
+    *start = ia;
 
     if (*inside) {
         /* If the point lies on a line we split the line, put the point onto it
@@ -2069,7 +2216,9 @@ find_provisional_neighbours(Triangulator *triangulator,
     /* When the point is outside, form new triangles by going along
      * the boundary line as far as we can ‘see’ the new point.  Make
      * all points along the way the neighbours of the new point. */
-    if (!make_ab_boundary_edge(triangulator, points, &ia, &ib, &ic, i))
+    if (!make_ab_boundary_edge(triangulator, points, &ia, &ib, &ic, i)
+        && !make_ab_boundary_edge_on_line(triangulator, points,
+                                          &ia, &ib, &ic, i))
         return FALSE;
 
     /* Again, treat points lying directly on a line by splitting the line.  We
@@ -2127,7 +2276,8 @@ triangulate(PointList *pointlist, GwySetFractionFunc set_fraction)
     TetragonDecisionCache cache;
     PointList mypoints;
     GwyXY *points;
-    guint npoints, i, iorig, niter, desperation;
+    guint *hints;
+    guint npoints, i, iorig, niter, desperation, start;
 
     npoints = pointlist->npoints;
     triangulator = triangulator_new_from_pointlist(pointlist);
@@ -2135,7 +2285,7 @@ triangulate(PointList *pointlist, GwySetFractionFunc set_fraction)
      * connect to the new point and points to update. */
     uint_queue_init(&queue);
     uint_queue_init(&todo);
-    tetragon_decision_cache_init(&cache, npoints);
+    tetragon_decision_cache_init(&cache);
 
     /* Point list as created by the triangulation where we can skip some points
      * and schedule them for later.  All indices in neighbours, etc. refer to
@@ -2145,6 +2295,9 @@ triangulate(PointList *pointlist, GwySetFractionFunc set_fraction)
     mypoints.points = g_new(GwyXY, npoints);
     mypoints.orig_index = g_new(guint, npoints);
     uint_queue_identity_fill(&todo, npoints);
+    /* Where to start searching for postponed points. */
+    hints = g_new(guint, npoints);
+    block_clear(hints, npoints);
 
     /* Create the first triangle.  If the points are all collinear we can
      * fail, at least for now...  The function is allowed to swap some points
@@ -2196,11 +2349,22 @@ triangulate(PointList *pointlist, GwySetFractionFunc set_fraction)
          * So points in the triangulator are always numbered sequentially. */
         mypoints.orig_index[i] = pointlist->orig_index[iorig];
         points[i] = pointlist->points[iorig];
-        if (!find_provisional_neighbours(triangulator, points, i, &queue,
-                                         &inside)) {
+        /* Start from the last inserted point.  We count on the insertion
+         * order with improved locality to make it a reasonable start.  For
+         * postponed points start from where we got the last time because
+         * the last inserted point can be anywhere.  However, once we get
+         * desperate, vary the starting point as the search may fail for
+         * a point near the boundary when started from one direction. */
+        if (hints[iorig] != UNDEF && !desperation)
+            start = hints[iorig];
+        else
+            start = i-1;
+        if (!find_provisional_neighbours(triangulator, points, i, &start,
+                                         &queue, &inside)) {
             /* Postpone the point.  This does not increment i, but niter is
              * still incremented so we will terminate eventually even if
              * nothing can be added. */
+            hints[iorig] = start;
             uint_queue_add_to_end(&todo, iorig);
             continue;
         }
@@ -2325,6 +2489,7 @@ triangulate(PointList *pointlist, GwySetFractionFunc set_fraction)
         /* We successfully added a point.  Reset @niter so that it counts to
          * the number of remaning points again. */
         niter = 0;
+        tetragon_decision_cache_reset(&cache);
     }
 
     if (triangulator->npoints < npoints)
@@ -2335,6 +2500,7 @@ triangulate(PointList *pointlist, GwySetFractionFunc set_fraction)
     gwy_assign(pointlist->points, points, npoints);
     gwy_assign(pointlist->orig_index, mypoints.orig_index, npoints);
     free_point_list(&mypoints);
+    g_free(hints);
     uint_queue_free(&queue);
     uint_queue_free(&todo);
     tetragon_decision_cache_free(&cache);
@@ -2343,6 +2509,7 @@ triangulate(PointList *pointlist, GwySetFractionFunc set_fraction)
 
 fail:
     free_point_list(&mypoints);
+    g_free(hints);
     uint_queue_free(&queue);
     uint_queue_free(&todo);
     tetragon_decision_cache_free(&cache);
@@ -3749,6 +3916,20 @@ interpolate_linear(Triangulation *triangulation,
     return TRUE;
 }
 
+static inline gboolean
+interpolate_one(Triangulation *triangulation,
+                GwyInterpolationType interpolation,
+                Triangle *triangle,
+                const GwyXY *pt,
+                gdouble *value)
+{
+    if (interpolation == GWY_INTERPOLATION_LINEAR)
+        return interpolate_linear(triangulation, triangle, pt, value);
+    if (interpolation == GWY_INTERPOLATION_NNA)
+        return interpolate_nna(triangulation, triangle, pt, value);
+    return interpolate_round(triangulation, triangle, pt, value);
+}
+
 /**
  * gwy_triangulation_interpolate:
  * @triangulation: Triangulation.
@@ -3774,12 +3955,10 @@ gwy_triangulation_interpolate(GwyTriangulation *object,
                               GwyDataField *dfield)
 {
     Triangulation *triangulation;
-    guint xres, yres, i, j;
+    guint xres, yres;
     gdouble qx, qy, xoff, yoff;
     gdouble *d;
-    Triangle triangle;
-    gboolean ok = FALSE;
-    GwyXY pt;
+    gboolean failed = FALSE, *pfailed = &failed;
 
     g_return_val_if_fail(GWY_IS_TRIANGULATION(object), FALSE);
     g_return_val_if_fail(GWY_IS_DATA_FIELD(dfield), FALSE);
@@ -3789,13 +3968,6 @@ gwy_triangulation_interpolate(GwyTriangulation *object,
                          || interpolation == GWY_INTERPOLATION_NNA
                          || interpolation == GWY_INTERPOLATION_ROUND, FALSE);
 
-    if (interpolation == GWY_INTERPOLATION_LINEAR)
-        make_valid_triangle(triangulation->neighbours, triangulation->nindex[1],
-                            triangulation->points, triangulation->point_size,
-                            &triangle, 0);
-    else
-        make_valid_vtriangle(triangulation, &triangle, 0);
-
     if (interpolation == GWY_INTERPOLATION_NNA)
         calculate_voronoi_zvalues(triangulation);
 
@@ -3807,27 +3979,59 @@ gwy_triangulation_interpolate(GwyTriangulation *object,
     qy = dfield->yreal/dfield->yres;
     d = dfield->data;
 
-    for (i = 0; i < yres; i++) {
-        pt.y = yoff + qy*(i + 0.5);
-        for (j = 0; j < xres; j++) {
-            pt.x = xoff + qx*(j + 0.5);
-            if (interpolation == GWY_INTERPOLATION_LINEAR)
-                ok = interpolate_linear(triangulation, &triangle, &pt, d);
-            else if (interpolation == GWY_INTERPOLATION_NNA)
-                ok = interpolate_nna(triangulation, &triangle, &pt, d);
-            else
-                ok = interpolate_round(triangulation, &triangle, &pt, d);
-            if (!ok)
-                goto fail;
-            d++;
+    /* Each thread walks its block of rows in a zig-zag manner so that the
+     * triangle containing the next pixel is always close to the previous
+     * one.  The walk to the first row goes along the left edge, pixel by
+     * pixel, as moving between distant points is not reliable when the path
+     * leaves the triangulation. */
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
+            shared(triangulation,interpolation,d,xres,yres,xoff,yoff,qx,qy, \
+                   pfailed)
+#endif
+    {
+        guint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
+        guint i, j, k;
+        Triangle triangle;
+        gboolean ok = TRUE;
+        gdouble z;
+        GwyXY pt;
+
+        if (interpolation == GWY_INTERPOLATION_LINEAR) {
+            make_valid_triangle(triangulation->neighbours,
+                                triangulation->nindex[1],
+                                triangulation->points,
+                                triangulation->point_size,
+                                &triangle, 0);
         }
+        else
+            make_valid_vtriangle(triangulation, &triangle, 0);
+
+        pt.x = xoff + 0.5*qx;
+        for (i = 0; i < ifrom && ok; i++) {
+            pt.y = yoff + qy*(i + 0.5);
+            ok = interpolate_one(triangulation, interpolation, &triangle, &pt,
+                                 &z);
+        }
+
+        for (i = ifrom; i < ito && ok; i++) {
+            pt.y = yoff + qy*(i + 0.5);
+            for (k = 0; k < xres; k++) {
+                j = ((i - ifrom) % 2) ? xres-1 - k : k;
+                pt.x = xoff + qx*(j + 0.5);
+                if (!(ok = interpolate_one(triangulation, interpolation,
+                                           &triangle, &pt, d + i*xres + j)))
+                    break;
+            }
+        }
+
+        if (!ok)
+            *pfailed = TRUE;
     }
-    ok = TRUE;
 
-fail:
     gwy_data_field_invalidate(dfield);
 
-    return ok;
+    return !failed;
 }
 
 /**
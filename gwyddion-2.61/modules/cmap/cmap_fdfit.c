@@ -109,7 +109,7 @@ static gboolean         module_register         (void);
 static GwyParamDef*     define_module_params    (void);
 static void             fdfit                   (GwyContainer *data,
                                                  GwyRunType runtype);
-static void             execute                 (ModuleArgs *args,
+static gboolean         execute                 (ModuleArgs *args,
                                                  GtkWindow *window);
 static GwyDialogOutcome run_gui                 (ModuleArgs *args,
                                                  GwyContainer *data,
@@ -170,6 +170,23 @@ static void             do_fdfit                (const gdouble *xdata,
                                                  gboolean *fix,
                                                  gdouble *error,
                                                  gboolean *fitok);
+static gint             prepare_fit_data        (const gdouble *xdata,
+                                                 const gdouble *ydata,
+                                                 gint ndata,
+                                                 const gint *segments,
+                                                 gint segment,
+                                                 gboolean segment_enabled,
+                                                 gboolean adhesion,
+                                                 gint adhesion_segment,
+                                                 gint baseline_segment,
+                                                 gdouble adhesion_range,
+                                                 gint adhesion_index,
+                                                 gdouble from,
+                                                 gdouble to,
+                                                 gdouble *retparam,
+                                                 gboolean *fix,
+                                                 GArray *xf,
+                                                 GArray *yf);
 static void             do_fdestimate           (const gdouble *xdata,
                                                  const gdouble *ydata,
                                                  gint ndata,
@@ -282,7 +299,8 @@ fdfit(GwyContainer *data, GwyRunType runtype)
             goto end;
     }
     if (outcome != GWY_DIALOG_HAVE_RESULT) {
-        execute(&args, gwy_app_find_window_for_curve_map(data, id));
+        if (!execute(&args, gwy_app_find_window_for_curve_map(data, id)))
+            goto end;
 
         preset = gwy_inventory_get_item(gwy_fd_curve_presets(),
                                         gwy_params_get_string(args.params, PARAM_FUNCTION));
@@ -808,7 +826,7 @@ preview(gpointer user_data)
     gwy_selection_set_data(gui->graph_selection, 1, sel);
 }
 
-static void
+static gboolean
 execute(ModuleArgs *args, GtkWindow *window)
 {
     GwyParams *params = args->params;
@@ -832,13 +850,14 @@ execute(ModuleArgs *args, GtkWindow *window)
     gdouble **rdata, *mdata;
     gdouble *inits;
     gint xres = gwy_lawn_get_xres(lawn), yres = gwy_lawn_get_yres(lawn);
-    gboolean fitok;
-
-    gint nsegments = gwy_lawn_get_n_segments(lawn);
-    gint *segments = g_new(gint, 2*nsegments);
+    gboolean *fitok;
+    GArray *xf, *yf;
+    guint *offsets;
+    gdouble *fitparams;
 
     const gdouble *cd, *cdx, *cdy;
     gint ndata, i, j, k, col, row;
+    gboolean ok;
 
     rdata = g_new(gdouble*, nparams);
     inits = g_new(gdouble, nparams);
@@ -863,40 +882,69 @@ execute(ModuleArgs *args, GtkWindow *window)
 
     gwy_app_wait_start(window, _("Fitting..."));
 
+    /* Gather the points to fit and initial parameters for all curves first; then fit them all at once in parallel.
+     * Without estimation, each curve starts from the result of the previous one, as in the single-curve fit. */
+    xf = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    yf = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    offsets = g_new(guint, xres*yres + 1);
+    fitparams = g_new(gdouble, xres*yres*nparams);
+    offsets[0] = 0;
     for (k = 0; k < xres*yres; k++) {
-        if (!gwy_app_wait_set_fraction((gdouble)k/(xres*yres)))
-            break;//what would happen next?
-
         col = k % xres;
         row = k/xres;
-        gwy_assign(segments, gwy_lawn_get_segments(lawn, col, row, NULL), 2*nsegments);
 
         cd = gwy_lawn_get_curves_data_const(lawn, col, row, &ndata);
         cdx = cd + ndata*abscissa;
         cdy = cd + ndata*ordinate;
 
-        if (estimate) 
+        if (estimate)
             do_fdestimate(cdx, cdy, ndata, preset,
                           gwy_lawn_get_segments(lawn, col, row, NULL),
                           segment, segment_enabled,
                           from, to, inits);
 
-        do_fdfit(cdx, cdy, ndata, preset,
-                 gwy_lawn_get_segments(lawn, col, row, NULL),
-                 segment, segment_enabled,
-                 adhesion, adhesion_segment, baseline_segment, baseline_range,
-                 args->adhesion_index,
-                 from, to, inits,
-                 args->param_fixed,
-                 NULL,
-                 &fitok);
-
-        for (j = 0; j < nparams; j++)
-             rdata[j][k] = inits[j];
+        gwy_assign(fitparams + k*nparams, inits, nparams);
+        offsets[k+1] = offsets[k] + prepare_fit_data(cdx, cdy, ndata,
+                                                     gwy_lawn_get_segments(lawn, col, row, NULL),
+                                                     segment, segment_enabled,
+                                                     adhesion, adhesion_segment, baseline_segment, baseline_range,
+                                                     args->adhesion_index,
+                                                     from, to, fitparams + k*nparams,
+                                                     args->param_fixed,
+                                                     xf, yf);
+    }
 
-        if (!fitok) mdata[k] = 1.0;
+    fitok = g_new(gboolean, xres*yres);
+    ok = gwy_nlfit_preset_fit_batch(preset, xres*yres, 0, offsets,
+                                    &g_array_index(xf, gdouble, 0), &g_array_index(yf, gdouble, 0),
+                                    fitparams, NULL, args->param_fixed, !estimate, NULL, fitok,
+                                    gwy_app_wait_set_fraction);
+
+    if (ok) {
+        for (k = 0; k < xres*yres; k++) {
+            for (j = 0; j < nparams; j++)
+                rdata[j][k] = fitparams[k*nparams + j];
+            if (!fitok[k])
+                mdata[k] = 1.0;
+        }
     }
 
+    g_array_free(xf, TRUE);
+    g_array_free(yf, TRUE);
+    g_free(offsets);
+    g_free(fitparams);
+    g_free(fitok);
+    g_free(rdata);
+    g_free(inits);
+
+    if (!ok) {
+        gwy_app_wait_finish();
+        for (i = 0; i < nparams; i++)
+            g_object_unref(args->result[i]);
+        GWY_FREE(args->result);
+        GWY_OBJECT_UNREF(args->mask);
+        return FALSE;
+    }
 
     for (i = 0; i < nparams; i++) {
         if (gwy_data_field_get_max(args->mask) > 0.0)
@@ -905,8 +953,7 @@ execute(ModuleArgs *args, GtkWindow *window)
 
     gwy_app_wait_finish();
 
-    g_free(inits);
-    g_free(segments);
+    return TRUE;
 }
 
 static void
@@ -996,21 +1043,20 @@ do_fdestimate(const gdouble *xdata, const gdouble *ydata,
     g_free(yf);
 }
 
-static void
-do_fdfit(const gdouble *xdata, const gdouble *ydata,
-         gint ndata, GwyNLFitPreset *preset,
-         const gint *segments,
-         gint segment, gboolean segment_enabled,
-         gboolean use_adhesion, gint adhesion_segment, gint baseline_segment, gdouble baseline_range,
-         gint adhesion_index,
-         gdouble from, gdouble to,
-         gdouble *fitparams, gboolean *fix, gdouble *error,
-         gboolean *fitok)
+/* Estimates adhesion if requested and appends the points to fit to @xf and @yf.  Returns the number of points. */
+static gint
+prepare_fit_data(const gdouble *xdata, const gdouble *ydata,
+                 gint ndata,
+                 const gint *segments,
+                 gint segment, gboolean segment_enabled,
+                 gboolean use_adhesion, gint adhesion_segment, gint baseline_segment, gdouble baseline_range,
+                 gint adhesion_index,
+                 gdouble from, gdouble to,
+                 gdouble *fitparams, gboolean *fix,
+                 GArray *xf, GArray *yf)
 {
-    gint i, j, n;
+    gint i, n;
     gdouble startval, endval, xmin, xmax, ymin, ymax;
-    gdouble *xf, *yf;
-    GwyNLFitter *fitter;
     gint segment_from, segment_to;
     gint baseline_from, baseline_to, adhesion_from, adhesion_to, nbaseline;
     gdouble bfrom, bto;
@@ -1093,43 +1139,53 @@ do_fdfit(const gdouble *xdata, const gdouble *ydata,
 
     }
 
-    //determine number of points to fit
-    n = 0;
-    for (i = 0; i < ndata; i++) {
-        if (xdata[i] >= startval && xdata[i] < endval
-            && i >= segment_from && i < segment_to)
-                n++;
-    }
-
     //fill the data to fit
-    xf = g_new(gdouble, n);
-    yf = g_new(gdouble, n);
-    j = 0;
+    n = 0;
     for (i = 0; i < ndata; i++) {
         if (xdata[i] >= startval && xdata[i] < endval
             && i >= segment_from && i < segment_to) {
-            xf[j] = xdata[i];
-            yf[j] = ydata[i];
-            j++;
+            g_array_append_val(xf, xdata[i]);
+            g_array_append_val(yf, ydata[i]);
+            n++;
         }
     }
 
+    return n;
+}
+
+static void
+do_fdfit(const gdouble *xdata, const gdouble *ydata,
+         gint ndata, GwyNLFitPreset *preset,
+         const gint *segments,
+         gint segment, gboolean segment_enabled,
+         gboolean use_adhesion, gint adhesion_segment, gint baseline_segment, gdouble baseline_range,
+         gint adhesion_index,
+         gdouble from, gdouble to,
+         gdouble *fitparams, gboolean *fix, gdouble *error,
+         gboolean *fitok)
+{
+    GArray *xf = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    GArray *yf = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    GwyNLFitter *fitter;
+    gint n;
+
+    n = prepare_fit_data(xdata, ydata, ndata, segments, segment, segment_enabled,
+                         use_adhesion, adhesion_segment, baseline_segment, baseline_range, adhesion_index,
+                         from, to, fitparams, fix, xf, yf);
+
     fitter = gwy_nlfit_preset_fit(preset,
                                   NULL,
                                   n,
-                                  xf,
-                                  yf,
+                                  &g_array_index(xf, gdouble, 0),
+                                  &g_array_index(yf, gdouble, 0),
                                   fitparams,
                                   error,
                                   fix);
 
     *fitok = gwy_math_nlfit_succeeded(fitter);
 
-    //if (error)
-    //    printf("err: %g %g %g %g\n", error[0], error[1], error[2], error[3]);
-
-    g_free(xf);
-    g_free(yf);
+    g_array_free(xf, TRUE);
+    g_array_free(yf, TRUE);
     gwy_math_nlfit_free(fitter);
 }
 
@@ -44,6 +44,7 @@
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyascii.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <app/gwymoduleutils-file.h>
 #include <app/data-browser.h>
@@ -224,11 +225,10 @@ acii_load(const gchar *filename,
     }
 
     data = gwy_data_field_get_data(dfield);
-    value = p;
-    for (i = 0; i < xres*yres; i++) {
-        data[i] = q*g_ascii_strtod(value, &p);
-        value = p;
-    }
+    /* Missing values are read as zeros, for compatibility. */
+    i = gwy_str_to_doubles(p, xres*yres, data, NULL);
+    gwy_clear(data + i, xres*yres - i);
+    gwy_data_field_multiply(dfield, q);
 
     container = gwy_container_new();
 
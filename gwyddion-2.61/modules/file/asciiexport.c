@@ -41,6 +41,7 @@
 #include <gtk/gtk.h>
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyascii.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <libprocess/datafield.h>
 #include <libgwydgets/gwydgetutils.h>
@@ -50,6 +51,11 @@
 
 #define EXTENSION ".txt"
 
+enum {
+    /* Enough digits to always read back as the same number. */
+    PRECISION_EXACT = 17,
+};
+
 typedef struct {
     gboolean add_comment;
     gboolean decimal_dot;
@@ -77,6 +83,11 @@ static gboolean export_one_channel       (GwyContainer *data,
                                           const ASCIIExportArgs *args,
                                           const DecimalDotInfo *decinfo,
                                           FILE *fh);
+static gboolean export_exact             (const gdouble *d,
+                                          gint xres,
+                                          gint yres,
+                                          const gchar *decimal_dot,
+                                          FILE *fh);
 static void     fill_decimal_dot_info    (DecimalDotInfo *info);
 static void     asciiexport_load_args    (GwyContainer *settings,
                                           ASCIIExportArgs *args);
@@ -92,7 +103,7 @@ static GwyModuleInfo module_info = {
     &module_register,
     N_("Exports data as simple ASCII matrix."),
     "Yeti <yeti@gwyddion.net>",
-    "1.5",
+    "1.6",
     "David Nečas (Yeti)",
     "2004",
 };
@@ -258,8 +269,11 @@ asciiexport_export_dialog(ASCIIExportArgs *args,
 
     label = gtk_label_new_with_mnemonic(_("_Precision:"));
     gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
-    precision = gtk_spin_button_new_with_range(0, 16, 1);
+    precision = gtk_spin_button_new_with_range(0, PRECISION_EXACT, 1);
     gtk_spin_button_set_value(GTK_SPIN_BUTTON(precision), args->precision);
+    gtk_widget_set_tooltip_text(precision,
+                                _("The maximum precision writes numbers which "
+                                  "read back exactly."));
     gtk_label_set_mnemonic_widget(GTK_LABEL(label), precision);
     gtk_box_pack_start(GTK_BOX(hbox), precision, FALSE, FALSE, 0);
 
@@ -350,6 +364,13 @@ export_one_channel(GwyContainer *data, gint id,
         gwy_si_unit_value_format_free(vf);
     }
 
+    if (args->precision >= PRECISION_EXACT) {
+        return export_exact(d, xres, yres,
+                            (decinfo->needs_decimal_dot && !args->decimal_dot
+                             ? decinfo->decimal_dot : NULL),
+                            fh);
+    }
+
     if (decinfo->needs_decimal_dot && args->decimal_dot) {
         for (i = 0; i < xres*yres; i++) {
             g_snprintf(buf, sizeof(buf), "%.*g%c",
@@ -372,6 +393,40 @@ export_one_channel(GwyContainer *data, gint id,
     return TRUE;
 }
 
+/* Formats values using gwy_double_to_str() which is much faster than printf()
+ * and does not lose any precision.  Whole rows are written at once. */
+static gboolean
+export_exact(const gdouble *d, gint xres, gint yres,
+             const gchar *decimal_dot, FILE *fh)
+{
+    gchar buf[GWY_DOUBLE_STR_BUF_SIZE];
+    GString *str;
+    gchar *pos;
+    gint i, j;
+    guint len;
+    gboolean ok = TRUE;
+
+    str = g_string_new(NULL);
+    for (i = 0; i < yres && ok; i++) {
+        g_string_truncate(str, 0);
+        for (j = 0; j < xres; j++) {
+            len = gwy_double_to_str(d[i*xres + j], buf);
+            if (decimal_dot && (pos = strchr(buf, '.'))) {
+                g_string_append_len(str, buf, pos - buf);
+                g_string_append(str, decimal_dot);
+                g_string_append(str, pos + 1);
+            }
+            else
+                g_string_append_len(str, buf, len);
+            g_string_append_c(str, j == xres-1 ? '\n' : '\t');
+        }
+        ok = (fwrite(str->str, 1, str->len, fh) == str->len);
+    }
+    g_string_free(str, TRUE);
+
+    return ok;
+}
+
 static void
 fill_decimal_dot_info(DecimalDotInfo *info)
 {
@@ -409,7 +464,7 @@ asciiexport_load_args(GwyContainer *settings,
                                       &args->add_comment);
     gwy_container_gis_int32_by_name(settings, precision_key, &args->precision);
 
-    args->precision = MIN(args->precision, 16);
+    args->precision = MIN(args->precision, PRECISION_EXACT);
 }
 
 static void
@@ -133,6 +133,31 @@ err_DIMENSION(GError **error, gint dim)
     return TRUE;
 }
 
+/* Checks the number of values read by gwy_str_to_doubles() and sets the error
+ * if some are missing.  Pass the end pointer gwy_str_to_doubles() returned. */
+static inline gboolean
+err_DATA_VALUES(GError **error, const gchar *end,
+                guint nread, guint expected)
+{
+    if (nread >= expected)
+        return FALSE;
+
+    while (g_ascii_isspace(*end))
+        end++;
+    if (*end) {
+        g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
+                    _("Malformed data encountered when reading sample "
+                      "#%d of %d"),
+                    nread, expected);
+    }
+    else {
+        g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
+                    _("End of file reached when reading sample #%d of %d"),
+                    nread, expected);
+    }
+    return TRUE;
+}
+
 static inline void
 err_BPP(GError **error, gint bpp)
 {
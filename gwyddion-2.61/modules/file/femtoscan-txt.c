@@ -48,6 +48,7 @@
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyascii.h>
 #include <libprocess/stats.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <app/gwymoduleutils-file.h>
@@ -119,7 +120,7 @@ read_values(GArray *values, gchar *p)
         gchar *end;
         gdouble v;
 
-        v = g_ascii_strtod(p, &end);
+        v = gwy_str_to_double(p, &end);
         if (end == p)
             return values->len - oldlen;
         g_array_append_val(values, v);
@@ -182,7 +183,7 @@ femto_load(const gchar *filename,
                 break;
         }
 
-        v = g_ascii_strtod(line, &end);
+        v = gwy_str_to_double(line, &end);
         if (end == line) {
             g_set_error(error, GWY_MODULE_FILE_ERROR,
                         GWY_MODULE_FILE_ERROR_DATA,
@@ -52,6 +52,9 @@
 #include <string.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -59,8 +62,13 @@
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwyutils.h>
 #include <libprocess/datafield.h>
+#include <libprocess/brick.h>
+#include <libdraw/gwyrgba.h>
 #include <libdraw/gwyselection.h>
 #include <libgwymodule/gwymodule-file.h>
+#include <app/settings.h>
+#include <app/data-browser.h>
+#include <app/gwymoduleutils-file.h>
 
 #include "err.h"
 
@@ -69,10 +77,18 @@
 #define MAGIC2 "GWYP"
 #define MAGIC_SIZE (sizeof(MAGIC)-1)
 
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
 /* The container prefix all graph reside in.  This is a bit silly but it does
  * not worth to break file compatibility with 1.x. */
 #define GRAPH_PREFIX "/0/graph/graph"
 
+/* Saved files can contain a reduced copy of one channel for previews. */
+#define THUMBNAIL_KEY "/thumbnail"
+#define THUMBNAIL_SIZE 256
+
 typedef struct {
     GArray *map;   /* data numbers in container, map plain position -> id */
     gint len;   /* length of reverse map @rmap */
@@ -81,16 +97,27 @@ typedef struct {
     GString *str;   /* scratch space */
 } CompressIdData;
 
+typedef struct {
+    const gchar *key;   /* item key, pointing into the buffer */
+    guchar ctype;   /* serialized item type */
+    gsize pos;   /* position of the value in the buffer */
+    gsize size;   /* size of the serialized value */
+} GwyFileItem;
+
 static gboolean      module_register         (void);
 static gint          gwyfile_detect          (const GwyFileDetectInfo *fileinfo,
                                               gboolean only_name);
 static GwyContainer* gwyfile_load            (const gchar *filename,
                                               GwyRunType mode,
                                               GError **error);
+static GwyContainer* gwyfile_load_preview    (const gchar *filename,
+                                              GwyRunType mode,
+                                              GError **error);
 static gboolean      gwyfile_save            (GwyContainer *data,
                                               const gchar *filename,
                                               GwyRunType mode,
                                               GError **error);
+static gchar*        gwyfile_resolve_symlinks(const gchar *filename);
 static void          gwyfile_pack_metadata   (GwyContainer *data);
 static void          gwyfile_remove_old_data (GObject *object);
 static GObject*      gwy_container_deserialize_old (const guchar *buffer,
@@ -103,7 +130,7 @@ static GwyModuleInfo module_info = {
     &module_register,
     N_("Loads and saves Gwyddion native data files (serialized objects)."),
     "Yeti <yeti@gwyddion.net>",
-    "0.18",
+    "0.20",
     "David Nečas (Yeti) & Petr Klapetek",
     "2003",
 };
@@ -119,6 +146,8 @@ module_register(void)
                            (GwyFileLoadFunc)&gwyfile_load,
                            (GwyFileSaveFunc)&gwyfile_save,
                            NULL);
+    gwy_file_func_set_preview("gwyfile",
+                              (GwyFileLoadFunc)&gwyfile_load_preview);
 
     return TRUE;
 }
@@ -140,27 +169,67 @@ gwyfile_detect(const GwyFileDetectInfo *fileinfo,
     return score;
 }
 
+/* Zero-copy loading keeps the file mapped while the data exist, which means
+ * it must not be modified in place by other programs meanwhile.  Therefore,
+ * it is only enabled on request.
+ *
+ * We never modify it in place either; gwyfile_save() replaces it by rename.
+ * On POSIX systems the mapping keeps the old file alive.  On Windows a mapped
+ * file cannot be replaced, so the borrowed arrays are copied first when a
+ * container is saved over the file it was mapped from. */
+static gboolean
+gwyfile_use_zero_copy(void)
+{
+    gboolean zero_copy = FALSE;
+
+    gwy_container_gis_boolean_by_name(gwy_app_settings_get(), "/module/gwyfile/zero_copy", &zero_copy);
+    return zero_copy;
+}
+
+/* The container qdata holding the name of the file its arrays may be mapped
+ * from. */
+static GQuark
+gwyfile_mapped_quark(void)
+{
+    static GQuark quark = 0;
+
+    if (!quark)
+        quark = g_quark_from_static_string("gwy-gwyfile-mapped-from");
+    return quark;
+}
+
 static GwyContainer*
 gwyfile_load(const gchar *filename,
              G_GNUC_UNUSED GwyRunType mode,
              GError **error)
 {
     GwyContainer *container;
+    GMappedFile *mfile;
     GObject *object;
     GError *err = NULL;
     guchar *buffer = NULL;
     gsize size = 0;
     gsize pos = 0;
-
-    if (!gwy_file_get_contents(filename, &buffer, &size, &err)) {
-        err_GET_FILE_CONTENTS(error, &err);
-        return NULL;
+    gboolean zero_copy;
+
+    /* In the zero-copy mode large data arrays keep pointing to the mapping.
+     * A writable GMappedFile is private, i.e. copy-on-write.  It requires a
+     * file we can open for writing though. */
+    zero_copy = gwyfile_use_zero_copy();
+    if (!zero_copy || !(mfile = g_mapped_file_new(filename, TRUE, NULL))) {
+        zero_copy = FALSE;
+        if (!(mfile = g_mapped_file_new(filename, FALSE, &err))) {
+            err_GET_FILE_CONTENTS(error, &err);
+            return NULL;
+        }
     }
+    buffer = (guchar*)g_mapped_file_get_contents(mfile);
+    size = g_mapped_file_get_length(mfile);
     if (size < MAGIC_SIZE
         || (memcmp(buffer, MAGIC, MAGIC_SIZE)
             && memcmp(buffer, MAGIC2, MAGIC_SIZE))) {
         err_FILE_TYPE(error, "Gwyddion");
-        gwy_file_abandon_contents(buffer, size, &err);
+        g_mapped_file_unref(mfile);
         return NULL;
     }
 
@@ -169,11 +238,20 @@ gwyfile_load(const gchar *filename,
                                                size - MAGIC_SIZE, &pos);
         gwyfile_remove_old_data(object);
     }
+    else if (zero_copy) {
+        pos = MAGIC_SIZE;
+        object = gwy_serializable_deserialize_mapped(mfile, &pos);
+        if (object) {
+            g_object_set_qdata_full(object, gwyfile_mapped_quark(),
+                                    gwyfile_resolve_symlinks(filename),
+                                    g_free);
+        }
+    }
     else
         object = gwy_serializable_deserialize(buffer + MAGIC_SIZE,
                                               size - MAGIC_SIZE, &pos);
 
-    gwy_file_abandon_contents(buffer, size, &err);
+    g_mapped_file_unref(mfile);
     if (!object) {
         g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
                     _("Data deserialization failed."));
@@ -192,18 +270,426 @@ gwyfile_load(const gchar *filename,
 
     /* Make sure that if there is "/filename" it is set by the app. */
     gwy_container_remove_by_name(container, "/filename");
+    /* The embedded thumbnail is only for previews. */
+    gwy_container_remove_by_name(container, THUMBNAIL_KEY);
+
+    return container;
+}
+
+/* Find the positions of top-level items of a serialized container without
+ * deserializing them.  Objects are skipped using their sizes, so the pages
+ * holding large data arrays of a mapped file are never even read. */
+static GArray*
+gwyfile_skim_container(const guchar *buffer, gsize size)
+{
+    GwyFileItem item;
+    GArray *items;
+    const guchar *p;
+    gsize pos, end, len, objsize;
+
+    if (!size
+        || !(pos = gwy_serialize_check_string(buffer, size, 0,
+                                              "GwyContainer"))
+        || size - pos < sizeof(guint32))
+        return NULL;
+
+    p = buffer + pos;
+    objsize = gwy_get_guint32_le(&p);
+    pos += sizeof(guint32);
+    if (objsize > size - pos)
+        return NULL;
+    end = pos + objsize;
+
+    items = g_array_new(FALSE, FALSE, sizeof(GwyFileItem));
+    while (pos < end) {
+        if (!(len = gwy_serialize_check_string(buffer, end, pos, NULL))
+            || end - pos <= len)
+            goto fail;
+        item.key = (const gchar*)buffer + pos;
+        pos += len;
+        item.ctype = buffer[pos++];
+        item.pos = pos;
+        len = 0;
+        if (item.ctype == 'b' || item.ctype == 'c')
+            len = 1;
+        else if (item.ctype == 'i')
+            len = sizeof(gint32);
+        else if (item.ctype == 'q' || item.ctype == 'd')
+            len = sizeof(gint64);
+        else if (item.ctype == 's' && pos < end)
+            len = gwy_serialize_check_string(buffer, end, pos, NULL);
+        else if (item.ctype == 'o' && pos < end
+                 && (len = gwy_serialize_check_string(buffer, end, pos, NULL))
+                 && end - pos - len >= sizeof(guint32)) {
+            p = buffer + pos + len;
+            objsize = gwy_get_guint32_le(&p);
+            len += sizeof(guint32);
+            len = (objsize <= end - pos - len) ? len + objsize : 0;
+        }
+        if (!len || len > end - pos)
+            goto fail;
+        item.size = len;
+        pos += len;
+        g_array_append_val(items, item);
+    }
+
+    return items;
+
+fail:
+    g_array_free(items, TRUE);
+    return NULL;
+}
+
+static void
+gwyfile_set_skimmed_item(GwyContainer *container,
+                         const guchar *buffer,
+                         const GwyFileItem *item)
+{
+    GQuark quark = g_quark_from_string(item->key);
+    const guchar *p = buffer + item->pos;
+    GObject *object;
+    gsize pos = 0;
+
+    if (item->ctype == 'b')
+        gwy_container_set_boolean(container, quark, !!*p);
+    else if (item->ctype == 'c')
+        gwy_container_set_uchar(container, quark, *p);
+    else if (item->ctype == 'i')
+        gwy_container_set_int32(container, quark, gwy_get_gint32_le(&p));
+    else if (item->ctype == 'q')
+        gwy_container_set_int64(container, quark, gwy_get_gint64_le(&p));
+    else if (item->ctype == 'd')
+        gwy_container_set_double(container, quark, gwy_get_gdouble_le(&p));
+    else if (item->ctype == 's')
+        gwy_container_set_const_string(container, quark, p);
+    else if (item->ctype == 'o'
+             && (object = gwy_serializable_deserialize(p, item->size, &pos))) {
+        gwy_container_set_object(container, quark, object);
+        g_object_unref(object);
+    }
+}
+
+/* Return channel id if @key is "/ID/@suffix", otherwise -1. */
+static gint
+gwyfile_parse_channel_key(const gchar *key, const gchar *suffix)
+{
+    const gchar *s;
+    gint id = 0;
+
+    if (key[0] != '/' || !g_ascii_isdigit(key[1]))
+        return -1;
+    for (s = key+1; g_ascii_isdigit(*s); s++) {
+        if (id > G_MAXINT/10 - 1)
+            return -1;
+        id = 10*id + (*s - '0');
+    }
+    return (*s == '/' && gwy_strequal(s+1, suffix)) ? id : -1;
+}
+
+/* Load only what is needed for a preview: the embedded thumbnail if there is
+ * one, or a single channel with its mask, presentation and display settings.
+ * Other data, which can be much larger, are skipped without reading. */
+static GwyContainer*
+gwyfile_load_preview(const gchar *filename,
+                     GwyRunType mode,
+                     GError **error)
+{
+    GwyContainer *container = NULL;
+    GMappedFile *mfile;
+    GObject *object;
+    GArray *items;
+    const GwyFileItem *item;
+    GError *err = NULL;
+    const guchar *buffer;
+    gchar *prefix;
+    gsize size, pos, prefix_len;
+    gint id = -1, visible_id = -1, itemid;
+    guint i;
+    gboolean have_visible_data = FALSE;
+
+    if (!(mfile = g_mapped_file_new(filename, FALSE, &err))) {
+        err_GET_FILE_CONTENTS(error, &err);
+        return NULL;
+    }
+    buffer = (const guchar*)g_mapped_file_get_contents(mfile);
+    size = g_mapped_file_get_length(mfile);
+    /* Old-style files and anything we cannot make sense of go through the
+     * normal loader which also reports errors properly. */
+    if (size < MAGIC_SIZE || memcmp(buffer, MAGIC2, MAGIC_SIZE)
+        || !(items = gwyfile_skim_container(buffer + MAGIC_SIZE,
+                                            size - MAGIC_SIZE))) {
+        g_mapped_file_unref(mfile);
+        return gwyfile_load(filename, mode, error);
+    }
+    buffer += MAGIC_SIZE;
+
+    for (i = 0; i < items->len; i++) {
+        item = &g_array_index(items, GwyFileItem, i);
+        if (item->ctype == 'o' && gwy_strequal(item->key, THUMBNAIL_KEY)) {
+            pos = 0;
+            object = gwy_serializable_deserialize(buffer + item->pos,
+                                                  item->size, &pos);
+            if (object && GWY_IS_CONTAINER(object)) {
+                container = GWY_CONTAINER(object);
+                goto end;
+            }
+            GWY_OBJECT_UNREF(object);
+        }
+    }
+
+    /* Choose the same channel gwyfile_save() would make a thumbnail of. */
+    for (i = 0; i < items->len; i++) {
+        item = &g_array_index(items, GwyFileItem, i);
+        if (item->ctype == 'o'
+            && (itemid = gwyfile_parse_channel_key(item->key, "data")) >= 0
+            && (id < 0 || itemid < id))
+            id = itemid;
+        if (item->ctype == 'b'
+            && buffer[item->pos]
+            && (itemid = gwyfile_parse_channel_key(item->key,
+                                                   "data/visible")) >= 0
+            && (visible_id < 0 || itemid < visible_id))
+            visible_id = itemid;
+    }
+    for (i = 0; visible_id >= 0 && i < items->len; i++) {
+        item = &g_array_index(items, GwyFileItem, i);
+        if (item->ctype == 'o'
+            && gwyfile_parse_channel_key(item->key, "data") == visible_id)
+            have_visible_data = TRUE;
+    }
+    if (have_visible_data)
+        id = visible_id;
+
+    container = gwy_container_new();
+    if (id < 0)
+        goto end;
+
+    prefix = g_strdup_printf("/%d/", id);
+    prefix_len = strlen(prefix);
+    for (i = 0; i < items->len; i++) {
+        item = &g_array_index(items, GwyFileItem, i);
+        if (strncmp(item->key, prefix, prefix_len))
+            continue;
+        if (item->ctype != 'o'
+            || gwy_strequal(item->key + prefix_len, "data")
+            || gwy_strequal(item->key + prefix_len, "mask")
+            || gwy_strequal(item->key + prefix_len, "show"))
+            gwyfile_set_skimmed_item(container, buffer, item);
+    }
+    g_free(prefix);
+
+end:
+    g_array_free(items, TRUE);
+    g_mapped_file_unref(mfile);
 
     return container;
 }
 
+static gboolean
+gwyfile_use_thumbnail(void)
+{
+    gboolean embed_thumbnail = TRUE;
+
+    gwy_container_gis_boolean_by_name(gwy_app_settings_get(), "/module/gwyfile/embed_thumbnail", &embed_thumbnail);
+    return embed_thumbnail;
+}
+
+/* Create a reduced copy of the channel a file preview would show, i.e. the
+ * first visible channel or just the first one.  Returns %NULL if the data are
+ * small enough to be used directly. */
+static GwyContainer*
+gwyfile_make_thumbnail(GwyContainer *data)
+{
+    static const gchar *const fields[] = { "data", "mask", "show" };
+    GwyContainer *thumbnail;
+    GwyDataField *dfield, *field;
+    GwyRGBA rgba;
+    const guchar *title;
+    gchar key[48];
+    gint *ids;
+    gint i, id = -1, visible_id = -1, xres, yres, txres, tyres;
+    gboolean visible;
+    gdouble q;
+
+    ids = gwy_app_data_browser_get_data_ids(data);
+    for (i = 0; ids[i] >= 0; i++) {
+        visible = FALSE;
+        g_snprintf(key, sizeof(key), "/%d/data/visible", ids[i]);
+        gwy_container_gis_boolean_by_name(data, key, &visible);
+        if (visible && (visible_id < 0 || ids[i] < visible_id))
+            visible_id = ids[i];
+        if (id < 0 || ids[i] < id)
+            id = ids[i];
+    }
+    g_free(ids);
+    if (visible_id >= 0)
+        id = visible_id;
+    if (id < 0)
+        return NULL;
+
+    dfield = gwy_container_get_object(data, gwy_app_get_data_key_for_id(id));
+    xres = gwy_data_field_get_xres(dfield);
+    yres = gwy_data_field_get_yres(dfield);
+    if (xres <= THUMBNAIL_SIZE && yres <= THUMBNAIL_SIZE)
+        return NULL;
+
+    q = (gdouble)THUMBNAIL_SIZE/MAX(xres, yres);
+    txres = CLAMP(GWY_ROUND(q*xres), 1, THUMBNAIL_SIZE);
+    tyres = CLAMP(GWY_ROUND(q*yres), 1, THUMBNAIL_SIZE);
+
+    thumbnail = gwy_container_new();
+    for (i = 0; i < G_N_ELEMENTS(fields); i++) {
+        g_snprintf(key, sizeof(key), "/%d/%s", id, fields[i]);
+        if (!gwy_container_gis_object_by_name(data, key, &field)
+            || !GWY_IS_DATA_FIELD(field)
+            || gwy_data_field_get_xres(field) != xres
+            || gwy_data_field_get_yres(field) != yres)
+            continue;
+        field = gwy_data_field_new_downsampled(field, txres, tyres);
+        gwy_container_set_object_by_name(thumbnail, key, field);
+        g_object_unref(field);
+    }
+
+    g_snprintf(key, sizeof(key), "/%d/base", id);
+    gwy_container_transfer(data, thumbnail, key, key, TRUE);
+    g_snprintf(key, sizeof(key), "/%d/mask", id);
+    if (gwy_rgba_get_from_container(&rgba, data, key))
+        gwy_rgba_store_to_container(&rgba, thumbnail, key);
+    if (gwy_container_gis_string(data, gwy_app_get_data_title_key_for_id(id),
+                                 &title)) {
+        gwy_container_set_const_string(thumbnail,
+                                       gwy_app_get_data_title_key_for_id(id),
+                                       title);
+    }
+    g_snprintf(key, sizeof(key), "/%d/data/visible", id);
+    gwy_container_set_boolean_by_name(thumbnail, key, TRUE);
+    gwy_container_set_int32_by_name(thumbnail, "/preview/xres", xres);
+    gwy_container_set_int32_by_name(thumbnail, "/preview/yres", yres);
+
+    return thumbnail;
+}
+
+/* Find the file we are really going to write to.  Symlinks must be kept and
+ * the file they point to replaced. */
+static gchar*
+gwyfile_resolve_symlinks(const gchar *filename)
+{
+    gchar *path = g_strdup(filename), *target, *dirname;
+    gint i;
+
+    for (i = 0; i < 16 && g_file_test(path, G_FILE_TEST_IS_SYMLINK); i++) {
+        if (!(target = g_file_read_link(path, NULL)))
+            break;
+        if (g_path_is_absolute(target)) {
+            g_free(path);
+            path = target;
+        }
+        else {
+            dirname = g_path_get_dirname(path);
+            g_free(path);
+            path = g_build_filename(dirname, target, NULL);
+            g_free(dirname);
+            g_free(target);
+        }
+    }
+
+    return path;
+}
+
+/* Create a new file next to @filename for atomic saving.  If it is not
+ * possible (e.g. the directory is not writable), fail.  Writing @filename
+ * directly would destroy the original on failure and could truncate a file
+ * mapped by gwyfile_load(). */
+static FILE*
+gwyfile_open_temporary(const gchar *filename, gchar **tmpname)
+{
+    GStatBuf st;
+    FILE *fh;
+    gint fd, i;
+
+    *tmpname = NULL;
+    for (i = 0; i < 8; i++) {
+        *tmpname = g_strdup_printf("%s.%08x.tmp", filename, g_random_int());
+        fd = g_open(*tmpname, O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0666);
+        if (fd != -1)
+            break;
+        GWY_FREE(*tmpname);
+        if (errno != EEXIST)
+            break;
+    }
+    if (!*tmpname)
+        return NULL;
+
+    /* Keep permissions of the file we are going to replace. */
+    if (g_stat(filename, &st) == 0)
+        g_chmod(*tmpname, st.st_mode & 07777);
+
+    if (!(fh = fdopen(fd, "wb"))) {
+        close(fd);
+        g_unlink(*tmpname);
+        GWY_FREE(*tmpname);
+    }
+
+    return fh;
+}
+
+#ifdef G_OS_WIN32
+static void
+gwyfile_copy_borrowed(G_GNUC_UNUSED gpointer key,
+                      gpointer pvalue,
+                      G_GNUC_UNUSED gpointer user_data)
+{
+    GValue *value = (GValue*)pvalue;
+    GObject *object;
+    GwyDataField *field;
+    GwyBrick *brick;
+
+    if (!G_VALUE_HOLDS_OBJECT(value))
+        return;
+
+    object = g_value_get_object(value);
+    /* Reallocation replaces borrowed arrays with allocated copies and does
+     * not change the others. */
+    if (GWY_IS_DATA_FIELD(object)) {
+        field = GWY_DATA_FIELD(object);
+        field->data = gwy_serialize_realloc_array(field->data,
+                                                  (gsize)field->xres
+                                                  *field->yres
+                                                  *sizeof(gdouble));
+    }
+    else if (GWY_IS_BRICK(object)) {
+        brick = GWY_BRICK(object);
+        brick->data = gwy_serialize_realloc_array(brick->data,
+                                                  (gsize)brick->xres
+                                                  *brick->yres*brick->zres
+                                                  *sizeof(gdouble));
+    }
+}
+
+/* If @data were loaded by mapping @target, copy all the borrowed arrays so
+ * that the file is released and can be replaced. */
+static void
+gwyfile_unmap_if_replacing(GwyContainer *data, const gchar *target)
+{
+    const gchar *mapped_from;
+
+    mapped_from = g_object_get_qdata(G_OBJECT(data), gwyfile_mapped_quark());
+    if (!mapped_from || !gwy_strequal(mapped_from, target))
+        return;
+
+    gwy_container_foreach(data, NULL, &gwyfile_copy_borrowed, NULL);
+    g_object_set_qdata(G_OBJECT(data), gwyfile_mapped_quark(), NULL);
+}
+#endif
+
 static gboolean
 gwyfile_save(GwyContainer *data,
              const gchar *filename,
              G_GNUC_UNUSED GwyRunType mode,
              GError **error)
 {
-    GByteArray *buffer;
-    gchar *filename_orig_utf8, *filename_utf8;
+    gchar *filename_orig_utf8, *filename_utf8, *target, *tmpname = NULL;
+    GwyContainer *thumbnail = NULL;
     FILE *fh;
     gboolean restore_filename, ok = TRUE;
 
@@ -226,29 +712,50 @@ gwyfile_save(GwyContainer *data,
         filename_utf8 = NULL;
     }
 
-    /* Serialize first.  If we get OOM and hard-abort here, at least keep any
-     * existing file intact. */
-    buffer = gwy_serializable_serialize(G_OBJECT(data), NULL);
-
-    /* Now actually write the file. */
-    if (!(fh = gwy_fopen(filename, "wb"))) {
+    /* Never save a stale thumbnail from elsewhere. */
+    gwy_container_remove_by_name(data, THUMBNAIL_KEY);
+    if (gwyfile_use_thumbnail()
+        && (thumbnail = gwyfile_make_thumbnail(data)))
+        gwy_container_set_object_by_name(data, THUMBNAIL_KEY, thumbnail);
+
+    /* Write to a temporary file and rename it over the target only when
+     * everything succeeds.  So if we fail or hard-abort in the middle, any
+     * existing file is kept intact.  This also keeps intact files which may
+     * be mapped by gwyfile_load(). */
+    target = gwyfile_resolve_symlinks(filename);
+    if (!(fh = gwyfile_open_temporary(target, &tmpname))) {
         err_OPEN_WRITE(error);
         ok = FALSE;
     }
     else {
         if (fwrite(MAGIC2, 1, MAGIC_SIZE, fh) != MAGIC_SIZE
-            || fwrite(buffer->data, 1, buffer->len, fh) != buffer->len) {
+            || !gwy_serializable_serialize_to_file(G_OBJECT(data), fh)) {
+            err_WRITE(error);
+            ok = FALSE;
+        }
+        if (fclose(fh) && ok) {
             err_WRITE(error);
             ok = FALSE;
-            g_unlink(filename);
         }
-        if (fclose(fh)) {
+#ifdef G_OS_WIN32
+        if (ok)
+            gwyfile_unmap_if_replacing(data, target);
+#endif
+        if (ok && g_rename(tmpname, target) != 0) {
             err_WRITE(error);
             ok = FALSE;
-            g_unlink(filename);
         }
+        /* Only ever remove the file we have created. */
+        if (!ok)
+            g_unlink(tmpname);
+    }
+    g_free(tmpname);
+    g_free(target);
+
+    if (thumbnail) {
+        gwy_container_remove_by_name(data, THUMBNAIL_KEY);
+        g_object_unref(thumbnail);
     }
-    g_byte_array_free(buffer, TRUE);
 
     /* Restore filename if save failed */
     if (!ok && restore_filename) {
@@ -17,8 +17,20 @@
 
 #include <glib.h>
 #include <libgwyddion/gwymacros.h>
+#include "libgwyddion/gwyomp.h"
 #include "get.h"
 
+/* Deflate and ZSTD decompression needs the corresponding libraries.  Modules which link them can enable the support by
+ * defining GWY_TIFF_WITH_ZLIB and GWY_TIFF_WITH_ZSTD before including this header. */
+#if defined(GWY_TIFF_WITH_ZLIB) && defined(HAVE_ZLIB)
+#include <zlib.h>
+#define GWY_TIFF_HAVE_DEFLATE 1
+#endif
+#if defined(GWY_TIFF_WITH_ZSTD) && defined(HAVE_ZSTD)
+#include <zstd.h>
+#define GWY_TIFF_HAVE_ZSTD 1
+#endif
+
 /*
  * This is a rudimentary built-in TIFF reader.
  *
@@ -122,14 +134,25 @@ typedef enum {
 
 /* Baseline readers are required to implement NONE, HUFFMAN and PACKBITS.
  * PACKBITS seems to be used in the wild occasionally.
- * HUFFMAN is only for bilevel images and can be probably ignored. */
+ * HUFFMAN is only for bilevel images and can be probably ignored.
+ * DEFLATE and ZSTD are common in large microscopy images (OME-TIFF).  DEFLATE_OLD is the obsolete code for the same
+ * compression. */
 typedef enum {
-    GWY_TIFF_COMPRESSION_NONE     = 1,
-    GWY_TIFF_COMPRESSION_HUFFMAN  = 2,
-    GWY_TIFF_COMPRESSION_LZW      = 5,
-    GWY_TIFF_COMPRESSION_PACKBITS = 32773,
+    GWY_TIFF_COMPRESSION_NONE        = 1,
+    GWY_TIFF_COMPRESSION_HUFFMAN     = 2,
+    GWY_TIFF_COMPRESSION_LZW         = 5,
+    GWY_TIFF_COMPRESSION_DEFLATE     = 8,
+    GWY_TIFF_COMPRESSION_PACKBITS    = 32773,
+    GWY_TIFF_COMPRESSION_DEFLATE_OLD = 32946,
+    GWY_TIFF_COMPRESSION_ZSTD        = 50000,
 } GwyTIFFCompression;
 
+typedef enum {
+    GWY_TIFF_PREDICTOR_NONE       = 1,
+    GWY_TIFF_PREDICTOR_HORIZONTAL = 2,
+    GWY_TIFF_PREDICTOR_FLOAT      = 3,
+} GwyTIFFPredictor;
+
 typedef enum {
     GWY_TIFF_ORIENTATION_TOPLEFT  = 1,
     GWY_TIFF_ORIENTATION_TOPRIGHT = 2,
@@ -198,6 +221,7 @@ typedef struct {
     gdouble (*get_gdouble)(const guchar **p);
     guint64 (*get_length)(const guchar **p);    /* 32bit, 64bit for BigTIFF */
     GwyTIFFVersion version;
+    guint byteorder;
     guint tagvaluesize;
     guint tagsize;
     guint ifdsize;
@@ -222,10 +246,11 @@ typedef struct {
     gdouble *rowbuf;
     guint sample_format;
     guint compression;
+    guint predictor;
     /* Decompression (keeping track of current state). */
     GwyTIFFUnpackFunc unpack_func;
-    guchar *unpacked;       /* Buffer for unpacking, large enough to hold one * strip or tile. */
-    guint64 which_unpacked; /* Which strip or tile we have in unpacked[]; G_MAXUINT64 means none. */
+    guchar *unpacked;       /* Buffer for unpacking, large enough to hold one strip or one row of tiles. */
+    guint64 which_unpacked; /* Which strip or row of tiles we have in unpacked[]; G_MAXUINT64 means none. */
 } GwyTIFFImageReader;
 
 /* Parameters version and byteorder are inout.  If they are non-zero, the file must match the specified value to be
@@ -296,6 +321,13 @@ err_TIFF_REQUIRED_TAG(GError **error, GwyTIFFTag tag)
     return NULL;
 }
 
+G_GNUC_UNUSED static void
+err_TIFF_DECOMPRESSION(GError **error)
+{
+    g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
+                _("Decompression of image data failed."));
+}
+
 static inline gboolean
 gwy_tiff_data_fits(const GwyTIFF *tiff,
                    guint64 offset,
@@ -461,6 +493,7 @@ gwy_tiff_load_impl(GwyTIFF *tiff,
         return FALSE;
     }
 
+    tiff->byteorder = byteorder;
     if (byteorder == G_LITTLE_ENDIAN) {
         tiff->get_guint16 = gwy_get_guint16_le;
         tiff->get_gint16 = gwy_get_gint16_le;
@@ -754,7 +787,7 @@ gwy_tiff_get_uints_entry(const GwyTIFF *tiff,
         return FALSE;
 
     if (size > tiff->tagvaluesize) {
-        offset = tiff->get_guint32(&p);
+        offset = tiff->get_length(&p);
         p = tiff->data + offset;
     }
 
@@ -908,8 +941,11 @@ gwy_tiff_get_float_entry(const GwyTIFF *tiff,
         break;
 
         case GWY_TIFF_DOUBLE:
-        offset = tiff->get_guint32(&p);
-        p = tiff->data + offset;
+        /* Stored directly in the entry in BigTIFF. */
+        if (tiff->tagvaluesize < sizeof(gdouble)) {
+            offset = tiff->get_length(&p);
+            p = tiff->data + offset;
+        }
         *retval = tiff->get_gdouble(&p);
         break;
 
@@ -947,7 +983,7 @@ gwy_tiff_get_string_entry(const GwyTIFF *tiff,
         memcpy(*retval, entry->value, entry->count);
     }
     else {
-        offset = tiff->get_guint32(&p);
+        offset = tiff->get_length(&p);
         p = tiff->data + offset;
         *retval = g_new(gchar, entry->count);
         memcpy(*retval, p, entry->count);
@@ -1190,6 +1226,180 @@ finalise:
     return retval;
 }
 
+#ifdef GWY_TIFF_HAVE_DEFLATE
+/* Unpack a data segment compressed using Deflate (a zlib stream).
+ *
+ * Returns the number of bytes consumed, except on failure when zero is returned.  Unlike with PackBits, we accept
+ * streams which continue after filling the segment because some writers pad them. */
+G_GNUC_UNUSED static guint
+gwy_tiff_unpack_deflate(const guchar *packed,
+                        guint packedsize,
+                        guchar *unpacked,
+                        guint tounpack)
+{
+    z_stream zbuf;
+    gint status;
+
+    gwy_clear(&zbuf, 1);
+    zbuf.next_in = (Bytef*)packed;
+    zbuf.avail_in = packedsize;
+    zbuf.next_out = unpacked;
+    zbuf.avail_out = tounpack;
+    if (inflateInit(&zbuf) != Z_OK)
+        return 0;
+
+    status = inflate(&zbuf, Z_FINISH);
+    inflateEnd(&zbuf);
+    if (zbuf.avail_out || (status != Z_STREAM_END && status != Z_OK && status != Z_BUF_ERROR)) {
+        gwy_debug("inflate status %d, %u bytes missing", status, zbuf.avail_out);
+        return 0;
+    }
+
+    return MAX(packedsize - zbuf.avail_in, 1);
+}
+#endif
+
+#ifdef GWY_TIFF_HAVE_ZSTD
+/* Unpack a data segment compressed using ZSTD.
+ *
+ * Returns the number of bytes consumed, except on failure when zero is returned. */
+G_GNUC_UNUSED static guint
+gwy_tiff_unpack_zstd(const guchar *packed,
+                     guint packedsize,
+                     guchar *unpacked,
+                     guint tounpack)
+{
+    size_t size;
+
+    size = ZSTD_decompress(unpacked, tounpack, packed, packedsize);
+    if (ZSTD_isError(size) || size != tounpack) {
+        gwy_debug("ZSTD failed: %s", ZSTD_isError(size) ? ZSTD_getErrorName(size) : "wrong size");
+        return 0;
+    }
+
+    return packedsize;
+}
+#endif
+
+static inline guint64
+gwy_tiff_get_raw_sample(const guchar *p, guint size, gboolean little_endian)
+{
+    guint64 v = 0;
+    guint i;
+
+    if (little_endian) {
+        for (i = size; i; i--)
+            v = (v << 8) | p[i-1];
+    }
+    else {
+        for (i = 0; i < size; i++)
+            v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline void
+gwy_tiff_set_raw_sample(guchar *p, guint size, gboolean little_endian, guint64 v)
+{
+    guint i;
+
+    if (little_endian) {
+        for (i = 0; i < size; i++, v >>= 8)
+            p[i] = v & 0xff;
+    }
+    else {
+        for (i = size; i; i--, v >>= 8)
+            p[i-1] = v & 0xff;
+    }
+}
+
+/* Undo the predictor in @nrows rows of unpacked data.
+ *
+ * Horizontal differencing is done with samples in the file byte order.  The floating point predictor differences
+ * bytes and stores each byte of all samples in a row together, most significant byte first.  We put them back in the
+ * file byte order so the data can be read the same way as other data. */
+G_GNUC_UNUSED static void
+gwy_tiff_undo_predictor(const GwyTIFF *tiff,
+                        const GwyTIFFImageReader *reader,
+                        guchar *data,
+                        guint64 nrows)
+{
+    gboolean le = (tiff->byteorder == G_LITTLE_ENDIAN);
+    guint spp = reader->samples_per_pixel, size = reader->bits_per_sample/8;
+    guint64 rowstride = reader->rowstride, nsamples = rowstride/size, r, i, b, v;
+    guchar *row, *tmp = NULL;
+
+    if (reader->predictor == GWY_TIFF_PREDICTOR_FLOAT)
+        tmp = g_new(guchar, rowstride);
+
+    for (r = 0; r < nrows; r++) {
+        row = data + r*rowstride;
+        if (reader->predictor == GWY_TIFF_PREDICTOR_HORIZONTAL && size == 1) {
+            for (i = spp; i < rowstride; i++)
+                row[i] += row[i-spp];
+        }
+        else if (reader->predictor == GWY_TIFF_PREDICTOR_HORIZONTAL) {
+            for (i = spp; i < nsamples; i++) {
+                v = gwy_tiff_get_raw_sample(row + i*size, size, le);
+                v += gwy_tiff_get_raw_sample(row + (i - spp)*size, size, le);
+                gwy_tiff_set_raw_sample(row + i*size, size, le, v);
+            }
+        }
+        else if (reader->predictor == GWY_TIFF_PREDICTOR_FLOAT) {
+            for (i = spp; i < rowstride; i++)
+                row[i] += row[i-spp];
+            memcpy(tmp, row, rowstride);
+            for (i = 0; i < nsamples; i++) {
+                for (b = 0; b < size; b++)
+                    row[i*size + (le ? size-1 - b : b)] = tmp[b*nsamples + i];
+            }
+        }
+    }
+
+    g_free(tmp);
+}
+
+/* Set up decompression and check whether we can undo the predictor. */
+G_GNUC_UNUSED static inline gboolean
+gwy_tiff_init_image_reader_unpacking(GwyTIFFImageReader *reader,
+                                     GError **error)
+{
+    GwyTIFFSampleFormat sformat = (GwyTIFFSampleFormat)reader->sample_format;
+    guint predictor = reader->predictor;
+
+    if (reader->compression == GWY_TIFF_COMPRESSION_PACKBITS)
+        reader->unpack_func = gwy_tiff_unpack_packbits;
+    else if (reader->compression == GWY_TIFF_COMPRESSION_LZW)
+        reader->unpack_func = gwy_tiff_unpack_lzw;
+#ifdef GWY_TIFF_HAVE_DEFLATE
+    else if (reader->compression == GWY_TIFF_COMPRESSION_DEFLATE
+             || reader->compression == GWY_TIFF_COMPRESSION_DEFLATE_OLD)
+        reader->unpack_func = gwy_tiff_unpack_deflate;
+#endif
+#ifdef GWY_TIFF_HAVE_ZSTD
+    else if (reader->compression == GWY_TIFF_COMPRESSION_ZSTD)
+        reader->unpack_func = gwy_tiff_unpack_zstd;
+#endif
+    else if (reader->compression != GWY_TIFF_COMPRESSION_NONE) {
+        g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
+                    _("Compression type %u is not supported."), reader->compression);
+        return FALSE;
+    }
+
+    /* Predictors are only defined for dictionary and entropy coding.  Others ignore the tag. */
+    if (reader->compression == GWY_TIFF_COMPRESSION_NONE || reader->compression == GWY_TIFF_COMPRESSION_PACKBITS)
+        predictor = reader->predictor = GWY_TIFF_PREDICTOR_NONE;
+
+    if (predictor != GWY_TIFF_PREDICTOR_NONE
+        && !(predictor == GWY_TIFF_PREDICTOR_HORIZONTAL && sformat != GWY_TIFF_SAMPLE_FORMAT_FLOAT)
+        && !(predictor == GWY_TIFF_PREDICTOR_FLOAT && sformat == GWY_TIFF_SAMPLE_FORMAT_FLOAT)) {
+        err_UNSUPPORTED(error, "Predictor");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /* Used for strip/tile offsets and byte counts. */
 G_GNUC_UNUSED static inline gboolean
 gwy_tiff_read_image_reader_sizes(const GwyTIFF *tiff,
@@ -1202,7 +1412,6 @@ gwy_tiff_read_image_reader_sizes(const GwyTIFF *tiff,
     const GwyTIFFEntry *entry;
     const guchar *p;
     guint64 l;
-    guint i;
 
     if (nvalues == 1) {
         if (!gwy_tiff_get_size(tiff, reader->dirno, tag, values))
@@ -1216,10 +1425,11 @@ gwy_tiff_read_image_reader_sizes(const GwyTIFF *tiff,
         return !!err_TIFF_REQUIRED_TAG(error, tag);
     }
 
-    /* Matching type ensured the tag data is at a valid position in the file. */
+    /* Matching type ensured the tag data is at a valid position in the file.  Few values can be stored directly in
+     * the entry, in particular in BigTIFF. */
     p = entry->value;
-    i = tiff->get_guint32(&p);
-    p = tiff->data + i;
+    if (nvalues*gwy_tiff_data_type_size(entry->type) > tiff->tagvaluesize)
+        p = tiff->data + tiff->get_length(&p);
     if (entry->type == GWY_TIFF_LONG) {
         for (l = 0; l < nvalues; l++)
             values[l] = tiff->get_guint32(&p);
@@ -1251,15 +1461,8 @@ gwy_tiff_init_image_reader_striped(const GwyTIFF *tiff,
         return FALSE;
     }
 
-    if (reader->compression == GWY_TIFF_COMPRESSION_PACKBITS)
-        reader->unpack_func = gwy_tiff_unpack_packbits;
-    else if (reader->compression == GWY_TIFF_COMPRESSION_LZW)
-        reader->unpack_func = gwy_tiff_unpack_lzw;
-    else if (reader->compression != GWY_TIFF_COMPRESSION_NONE) {
-        g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                    _("Compression type %u is not supported."), reader->compression);
+    if (!gwy_tiff_init_image_reader_unpacking(reader, error))
         return FALSE;
-    }
 
     nstrips = (reader->height + reader->strip_rows-1)/reader->strip_rows;
     reader->offsets = g_new(guint64, nstrips);
@@ -1313,11 +1516,8 @@ gwy_tiff_init_image_reader_tiled(const GwyTIFF *tiff,
         return FALSE;
     }
 
-    if (reader->compression != GWY_TIFF_COMPRESSION_NONE) {
-        g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                    _("Compression type %u is not supported."), reader->compression);
+    if (!gwy_tiff_init_image_reader_unpacking(reader, error))
         return FALSE;
-    }
 
     nhtiles = (reader->width + reader->tile_width-1)/reader->tile_width;
     nvtiles = (reader->height + reader->tile_height-1)/reader->tile_height;
@@ -1344,8 +1544,9 @@ gwy_tiff_init_image_reader_tiled(const GwyTIFF *tiff,
         }
     }
 
+    /* Row-wise reading needs an entire row of tiles unpacked. */
     if (reader->compression != GWY_TIFF_COMPRESSION_NONE)
-        reader->unpacked = g_new(guchar, tsize);
+        reader->unpacked = g_new(guchar, tsize*nhtiles);
 
     return TRUE;
 
@@ -1412,6 +1613,8 @@ gwy_tiff_get_image_reader(const GwyTIFF *tiff,
     /* Integer fields specifying data in a format we do not support */
     if (!gwy_tiff_get_uint(tiff, dirno, GWY_TIFFTAG_COMPRESSION, &reader.compression))
         reader.compression = GWY_TIFF_COMPRESSION_NONE;
+    if (!gwy_tiff_get_uint(tiff, dirno, GWY_TIFFTAG_PREDICTOR, &reader.predictor))
+        reader.predictor = GWY_TIFF_PREDICTOR_NONE;
 
     if (!tiff->allow_compressed && reader.compression != GWY_TIFF_COMPRESSION_NONE) {
         g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
@@ -1547,6 +1750,29 @@ gwy_tiff_reader_read_segment(const GwyTIFF *tiff,
     }
 }
 
+/* Get pointer to the data of strip or tile @segno, which has @nrows rows.  Uncompressed data are returned directly
+ * from the file.  Compressed data are unpacked to @buffer which must be large enough to hold the entire segment.
+ * Returns %NULL on failure. */
+G_GNUC_UNUSED static inline const guchar*
+gwy_tiff_reader_get_segment(const GwyTIFF *tiff,
+                            const GwyTIFFImageReader *reader,
+                            guint64 segno,
+                            guint64 nrows,
+                            guchar *buffer)
+{
+    const guchar *p = tiff->data + reader->offsets[segno];
+
+    if (!reader->unpack_func)
+        return p;
+
+    if (!reader->unpack_func(p, reader->bytecounts[segno], buffer, reader->rowstride*nrows))
+        return NULL;
+    if (reader->predictor != GWY_TIFF_PREDICTOR_NONE)
+        gwy_tiff_undo_predictor(tiff, reader, buffer, nrows);
+
+    return buffer;
+}
+
 G_GNUC_UNUSED static inline gboolean
 gwy_tiff_read_image_row_striped(const GwyTIFF *tiff,
                                 GwyTIFFImageReader *reader,
@@ -1566,7 +1792,6 @@ gwy_tiff_read_image_row_striped(const GwyTIFF *tiff,
     nrows = reader->strip_rows;
     stripno = rowno/nrows;
     stripindex = rowno % nrows;
-    p = tiff->data + reader->offsets[stripno];
     if (reader->unpack_func) {
         g_assert(reader->unpacked);
         /* If we want a row from different stripe than current we unpack the stripe. */
@@ -1574,13 +1799,16 @@ gwy_tiff_read_image_row_striped(const GwyTIFF *tiff,
             nstrips = (reader->height + nrows-1)/nrows;
             if (stripno == nstrips-1 && reader->height % nrows)
                 nrows = reader->height % nrows;
-            if (!reader->unpack_func(p, reader->bytecounts[stripno], reader->unpacked, rowstride * nrows))
+            reader->which_unpacked = G_MAXUINT64;
+            if (!gwy_tiff_reader_get_segment(tiff, reader, stripno, nrows, reader->unpacked))
                 return FALSE;
             reader->which_unpacked = stripno;
         }
         /* Read from the unpacked buffer instead of the file data. */
         p = reader->unpacked;
     }
+    else
+        p = tiff->data + reader->offsets[stripno];
     p += stripindex*rowstride + (bps/8)*channelno;
     skip = (reader->samples_per_pixel - 1)*bps/8;
     gwy_tiff_reader_read_segment(tiff, sformat, bps, p, reader->width, skip, q, z0, dest);
@@ -1588,7 +1816,7 @@ gwy_tiff_read_image_row_striped(const GwyTIFF *tiff,
     return TRUE;
 }
 
-G_GNUC_UNUSED static inline void
+G_GNUC_UNUSED static inline gboolean
 gwy_tiff_read_image_row_tiled(const GwyTIFF *tiff,
                               GwyTIFFImageReader *reader,
                               guint channelno,
@@ -1600,6 +1828,7 @@ gwy_tiff_read_image_row_tiled(const GwyTIFF *tiff,
     GwyTIFFSampleFormat sformat = (GwyTIFFSampleFormat)reader->sample_format;
     guint bps = reader->bits_per_sample;
     guint nhtiles, vtileno, vtileindex, i, l, skip, len;
+    gsize tsize;
     const guchar *p;
 
     nhtiles = (reader->width + reader->tile_width-1)/reader->tile_width;
@@ -1607,19 +1836,38 @@ gwy_tiff_read_image_row_tiled(const GwyTIFF *tiff,
     vtileindex = rowno % reader->tile_height;
     skip = (reader->samples_per_pixel - 1)*bps/8;
     len = reader->tile_width;
+    tsize = reader->rowstride*reader->tile_height;
+    /* Tiles are always full, even at the image edges, so we can unpack the entire row of tiles at once. */
+    if (reader->unpack_func && vtileno != reader->which_unpacked) {
+        g_assert(reader->unpacked);
+        reader->which_unpacked = G_MAXUINT64;
+        for (i = 0; i < nhtiles; i++) {
+            l = vtileno*nhtiles + i;
+            if (!gwy_tiff_reader_get_segment(tiff, reader, l, reader->tile_height, reader->unpacked + i*tsize))
+                return FALSE;
+        }
+        reader->which_unpacked = vtileno;
+    }
     for (i = 0; i < nhtiles; i++) {
         l = vtileno*nhtiles + i;
-        p = tiff->data + (reader->offsets[l] + vtileindex*reader->rowstride + (bps/8)*channelno);
-        if (i == reader->tile_width-1 && reader->width % reader->tile_width)
+        if (reader->unpack_func)
+            p = reader->unpacked + i*tsize;
+        else
+            p = tiff->data + reader->offsets[l];
+        p += vtileindex*reader->rowstride + (bps/8)*channelno;
+        if (i == nhtiles-1 && reader->width % reader->tile_width)
             len = reader->width % reader->tile_width;
         gwy_tiff_reader_read_segment(tiff, sformat, bps, p, len, skip, q, z0, dest);
         dest += len;
     }
+
+    return TRUE;
 }
 
 /* If the file may be compressed (which needs to be explicitly allowed using gwy_tiff_allow_compressed()) this
  * function needs to be called with rowno in a mononotonically increasing sequence.  Anything else can result in
- * repeated unpacking data from the beginning and quadratic time complexity. */
+ * repeated unpacking data from the beginning and quadratic time complexity.  Use gwy_tiff_read_image() for reading
+ * entire images. */
 G_GNUC_UNUSED static inline gboolean
 gwy_tiff_read_image_row(const GwyTIFF *tiff,
                         GwyTIFFImageReader *reader,
@@ -1636,18 +1884,14 @@ gwy_tiff_read_image_row(const GwyTIFF *tiff,
     g_return_val_if_fail(channelno < reader->samples_per_pixel, FALSE);
     if (reader->strip_rows) {
         g_return_val_if_fail(!reader->tile_width, FALSE);
-        gwy_tiff_read_image_row_striped(tiff, reader, channelno, rowno, q, z0, dest);
-    }
-    else {
-        g_return_val_if_fail(reader->tile_width, FALSE);
-        g_return_val_if_fail(!reader->unpack_func, FALSE);
-        gwy_tiff_read_image_row_tiled(tiff, reader, channelno, rowno, q, z0, dest);
+        return gwy_tiff_read_image_row_striped(tiff, reader, channelno, rowno, q, z0, dest);
     }
 
-    return TRUE;
+    g_return_val_if_fail(reader->tile_width, FALSE);
+    return gwy_tiff_read_image_row_tiled(tiff, reader, channelno, rowno, q, z0, dest);
 }
 
-G_GNUC_UNUSED static inline void
+G_GNUC_UNUSED static inline gboolean
 gwy_tiff_read_image_row_averaged(const GwyTIFF *tiff,
                                  GwyTIFFImageReader *reader,
                                  guint rowno,
@@ -1658,12 +1902,13 @@ gwy_tiff_read_image_row_averaged(const GwyTIFF *tiff,
     gint ch, j, width, spp = reader->samples_per_pixel;
     gdouble *rowbuf;
 
-    g_return_if_fail(spp >= 1);
+    g_return_val_if_fail(spp >= 1, FALSE);
 
     q /= spp;
-    gwy_tiff_read_image_row(tiff, reader, 0, rowno, q, z0, dest);
+    if (!gwy_tiff_read_image_row(tiff, reader, 0, rowno, q, z0, dest))
+        return FALSE;
     if (spp == 1)
-        return;
+        return TRUE;
 
     width = reader->width;
     if (!reader->rowbuf)
@@ -1671,10 +1916,130 @@ gwy_tiff_read_image_row_averaged(const GwyTIFF *tiff,
 
     rowbuf = reader->rowbuf;
     for (ch = 1; ch < spp; ch++) {
-        gwy_tiff_read_image_row(tiff, reader, ch, rowno, q, 0.0, rowbuf);
+        if (!gwy_tiff_read_image_row(tiff, reader, ch, rowno, q, 0.0, rowbuf))
+            return FALSE;
         for (j = 0; j < width; j++)
             dest[j] += rowbuf[j];
     }
+
+    return TRUE;
+}
+
+/* Read an entire image.  Strips and tiles are independent so they are unpacked and converted in parallel, each
+ * thread having its own unpacking buffer.  Channel G_MAXUINT means averaging all samples. */
+G_GNUC_UNUSED static inline gboolean
+gwy_tiff_read_image_impl(const GwyTIFF *tiff,
+                         const GwyTIFFImageReader *reader,
+                         guint channelno,
+                         gdouble q,
+                         gdouble z0,
+                         gdouble *dest)
+{
+    GwyTIFFSampleFormat sformat = (GwyTIFFSampleFormat)reader->sample_format;
+    guint64 width = reader->width, height = reader->height, segwidth, segheight, nhsegs, nsegs;
+    guint bps = reader->bits_per_sample, spp = reader->samples_per_pixel;
+    gboolean ok = TRUE;
+
+    if (reader->strip_rows) {
+        segwidth = width;
+        segheight = reader->strip_rows;
+    }
+    else {
+        segwidth = reader->tile_width;
+        segheight = reader->tile_height;
+    }
+    nhsegs = (width + segwidth-1)/segwidth;
+    nsegs = nhsegs*((height + segheight-1)/segheight);
+    if (channelno == G_MAXUINT)
+        q /= spp;
+
+#ifdef _OPENMP
+#pragma omp parallel if(gwy_threads_are_enabled() && nsegs > 1) default(none) \
+            shared(tiff,reader,dest,q,z0,channelno,sformat,width,height,segwidth,segheight,nhsegs,nsegs,bps,spp,ok)
+#endif
+    {
+        guint64 ifrom = gwy_omp_chunk_start(nsegs), ito = gwy_omp_chunk_end(nsegs);
+        guint64 k, r, row, col, nrows, len;
+        guint skip = (spp - 1)*bps/8, ch;
+        guchar *buffer = NULL;
+        gdouble *rowbuf = NULL, *d;
+        const guchar *p;
+
+        if (reader->unpack_func)
+            buffer = g_new(guchar, reader->rowstride*segheight);
+        if (channelno == G_MAXUINT && spp > 1)
+            rowbuf = g_new(gdouble, segwidth);
+
+        for (k = ifrom; k < ito; k++) {
+            if (!gwy_omp_atomic_read_boolean(&ok))
+                break;
+
+            row = (k/nhsegs)*segheight;
+            col = (k % nhsegs)*segwidth;
+            nrows = MIN(segheight, height - row);
+            len = MIN(segwidth, width - col);
+            /* Tiles are padded to full size, only the last strip can be shorter. */
+            if (!(p = gwy_tiff_reader_get_segment(tiff, reader, k, reader->strip_rows ? nrows : segheight, buffer))) {
+                gwy_omp_atomic_write_boolean(&ok, FALSE);
+                break;
+            }
+
+            for (r = 0; r < nrows; r++, p += reader->rowstride) {
+                d = dest + (row + r)*width + col;
+                if (channelno != G_MAXUINT) {
+                    gwy_tiff_reader_read_segment(tiff, sformat, bps, p + (bps/8)*channelno, len, skip, q, z0, d);
+                    continue;
+                }
+                gwy_tiff_reader_read_segment(tiff, sformat, bps, p, len, skip, q, z0, d);
+                for (ch = 1; ch < spp; ch++) {
+                    guint64 j;
+
+                    gwy_tiff_reader_read_segment(tiff, sformat, bps, p + (bps/8)*ch, len, skip, q, 0.0, rowbuf);
+                    for (j = 0; j < len; j++)
+                        d[j] += rowbuf[j];
+                }
+            }
+        }
+
+        g_free(rowbuf);
+        g_free(buffer);
+    }
+
+    return ok;
+}
+
+/* Read channel @channelno of the entire image to @dest, which must have space for width×height values.  Unlike
+ * gwy_tiff_read_image_row(), it does not modify the reader state and can be used for any image. */
+G_GNUC_UNUSED static inline gboolean
+gwy_tiff_read_image(const GwyTIFF *tiff,
+                    const GwyTIFFImageReader *reader,
+                    guint channelno,
+                    gdouble q,
+                    gdouble z0,
+                    gdouble *dest)
+{
+    g_return_val_if_fail(tiff, FALSE);
+    g_return_val_if_fail(reader, FALSE);
+    g_return_val_if_fail(reader->dirno < tiff->dirs->len, FALSE);
+    g_return_val_if_fail(channelno < reader->samples_per_pixel, FALSE);
+    g_return_val_if_fail(reader->strip_rows || reader->tile_width, FALSE);
+    return gwy_tiff_read_image_impl(tiff, reader, channelno, q, z0, dest);
+}
+
+/* Read the entire image to @dest, averaging all samples (channels). */
+G_GNUC_UNUSED static inline gboolean
+gwy_tiff_read_image_averaged(const GwyTIFF *tiff,
+                             const GwyTIFFImageReader *reader,
+                             gdouble q,
+                             gdouble z0,
+                             gdouble *dest)
+{
+    g_return_val_if_fail(tiff, FALSE);
+    g_return_val_if_fail(reader, FALSE);
+    g_return_val_if_fail(reader->dirno < tiff->dirs->len, FALSE);
+    g_return_val_if_fail(reader->samples_per_pixel >= 1, FALSE);
+    g_return_val_if_fail(reader->strip_rows || reader->tile_width, FALSE);
+    return gwy_tiff_read_image_impl(tiff, reader, G_MAXUINT, q, z0, dest);
 }
 
 /* Idempotent, use: reader = gwy_tiff_image_reader_free(reader); */
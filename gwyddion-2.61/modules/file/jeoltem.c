@@ -485,7 +485,6 @@ jeoltem_load_data(JEOLTEMFile *jtfile, GError **error)
     GwyTIFFImageReader *reader;
     gdouble xstep, ystep, q;
     gdouble *data;
-    guint i;
 
     /* Request a reader, this ensures dimensions and stuff are defined. */
     if (!(reader = gwy_tiff_get_image_reader(jtfile->tiff, 0, 1, error)))
@@ -502,8 +501,7 @@ jeoltem_load_data(JEOLTEMFile *jtfile, GError **error)
     gwy_si_unit_set_from_string(gwy_data_field_get_si_unit_xy(dfield), "m");
 
     data = gwy_data_field_get_data(dfield);
-    for (i = 0; i < reader->height; i++)
-        gwy_tiff_read_image_row(jtfile->tiff, reader, 0, i, q, 0.0, data + i*reader->width);
+    gwy_tiff_read_image(jtfile->tiff, reader, 0, q, 0.0, data);
 
     container = gwy_container_new();
 
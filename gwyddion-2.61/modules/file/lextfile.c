@@ -279,7 +279,6 @@ lext_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
         double xscale, yscale, zfactor;
         GQuark quark;
         gdouble *data;
-        gint i;
 
         g_free(title);
         title = NULL;
@@ -370,9 +369,7 @@ lext_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
             g_object_unref(siunit);
 
             data = gwy_data_field_get_data(dfield);
-            for (i = 0; i < reader->height; i++)
-                gwy_tiff_read_image_row(tiff, reader, ch, i, zfactor, 0.0,
-                                        data + i*reader->width);
+            gwy_tiff_read_image(tiff, reader, ch, zfactor, 0.0, data);
 
             /* add read datafield to container */
             quark = gwy_app_get_data_key_for_id(id);
@@ -141,7 +141,6 @@ mgl_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
     GwyTIFFImageReader *reader = NULL;
     GwyTextHeaderParser parser;
     GHashTable *hash;
-    gint i;
     gchar *comment = NULL;
     const gchar *value;
     GError *err = NULL;
@@ -213,9 +212,7 @@ mgl_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
         gwy_si_unit_set_from_string(gwy_data_field_get_si_unit_xy(dfield), "m");
 
         data = gwy_data_field_get_data(dfield);
-        for (i = 0; i < reader->height; i++)
-            gwy_tiff_read_image_row_averaged(tiff, reader, i, q, 0.0,
-                                             data + i*reader->width);
+        gwy_tiff_read_image_averaged(tiff, reader, q, 0.0, data);
 
         if (!container)
             container = gwy_container_new();
@@ -52,6 +52,7 @@
 #include <gtk/gtk.h>
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwymath.h>
+#include <libgwyddion/gwyascii.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <libprocess/datafield.h>
 #include <libgwydgets/gwydgetutils.h>
@@ -1051,7 +1052,7 @@ read_data_file(GwyDoubleArray *data, const gchar *filename,
             /* Only read channels that were selected.  This saves both memory
              * and time. */
             if (include_channel[i]) {
-                rec[j] = g_ascii_strtod(line, &end);
+                rec[j] = gwy_str_to_double(line, &end);
                 if (end == line) {
                     gwy_debug("line %u terminated prematurely", linecount);
                     goto fail;
@@ -48,6 +48,7 @@
 #include <libgwyddion/gwyversion.h>
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyascii.h>
 #include <libprocess/stats.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <app/gwymoduleutils-file.h>
@@ -192,9 +193,8 @@ read_image_data(GHashTable *hash, gchar *p, const gchar *filename,
 {
     GwyContainer *container = NULL;
     GwyDataField *field = NULL;
-    gchar *value;
     gdouble xreal, yreal, q;
-    gint i, xres, yres, power10;
+    gint n, xres, yres, power10;
     gdouble *data;
 
     xres = atoi(g_hash_table_lookup(hash, "NX"));
@@ -230,23 +230,12 @@ read_image_data(GHashTable *hash, gchar *p, const gchar *filename,
      * rescale data according to Scale Data? */
 
     data = gwy_data_field_get_data(field);
-    value = p;
-    for (i = 0; i < xres*yres; i++) {
-        data[i] = q*g_ascii_strtod(value, &p);
-        if (p == value && (!*p || g_ascii_isspace(*p))) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                        _("End of file reached when reading sample #%d of %d"), i, xres*yres);
-            g_object_unref(field);
-            return NULL;
-        }
-        if (p == value) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                        _("Malformed data encountered when reading sample #%d of %d"), i, xres*yres);
-            g_object_unref(field);
-            return NULL;
-        }
-        value = p;
+    n = gwy_str_to_doubles(p, xres*yres, data, &p);
+    if (err_DATA_VALUES(error, p, n, xres*yres)) {
+        g_object_unref(field);
+        return NULL;
     }
+    gwy_data_field_multiply(field, q);
 
     container = gwy_container_new();
     gwy_container_set_object(container, gwy_app_get_data_key_for_id(0), field);
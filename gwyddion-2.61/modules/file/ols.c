@@ -146,7 +146,7 @@ ols_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
     GwyTIFFImageReader *reader = NULL;
     GwyTextHeaderParser parser;
     GHashTable *hash;
-    gint i, power10;
+    gint power10;
     gchar *comment = NULL;
     const gchar *s1;
     GError *err = NULL;
@@ -226,10 +226,7 @@ ols_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
 
             factor = z_axis * pow10(power10);
             data = gwy_data_field_get_data(dfield);
-
-            for (i = 0; i < reader->height; i++)
-                gwy_tiff_read_image_row(tiff, reader, ch, i, factor, 0.0,
-                                        data + i*reader->width);
+            gwy_tiff_read_image(tiff, reader, ch, factor, 0.0, data);
 
             /* add read datafield to container */
             if (!container)
@@ -56,6 +56,10 @@
 #include <app/gwymoduleutils-file.h>
 #include <app/data-browser.h>
 #include "err.h"
+
+/* OME TIFF files are commonly Deflate or ZSTD-compressed. */
+#define GWY_TIFF_WITH_ZLIB
+#define GWY_TIFF_WITH_ZSTD
 #include "gwytiff.h"
 
 #define Micrometre (1e-6)
@@ -213,6 +217,7 @@ ome_load(const gchar *filename,
     if (!tiff)
         return NULL;
 
+    gwy_tiff_allow_compressed(tiff, TRUE);
     container = ome_load_tiff(tiff, filename, error);
     gwy_tiff_free(tiff);
 
@@ -319,7 +324,6 @@ ome_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
         spp = reader->samples_per_pixel;
         for (ch = 0; ch < spp; ch++) {
             GQuark quark;
-            guint i;
             gdouble *d;
             gdouble zfactor = 1.0, xreal = omefile.xres, yreal = omefile.yres;
 
@@ -339,9 +343,12 @@ ome_load_tiff(const GwyTIFF *tiff, const gchar *filename, GError **error)
             }
 
             d = gwy_data_field_get_data(dfield);
-            for (i = 0; i < reader->height; i++)
-                gwy_tiff_read_image_row(tiff, reader, ch, i, zfactor, 0.0,
-                                        d + i*reader->width);
+            if (!gwy_tiff_read_image(tiff, reader, ch, zfactor, 0.0, d)) {
+                g_warning("Ignoring directory %u: cannot decompress data",
+                          dir_num);
+                g_object_unref(dfield);
+                break;
+            }
 
             /* add read datafield to container */
             quark = gwy_app_get_data_key_for_id(id);
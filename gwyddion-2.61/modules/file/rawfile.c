@@ -48,6 +48,7 @@
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwydebugobjects.h>
 #include <libgwyddion/gwymath.h>
+#include <libgwyddion/gwyascii.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <libprocess/stats.h>
 #include <libdraw/gwypixfield.h>
@@ -2424,7 +2425,7 @@ gwy_ascii_strtod(const gchar *nptr, const gchar *missingval, gchar **endptr)
         }
     }
 
-    return g_ascii_strtod(nptr, endptr);
+    return gwy_str_to_double(nptr, endptr);
 }
 
 static gdouble
@@ -50,6 +50,7 @@
 #include <libgwyddion/gwyversion.h>
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyascii.h>
 #include <libprocess/stats.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <app/gwymoduleutils-file.h>
@@ -211,7 +212,7 @@ read_image_data(GHashTable *hash, gchar *p, const gchar *filename,
     GwyDataField *field = NULL, *mfield = NULL;
     gchar *value;
     gdouble xreal, yreal, q;
-    gint i, xres, yres;
+    gint i, n, xres, yres;
     gdouble *data;
 
     xres = atoi(g_hash_table_lookup(hash, "x-pixels"));
@@ -247,32 +248,19 @@ read_image_data(GHashTable *hash, gchar *p, const gchar *filename,
         q = 1.0;
 
     data = gwy_data_field_get_data(field);
-    value = p;
-    for (i = 0; i < xres*yres; i++) {
-        data[i] = q*g_ascii_strtod(value, &p);
-        if (p == value && (!*p || g_ascii_isspace(*p))) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                        _("End of file reached when reading sample #%d of %d"), i, xres*yres);
-            g_object_unref(field);
-            return NULL;
-        }
-        if (p == value) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                        _("Malformed data encountered when reading sample #%d of %d"), i, xres*yres);
-            g_object_unref(field);
-            return NULL;
-        }
-        value = p;
+    n = gwy_str_to_doubles(p, xres*yres, data, &p);
+    if (err_DATA_VALUES(error, p, n, xres*yres)) {
+        g_object_unref(field);
+        return NULL;
     }
+    gwy_data_field_multiply(field, q);
 
     if ((value = g_hash_table_lookup(hash, "voidpixels")) && atoi(value)) {
-        mfield = gwy_data_field_new_alike(field, FALSE);
+        mfield = gwy_data_field_new_alike(field, TRUE);
         data = gwy_data_field_get_data(mfield);
-        value = p;
-        for (i = 0; i < xres*yres; i++) {
-            data[i] = 1.0 - g_ascii_strtod(value, &p);
-            value = p;
-        }
+        gwy_str_to_doubles(p, xres*yres, data, &p);
+        for (i = 0; i < xres*yres; i++)
+            data[i] = 1.0 - data[i];
         if (!gwy_app_channel_remove_bad_data(field, mfield))
             GWY_OBJECT_UNREF(mfield);
     }
@@ -367,9 +355,9 @@ read_graph_data(GHashTable *hash, gchar *buffer, gchar *p,
         if (!line[0] || line[0] == '#')
             continue;
 
-        x = g_ascii_strtod(line, &end);
+        x = gwy_str_to_double(line, &end);
         line = end;
-        y = g_ascii_strtod(line, &end);
+        y = gwy_str_to_double(line, &end);
         if (end == line) {
             g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
                         _("Malformed data encountered when reading sample #%u"), i);
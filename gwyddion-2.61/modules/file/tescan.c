@@ -184,6 +184,7 @@ tsctif_load(const gchar *filename,
     if (!tiff)
         return NULL;
 
+    gwy_tiff_allow_compressed(tiff, TRUE);
     entry = tsctif_find_header(tiff, error);
     if (!entry) {
         gwy_tiff_free(tiff);
@@ -261,11 +262,13 @@ tsctif_load_tiff(GwyTIFF *tiff, const GwyTIFFEntry *entry, GError **error)
     gwy_si_unit_set_from_string(gwy_data_field_get_si_unit_xy(dfield), "m");
 
     data = gwy_data_field_get_data(dfield);
-    for (i = 0; i < reader->height; i++)
-        gwy_tiff_read_image_row(tiff, reader, 0, i,
-                                1.0/((1 << reader->bits_per_sample) - 1),
-                                0.0,
-                                data + i*reader->width);
+    if (!gwy_tiff_read_image(tiff, reader, 0,
+                             1.0/((1 << reader->bits_per_sample) - 1), 0.0,
+                             data)) {
+        err_TIFF_DECOMPRESSION(error);
+        g_object_unref(dfield);
+        goto fail;
+    }
 
     container = gwy_container_new();
 
@@ -46,6 +46,7 @@
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwyutils.h>
+#include <libgwyddion/gwyascii.h>
 #include <libprocess/stats.h>
 #include <libgwymodule/gwymodule-file.h>
 #include <app/gwymoduleutils-file.h>
@@ -130,12 +131,12 @@ dat_load(const gchar *filename,
     GwyTextHeaderParser parser;
     GwySIUnit *xyunit = NULL, *zunit = NULL;
     gint power10xy, power10z;
-    gchar *line, *p, *value, *title, *buffer = NULL;
+    gchar *line, *p, *title, *buffer = NULL;
     GHashTable *hash = NULL;
     gsize size;
     GError *err = NULL;
     gdouble xreal, yreal, q;
-    gint i, xres, yres;
+    gint n, xres, yres;
     gdouble *data;
 
     if (!g_file_get_contents(filename, &buffer, &size, &err)) {
@@ -203,21 +204,10 @@ dat_load(const gchar *filename,
     q = pow10(power10z);
 
     data = gwy_data_field_get_data(dfield);
-    value = p;
-    for (i = 0; i < xres*yres; i++) {
-        data[i] = q*g_ascii_strtod(value, &p);
-        if (p == value && (!*p || g_ascii_isspace(*p))) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                        _("End of file reached when reading sample #%d of %d"), i, xres*yres);
-            goto fail;
-        }
-        if (p == value) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR, GWY_MODULE_FILE_ERROR_DATA,
-                        _("Malformed data encountered when reading sample #%d of %d"), i, xres*yres);
-            goto fail;
-        }
-        value = p;
-    }
+    n = gwy_str_to_doubles(p, xres*yres, data, &p);
+    if (err_DATA_VALUES(error, p, n, xres*yres))
+        goto fail;
+    gwy_data_field_multiply(dfield, q);
 
     container = gwy_container_new();
 
@@ -130,6 +130,7 @@ zeiss_load(const gchar *filename,
     if (!tiff)
         return NULL;
 
+    gwy_tiff_allow_compressed(tiff, TRUE);
     container = zeiss_load_tiff(tiff, error);
     if (container)
         gwy_file_channel_import_log_add(container, 0, NULL, filename);
@@ -147,7 +148,7 @@ zeiss_load_tiff(const GwyTIFF *tiff, GError **error)
     GwySIUnit *siunit;
     GwyTIFFImageReader *reader = NULL;
     GHashTable *hash = NULL;
-    gint i, power10;
+    gint power10;
     gchar *value, *end, *comment = NULL;
     gdouble *data;
     gboolean new_file;
@@ -213,9 +214,11 @@ zeiss_load_tiff(const GwyTIFF *tiff, GError **error)
     g_object_unref(siunit);
 
     data = gwy_data_field_get_data(dfield);
-    for (i = 0; i < reader->height; i++)
-        gwy_tiff_read_image_row_averaged(tiff, reader, i, 1.0, 0.0,
-                                         data + i*reader->width);
+    if (!gwy_tiff_read_image_averaged(tiff, reader, 1.0, 0.0, data)) {
+        err_TIFF_DECOMPRESSION(error);
+        g_object_unref(dfield);
+        goto fail;
+    }
 
     container = gwy_container_new();
     gwy_container_set_object_by_name(container, "/0/data", dfield);
@@ -235,6 +238,7 @@ fail:
     if (hash)
         g_hash_table_destroy(hash);
     g_free(comment);
+    gwy_tiff_image_reader_free(reader);
 
     return container;
 }
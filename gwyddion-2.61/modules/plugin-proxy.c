@@ -40,6 +40,32 @@
  * XXX: the `dump' should probably be `dumb'...
  *
  * XXX: Plug-ins cannot specify sens_flags.
+ *
+ * Process plug-ins which list `worker' among the lines following run modes
+ * in their registration info are started only once, as `plugin worker', and
+ * kept running.  Each invocation is then a request written to the worker's
+ * standard input:
+ *
+ *   run NAME RUNMODE SHARED-FILE-NAME
+ *   /0/data/xres=...               (the same keys as in dump files)
+ *   /0/data=@OFFSET
+ *   <empty line>
+ *
+ * where the data are not inline but stored in the shared file (memory-backed
+ * if possible, mapped by both sides) as raw little endian doubles starting
+ * at byte OFFSET.  The worker writes its results to the shared file too (it
+ * may grow it) and replies on its standard output either with
+ *
+ *   ok
+ *   /0/data/xres=...               (the same keys as in dump files)
+ *   /0/data=@OFFSET
+ *   <empty line>
+ *
+ * or with a single line `error MESSAGE'.  The worker should terminate when
+ * its standard input is closed.  If anything goes wrong with the worker
+ * protocol, the plug-in falls back to being run with a dump file.  A worker
+ * which does not reply within WORKER_TIMEOUT is killed and the invocation
+ * fails.
  */
 
 #include "config.h"
@@ -47,9 +73,15 @@
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <signal.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifndef G_OS_WIN32
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
 #include <glib/gstdio.h>
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwyutils.h>
@@ -57,12 +89,25 @@
 #include <libprocess/datafield.h>
 #include <app/gwyapp.h>
 
+/* How long to wait for a worker reply (in seconds) before giving up. */
+#define WORKER_TIMEOUT 120
+
+typedef struct {
+    GPid pid;           /* Zero once the worker has exited */
+    FILE *in;           /* Requests, the worker's stdin */
+    gint out;           /* Replies, the worker's stdout */
+    GString *buffer;    /* Replies read but not consumed yet */
+    gboolean timed_out;
+} ProcPluginWorker;
+
 typedef struct {
     gchar *name;
     gchar *menu_path;
     gchar *tooltip;
     GwyRunType run;
     gchar *file;  /* The file to execute to run the plug-in */
+    gboolean can_serve;  /* Supports the persistent worker protocol */
+    ProcPluginWorker *worker;
 } ProcPluginInfo;
 
 typedef struct {
@@ -99,6 +144,12 @@ static void            proc_plugin_proxy_run     (GwyContainer *data,
                                                   const gchar *name);
 static ProcPluginInfo* proc_find_plugin          (const gchar *name,
                                                   GwyRunType run);
+static gboolean        proc_worker_run           (ProcPluginInfo *info,
+                                                  GwyContainer *data,
+                                                  GQuark dquark,
+                                                  GQuark mquark,
+                                                  const gchar *runmode,
+                                                  GwyContainer **newdata);
 
 /* file plug-in-proxy */
 static GList*          file_register_plugins     (GList *plugins,
@@ -131,10 +182,15 @@ static FILE*           text_dump_export          (GwyContainer *data,
 static void            dump_export_data_field    (GwyDataField *dfield,
                                                   const gchar *name,
                                                   FILE *fh);
+static void            dump_export_field_header  (GwyDataField *dfield,
+                                                  const gchar *name,
+                                                  FILE *fh);
 static FILE*           open_temporary_file       (gchar **filename,
                                                   GError **error);
 static GwyContainer*   text_dump_import          (gchar *buffer,
                                                   gsize size,
+                                                  const guchar *shared,
+                                                  gsize shared_size,
                                                   GError **error);
 static gchar*        decode_glib_encoded_filename(const gchar *filename);
 
@@ -146,7 +202,7 @@ static GwyModuleInfo module_info = {
        "running external programs (plug-ins) on data pretending they are "
        "data processing or file loading/saving modules."),
     "Yeti <yeti@gwyddion.net>",
-    "3.9",
+    "3.10",
     "David Nečas (Yeti) & Petr Klapetek",
     "2004",
 };
@@ -463,6 +519,12 @@ proc_register_plugins(GList *plugins,
             info->menu_path = g_strconcat(_("/_Plug-Ins"), menu_path, NULL);
             info->tooltip = g_strdup_printf(_("Run plug-in %s"), menu_path+1);
             info->run = run;
+            info->can_serve = FALSE;
+            info->worker = NULL;
+            while (buffer && *buffer) {
+                if (gwy_strequal(gwy_str_next_line(&buffer), "worker"))
+                    info->can_serve = TRUE;
+            }
             if (gwy_process_func_register(info->name,
                                           proc_plugin_proxy_run,
                                           info->menu_path,
@@ -508,10 +570,10 @@ proc_plugin_proxy_run(GwyContainer *data,
                       const gchar *name)
 {
     ProcPluginInfo *info;
-    GwyContainer *newdata;
-    gchar *filename, *buffer = NULL;
+    GwyContainer *newdata = NULL;
+    gchar *filename = NULL, *buffer = NULL;
     GError *err = NULL;
-    gint exit_status, id, newid;
+    gint exit_status = 0, id, newid;
     gsize size = 0;
     FILE *fh;
     gchar *args[] = { NULL, "run", NULL, NULL, NULL };
@@ -527,21 +589,30 @@ proc_plugin_proxy_run(GwyContainer *data,
     if (!(info = proc_find_plugin(name, run)))
         return;
 
-    fh = text_dump_export(data, dquark, mquark, &filename, NULL);
-    g_return_if_fail(fh);
     args[0] = info->file;
     args[2] = g_strdup(gwy_enum_to_string(run, run_mode_names, -1));
-    args[3] = decode_glib_encoded_filename(filename);
-    gwy_debug("%s %s %s %s", args[0], args[1], args[2], args[3]);
-    ok = g_spawn_sync(NULL, args, NULL, 0, NULL, NULL,
-                      NULL, NULL, &exit_status, &err);
-    if (!err)
-        ok &= g_file_get_contents(filename, &buffer, &size, &err);
-    g_unlink(filename);
-    fclose(fh);
-    gwy_debug("ok = %d, exit_status = %d, err = %p", ok, exit_status, err);
-    ok &= !exit_status;
-    if (ok && (newdata = text_dump_import(buffer, size, NULL))) {
+    if (!info->can_serve
+        || !proc_worker_run(info, data, dquark, mquark, args[2], &newdata)) {
+        fh = text_dump_export(data, dquark, mquark, &filename, NULL);
+        if (!fh) {
+            g_free(args[2]);
+            g_return_if_reached();
+        }
+        args[3] = decode_glib_encoded_filename(filename);
+        gwy_debug("%s %s %s %s", args[0], args[1], args[2], args[3]);
+        ok = g_spawn_sync(NULL, args, NULL, 0, NULL, NULL,
+                          NULL, NULL, &exit_status, &err);
+        if (!err)
+            ok &= g_file_get_contents(filename, &buffer, &size, &err);
+        g_unlink(filename);
+        fclose(fh);
+        gwy_debug("ok = %d, exit_status = %d, err = %p",
+                  ok, exit_status, err);
+        ok &= !exit_status;
+        if (ok)
+            newdata = text_dump_import(buffer, size, NULL, 0, NULL);
+    }
+    if (newdata) {
         GwyDataField *dfield;
 
         /* Merge data */
@@ -633,6 +704,395 @@ proc_find_plugin(const gchar *name,
     return info;
 }
 
+#ifdef G_OS_WIN32
+static gboolean
+proc_worker_run(G_GNUC_UNUSED ProcPluginInfo *info,
+                G_GNUC_UNUSED GwyContainer *data,
+                G_GNUC_UNUSED GQuark dquark,
+                G_GNUC_UNUSED GQuark mquark,
+                G_GNUC_UNUSED const gchar *runmode,
+                G_GNUC_UNUSED GwyContainer **newdata)
+{
+    return FALSE;
+}
+#else
+/**
+ * worker_block_sigpipe:
+ * @oldset: Location to store the original signal mask to.
+ *
+ * Blocks SIGPIPE in the calling thread.
+ *
+ * Writing to a worker which has died fails with EPIPE.  The accompanying
+ * SIGPIPE, which would kill us, must not be delivered.  Writes to workers must
+ * be enclosed in worker_block_sigpipe() and worker_unblock_sigpipe().
+ *
+ * Returns: Whether SIGPIPE was pending already before.
+ **/
+static gboolean
+worker_block_sigpipe(sigset_t *oldset)
+{
+    sigset_t sigpipe, pending;
+
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    sigpending(&pending);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, oldset);
+
+    return sigismember(&pending, SIGPIPE);
+}
+
+/**
+ * worker_unblock_sigpipe:
+ * @oldset: The original signal mask.
+ * @was_pending: Return value of worker_block_sigpipe().
+ *
+ * Discards SIGPIPE raised by writes to a worker and restores the signal mask.
+ **/
+static void
+worker_unblock_sigpipe(const sigset_t *oldset,
+                       gboolean was_pending)
+{
+    sigset_t sigpipe, pending;
+    gint sig;
+
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    sigpending(&pending);
+    if (!was_pending && sigismember(&pending, SIGPIPE))
+        sigwait(&sigpipe, &sig);
+    pthread_sigmask(SIG_SETMASK, oldset, NULL);
+}
+
+/**
+ * proc_worker_exited:
+ * @pid: Process id of the worker.
+ * @status: Exit status.
+ * @user_data: Plug-in info.
+ *
+ * Notes the exit of a worker process, which is reaped by GLib.
+ **/
+static void
+proc_worker_exited(GPid pid,
+                   gint status,
+                   gpointer user_data)
+{
+    ProcPluginInfo *info = (ProcPluginInfo*)user_data;
+
+    gwy_debug("worker %s exited with status %d", info->file, status);
+    if (info->worker && info->worker->pid == pid)
+        info->worker->pid = 0;
+    g_spawn_close_pid(pid);
+}
+
+/**
+ * proc_worker_stop:
+ * @info: Plug-in info.
+ *
+ * Stops a running persistent worker of plug-in @info, if any.
+ *
+ * The worker is expected to quit once its standard input is closed.  We only
+ * stop workers which misbehaved though, so it is also terminated.
+ **/
+static void
+proc_worker_stop(ProcPluginInfo *info)
+{
+    ProcPluginWorker *worker = info->worker;
+    sigset_t oldset;
+    gboolean was_pending;
+
+    if (!worker)
+        return;
+
+    if (worker->in) {
+        /* Closing may flush unwritten requests. */
+        was_pending = worker_block_sigpipe(&oldset);
+        fclose(worker->in);
+        worker_unblock_sigpipe(&oldset, was_pending);
+    }
+    if (worker->out >= 0)
+        close(worker->out);
+    if (worker->pid)
+        kill(worker->pid, SIGTERM);
+    g_string_free(worker->buffer, TRUE);
+    g_free(worker);
+    info->worker = NULL;
+}
+
+/**
+ * proc_worker_start:
+ * @info: Plug-in info.
+ *
+ * Starts plug-in @info as a persistent worker.
+ *
+ * Returns: Whether the worker is running.
+ **/
+static gboolean
+proc_worker_start(ProcPluginInfo *info)
+{
+    gchar *args[] = { NULL, "worker", NULL };
+    ProcPluginWorker *worker;
+    GError *err = NULL;
+    GPid pid;
+    gint fdin, fdout;
+
+    args[0] = info->file;
+    gwy_debug("starting worker %s", info->file);
+    if (!g_spawn_async_with_pipes(NULL, args, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                                  NULL, NULL, &pid, &fdin, &fdout, NULL,
+                                  &err)) {
+        g_warning("Cannot start plug-in worker %s: %s",
+                  info->file, err->message);
+        g_clear_error(&err);
+        return FALSE;
+    }
+
+    worker = info->worker = g_new0(ProcPluginWorker, 1);
+    worker->pid = pid;
+    worker->out = fdout;
+    worker->buffer = g_string_new(NULL);
+    g_child_watch_add(pid, proc_worker_exited, info);
+    if (!(worker->in = fdopen(fdin, "w"))) {
+        close(fdin);
+        proc_worker_stop(info);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * worker_read_line:
+ * @worker: A plug-in worker.
+ * @str: String to store the line to.
+ *
+ * Reads one complete line of arbitrary length from the worker, without the
+ * terminating newline.
+ *
+ * If the worker does not send anything for WORKER_TIMEOUT, the read fails
+ * and the worker is marked as timed out.
+ *
+ * Returns: Whether a complete line was read.
+ **/
+static gboolean
+worker_read_line(ProcPluginWorker *worker, GString *str)
+{
+    struct pollfd pfd;
+    gchar buf[4096];
+    const gchar *eol;
+    gssize n;
+
+    while (!(eol = memchr(worker->buffer->str, '\n', worker->buffer->len))) {
+        pfd.fd = worker->out;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        n = poll(&pfd, 1, 1000*WORKER_TIMEOUT);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (!n)
+            worker->timed_out = TRUE;
+        if (n <= 0)
+            return FALSE;
+
+        n = read(worker->out, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        g_string_append_len(worker->buffer, buf, n);
+    }
+
+    n = eol - worker->buffer->str;
+    g_string_truncate(str, 0);
+    g_string_append_len(str, worker->buffer->str, n);
+    g_string_erase(worker->buffer, 0, n+1);
+
+    return TRUE;
+}
+
+/**
+ * open_shared_file:
+ * @filename: Where the filename is to be stored.
+ *
+ * Creates a file for data exchange with workers, preferably on a memory
+ * backed file system.
+ *
+ * Returns: The file descriptor of the open file, -1 on failure.
+ **/
+static gint
+open_shared_file(gchar **filename)
+{
+    const gchar *dirs[] = { "/dev/shm", NULL };
+    guint i;
+    gint fd;
+
+    dirs[1] = g_get_tmp_dir();
+    for (i = 0; i < G_N_ELEMENTS(dirs); i++) {
+        if (!g_file_test(dirs[i], G_FILE_TEST_IS_DIR))
+            continue;
+        *filename = g_build_filename(dirs[i], "gwywXXXXXX", NULL);
+        if ((fd = g_mkstemp(*filename)) >= 0)
+            return fd;
+        g_free(*filename);
+    }
+    *filename = NULL;
+
+    return -1;
+}
+
+/**
+ * proc_worker_run:
+ * @info: Plug-in info.
+ * @data: A data container.
+ * @dquark: Key of the data field in @data.
+ * @mquark: Key of the mask in @data.
+ * @runmode: Run mode name.
+ * @newdata: Location to store the container with results to.
+ *
+ * Runs plug-in @info on @data using the persistent worker protocol, starting
+ * the worker if necessary.
+ *
+ * If the worker protocol fails, the worker is stopped and the plug-in is no
+ * longer run this way.
+ *
+ * Returns: Whether the worker handled the request.  When it returns %FALSE,
+ *          the plug-in should be run the normal way.  Note @newdata can be
+ *          %NULL even if it returns %TRUE, if the plug-in itself failed.
+ **/
+static gboolean
+proc_worker_run(ProcPluginInfo *info,
+                GwyContainer *data,
+                GQuark dquark,
+                GQuark mquark,
+                const gchar *runmode,
+                GwyContainer **newdata)
+{
+    static const gchar *names[] = { "/0/data", "/0/mask" };
+    ProcPluginWorker *worker;
+    GwyDataField *fields[2];
+    gsize offsets[2], sizes[2], size = 0;
+    GString *line = NULL, *reply = NULL;
+    gchar *filename = NULL;
+    gpointer shared;
+    struct stat st;
+    sigset_t oldset;
+    gint fd = -1, i, nfields = 1;
+    gboolean ok = FALSE, complete = FALSE, was_pending, written;
+
+    *newdata = NULL;
+    if (!info->worker && !proc_worker_start(info))
+        goto end;
+    worker = info->worker;
+
+    fields[0] = GWY_DATA_FIELD(gwy_container_get_object(data, dquark));
+    if (gwy_container_gis_object(data, mquark, &fields[1]))
+        nfields++;
+    for (i = 0; i < nfields; i++) {
+        offsets[i] = size;
+        sizes[i] = (gsize)gwy_data_field_get_xres(fields[i])
+                   * gwy_data_field_get_yres(fields[i]);
+        size += sizes[i]*sizeof(gdouble);
+    }
+
+    /* Pass the data through shared memory. */
+    if ((fd = open_shared_file(&filename)) < 0
+        || ftruncate(fd, size) != 0)
+        goto end;
+    shared = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shared == MAP_FAILED)
+        goto end;
+    for (i = 0; i < nfields; i++) {
+        const gdouble *d = gwy_data_field_get_data_const(fields[i]);
+        guint8 *p = (guint8*)shared + offsets[i];
+
+#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
+        memcpy(p, d, sizes[i]*sizeof(gdouble));
+#else
+        gwy_memcpy_byte_swap((const guint8*)d, p,
+                             sizeof(gdouble), sizes[i], sizeof(gdouble)-1);
+#endif
+    }
+    munmap(shared, size);
+
+    /* And the rest through the pipe. */
+    was_pending = worker_block_sigpipe(&oldset);
+    fprintf(worker->in, "run %s %s %s\n", info->name, runmode, filename);
+    for (i = 0; i < nfields; i++) {
+        dump_export_field_header(fields[i], names[i], worker->in);
+        fprintf(worker->in, "%s=@%" G_GSIZE_FORMAT "\n", names[i], offsets[i]);
+    }
+    fputc('\n', worker->in);
+    written = (fflush(worker->in) == 0 && !ferror(worker->in));
+    worker_unblock_sigpipe(&oldset, was_pending);
+    if (!written)
+        goto end;
+
+    line = g_string_new(NULL);
+    if (!worker_read_line(worker, line))
+        goto end;
+    if (g_str_has_prefix(line->str, "error")) {
+        g_warning("Plug-in %s failed: %s",
+                  info->file, g_strstrip(line->str + strlen("error")));
+        ok = TRUE;
+        goto end;
+    }
+    if (!gwy_strequal(line->str, "ok"))
+        goto end;
+
+    reply = g_string_new(NULL);
+    while (worker_read_line(worker, line)) {
+        if (!line->len) {
+            complete = TRUE;
+            break;
+        }
+        g_string_append_len(reply, line->str, line->len);
+        g_string_append_c(reply, '\n');
+    }
+    if (!complete || fstat(fd, &st) != 0)
+        goto end;
+
+    ok = TRUE;
+    size = st.st_size;
+    if (!size) {
+        *newdata = text_dump_import(reply->str, reply->len, NULL, 0, NULL);
+        goto end;
+    }
+    shared = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (shared == MAP_FAILED) {
+        ok = FALSE;
+        goto end;
+    }
+    *newdata = text_dump_import(reply->str, reply->len, shared, size, NULL);
+    munmap(shared, size);
+
+end:
+    if (info->worker && info->worker->timed_out) {
+        /* Do not run a plug-in which hangs again.  Just fail. */
+        g_warning("Plug-in worker %s did not reply in %d s, stopping it.",
+                  info->file, WORKER_TIMEOUT);
+        proc_worker_stop(info);
+        info->can_serve = FALSE;
+        ok = TRUE;
+    }
+    else if (!ok && info->can_serve) {
+        g_warning("Plug-in worker %s failed, running it normally.",
+                  info->file);
+        proc_worker_stop(info);
+        info->can_serve = FALSE;
+    }
+    if (line)
+        g_string_free(line, TRUE);
+    if (reply)
+        g_string_free(reply, TRUE);
+    if (fd >= 0) {
+        g_unlink(filename);
+        close(fd);
+    }
+    g_free(filename);
+
+    return ok;
+}
+#endif
+
 /***** File ****************************************************************/
 
 /**
@@ -779,7 +1239,7 @@ file_plugin_proxy_load(const gchar *filename,
         ok = FALSE;
     }
     if (ok) {
-        data = text_dump_import(buffer, size, error);
+        data = text_dump_import(buffer, size, NULL, 0, error);
         if (!data)
             ok = FALSE;
     }
@@ -1130,27 +1590,12 @@ static void
 dump_export_data_field(GwyDataField *dfield, const gchar *name, FILE *fh)
 {
     const gdouble *data;
-    gchar *unit;
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
     gint xres, yres;
 
     gwy_debug("Exporting %s", name);
     xres = gwy_data_field_get_xres(dfield);
     yres = gwy_data_field_get_yres(dfield);
-    fprintf(fh, "%s/xres=%d\n", name, xres);
-    fprintf(fh, "%s/yres=%d\n", name, yres);
-    fprintf(fh, "%s/xreal=%s\n", name,
-            g_ascii_dtostr(buf, sizeof(buf), gwy_data_field_get_xreal(dfield)));
-    fprintf(fh, "%s/yreal=%s\n", name,
-            g_ascii_dtostr(buf, sizeof(buf), gwy_data_field_get_yreal(dfield)));
-    unit = gwy_si_unit_get_string(gwy_data_field_get_si_unit_xy(dfield),
-                                  GWY_SI_UNIT_FORMAT_PLAIN);
-    fprintf(fh, "%s/unit-xy=%s\n", name, unit);
-    g_free(unit);
-    unit = gwy_si_unit_get_string(gwy_data_field_get_si_unit_z(dfield),
-                                  GWY_SI_UNIT_FORMAT_PLAIN);
-    fprintf(fh, "%s/unit-z=%s\n", name, unit);
-    g_free(unit);
+    dump_export_field_header(dfield, name, fh);
     fprintf(fh, "%s=[\n[", name);
     fflush(fh);
     data = gwy_data_field_get_data_const(dfield);
@@ -1171,6 +1616,36 @@ dump_export_data_field(GwyDataField *dfield, const gchar *name, FILE *fh)
     fflush(fh);
 }
 
+/**
+ * dump_export_field_header:
+ * @dfield: A #GwyDataField.
+ * @name: The name of @dfield.
+ * @fh: A filehandle open for writing.
+ *
+ * Dumps dimensions and units of a #GwyDataField to @fh.
+ **/
+static void
+dump_export_field_header(GwyDataField *dfield, const gchar *name, FILE *fh)
+{
+    gchar *unit;
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    fprintf(fh, "%s/xres=%d\n", name, gwy_data_field_get_xres(dfield));
+    fprintf(fh, "%s/yres=%d\n", name, gwy_data_field_get_yres(dfield));
+    fprintf(fh, "%s/xreal=%s\n", name,
+            g_ascii_dtostr(buf, sizeof(buf), gwy_data_field_get_xreal(dfield)));
+    fprintf(fh, "%s/yreal=%s\n", name,
+            g_ascii_dtostr(buf, sizeof(buf), gwy_data_field_get_yreal(dfield)));
+    unit = gwy_si_unit_get_string(gwy_data_field_get_si_unit_xy(dfield),
+                                  GWY_SI_UNIT_FORMAT_PLAIN);
+    fprintf(fh, "%s/unit-xy=%s\n", name, unit);
+    g_free(unit);
+    unit = gwy_si_unit_get_string(gwy_data_field_get_si_unit_z(dfield),
+                                  GWY_SI_UNIT_FORMAT_PLAIN);
+    fprintf(fh, "%s/unit-z=%s\n", name, unit);
+    g_free(unit);
+}
+
 /**
  * open_temporary_file:
  * @filename: Where the filename is to be stored.
@@ -1225,18 +1700,37 @@ open_temporary_file(gchar **filename,
     return fh;
 }
 
+/**
+ * text_dump_import:
+ * @buffer: Dump file contents.
+ * @size: Size of @buffer.
+ * @shared: Shared data of a worker reply (or %NULL).
+ * @shared_size: Size of @shared.
+ * @error: Return location for a #GError (or %NULL).
+ *
+ * Reads data container from a dump.
+ *
+ * If @shared is not %NULL, data fields can be also given as offsets into
+ * @shared, as in worker replies.
+ *
+ * Returns: A newly created data container, %NULL on failure.
+ **/
 static GwyContainer*
 text_dump_import(gchar *buffer,
                  gsize size,
+                 const guchar *shared,
+                 gsize shared_size,
                  GError **error)
 {
-    gchar *val, *key, *pos, *line, *title;
+    gchar *val, *key, *pos, *line, *title, *end;
     GwyContainer *data;
     GwyDataField *dfield;
     gdouble xreal, yreal;
     gint xres, yres;
     GwySIUnit *uxy, *uz;
-    const guchar *s;
+    const guchar *s, *src;
+    gboolean is_shared;
+    guint64 offset = 0;
     gdouble *d;
     gsize n;
 
@@ -1257,7 +1751,17 @@ text_dump_import(gchar *buffer,
         }
         *val = '\0';
         val++;
-        if (!gwy_strequal(val, "[") || !pos || *pos != '[') {
+        is_shared = (shared && *val == '@');
+        if (is_shared) {
+            offset = g_ascii_strtoull(val + 1, &end, 10);
+            if (end == val + 1 || *end) {
+                g_set_error(error, GWY_MODULE_FILE_ERROR,
+                            GWY_MODULE_FILE_ERROR_DATA,
+                            _("Invalid shared data offset."));
+                goto fail;
+            }
+        }
+        else if (!gwy_strequal(val, "[") || !pos || *pos != '[') {
             gwy_debug("<%s>=<%s>", line, val);
             if (*val)
                 gwy_container_set_string_by_name(data, line, g_strdup(val));
@@ -1266,8 +1770,10 @@ text_dump_import(gchar *buffer,
             continue;
         }
 
-        g_assert(pos && *pos == '[');
-        pos++;
+        if (!is_shared) {
+            g_assert(pos && *pos == '[');
+            pos++;
+        }
         dfield = NULL;
         gwy_container_gis_object_by_name(data, line, &dfield);
 
@@ -1362,11 +1868,23 @@ text_dump_import(gchar *buffer,
         g_free(key);
 
         n = xres*yres*sizeof(gdouble);
-        if ((gsize)(pos - buffer) + n + 3 > size) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR,
-                        GWY_MODULE_FILE_ERROR_DATA,
-                        _("End of file reached inside a data field."));
-            goto fail;
+        if (is_shared) {
+            if (offset > shared_size || n > shared_size - offset) {
+                g_set_error(error, GWY_MODULE_FILE_ERROR,
+                            GWY_MODULE_FILE_ERROR_DATA,
+                            _("End of file reached inside a data field."));
+                goto fail;
+            }
+            src = shared + offset;
+        }
+        else {
+            if ((gsize)(pos - buffer) + n + 3 > size) {
+                g_set_error(error, GWY_MODULE_FILE_ERROR,
+                            GWY_MODULE_FILE_ERROR_DATA,
+                            _("End of file reached inside a data field."));
+                goto fail;
+            }
+            src = pos;
         }
         dfield = GWY_DATA_FIELD(gwy_data_field_new(xres, yres, xreal, yreal,
                                                    FALSE));
@@ -1376,19 +1894,21 @@ text_dump_import(gchar *buffer,
         gwy_object_unref(uz);
         d = gwy_data_field_get_data(dfield);
 #if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-        memcpy(d, pos, n);
+        memcpy(d, src, n);
 #else
-        gwy_memcpy_byte_swap(pos, (guint8*)d,
+        gwy_memcpy_byte_swap(src, (guint8*)d,
                              sizeof(gdouble), xres*yres, sizeof(gdouble)-1);
 #endif
-        pos += n;
-        val = gwy_str_next_line(&pos);
-        if (!gwy_strequal(val, "]]")) {
-            g_set_error(error, GWY_MODULE_FILE_ERROR,
-                        GWY_MODULE_FILE_ERROR_DATA,
-                        _("Missing end of data field marker."));
-            gwy_object_unref(dfield);
-            goto fail;
+        if (!is_shared) {
+            pos += n;
+            val = gwy_str_next_line(&pos);
+            if (!gwy_strequal(val, "]]")) {
+                g_set_error(error, GWY_MODULE_FILE_ERROR,
+                            GWY_MODULE_FILE_ERROR_DATA,
+                            _("Missing end of data field marker."));
+                gwy_object_unref(dfield);
+                goto fail;
+            }
         }
         gwy_container_remove_by_prefix(data, line);
         gwy_container_set_object_by_name(data, line, dfield);
@@ -0,0 +1,179 @@
+/*
+ *  $Id$
+ *  Copyright (C) 2022 David Necas (Yeti), Petr Klapetek.
+ *  E-mail: yeti@gwyddion.net, klapetek@gwyddion.net.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GWY_PROCESS_CELL_LIST_H__
+#define __GWY_PROCESS_CELL_LIST_H__
+
+#include <math.h>
+#include <glib.h>
+
+/* Lennard-Jones interactions are neglected beyond this distance, in units of σ.  The potential is 1.6 % of its
+ * minimum depth there. */
+#define LJ_CUTOFF 2.5
+
+/* Uniform grid of cells in the xy-plane for neighbour searches in particle simulations.  Particles sit on top of
+ * a surface so binning in z would not help.
+ *
+ * Each cell holds a doubly linked list of particles.  Inserting a particle and moving it to another cell are O(1), so
+ * updating the list after all particles move is O(N) and only touches particles which actually crossed a cell
+ * boundary.  Particles outside the area are put into the nearest edge cell.  This keeps searches exact because
+ * clamping never increases the cell distance of two particles. */
+typedef struct {
+    gdouble cellsize;
+    gint xcells;
+    gint ycells;
+    gint nparticles;
+    gint *head;    /* First particle in each cell, -1 if empty. */
+    gint *next;    /* Next particle in the same cell, -1 if last. */
+    gint *prev;    /* Previous particle in the same cell, -1 if first. */
+    gint *cell;    /* Cell of each particle, -1 if not in the list. */
+} CellList;
+
+/* The cell size should be about the largest interaction range.  It is only a performance parameter; searches with any
+ * radius are correct.  The number of cells is limited to a small multiple of the number of particles to keep memory
+ * footprint proportional to the simulation size. */
+G_GNUC_UNUSED
+static CellList*
+cell_list_new(gdouble xreal, gdouble yreal, gdouble cellsize, gint nparticles)
+{
+    CellList *clist;
+    gdouble maxcells = 4.0*MAX(nparticles, 16);
+    gint i;
+
+    g_return_val_if_fail(xreal > 0.0 && yreal > 0.0, NULL);
+    g_return_val_if_fail(nparticles >= 0, NULL);
+
+    clist = g_new0(CellList, 1);
+    if (!(cellsize > 0.0))
+        cellsize = MAX(xreal, yreal);
+    if (xreal/cellsize * yreal/cellsize > maxcells)
+        cellsize = sqrt(xreal*yreal/maxcells);
+
+    clist->cellsize = cellsize;
+    clist->xcells = MAX((gint)ceil(xreal/cellsize), 1);
+    clist->ycells = MAX((gint)ceil(yreal/cellsize), 1);
+    clist->nparticles = nparticles;
+    clist->head = g_new(gint, clist->xcells*clist->ycells);
+    clist->next = g_new(gint, nparticles);
+    clist->prev = g_new(gint, nparticles);
+    clist->cell = g_new(gint, nparticles);
+    for (i = 0; i < clist->xcells*clist->ycells; i++)
+        clist->head[i] = -1;
+    for (i = 0; i < nparticles; i++)
+        clist->next[i] = clist->prev[i] = clist->cell[i] = -1;
+
+    return clist;
+}
+
+G_GNUC_UNUSED
+static void
+cell_list_free(CellList *clist)
+{
+    if (!clist)
+        return;
+
+    g_free(clist->head);
+    g_free(clist->next);
+    g_free(clist->prev);
+    g_free(clist->cell);
+    g_free(clist);
+}
+
+static inline gint
+cell_list_coord(gdouble t, gdouble cellsize, gint ncells)
+{
+    t = floor(t/cellsize);
+    /* Also catches NaNs. */
+    if (!(t >= 0.0))
+        return 0;
+    if (t >= ncells)
+        return ncells-1;
+    return (gint)t;
+}
+
+G_GNUC_UNUSED
+static void
+cell_list_remove(CellList *clist, gint k)
+{
+    gint c = clist->cell[k], p = clist->prev[k], n = clist->next[k];
+
+    if (c < 0)
+        return;
+
+    if (p >= 0)
+        clist->next[p] = n;
+    else
+        clist->head[c] = n;
+    if (n >= 0)
+        clist->prev[n] = p;
+
+    clist->next[k] = clist->prev[k] = clist->cell[k] = -1;
+}
+
+/* Inserts particle @k into the list or moves it to the cell corresponding to its new position.  Must not be run
+ * concurrently for the same list. */
+G_GNUC_UNUSED
+static void
+cell_list_place(CellList *clist, gint k, gdouble x, gdouble y)
+{
+    gint c;
+
+    c = (cell_list_coord(y, clist->cellsize, clist->ycells)*clist->xcells
+         + cell_list_coord(x, clist->cellsize, clist->xcells));
+    if (c == clist->cell[k])
+        return;
+
+    cell_list_remove(clist, k);
+    clist->cell[k] = c;
+    clist->prev[k] = -1;
+    clist->next[k] = clist->head[c];
+    if (clist->head[c] >= 0)
+        clist->prev[clist->head[c]] = k;
+    clist->head[c] = k;
+}
+
+/* Fills @neighbours with indices of all particles in cells which intersect the square of half-side @radius centred
+ * at (@x,@y).  The caller must check the distances; the candidates are a superset of particles within @radius.  Only
+ * reads the list so it can be run from multiple threads, each with its own array. */
+G_GNUC_UNUSED
+static guint
+cell_list_gather(const CellList *clist, gdouble x, gdouble y, gdouble radius, GArray *neighbours)
+{
+    gint ifrom, ito, jfrom, jto, i, j, k;
+
+    g_array_set_size(neighbours, 0);
+    jfrom = cell_list_coord(x - radius, clist->cellsize, clist->xcells);
+    jto = cell_list_coord(x + radius, clist->cellsize, clist->xcells);
+    ifrom = cell_list_coord(y - radius, clist->cellsize, clist->ycells);
+    ito = cell_list_coord(y + radius, clist->cellsize, clist->ycells);
+    for (i = ifrom; i <= ito; i++) {
+        for (j = jfrom; j <= jto; j++) {
+            for (k = clist->head[i*clist->xcells + j]; k >= 0; k = clist->next[k])
+                g_array_append_val(neighbours, k);
+        }
+    }
+
+    return neighbours->len;
+}
+
+#endif
+
+/* vim: set cin columns=120 tw=118 et ts=4 sw=4 cino=>1s,e0,n0,f0,{0,}0,^0,\:1s,=0,g1s,h0,t0,+1s,c3,(0,u0 : */
@@ -22,6 +22,7 @@
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwyrandgenset.h>
 #include <libgwyddion/gwythreads.h>
+#include <libgwyddion/gwyomp.h>
 #include <libprocess/stats.h>
 #include <libprocess/arithmetic.h>
 #include <libprocess/inttrans.h>
@@ -30,6 +31,7 @@
 #include <app/gwyapp.h>
 #include <app/gwymoduleutils-synth.h>
 #include "preview.h"
+#include "celllist.h"
 
 #define RUN_MODES (GWY_RUN_IMMEDIATE | GWY_RUN_INTERACTIVE)
 
@@ -44,7 +46,7 @@
 // N+1. run noninteractive or interactive with function N at end
 
 enum {
-    MAXN = 10000,
+    MAXN = 100000,
 };
 
 enum {
@@ -430,7 +432,7 @@ lj_potential_grad_spheres(gdouble ax, gdouble ay, gdouble az, gdouble bx, gdoubl
     gdouble dist2 = dx*dx + dy*dy + dz*dz;
     gdouble s2 = sigma*sigma, s4, s6, s12, d4, d8, d14, c;
 
-    if (asize <= 0.0 || bsize <= 0.0 || dist2 <= 0.1*s2)
+    if (asize <= 0.0 || bsize <= 0.0 || dist2 <= 0.1*s2 || dist2 >= LJ_CUTOFF*LJ_CUTOFF*s2)
         return;
 
     s4 = s2*s2;
@@ -472,6 +474,7 @@ integrate_lj_substrate(const gdouble *zldata, gint xres, gint yres, gdouble dx,
 
 static gboolean
 try_to_add_particle(GwyXYZ *r, gdouble *rdisizes, gint ndeposited,
+                    CellList *clist, GArray *neighbours,
                     const gdouble *zldata, gint xres, gint yres,
                     gdouble dx, gdouble dy,
                     gdouble size, gdouble size_noise,
@@ -479,7 +482,7 @@ try_to_add_particle(GwyXYZ *r, gdouble *rdisizes, gint ndeposited,
 {
     GwyXYZ rnew;
     gdouble disize;
-    gint xpos, ypos, k;
+    gint xpos, ypos, k, m, nn;
 
     size += gwy_rand_gen_set_gaussian(rngset, 0, size_noise);
     size = fmax(size, size/100.0);
@@ -495,8 +498,14 @@ try_to_add_particle(GwyXYZ *r, gdouble *rdisizes, gint ndeposited,
     rnew.y = ypos*dy;
     rnew.z = zldata[ypos*xres + xpos] + size;
 
-    for (k = 0; k < ndeposited; k++) {
-        gdouble dxk = rnew.x - r[k].x, dyk = rnew.y - r[k].y, dzk = rnew.z - r[k].z;
+    nn = cell_list_gather(clist, rnew.x, rnew.y, 2.0*size, neighbours);
+    for (m = 0; m < nn; m++) {
+        gdouble dxk, dyk, dzk;
+
+        k = g_array_index(neighbours, gint, m);
+        dxk = rnew.x - r[k].x;
+        dyk = rnew.y - r[k].y;
+        dzk = rnew.z - r[k].z;
         if (dxk*dxk + dyk*dyk + dzk*dzk < 4.0*size*size)
             return FALSE;
     }
@@ -505,6 +514,7 @@ try_to_add_particle(GwyXYZ *r, gdouble *rdisizes, gint ndeposited,
     r[ndeposited].x = rnew.x;
     r[ndeposited].y = rnew.y;
     r[ndeposited].z = rnew.z;
+    cell_list_place(clist, ndeposited, rnew.x, rnew.y);
     return TRUE;
 }
 
@@ -539,7 +549,10 @@ execute(ModuleArgs *args, GtkWindow *wait_window, gint *pndeposited)
     gdouble xreal, yreal, diff, dx, dy;
     gdouble *rdisizes = NULL, *extdata;
     GwyXYZ *r = NULL, *v = NULL, *a = NULL, *f = NULL;
-    gint i, k, nloc, maxloc = 1, maxsteps = 10000;
+    CellList *clist = NULL;
+    GArray *neighbours = NULL;
+    gint i, k, nloc, maxloc = 1, maxsteps;
+    gdouble maxsize = 0.0;
     gdouble preview_time = (animated ? 1.25 : 0.0);
     gdouble norm;
     GTimer *timer;
@@ -594,14 +607,22 @@ execute(ModuleArgs *args, GtkWindow *wait_window, gint *pndeposited)
     v = g_new0(GwyXYZ, nparticles);
     a = g_new0(GwyXYZ, nparticles);
     f = g_new(GwyXYZ, nparticles);
+    /* Neighbour searches only look at cells within the LJ cutoff so the simulation cost is linear in the number of
+     * particles. */
+    clist = cell_list_new(xreal, yreal, LJ_CUTOFF*0.82*2.0*(size + size_noise), nparticles);
+    neighbours = g_array_new(FALSE, FALSE, sizeof(gint));
 
     ndeposited = steps = 0;
+    maxsteps = MAX(10000, 2*nparticles);
     if (!gwy_app_wait_set_message(_("Initial particle set...")))
         goto end;
 
     while (ndeposited < nparticles && steps < maxsteps) {
-        if (try_to_add_particle(r, rdisizes, ndeposited, extdata, xres, yres, dx, dy, size, size_noise, rng, rngset))
+        if (try_to_add_particle(r, rdisizes, ndeposited, clist, neighbours, extdata, xres, yres, dx, dy,
+                                size, size_noise, rng, rngset)) {
+            maxsize = fmax(maxsize, rdisizes[ndeposited]);
             ndeposited++;
+        }
         steps++;
     };
 
@@ -618,46 +639,63 @@ execute(ModuleArgs *args, GtkWindow *wait_window, gint *pndeposited)
         if (ndeposited < nparticles && i < 3*revise/4) {
             nloc = 0;
             while (ndeposited < nparticles && nloc < maxloc) {
-                if (try_to_add_particle(r, rdisizes, ndeposited, extdata, xres, yres, dx, dy, size, size_noise,
-                                        rng, rngset))
+                if (try_to_add_particle(r, rdisizes, ndeposited, clist, neighbours, extdata, xres, yres, dx, dy,
+                                        size, size_noise, rng, rngset)) {
+                    maxsize = fmax(maxsize, rdisizes[ndeposited]);
                     ndeposited++;
+                }
                 nloc++;
             };
         }
 
         /* test succesive LJ steps on substrate */
 #ifdef _OPENMP
-#pragma omp parallel for if (gwy_threads_are_enabled()) default(none) \
+#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
             private(k) \
-            shared(r,f,ndeposited,rdisizes,diff,extdata,xres,yres,dx,dy)
+            shared(r,f,clist,rdisizes,maxsize,diff,extdata,xres,yres,dx,dy)
 #endif
-        for (k = 0; k < ndeposited; k++) {
-            gdouble rxk = r[k].x, ryk = r[k].y, rzk = r[k].z, sizek = rdisizes[k];
-            GwyXYZ fk = { 0.0, 0.0, 0.0 };
-            gint m;
-
-            if (rxk/dx < 0.0 || rxk/dx >= xres || ryk/dy < 0.0 || ryk/dy >= yres) {
-                f[k] = fk;
-                continue;
-            }
-
-            /* Forces from other particles. */
-            for (m = 0; m < ndeposited; m++) {
-                if (m != k)
-                    lj_potential_grad_spheres(r[m].x, r[m].y, r[m].z, rxk, ryk, rzk, sizek, rdisizes[m], &fk);
+        {
+            GArray *tneighbours = g_array_new(FALSE, FALSE, sizeof(gint));
+            gint ncells = clist->xcells*clist->ycells;
+            gint cfrom = gwy_omp_chunk_start(ncells), cto = gwy_omp_chunk_end(ncells);
+            gint c;
+
+            for (c = cfrom; c < cto; c++) {
+                for (k = clist->head[c]; k >= 0; k = clist->next[k]) {
+                    gdouble rxk = r[k].x, ryk = r[k].y, rzk = r[k].z, sizek = rdisizes[k];
+                    GwyXYZ fk = { 0.0, 0.0, 0.0 };
+                    const gint *nb;
+                    gint m, nn;
+
+                    if (rxk/dx < 0.0 || rxk/dx >= xres || ryk/dy < 0.0 || ryk/dy >= yres) {
+                        f[k] = fk;
+                        continue;
+                    }
+
+                    /* Forces from other particles within the cutoff. */
+                    nn = cell_list_gather(clist, rxk, ryk, LJ_CUTOFF*0.82*(sizek + maxsize), tneighbours);
+                    nb = &g_array_index(tneighbours, gint, 0);
+                    for (m = 0; m < nn; m++) {
+                        if (nb[m] != k) {
+                            lj_potential_grad_spheres(r[nb[m]].x, r[nb[m]].y, r[nb[m]].z, rxk, ryk, rzk,
+                                                      sizek, rdisizes[nb[m]], &fk);
+                        }
+                    }
+
+                    /* Force from substracte.
+                     * FIXME: This one is strange and cannot be differentiated exactly until the rounding is replaced
+                     * by some continous surface height interpolation.  */
+                    fk.x -= (integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk+diff, ryk, rzk, sizek)
+                             - integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk-diff, ryk, rzk, sizek))/2/diff;
+                    fk.y -= (integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk-diff, rzk, sizek)
+                             - integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk+diff, rzk, sizek))/2/diff;
+                    fk.z -= (integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk, rzk+diff, sizek)
+                             - integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk, rzk-diff, sizek))/2/diff;
+
+                    f[k] = fk;
+                }
             }
-
-            /* Force from substracte.
-             * FIXME: This one is strange and cannot be differentiated exactly until the rounding is replaced by some
-             * continous surface height interpolation.  */
-            fk.x -= (integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk+diff, ryk, rzk, sizek)
-                     - integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk-diff, ryk, rzk, sizek))/2/diff;
-            fk.y -= (integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk-diff, rzk, sizek)
-                     - integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk+diff, rzk, sizek))/2/diff;
-            fk.z -= (integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk, rzk+diff, sizek)
-                     - integrate_lj_substrate(extdata, xres, yres, dx, dy, rxk, ryk, rzk-diff, sizek))/2/diff;
-
-            f[k] = fk;
+            g_array_free(tneighbours, TRUE);
         }
 
 #ifdef _OPENMP
@@ -687,6 +725,10 @@ execute(ModuleArgs *args, GtkWindow *wait_window, gint *pndeposited)
             a[k] = ak;
         }
 
+        /* Only particles which crossed a cell boundary are actually relinked. */
+        for (k = 0; k < ndeposited; k++)
+            cell_list_place(clist, k, r[k].x, r[k].y);
+
         if (i % 100 == 99) {
             GwySynthUpdateType update = gwy_synth_update_progress(timer, preview_time, i, revise);
 
@@ -713,6 +755,9 @@ end:
     g_free(v);
     g_free(a);
     g_free(f);
+    cell_list_free(clist);
+    if (neighbours)
+        g_array_free(neighbours, TRUE);
 
     gwy_rand_gen_set_free(rngset);
 
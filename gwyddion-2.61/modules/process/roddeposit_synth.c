@@ -26,6 +26,8 @@
 #include <libgwyddion/gwymacros.h>
 #include <libgwyddion/gwymath.h>
 #include <libgwyddion/gwyrandgenset.h>
+#include <libgwyddion/gwythreads.h>
+#include <libgwyddion/gwyomp.h>
 #include <libprocess/stats.h>
 #include <libprocess/arithmetic.h>
 #include <libprocess/inttrans.h>
@@ -34,6 +36,7 @@
 #include <app/gwyapp.h>
 #include "dimensions.h"
 #include "preview.h"
+#include "celllist.h"
 
 #define RODDEPOSIT_SYNTH_RUN_MODES (GWY_RUN_IMMEDIATE | GWY_RUN_INTERACTIVE)
 
@@ -1150,7 +1153,7 @@ showit2(GwyDataField *lfield, GwyDataField *dfield,
 
 
 
-/*lj potential between two particles*/
+/*lj potential between two particles, shifted to zero at the cutoff distance*/
 static gdouble
 get_lj_potential_spheres(gdouble ax, gdouble ay, gdouble az, gdouble bx, gdouble by, gdouble bz, gdouble asize, gdouble bsize, gdouble factor)
 {
@@ -1159,10 +1162,12 @@ get_lj_potential_spheres(gdouble ax, gdouble ay, gdouble az, gdouble bx, gdouble
                     + (ay-by)*(ay-by)
                     + (az-bz)*(az-bz));
 
-    if ((asize>0 && bsize>0) && dist > asize/100) {
+    if ((asize>0 && bsize>0) && dist > asize/100
+        && dist < LJ_CUTOFF*LJ_CUTOFF*sigma*sigma) {
         gdouble s2 = sigma*sigma, s4 = s2*s2, s6 = s4*s2, s12 = s6*s6;
         gdouble d3 = dist*dist*dist, d6 = d3*d3;
-        return (asize)*factor*1e-10*(s12/d6 - s6/d3);
+        gdouble c2 = 1.0/(LJ_CUTOFF*LJ_CUTOFF), c6 = c2*c2*c2;
+        return (asize)*factor*1e-10*(s12/d6 - s6/d3 - (c6*c6 - c6));
     }
     //return (asize)*3e-5*(pow(sigma, 12)/pow(dist, 6) - pow(sigma, 6)/pow(dist, 3)); //corrected for particle size
     else return 0;
@@ -1231,14 +1236,14 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
                  gboolean *success, gboolean outdata,
                  gdouble **oxdata, gdouble **oydata, gdouble **ozdata, gdouble **ordata, gint *ondata)
 {
-    gint i, ii, j, m, k;
+    gint i, ii, j, k, nn;
     GwyRandGenSet *rngset;
     GRand *rng;
     GwyDataField *surface=NULL, *lfield, *zlfield, *zdfield; //FIXME all of them?
     gint xres, yres, oxres, oyres, ndata, steps;
     gdouble xreal, yreal, oxreal, oyreal, diff;
     gdouble size, width;
-    gdouble mass=1,  timestep = 0.5, rxv, ryv, rzv, zval;
+    gdouble mass=1,  timestep = 0.5, rxv, ryv, rzv;
     gint add, presetval;
     gint *xdata, *ydata;
     gdouble *disizes, *rdisizes;
@@ -1247,7 +1252,9 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
     gdouble *ax, *ay, *az;
     gdouble *fx, *fy, *fz;
     gint *bp, *active;
-    gdouble disize;
+    CellList *clist;
+    GArray *neighbours;
+    gdouble disize, maxsize = 0.0;
     gint xpos, ypos, too_close;
     gint nloc, maxloc = 1;
     gint max = 50000000;
@@ -1331,6 +1338,7 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
     fz = g_new(gdouble, presetval);
     bp = g_new0(gint, presetval);    // list of triplets (having the same value)
     active = g_new0(gint, presetval); // list of reasonably located particles
+    neighbours = g_array_new(FALSE, FALSE, sizeof(gint));
 
 
     /*allocate field with increased size, do all the computation and cut field back, return dfield again*/
@@ -1360,6 +1368,11 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
     zlfield = gwy_data_field_duplicate(lfield);
     zdfield = gwy_data_field_duplicate(dfield);
 
+    /* Neighbour searches only look at cells within the LJ cutoff so the
+     * simulation cost is linear in the number of particles. */
+    clist = cell_list_new(xreal, yreal, LJ_CUTOFF*0.82*2.0*(size + width),
+                          presetval);
+
     ndata = steps = ntr = 0;
 
     width_from = G_MAXDOUBLE;
@@ -1403,7 +1416,10 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
                 angle = G_PI*g_rand_double(rng);
                 aspect = (args->aspect + gwy_rand_gen_set_gaussian(rngset, 0, args->aspect_noise)) - 1.0;
 
-                for (k = 0; k < ndata; k++) {
+                nn = cell_list_gather(clist, rxv, ryv, sqrt(10.0)*size,
+                                      neighbours);
+                for (j = 0; j < nn; j++) {
+                    k = g_array_index(neighbours, gint, j);
                     if (((rxv-rx[k])*(rxv-rx[k])
                          + (ryv-ry[k])*(ryv-ry[k])
                          + (rzv-rz[k])*(rzv-rz[k])) < 10.0*size*size) {
@@ -1414,7 +1430,7 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
                 if (too_close)
                     continue;
 
-                if (ndata >= 10000)
+                if (ndata + 3 > presetval)
                     break;
 
 
@@ -1458,6 +1474,10 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
 
                 //printf("adding triplet %d of size %g to %d %d %d   %g %g %g\n", ntr, rdisizes[ndata], ndata-2, ndata-1, ndata, rx[ndata], ry[ndata], rz[ndata]);
 
+                for (k = ndata-2; k <= ndata; k++)
+                    cell_list_place(clist, k, rx[k], ry[k]);
+                maxsize = MAX(maxsize, size);
+
                 ntr++;
                 ndata++;
                 nloc++;
@@ -1469,51 +1489,67 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
 
 
         /*calculate forces for all the active particles*/
-        for (k = 0; k < ndata; k++) {
-
-            if (active[k]==0) continue;
-
-
-            fx[k] = fy[k] = fz[k] = 0;
-            /*calculate forces for all particles on substrate*/
-
-            if (gwy_data_field_rtoi(lfield, rx[k]) < 0
-                || gwy_data_field_rtoj(lfield, ry[k]) < 0
-                || gwy_data_field_rtoi(lfield, rx[k]) >= xres
-                || gwy_data_field_rtoj(lfield, ry[k]) >= yres)
-                continue;
-
-            for (m = 0; m < ndata; m++) {
-                if (m == k || bp[m] == bp[k])
-                    continue;
-
-                fx[k] -= (get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k]+diff, ry[k], rz[k], rdisizes[k], rdisizes[m], args->ljparticle)
-                              -get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k]-diff, ry[k], rz[k], rdisizes[k], rdisizes[m], args->ljparticle))/2/diff;
-                fy[k] -= (get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k]+diff, rz[k], rdisizes[k], rdisizes[m], args->ljparticle)
-                              -get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k]-diff, rz[k], rdisizes[k], rdisizes[m], args->ljparticle))/2/diff;
-                fz[k] -= (get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k], rz[k]+diff, rdisizes[k], rdisizes[m], args->ljparticle)
-                              -get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k], rz[k]-diff, rdisizes[k], rdisizes[m], args->ljparticle))/2/diff;
-
-            }
-            zval = gwy_data_field_get_val(lfield, CLAMP(gwy_data_field_rtoi(zlfield, rx[k]), 0, gwy_data_field_get_xres(zlfield)-1),
-                                          CLAMP(gwy_data_field_rtoi(zlfield, ry[k]), 0, gwy_data_field_get_yres(zlfield)-1));
-
+#ifdef _OPENMP
+#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
+            private(k) \
+            shared(clist,active,bp,rx,ry,rz,vx,vy,fx,fy,fz,rdisizes,maxsize,diff,lfield,zlfield,xres,yres,size,args)
+#endif
+        {
+            GArray *tneighbours = g_array_new(FALSE, FALSE, sizeof(gint));
+            gint ncells = clist->xcells*clist->ycells;
+            gint cfrom = gwy_omp_chunk_start(ncells), cto = gwy_omp_chunk_end(ncells);
+            const gint *nb;
+            gdouble zk;
+            gint c, m, n, nnk;
+
+            for (c = cfrom; c < cto; c++) {
+                for (k = clist->head[c]; k >= 0; k = clist->next[k]) {
+                    if (active[k]==0) continue;
+
+                    fx[k] = fy[k] = fz[k] = 0;
+                    /*calculate forces for all particles on substrate*/
+
+                    if (gwy_data_field_rtoi(lfield, rx[k]) < 0
+                        || gwy_data_field_rtoj(lfield, ry[k]) < 0
+                        || gwy_data_field_rtoi(lfield, rx[k]) >= xres
+                        || gwy_data_field_rtoj(lfield, ry[k]) >= yres)
+                        continue;
+
+                    /*only particles within the LJ cutoff contribute*/
+                    nnk = cell_list_gather(clist, rx[k], ry[k], LJ_CUTOFF*0.82*(rdisizes[k] + maxsize) + diff,
+                                           tneighbours);
+                    nb = &g_array_index(tneighbours, gint, 0);
+                    for (n = 0; n < nnk; n++) {
+                        m = nb[n];
+                        if (m == k || bp[m] == bp[k])
+                            continue;
+
+                        fx[k] -= (get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k]+diff, ry[k], rz[k], rdisizes[k], rdisizes[m], args->ljparticle)
+                                      -get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k]-diff, ry[k], rz[k], rdisizes[k], rdisizes[m], args->ljparticle))/2/diff;
+                        fy[k] -= (get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k]+diff, rz[k], rdisizes[k], rdisizes[m], args->ljparticle)
+                                      -get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k]-diff, rz[k], rdisizes[k], rdisizes[m], args->ljparticle))/2/diff;
+                        fz[k] -= (get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k], rz[k]+diff, rdisizes[k], rdisizes[m], args->ljparticle)
+                                      -get_lj_potential_spheres(rx[m], ry[m], rz[m], rx[k], ry[k], rz[k]-diff, rdisizes[k], rdisizes[m], args->ljparticle))/2/diff;
 
-            fz[k] -= (integrate_lj_substrate(zval, rz[k]+diff, rdisizes[k], args->ljsurface)
-                    - integrate_lj_substrate(zval, rz[k]-diff, rdisizes[k], args->ljsurface))/2/diff;
+                    }
+                    zk = gwy_data_field_get_val(lfield, CLAMP(gwy_data_field_rtoi(zlfield, rx[k]), 0, gwy_data_field_get_xres(zlfield)-1),
+                                                CLAMP(gwy_data_field_rtoi(zlfield, ry[k]), 0, gwy_data_field_get_yres(zlfield)-1));
 
-            
+                    fz[k] -= (integrate_lj_substrate(zk, rz[k]+diff, rdisizes[k], args->ljsurface)
+                            - integrate_lj_substrate(zk, rz[k]-diff, rdisizes[k], args->ljsurface))/2/diff;
 
-            //effects on surface
-            if ((rz[k]-zval)>1.2*size) {
-                 fz[k] -= args->gravity*1e-7; //some 'gravity' everywhere to let it fall down even from large heights where integrated L-J is almost zero
+                    //effects on surface
+                    if ((rz[k]-zk)>1.2*size) {
+                         fz[k] -= args->gravity*1e-7; //some 'gravity' everywhere to let it fall down even from large heights where integrated L-J is almost zero
 
-            } else {
-               vx[k] *= args->mobility;
-               vy[k] *= args->mobility;
+                    } else {
+                       vx[k] *= args->mobility;
+                       vy[k] *= args->mobility;
 
+                    }
+                }
             }
-
+            g_array_free(tneighbours, TRUE);
         }
 
 
@@ -1562,6 +1598,14 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
 
         }
 
+        //relink particles which crossed a cell boundary
+        for (k=0; k<ndata; k++)
+        {
+            if (active[k]==0) continue;
+
+            cell_list_place(clist, k, rx[k], ry[k]);
+        }
+
         //exclude what is no more usable (only deactivate it)
         for (k=0; k<ndata; k++)
         {
@@ -1917,6 +1961,8 @@ rod_deposit_synth_do(const RodDepositSynthArgs *args,
     g_free(fy);
     g_free(fz);
     g_free(bp);
+    cell_list_free(clist);
+    g_array_free(neighbours, TRUE);
 
     gwy_rand_gen_set_free(rngset);
 
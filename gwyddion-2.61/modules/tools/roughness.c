@@ -1151,7 +1151,7 @@ static void
 gwy_tool_roughness_update_parameters(GwyToolRoughness *tool)
 {
     GwyDataLine *roughness, *waviness, *texture;
-    gdouble ra, rq, da, dq, rp, rv, rpm, rvm, rtm, l0, real;
+    gdouble ra, rq, rsk, rku, wa, wq, da, dq, rp, rv, rpm, rvm, rtm, l0, real;
 
     roughness = tool->profiles.roughness;
     waviness = tool->profiles.waviness;
@@ -1167,8 +1167,8 @@ gwy_tool_roughness_update_parameters(GwyToolRoughness *tool)
     /* This should essentially do nothing but it is safe. */
     gwy_data_line_add(roughness, -gwy_data_line_get_avg(roughness));
 
-    ra = gwy_data_line_get_ra(roughness);
-    rq = gwy_data_line_get_rms(roughness);
+    gwy_data_line_get_stats(roughness, NULL, &ra, &rq, &rsk, &rku);
+    gwy_data_line_get_stats(waviness, NULL, &wa, &wq, NULL, NULL);
     rv = gwy_data_line_get_xvm(roughness, 1, 1);
     rp = gwy_data_line_get_xpm(roughness, 1, 1);
     rvm = gwy_data_line_get_xvm(roughness, 5, 1);
@@ -1186,10 +1186,10 @@ gwy_tool_roughness_update_parameters(GwyToolRoughness *tool)
                             "Rz", gwy_tool_roughness_Xz(roughness),
                             "RzISO", rtm,
                             "Ry", gwy_tool_roughness_Ry(roughness),
-                            "Rsk", gwy_data_line_get_skew(roughness),
-                            "Rku", gwy_data_line_get_kurtosis(roughness) + 3.0,
-                            "Wa", gwy_data_line_get_ra(waviness),
-                            "Wq", gwy_data_line_get_rms(waviness),
+                            "Rsk", rsk,
+                            "Rku", rku + 3.0,
+                            "Wa", wa,
+                            "Wq", wq,
                             "Wy", gwy_data_line_get_xtm(waviness, 1, 1),
                             "Pt", gwy_data_line_get_xtm(texture, 1, 1),
                             "Deltaa", da,
@@ -690,6 +690,7 @@ gwy_tool_stats_calculate(GwyToolStats *tool)
     GwyMaskingType masking;
     GwyResults *results = tool->results;
     StatsUncertanties unc;
+    GwyStatsSummary summary;
     gdouble xoff, yoff, q;
     gdouble min, max, avg, median, Sa, rms, rms_gw, skew, kurtosis,
             projarea, area, Sdq, volume, var, phi, theta, linedis;
@@ -721,54 +722,40 @@ gwy_tool_stats_calculate(GwyToolStats *tool)
         mask = NULL;
     }
 
+    /* Everything which can be calculated in one sweep over the data.  This
+     * matters with instant updates on large images. */
+    gwy_data_field_area_get_stats_summary(field, mask, masking, col, row, w, h,
+                                          &summary);
+    nn = summary.n;
     q = gwy_data_field_get_dx(field) * gwy_data_field_get_dy(field);
-    if (mask) {
-        if (masking == GWY_MASK_INCLUDE)
-            gwy_data_field_area_count_in_range(mask, NULL, col, row, w, h,
-                                               0.0, 0.0, &nn, NULL);
-        else
-            gwy_data_field_area_count_in_range(mask, NULL, col, row, w, h,
-                                               1.0, 1.0, NULL, &nn);
-        nn = w*h - nn;
-    }
-    else
-        nn = w*h;
     projarea = nn * q;
     /* TODO: do something more reasonable when nn == 0 */
 
-    gwy_data_field_area_get_min_max_mask(field, mask, masking, col, row, w, h,
-                                         &min, &max);
-    gwy_data_field_area_get_stats_mask(field, mask, masking, col, row, w, h,
-                                       &avg, &Sa, &rms, &skew, &kurtosis);
-    rms_gw = gwy_data_field_area_get_grainwise_rms(field, mask, masking,
-                                                   col, row, w, h);
-    median = gwy_data_field_area_get_median_mask(field, mask, masking,
-                                                 col, row, w, h);
-    var = gwy_data_field_area_get_variation(field, mask, masking,
-                                            col, row, w, h);
-    Sdq = gwy_data_field_area_get_surface_slope_mask(field, mask, masking,
-                                                     col, row, w, h);
-
-    linedis = gwy_data_field_scan_line_discrepancy(field, mask, masking,
-                                                   col, row, w, h);
-    if (linedis > 0.0) {
-        linedis /= sqrt(gwy_data_field_area_get_mean_square(field,
-                                                            mask, masking,
-                                                            col, row, w, h));
-    }
-
-    if (tool->same_units) {
-        area = gwy_data_field_area_get_surface_area_mask(field, mask, masking,
-                                                         col, row, w, h);
+    min = summary.min;
+    max = summary.max;
+    avg = summary.avg;
+    Sa = summary.ra;
+    rms = summary.rms;
+    skew = summary.skew;
+    kurtosis = summary.kurtosis;
+    median = summary.median;
+    var = summary.variation;
+    Sdq = summary.slope;
+    volume = summary.volume;
+    /* Only makes sense if lateral dimensions and values are the same. */
+    area = tool->same_units ? summary.surface_area : 0.0;
+
+    /* Without mask there is just one grain. */
+    if (mask) {
+        rms_gw = gwy_data_field_area_get_grainwise_rms(field, mask, masking,
+                                                       col, row, w, h);
     }
     else
-        area = 0.0;   /* Silly GCC. */
-
-    volume = gwy_data_field_area_get_volume(field, NULL, mask, col, row, w, h);
-    if (masking == GWY_MASK_EXCLUDE) {
-        volume = gwy_data_field_area_get_volume(field, NULL, NULL,
-                                                col, row, w, h) - volume;
-    }
+        rms_gw = rms;
+    linedis = gwy_data_field_scan_line_discrepancy(field, mask, masking,
+                                                   col, row, w, h);
+    if (linedis > 0.0)
+        linedis /= sqrt(summary.mean_square);
 
     if (tool->same_units && !mask) {
         gwy_data_field_area_get_inclination(field, col, row, w, h,
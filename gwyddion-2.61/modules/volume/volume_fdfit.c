@@ -890,10 +890,12 @@ volfit_do(VolfitControls *controls)
     FitParamArg *arg;
     VolfitArgs *args;
     GtkWidget *dialog;
-    gdouble *param, *error, *data, max;
-    gboolean *fixed;
-    gint xres, yres, newid, i, j, k, m, nparams, nfree = 0;
-    gboolean allfixed, errorknown;
+    const gdouble *curves, *xdata;
+    gdouble *ydata, *params, *errors, *data, *edata, max;
+    gboolean *fixed, *fitok;
+    gint xres, yres, zres, npixels, newid, i, k, m, n, kfrom, nparams;
+    gint nfree = 0;
+    gboolean allfixed, ok;
     GwyDataField **result;
     GwyDataField **eresult;
     GwyDataField *cresult, *chresult;
@@ -907,8 +909,6 @@ volfit_do(VolfitControls *controls)
 
     nparams = gwy_nlfit_preset_get_nparams(args->volfitfunc);
     fixed = g_newa(gboolean, nparams);
-    param = g_newa(gdouble, nparams);
-    error = g_newa(gdouble, nparams);
 
     allfixed = TRUE;
     nfree = 0;
@@ -936,60 +936,73 @@ volfit_do(VolfitControls *controls)
     gwy_data_field_fill(chresult, -1.0);
     xres = gwy_brick_get_xres(args->brick);
     yres = gwy_brick_get_yres(args->brick);
+    zres = gwy_brick_get_zres(args->brick);
+    npixels = xres*yres;
 
-    for (i = 0; i < xres; i++) {
-        for (j = 0; j < yres; j++) {
-            pick_and_normalize_data(controls->args, i, j);
-
-            for (k = 0; k < nparams; k++) {
-                arg = &g_array_index(args->param, FitParamArg, k);
-                arg->value = arg->init;
-            }
-
-            if (gwy_data_line_get_res(args->xdata) <= nfree) {
-                dialog = gtk_message_dialog_new(GTK_WINDOW(controls->dialog),
-                                                GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                GTK_MESSAGE_ERROR,
-                                                GTK_BUTTONS_OK,
-                                                _("It is necessary to select more "
-                                                  "data points than free fit "
-                                                  "parameters"));
-                gtk_dialog_run(GTK_DIALOG(dialog));
-                gtk_widget_destroy(dialog);
-                goto fail;
-            }
+    /* All curves share the abscissa, so we can pick the fitted range just once
+     * and then fit the same part of each curve. */
+    n = pick_and_normalize_data(args, 0, 0);
+    if (n <= nfree) {
+        dialog = gtk_message_dialog_new(GTK_WINDOW(controls->dialog),
+                                        GTK_DIALOG_DESTROY_WITH_PARENT,
+                                        GTK_MESSAGE_ERROR,
+                                        GTK_BUTTONS_OK,
+                                        _("It is necessary to select more "
+                                          "data points than free fit "
+                                          "parameters"));
+        gtk_dialog_run(GTK_DIALOG(dialog));
+        gtk_widget_destroy(dialog);
+        goto fail;
+    }
+    xdata = gwy_data_line_get_data_const(args->xdata);
+    kfrom = GWY_ROUND(xdata[0]*zres/gwy_brick_get_zreal(args->brick));
+
+    curves = gwy_brick_get_curves_const(args->brick);
+    ydata = g_new(gdouble, (gsize)npixels*n);
+    for (k = 0; k < npixels; k++)
+        gwy_assign(ydata + (gsize)k*n, curves + (gsize)k*zres + kfrom, n);
+    gwy_brick_invalidate(args->brick);
+
+    params = g_new(gdouble, (gsize)npixels*nparams);
+    errors = g_new(gdouble, (gsize)npixels*nparams);
+    fitok = g_new(gboolean, npixels);
+    for (k = 0; k < npixels; k++) {
+        for (m = 0; m < nparams; m++) {
+            arg = &g_array_index(args->param, FitParamArg, m);
+            params[k*nparams + m] = arg->init;
+        }
+    }
 
-            if (args->fitter)
-                gwy_math_nlfit_free(args->fitter);
-
-            for (k = 0; k < nparams; k++)
-                param[k] = g_array_index(args->param, FitParamArg, k).value;
-            args->fitter
-                = gwy_nlfit_preset_fit(args->volfitfunc, NULL,
-                                       gwy_data_line_get_res(args->xdata),
-                                       gwy_data_line_get_data_const(args->xdata),
-                                       gwy_data_line_get_data_const(args->ydata),
-                                       param, error, fixed);
-            errorknown = (args->fitter->covar != NULL);
-
-            m = 0;
-            for (k = 0; k < nparams; k++) {
-                if (!fixed[k]) {
-                    gwy_data_field_set_val(result[m], i, j, param[k]);
-                    gwy_data_field_set_val(eresult[m], i, j, error[k]);
-                    m++;
-                }
-            }
-            gwy_data_field_set_val(cresult, i, j, errorknown);
+    ok = gwy_nlfit_preset_fit_batch(args->volfitfunc, npixels, n, NULL,
+                                    xdata, ydata, params, errors, fixed, TRUE,
+                                    gwy_data_field_get_data(chresult), fitok,
+                                    gwy_app_wait_set_fraction);
+    g_free(ydata);
+    if (!ok) {
+        g_free(params);
+        g_free(errors);
+        g_free(fitok);
+        goto fail;
+    }
 
-            if (errorknown) {
-                gwy_data_field_set_val(chresult, i, j,
-                                       gwy_math_nlfit_get_dispersion(args->fitter));
+    m = 0;
+    for (k = 0; k < nparams; k++) {
+        if (!fixed[k]) {
+            data = gwy_data_field_get_data(result[m]);
+            edata = gwy_data_field_get_data(eresult[m]);
+            for (i = 0; i < npixels; i++) {
+                data[i] = params[i*nparams + k];
+                edata[i] = errors[i*nparams + k];
             }
+            m++;
         }
-        if (!gwy_app_wait_set_fraction((gdouble)i/xres))
-            goto fail;
     }
+    data = gwy_data_field_get_data(cresult);
+    for (i = 0; i < npixels; i++)
+        data[i] = fitok[i];
+    g_free(params);
+    g_free(errors);
+    g_free(fitok);
     gwy_app_wait_finish();
 
     m = 0;
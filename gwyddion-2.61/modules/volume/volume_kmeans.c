@@ -27,6 +27,7 @@
 #include <libprocess/arithmetic.h>
 #include <libprocess/stats.h>
 #include <libprocess/brick.h>
+#include <libprocess/clustering.h>
 #include <libprocess/datafield.h>
 #include <libprocess/filters.h>
 #include <libgwydgets/gwystock.h>
@@ -353,18 +354,11 @@ volume_kmeans_do(GwyContainer *container, KMeansArgs *args)
     const GwyRGBA *rgba;
     gint id;
     gchar *description;
-    GRand *rand;
-    const gdouble *data;
-    gdouble *centers, *oldcenters, *sum, *data1, *xdata, *ydata;
-    gdouble *variance, *errordata;
-    gdouble min, dist, xreal, yreal, zreal, xoffset, yoffset, zoffset;
-    gdouble epsilon = args->epsilon;
-    gint xres, yres, zres, i, j, l, c, newid;
-    gint *npix;
+    gdouble *centers, *xdata, *ydata;
+    gdouble xreal, yreal, zreal, xoffset, yoffset, zoffset;
+    gint xres, yres, zres, i, c, newid;
     gint k = args->k;
-    gint iterations = 0;
-    gint max_iterations = args->max_iterations;
-    gboolean converged = FALSE, cancelled = FALSE;
+    gboolean cancelled = FALSE;
     gboolean normalize = args->normalize;
 
     gwy_app_data_browser_get_current(GWY_APP_BRICK, &brick,
@@ -375,6 +369,8 @@ volume_kmeans_do(GwyContainer *container, KMeansArgs *args)
     xres = gwy_brick_get_xres(brick);
     yres = gwy_brick_get_yres(brick);
     zres = gwy_brick_get_zres(brick);
+    /* There cannot be more clusters than spectra. */
+    k = MIN(k, xres*yres);
     xreal = gwy_brick_get_xreal(brick);
     yreal = gwy_brick_get_yreal(brick);
     zreal = gwy_brick_get_zreal(brick);
@@ -396,223 +392,10 @@ volume_kmeans_do(GwyContainer *container, KMeansArgs *args)
     gwy_app_wait_start(gwy_app_find_window_for_volume(container, id),
                        _("Initializing..."));
 
-    if (normalize) {
+    if (normalize)
         normalized = normalize_brick(brick, intmap);
-        data = gwy_brick_get_data_const(normalized);
-    }
-    else {
-        data = gwy_brick_get_data_const(brick);
-    }
 
     centers = g_new(gdouble, zres*k);
-    oldcenters = g_new(gdouble, zres*k);
-    sum = g_new(gdouble, zres*k);
-    npix = g_new(gint, k);
-    variance = g_new(gdouble, k);
-    data1 = gwy_data_field_get_data(dfield);
-
-    rand = g_rand_new();
-    for (c = 0; c < k; c++) {
-        i = g_rand_int_range(rand, 0, xres);
-        j = g_rand_int_range(rand, 0, yres);
-        for (l = 0; l < zres; l++) {
-            *(centers + c * zres + l)
-                             = *(data + l * xres * yres + j * xres + i);
-        };
-    };
-    g_rand_free(rand);
-
-    if (!gwy_app_wait_set_message(_("K-means iteration...")))
-        cancelled = TRUE;
-
-    while (!converged && !cancelled) {
-        if (!gwy_app_wait_set_fraction((gdouble)iterations/max_iterations)) {
-            cancelled = TRUE;
-            break;
-        }
-
-        /* pixels belong to cluster with min distance */
-        for (j = 0; j < yres; j++)
-            for (i = 0; i < xres; i++) {
-                *(data1 + j * xres + i) = 0;
-                min = G_MAXDOUBLE;
-                for (c = 0; c < k; c++) {
-                    dist = 0;
-                    for (l = 0; l < zres; l++) {
-                        *(oldcenters + c * zres + l)
-                                            = *(centers + c * zres + l);
-                        dist
-                            += (*(data + l * xres * yres + j * xres + i)
-                              - *(centers + c * zres + l))
-                             * (*(data + l * xres * yres + j * xres + i)
-                              - *(centers + c * zres + l));
-                    }
-                    if (dist < min) {
-                        min = dist;
-                        *(data1 + j * xres + i) = c;
-                    }
-                }
-            }
-
-        /* new center coordinates as average of pixels */
-        for (c = 0; c < k; c++) {
-            *(npix + c) = 0;
-            for (l = 0; l < zres; l++) {
-                *(sum + c * zres + l) = 0;
-            }
-        }
-        for (i = 0; i < xres; i++) {
-            for (j = 0; j < yres; j++) {
-                c = (gint)(*(data1 + j * xres + i));
-                *(npix + c) += 1;
-                for (l = 0; l < zres; l++) {
-                    *(sum + c * zres + l)
-                            += *(data + l * xres * yres + j * xres + i);
-                }
-            }
-        }
-        for (c = 0; c < k; c++)
-            for (l = 0; l < zres; l++) {
-                *(centers + c * zres + l) = (*(npix + c) > 0) ?
-                     *(sum + c * zres + l)/(gdouble)(*(npix + c)) : 0.0;
-        }
-
-        converged = TRUE;
-        for (c = 0; c < k; c++) {
-            for (l = 0; l < zres; l++)
-                if (fabs(*(oldcenters + c * zres + l)
-                               - *(centers + c * zres + l)) > epsilon) {
-                    converged = FALSE;
-                    break;
-                }
-        }
-        if (iterations == max_iterations) {
-            converged = TRUE;
-            break;
-        }
-        iterations++;
-    }
-
-    if (cancelled) {
-        gwy_app_wait_finish();
-        goto fail;
-    }
-
-    /* second try, outliers are not counted now */
-    if (args->remove_outliers) {
-        converged = FALSE;
-        while (!converged && !cancelled) {
-            if (!gwy_app_wait_set_fraction((gdouble)iterations/max_iterations)) {
-                cancelled = TRUE;
-                break;
-            }
-
-            /* pixels belong to cluster with min distance */
-            for (j = 0; j < yres; j++)
-                for (i = 0; i < xres; i++) {
-                    *(data1 + j * xres + i) = 0;
-                    min = G_MAXDOUBLE;
-                    for (c = 0; c < k; c++) {
-                        dist = 0;
-                        for (l = 0; l < zres; l++) {
-                            *(oldcenters + c * zres + l)
-                                            = *(centers + c * zres + l);
-                            dist
-                            += (*(data + l * xres * yres + j * xres + i)
-                                            - *(centers + c * zres + l))
-                             * (*(data + l * xres * yres + j * xres + i)
-                                           - *(centers + c * zres + l));
-                        }
-                        if (dist < min) {
-                            min = dist;
-                            *(data1 + j * xres + i) = c;
-                        }
-                    }
-                }
-
-            /* variance calculation */
-            for (c = 0; c < k; c++) {
-                *(npix + c) = 0;
-                *(variance + c) = 0.0;
-            }
-
-            for (i = 0; i < xres; i++) {
-                for (j = 0; j < yres; j++) {
-                    c = (gint)(*(data1 + j * xres + i));
-                    *(npix + c) += 1;
-                    dist = 0;
-                    for (l = 0; l < zres; l++) {
-                        dist
-                            += (*(data + l * xres * yres + j * xres + i)
-                                            - *(centers + c * zres + l))
-                             * (*(data + l * xres * yres + j * xres + i)
-                                           - *(centers + c * zres + l));
-                    }
-                    *(variance + c) += dist;
-                }
-            }
-
-            for (c = 0; c < k; c++) {
-                if (*(npix + c) > 0) {
-                    *(variance + c) /= *(npix+c);
-                    *(variance + c) = sqrt(*(variance + c));
-                }
-            }
-
-            /* new center coordinates as average of pixels */
-            for (c = 0; c < k; c++) {
-                *(npix + c) = 0;
-                for (l = 0; l < zres; l++) {
-                    *(sum + c * zres + l) = 0;
-                }
-            }
-            for (i = 0; i < xres; i++) {
-                for (j = 0; j < yres; j++) {
-                    c = (gint)(*(data1 + j * xres + i));
-                    dist = 0;
-                    for (l = 0; l < zres; l++) {
-                        dist
-                            += (*(data + l * xres * yres + j * xres + i)
-                                            - *(centers + c * zres + l))
-                             * (*(data + l * xres * yres + j * xres + i)
-                                           - *(centers + c * zres + l));
-                    }
-                    if (sqrt(dist) < args->outliers_threshold * (*(variance + c))) {
-                        *(npix + c) += 1;
-                        for (l = 0; l < zres; l++) {
-                            *(sum + c * zres + l)
-                            += *(data + l * xres * yres + j * xres + i);
-                        }
-                    }
-                }
-            }
-            for (c = 0; c < k; c++)
-                for (l = 0; l < zres; l++) {
-                    *(centers + c * zres + l) = (*(npix + c) > 0) ?
-                         *(sum + c * zres + l)/(gdouble)(*(npix + c)) : 0.0;
-            }
-
-            converged = TRUE;
-            for (c = 0; c < k; c++) {
-                for (l = 0; l < zres; l++)
-                    if (fabs(*(oldcenters + c * zres + l)
-                                   - *(centers + c * zres + l)) > epsilon) {
-                        converged = FALSE;
-                        break;
-                    }
-            }
-            if (iterations == max_iterations) {
-                converged = TRUE;
-                break;
-            }
-            iterations++;
-        }
-    }
-
-    gwy_app_wait_finish();
-    if (cancelled)
-        goto fail;
-
     errormap = gwy_data_field_new_alike(dfield, TRUE);
     if (!normalize) {
         siunit = gwy_brick_get_si_unit_w(brick);
@@ -620,22 +403,22 @@ volume_kmeans_do(GwyContainer *container, KMeansArgs *args)
         gwy_data_field_set_si_unit_z(errormap, siunit);
         g_object_unref(siunit);
     }
-    errordata = gwy_data_field_get_data(errormap);
 
-    for (i = 0; i < xres; i++) {
-        for (j = 0; j < yres; j++) {
-            dist = 0.0;
-            c = (gint)(*(data1 + j * xres + i));
-            for (l = 0; l < zres; l++) {
-                dist += (*(data + l * xres * yres + j * xres + i)
-                         - *(centers + c * zres + l))
-                    * (*(data + l * xres * yres + j * xres + i)
-                       - *(centers + c * zres + l));
-            }
-            *(errordata + j * xres + i) = sqrt(dist);
-        }
+    if (!gwy_app_wait_set_message(_("K-means iteration...")))
+        cancelled = TRUE;
+    else {
+        cancelled = !gwy_brick_kmeans(normalized ? normalized : brick, k,
+                                      args->epsilon, args->max_iterations,
+                                      args->remove_outliers
+                                      ? args->outliers_threshold : 0.0,
+                                      centers, dfield, errormap,
+                                      gwy_app_wait_set_fraction);
     }
 
+    gwy_app_wait_finish();
+    if (cancelled)
+        goto fail;
+
     gwy_data_field_add(dfield, 1.0);
     newid = gwy_app_data_browser_add_data_field(dfield,
                                                 container, TRUE);
@@ -720,10 +503,6 @@ fail:
     gwy_object_unref(intmap);
     gwy_object_unref(dfield);
     gwy_object_unref(normalized);
-    g_free(variance);
-    g_free(npix);
-    g_free(sum);
-    g_free(oldcenters);
     g_free(centers);
 }
 
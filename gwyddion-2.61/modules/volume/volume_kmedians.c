@@ -28,6 +28,7 @@
 #include <libprocess/arithmetic.h>
 #include <libprocess/stats.h>
 #include <libprocess/brick.h>
+#include <libprocess/clustering.h>
 #include <libprocess/datafield.h>
 #include <libprocess/filters.h>
 #include <libgwydgets/gwystock.h>
@@ -319,18 +320,11 @@ volume_kmedians_do(GwyContainer *container, KMediansArgs *args)
     const GwyRGBA *rgba;
     gint id;
     gchar *description;
-    GRand *rand;
-    const gdouble *data;
-    gdouble *centers, *oldcenters, *plane, *data1, *xdata, *ydata;
-    gdouble *errordata;
-    gdouble min, dist, xreal, yreal, zreal, xoffset, yoffset, zoffset;
-    gdouble epsilon = args->epsilon;
-    gint xres, yres, zres, i, j, l, c, newid;
-    gint *npix;
+    gdouble *centers, *xdata, *ydata;
+    gdouble xreal, yreal, zreal, xoffset, yoffset, zoffset;
+    gint xres, yres, zres, i, c, newid;
     gint k = args->k;
-    gint iterations = 0;
-    gint max_iterations = args->max_iterations;
-    gboolean converged = FALSE, cancelled = FALSE;
+    gboolean cancelled = FALSE;
     gboolean normalize = args->normalize;
 
     gwy_app_data_browser_get_current(GWY_APP_BRICK, &brick,
@@ -341,6 +335,8 @@ volume_kmedians_do(GwyContainer *container, KMediansArgs *args)
     xres = gwy_brick_get_xres(brick);
     yres = gwy_brick_get_yres(brick);
     zres = gwy_brick_get_zres(brick);
+    /* There cannot be more clusters than spectra. */
+    k = MIN(k, xres*yres);
     xreal = gwy_brick_get_xreal(brick);
     yreal = gwy_brick_get_yreal(brick);
     zreal = gwy_brick_get_zreal(brick);
@@ -362,105 +358,10 @@ volume_kmedians_do(GwyContainer *container, KMediansArgs *args)
     gwy_app_wait_start(gwy_app_find_window_for_volume(container, id),
                        _("Initializing..."));
 
-    if (normalize) {
+    if (normalize)
         normalized = normalize_brick(brick, intmap);
-        data = gwy_brick_get_data_const(normalized);
-    }
-    else {
-        data = gwy_brick_get_data_const(brick);
-    }
 
     centers = g_new(gdouble, zres*k);
-    oldcenters = g_new(gdouble, zres*k);
-    plane = g_new(gdouble, xres * yres * k);
-    npix = g_new(gint, k);
-    data1 = gwy_data_field_get_data(dfield);
-
-    rand = g_rand_new();
-    for (c = 0; c < k; c++) {
-        i = g_rand_int_range(rand, 0, xres);
-        j = g_rand_int_range(rand, 0, yres);
-        for (l = 0; l < zres; l++) {
-            *(centers + c * zres + l)
-                             = *(data + l * xres * yres + j * xres + i);
-        };
-    };
-    g_rand_free(rand);
-
-    if (!gwy_app_wait_set_message(_("K-medians iteration...")))
-        cancelled = TRUE;
-
-    while (!converged && !cancelled) {
-        if (!gwy_app_wait_set_fraction((gdouble)iterations/max_iterations)) {
-            cancelled = TRUE;
-            break;
-        }
-
-        /* pixels belong to cluster with min distance */
-        for (j = 0; j < yres; j++)
-            for (i = 0; i < xres; i++) {
-                *(data1 + j * xres + i) = 0;
-                min = G_MAXDOUBLE;
-                for (c = 0; c < k; c++) {
-                    dist = 0;
-                    for (l = 0; l < zres; l++) {
-                        *(oldcenters + c * zres + l)
-                                            = *(centers + c * zres + l);
-                        dist
-                            += (*(data + l * xres * yres + j * xres + i)
-                              - *(centers + c * zres + l))
-                             * (*(data + l * xres * yres + j * xres + i)
-                              - *(centers + c * zres + l));
-                    }
-                    if (dist < min) {
-                        min = dist;
-                        *(data1 + j * xres + i) = c;
-                    }
-                }
-            }
-
-        /* We're calculating median per one coordinate of all pixels
-         * that belongs to same cluster and use it as this coordinate
-         * position for cluster center */
-        for (l = 0; l < zres; l++) {
-            for (c = 0; c < k; c++) {
-                *(npix + c) = 0;
-            }
-
-            for (j = 0; j < yres; j++) {
-                for (i = 0; i < xres; i++) {
-                    c = (gint)(*(data1 + j * xres + i));
-                    (*(npix + c))++;
-                    *(plane + c * xres * yres + *(npix + c) - 1)
-                             = *(data + l * xres * yres + j * xres + i);
-                }
-            }
-            for (c = 0; c < k; c++) {
-                gwy_math_sort(*(npix + c), plane + c * xres * yres);
-                *(centers + c * zres + l)
-                         = *(plane + c * xres * yres + *(npix + c) / 2);
-            }
-        }
-
-        converged = TRUE;
-        for (c = 0; c < k; c++) {
-            for (l = 0; l < zres; l++)
-                if (fabs(*(oldcenters + c * zres + l)
-                               - *(centers + c * zres + l)) > epsilon) {
-                    converged = FALSE;
-                    break;
-                }
-        }
-        if (iterations == max_iterations) {
-            converged = TRUE;
-        }
-        iterations++;
-    }
-
-    gwy_app_wait_finish();
-    if (cancelled)
-        goto fail;
-
     errormap = gwy_data_field_new_alike(dfield, TRUE);
     if (!normalize) {
         siunit = gwy_brick_get_si_unit_w(brick);
@@ -468,22 +369,20 @@ volume_kmedians_do(GwyContainer *container, KMediansArgs *args)
         gwy_data_field_set_si_unit_z(errormap, siunit);
         g_object_unref(siunit);
     }
-    errordata = gwy_data_field_get_data(errormap);
 
-    for (i = 0; i < xres; i++) {
-        for (j = 0; j < yres; j++) {
-            dist = 0.0;
-            c = (gint)(*(data1 + j * xres + i));
-            for (l = 0; l < zres; l++) {
-                dist += (*(data + l * xres * yres + j * xres + i)
-                         - *(centers + c * zres + l))
-                    * (*(data + l * xres * yres + j * xres + i)
-                       - *(centers + c * zres + l));
-            }
-            *(errordata + j * xres + i) = sqrt(dist);
-        }
+    if (!gwy_app_wait_set_message(_("K-medians iteration...")))
+        cancelled = TRUE;
+    else {
+        cancelled = !gwy_brick_kmedians(normalized ? normalized : brick, k,
+                                        args->epsilon, args->max_iterations,
+                                        centers, dfield, errormap,
+                                        gwy_app_wait_set_fraction);
     }
 
+    gwy_app_wait_finish();
+    if (cancelled)
+        goto fail;
+
     gwy_data_field_add(dfield, 1.0);
     newid = gwy_app_data_browser_add_data_field(dfield,
                                                 container, TRUE);
@@ -568,9 +467,6 @@ fail:
     gwy_object_unref(intmap);
     gwy_object_unref(dfield);
     gwy_object_unref(normalized);
-    g_free(npix);
-    g_free(plane);
-    g_free(oldcenters);
     g_free(centers);
 }
 
@@ -284,7 +284,7 @@ execute(ModuleArgs *args, GwyContainer *data, gint id)
     const gdouble *caldata;
     gdouble *curvedata;
     GwyLawn *lawn;
-    gint i, j, k, m, n, nbricks, ncurves;
+    gint i, j, m, n, nbricks, ncurves;
     GArray *allbricks_array;
     OtherData *allbricks;
     gchar *s;
@@ -299,13 +299,12 @@ execute(ModuleArgs *args, GwyContainer *data, gint id)
     ncurves = nbricks + !!calibration;
     caldata = calibration ? gwy_data_line_get_data(calibration) : NULL;
     for (m = 0; m < nbricks; m++)
-        allbricks[m].data = gwy_brick_get_data_const(allbricks[m].brick);
+        allbricks[m].data = gwy_brick_get_curves_const(allbricks[m].brick);
 
     curvedata = g_new(gdouble, zres*ncurves);
     args->result = lawn = gwy_lawn_new(xres, yres, gwy_brick_get_xreal(brick), gwy_brick_get_yreal(brick), ncurves, 0);
     gwy_lawn_set_xoffset(lawn, gwy_brick_get_xoffset(brick));
     gwy_lawn_set_yoffset(lawn, gwy_brick_get_yoffset(brick));
-    /* FIXME: Absolutely bonkers memory access pattern. */
     for (i = 0; i < yres; i++) {
         for (j = 0; j < xres; j++) {
             n = 0;
@@ -314,8 +313,8 @@ execute(ModuleArgs *args, GwyContainer *data, gint id)
                 n += zres;
             }
             for (m = 0; m < nbricks; m++) {
-                for (k = 0; k < zres; k++)
-                    curvedata[n++] = allbricks[m].data[i*xres + j + xres*yres*k];
+                gwy_assign(curvedata + n, allbricks[m].data + (i*xres + j)*zres, zres);
+                n += zres;
             }
             gwy_lawn_set_curves(lawn, j, i, zres, curvedata, NULL);
         }
@@ -338,6 +337,9 @@ execute(ModuleArgs *args, GwyContainer *data, gint id)
         n++;
     }
 
+    /* Free the spectrum-major views. */
+    for (m = 0; m < nbricks; m++)
+        gwy_brick_invalidate(allbricks[m].brick);
     g_array_free(allbricks_array, TRUE);
     g_free(curvedata);
 }
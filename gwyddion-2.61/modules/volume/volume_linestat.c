@@ -36,8 +36,6 @@
 
 enum {
     PREVIEW_SIZE = 360,
-    /* 16 is good for current processors; increasing it to 32 might not hurt in the future. */
-    BLOCK_SIZE = 16,
 };
 
 enum {
@@ -72,10 +70,9 @@ typedef struct {
     GwyBrick *brick;
     const gdouble *db;
     GwyDataLine *dline;
-    gdouble *buf;
     guint npts;
     guint npixels;
-    guint planesize;
+    guint zres;
     guint k;
 } LineStatIter;
 
@@ -263,6 +260,8 @@ line_stat(GwyContainer *data, GwyRunType runtype)
     }
 
 end:
+    /* Free the spectrum-major view. */
+    gwy_brick_invalidate(brick);
     g_object_unref(args.result);
     g_object_unref(args.params);
 }
@@ -543,8 +542,10 @@ preview(gpointer user_data)
     gwy_dialog_have_result(GWY_DIALOG(gui->dialog));
 }
 
+/* The spectrum-major view of the brick must already exist; it cannot be created concurrently from multiple threads. */
 static void
 line_stat_iter_init(LineStatIter *iter, GwyBrick *brick,
+                    const gdouble *curves,
                     gint kfrom, gint kto,
                     gint zfrom, gint zto)
 {
@@ -552,9 +553,8 @@ line_stat_iter_init(LineStatIter *iter, GwyBrick *brick,
     iter->brick = brick;
     iter->npts = zto - zfrom;
     iter->npixels = kto - kfrom;
-    iter->planesize = brick->xres*brick->yres;
-    iter->db = gwy_brick_get_data_const(brick) + zfrom*iter->planesize + kfrom;
-    iter->buf = g_new(gdouble, MIN(BLOCK_SIZE, iter->npixels) * iter->npts);
+    iter->zres = brick->zres;
+    iter->db = curves + kfrom*(gsize)iter->zres + zfrom;
     iter->dline = gwy_data_line_new(1, 1.0, FALSE);
     iter->k = (guint)(-1);
     /* Sets up line properties. */
@@ -564,30 +564,14 @@ line_stat_iter_init(LineStatIter *iter, GwyBrick *brick,
 static void
 line_stat_iter_next(LineStatIter *iter)
 {
-    guint blocksize, npts, kk, m, planesize;
-
-    npts = iter->npts;
-    planesize = iter->planesize;
     iter->k++;
     g_return_if_fail(iter->k < iter->npixels);
-
-    kk = iter->k % BLOCK_SIZE;
-    if (!kk) {
-        blocksize = MIN(BLOCK_SIZE, iter->npixels - iter->k);
-        for (m = 0; m < npts; m++) {
-            const gdouble *db = iter->db + m*planesize + iter->k;
-            for (kk = 0; kk < blocksize; kk++)
-                iter->buf[kk*npts + m] = db[kk];
-        }
-        kk = 0;
-    }
-    memcpy(iter->dline->data, iter->buf + kk*npts, npts * sizeof(gdouble));
+    gwy_assign(iter->dline->data, iter->db + iter->k*(gsize)iter->zres, iter->npts);
 }
 
 static void
 line_stat_iter_free(LineStatIter *iter)
 {
-    g_free(iter->buf);
     gwy_object_unref(iter->dline);
 }
 
@@ -635,6 +619,7 @@ execute(ModuleArgs *args)
     GwyDataLine *calibration = args->calibration;
     gint xres = gwy_brick_get_xres(brick), yres = gwy_brick_get_yres(brick), zres = gwy_brick_get_zres(brick);
     LineStatFunc lsfunc = NULL;
+    const gdouble *curves;
     gint i, j;
     guint k;
     gdouble *data, val, zreal, zoffset;
@@ -648,19 +633,20 @@ execute(ModuleArgs *args)
     }
     gwy_brick_extract_xy_plane(brick, field, 0);
 
-    /* Use an iterator interface to formally process data profile by profle, but physically extract them from the
-     * brick by larger blocks, gaining a speedup about 3 from the much improved memory access pattern. */
+    /* Process data profile by profile, reading them from the spectrum-major view of the brick where each is
+     * contiguous.  The view is kept until the module finishes, so repeated previews do not recreate it. */
+    curves = gwy_brick_get_curves_const(brick);
 #ifdef _OPENMP
 #pragma omp parallel if(gwy_threads_are_enabled()) default(none) \
             private(k) \
-            shared(brick,xres,yres,zfrom,zto,field,lsfunc)
+            shared(brick,curves,xres,yres,zfrom,zto,field,lsfunc)
 #endif
     {
         LineStatIter iter;
         guint kfrom = gwy_omp_chunk_start(xres*yres);
         guint kto = gwy_omp_chunk_end(xres*yres);
 
-        line_stat_iter_init(&iter, brick, kfrom, kto, zfrom, zto);
+        line_stat_iter_init(&iter, brick, curves, kfrom, kto, zfrom, zto);
         for (k = kfrom; k < kto; k++) {
             line_stat_iter_next(&iter);
             field->data[k] = lsfunc(iter.dline);
@@ -726,48 +726,37 @@ update_labels(RephaseControls *controls)
     gtk_label_set_markup(GTK_LABEL(controls->zposreal), buf);
 }
 
-/* gets the two brick values for lev, corrected for shift and
- * direction/inversion. lev should go from 0 to zres */
-static gboolean
-get_shifted_values(GwyBrick *b1, GwyBrick *b2,
-                   gint col, gint row, gint lev,
-                   gint shift, gint right, gint invert,
-                   gdouble *val1, gdouble *val2)
+/* gets the two brick planes for lev, corrected for shift and
+ * direction/inversion. lev should go from 0 to zres.  A plane is set to NULL
+ * if there is no source for it; the previous value is kept then. */
+static void
+get_shifted_planes(GwyBrick *b1, GwyBrick *b2,
+                   gint lev, gint shift, gint invert,
+                   const gdouble **plane1, const gdouble **plane2)
 {
     const gdouble *b1data = b1->data, *b2data = b2->data;
-    gint xres = b1->xres, yres = b1->yres, zres = b1->zres;
+    gint n = b1->xres*b1->yres, zres = b1->zres;
     gint pos;
 
-    if (right) {
-        pos = lev + shift;
-        if (pos < zres)
-            *val1 = b1data[col + xres*row  + xres*yres*pos];
-        else {
-            if (invert) {
-                pos = 2*zres - pos - 1;
-                *val1 = b2data[col + xres*row  + xres*yres*pos];
-            }
-            else {
-                /* ??? ??? ??? ??? ??? val1 is unset. */
-            }
-        }
+    *plane1 = *plane2 = NULL;
 
-        pos = lev + shift + zres;
-        if (pos < 2*zres) {
-            pos = 2*zres - pos - 1;
-            *val2 = b2data[col + xres*row  + xres*yres*pos];
-        }
-        else {
-            pos -= 2*zres;
-            *val2 = b1data[col + xres*row  + xres*yres*pos];
-        }
+    pos = lev + shift;
+    if (pos < zres)
+        *plane1 = b1data + n*pos;
+    else if (invert && pos < 2*zres) {
+        pos = 2*zres - pos - 1;
+        *plane1 = b2data + n*pos;
     }
-    else {
-        *val1 = 3;
-        *val2 = 4;
-    }
-    return TRUE;
 
+    pos = lev + shift + zres;
+    if (pos < 2*zres) {
+        pos = 2*zres - pos - 1;
+        *plane2 = b2data + n*pos;
+    }
+    else if (pos < 3*zres) {
+        pos -= 2*zres;
+        *plane2 = b1data + n*pos;
+    }
 }
 
 static void
@@ -777,37 +766,38 @@ rephase_do(RephaseArgs *args, GwyContainer *data, gint id)
     gint newid;
     GwyBrick *brick = args->brick;
     GwyBrick *second_brick = args->second_brick;
-    gint xres = brick->xres, yres = brick->yres, zres = brick->zres;
-    gint col, row, lev;
+    gint n = brick->xres*brick->yres, zres = brick->zres;
+    gint lev;
+    const gdouble *plane1, *plane2;
     gdouble *r1data, *r2data;
-    gdouble val1, val2, lastval1, lastval2;
 
     result1 = gwy_brick_new_alike(args->brick, TRUE);
     result2 = gwy_brick_new_alike(args->brick, TRUE);
 
-    r1data = gwy_brick_get_data(result1);
-    r2data = gwy_brick_get_data(result2);
-
-    for (col = 0; col < xres; col++) {
-        for (row = 0; row < yres; row++) {
-            for (lev = 0; lev < zres; lev++) {
-                 if (get_shifted_values(brick, second_brick,
-                                        col, row, lev,
-                                        args->currpos.z, args->right,
-                                        args->invert,
-                                        &val1, &val2)) {
-                     r1data[col + xres*row  + xres*yres*lev] = val1;
-                     r2data[col + xres*row  + xres*yres*lev] = val2;
-                     lastval1 = val1;
-                     lastval2 = val2;
-                 }
-                 else {
-                     r1data[col + xres*row  + xres*yres*lev] = lastval1;
-                     r2data[col + xres*row  + xres*yres*lev] = lastval2;
-                 }
-            }
+    /* Process the bricks plane by plane, in the order they are stored.  Each
+     * result plane is a copy of a shifted source plane, or of the previous
+     * result plane if there is no source for it. */
+    if (args->right) {
+        r1data = gwy_brick_get_data(result1);
+        r2data = gwy_brick_get_data(result2);
+        for (lev = 0; lev < zres; lev++) {
+            get_shifted_planes(brick, second_brick, lev,
+                               args->currpos.z, args->invert,
+                               &plane1, &plane2);
+            if (!plane1 && lev)
+                plane1 = r1data + n*(lev - 1);
+            if (!plane2 && lev)
+                plane2 = r2data + n*(lev - 1);
+            if (plane1)
+                gwy_assign(r1data + n*lev, plane1, n);
+            if (plane2)
+                gwy_assign(r2data + n*lev, plane2, n);
         }
     }
+    else {
+        gwy_brick_fill(result1, 3.0);
+        gwy_brick_fill(result2, 4.0);
+    }
     gwy_brick_data_changed(result1);
     gwy_brick_data_changed(result2);
 
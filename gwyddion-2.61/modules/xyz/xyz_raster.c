@@ -30,6 +30,7 @@
 #include <libprocess/filters.h>
 #include <libprocess/grains.h>
 #include <libprocess/triangulation.h>
+#include <libprocess/pointindex.h>
 #include <libgwydgets/gwydataview.h>
 #include <libgwydgets/gwylayer-basic.h>
 #include <libgwydgets/gwydgetutils.h>
@@ -38,7 +39,6 @@
 #include <libgwymodule/gwymodule-xyz.h>
 #include <app/gwymoduleutils.h>
 #include <app/gwyapp.h>
-#include "libgwyddion/gwyomp.h"
 
 #define XYZRAS_RUN_MODES (GWY_RUN_INTERACTIVE | GWY_RUN_IMMEDIATE)
 
@@ -48,6 +48,11 @@
  * for identical point detection and border extension. */
 #define CELL_SIDE 1.6
 
+/* Default number of nearest points used in the Field interpolation.  The
+ * weights fall off with the fourth power of distance so farther points
+ * contribute very little to smooth data. */
+#define FIELD_NEIGHBOURS 32
+
 enum {
     PREVIEW_SIZE = 400,
     UNDEF = G_MAXUINT
@@ -70,6 +75,10 @@ typedef struct {
     gint xres;
     gint yres;
     gboolean mask_empty;
+    /* Field interpolation: number of nearest points (0 for all) and cutoff
+     * radius in pixels (0 for unlimited). */
+    gint neighbours;
+    gdouble cutoff;
     /* Interface only. */
     gdouble xmin;
     gdouble xmax;
@@ -105,6 +114,8 @@ typedef struct {
     GtkWidget *interpolation;
     GtkWidget *exterior;
     GtkWidget *mask_empty;
+    GtkObject *neighbours;
+    GtkObject *cutoff;
     GtkWidget *view;
     GtkWidget *do_preview;
     GtkWidget *error;
@@ -138,6 +149,7 @@ static gint          construct_options      (XYZRasControls *controls,
                                              GtkTable *table,
                                              gint row);
 static void          make_pixels_square     (XYZRasControls *controls);
+static void          field_options_set_sensitive(XYZRasControls *controls);
 static void          xres_changed           (XYZRasControls *controls,
                                              GtkAdjustment *adj);
 static void          yres_changed           (XYZRasControls *controls,
@@ -156,6 +168,10 @@ static void          exterior_changed       (XYZRasControls *controls,
                                              GtkComboBox *combo);
 static void          mask_empty_changed     (XYZRasControls *controls,
                                              GtkToggleButton *button);
+static void          neighbours_changed     (XYZRasControls *controls,
+                                             GtkAdjustment *adj);
+static void          cutoff_changed         (XYZRasControls *controls,
+                                             GtkAdjustment *adj);
 static void          reset_ranges           (XYZRasControls *controls);
 static void          update_selection       (XYZRasControls *controls);
 static void          selection_changed      (XYZRasControls *controls,
@@ -170,8 +186,8 @@ static GwyDataField* xyzras_do              (XYZRasData *rdata,
                                              GwyDataField **mask,
                                              GtkWindow *dialog,
                                              gchar **error);
-static gboolean      interpolate_field      (guint npoints,
-                                             const GwyXYZ *points,
+static gboolean      rasterize_indexed      (const GArray *points,
+                                             const XYZRasArgs *args,
                                              GwyDataField *dfield,
                                              GwySetFractionFunc set_fraction,
                                              GwySetMessageFunc set_message);
@@ -194,6 +210,7 @@ static void          xyzras_save_args       (GwyContainer *container,
 static const XYZRasArgs xyzras_defaults = {
     GWY_INTERPOLATION_AVERAGE, GWY_EXTERIOR_MIRROR_EXTEND,
     512, 512, TRUE,
+    FIELD_NEIGHBOURS, 0.0,
     /* Interface only. */
     0.0, 0.0, 0.0, 0.0,
 };
@@ -203,7 +220,7 @@ static GwyModuleInfo module_info = {
     &module_register,
     N_("Rasterizes XYZ data to images."),
     "Yeti <yeti@gwyddion.net>",
-    "1.4",
+    "1.5",
     "David Nečas (Yeti)",
     "2016",
 };
@@ -501,6 +518,10 @@ xyzras_dialog(XYZRasArgs *args,
                              G_CALLBACK(exterior_changed), &controls);
     g_signal_connect_swapped(controls.mask_empty, "toggled",
                              G_CALLBACK(mask_empty_changed), &controls);
+    g_signal_connect_swapped(controls.neighbours, "value-changed",
+                             G_CALLBACK(neighbours_changed), &controls);
+    g_signal_connect_swapped(controls.cutoff, "value-changed",
+                             G_CALLBACK(cutoff_changed), &controls);
 
     controls.in_update = FALSE;
     reset_ranges(&controls);
@@ -636,6 +657,22 @@ construct_options(XYZRasControls *controls,
                      GTK_EXPAND | GTK_FILL, 0, 0, 0);
     row++;
 
+    controls->neighbours = gtk_adjustment_new(args->neighbours,
+                                              0, 256, 1, 8, 0);
+    gwy_table_attach_adjbar(GTK_WIDGET(table), row,
+                            _("Nearest _points:"), NULL,
+                            controls->neighbours,
+                            GWY_HSCALE_SQRT | GWY_HSCALE_SNAP);
+    row++;
+
+    controls->cutoff = gtk_adjustment_new(args->cutoff,
+                                          0.0, 1000.0, 0.1, 10.0, 0);
+    gwy_table_attach_adjbar(GTK_WIDGET(table), row,
+                            _("C_utoff radius:"), _("px"),
+                            controls->cutoff, GWY_HSCALE_SQRT);
+    row++;
+    field_options_set_sensitive(controls);
+
     label = gtk_label_new_with_mnemonic(_("_Exterior type:"));
     gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
     gtk_table_attach(table, label, 0, 1, row, row+1,
@@ -670,6 +707,18 @@ construct_options(XYZRasControls *controls,
     return row;
 }
 
+/* Nearest points and cutoff radius only apply to the Field interpolation.
+ * Setting both to zero gives the original global Shepard interpolation. */
+static void
+field_options_set_sensitive(XYZRasControls *controls)
+{
+    gboolean sens = ((gint)controls->args->interpolation
+                     == GWY_INTERPOLATION_FIELD);
+
+    gwy_table_hscale_set_sensitive(controls->neighbours, sens);
+    gwy_table_hscale_set_sensitive(controls->cutoff, sens);
+}
+
 static void
 set_adjustment_in_update(XYZRasControls *controls,
                          GtkAdjustment *adj,
@@ -810,6 +859,7 @@ interpolation_changed(XYZRasControls *controls,
     gtk_widget_set_sensitive(controls->mask_empty,
                              (gint)controls->args->interpolation
                              == GWY_INTERPOLATION_AVERAGE);
+    field_options_set_sensitive(controls);
     invalidate_raster(controls->rdata);
 }
 
@@ -828,6 +878,22 @@ mask_empty_changed(XYZRasControls *controls,
     controls->args->mask_empty = gtk_toggle_button_get_active(button);
 }
 
+static void
+neighbours_changed(XYZRasControls *controls,
+                   GtkAdjustment *adj)
+{
+    controls->args->neighbours = gwy_adjustment_get_int(adj);
+    invalidate_raster(controls->rdata);
+}
+
+static void
+cutoff_changed(XYZRasControls *controls,
+               GtkAdjustment *adj)
+{
+    controls->args->cutoff = gtk_adjustment_get_value(adj);
+    invalidate_raster(controls->rdata);
+}
+
 static void
 set_all_physical_dimensions(XYZRasControls *controls)
 {
@@ -1012,12 +1078,13 @@ xyzras_do(XYZRasData *rdata,
     gwy_data_field_set_yoffset(dfield, args->ymin);
     gwy_surface_copy_units_to_data_field(surface, dfield);
 
-    if ((gint)args->interpolation == GWY_INTERPOLATION_FIELD) {
+    if ((gint)args->interpolation == GWY_INTERPOLATION_FIELD
+        || args->interpolation == GWY_INTERPOLATION_ROUND) {
         if (window)
             gwy_app_wait_start(window, _("Initializing..."));
 
         extend_borders(rdata, args, FALSE, EPSREL);
-        ok = interpolate_field(points->len, (const GwyXYZ*)points->data, dfield,
+        ok = rasterize_indexed(points, args, dfield,
                                set_fraction, set_message);
         if (window)
             gwy_app_wait_finish();
@@ -1088,73 +1155,36 @@ xyzras_do(XYZRasData *rdata,
     return dfield;
 }
 
+/* Field and Round interpolations only need neighbour queries, so they are
+ * done with a spatial index instead of triangulation. */
 static gboolean
-interpolate_field(guint npoints,
-                  const GwyXYZ *points,
+rasterize_indexed(const GArray *points,
+                  const XYZRasArgs *args,
                   GwyDataField *dfield,
                   GwySetFractionFunc set_fraction,
                   GwySetMessageFunc set_message)
 {
-    gboolean cancelled = FALSE, *pcancelled = &cancelled;
-    gdouble xoff, yoff, qx, qy;
-    guint xres, yres;
-    gdouble *d;
-
-    xres = gwy_data_field_get_xres(dfield);
-    yres = gwy_data_field_get_yres(dfield);
-    xoff = gwy_data_field_get_xoffset(dfield);
-    yoff = gwy_data_field_get_yoffset(dfield);
-    qx = gwy_data_field_get_xreal(dfield)/xres;
-    qy = gwy_data_field_get_yreal(dfield)/yres;
-    d = gwy_data_field_get_data(dfield);
+    GwyPointIndex *pindex;
+    gdouble cutoff;
+    gboolean ok;
 
+    pindex = gwy_point_index_new((const GwyXYZ*)points->data, points->len);
     if (set_message)
         set_message(_("Interpolating..."));
 
-#ifdef _OPENMP
-#pragma omp parallel if (gwy_threads_are_enabled()) default(none) \
-            shared(d,xres,yres,points,npoints,xoff,yoff,qx,qy,set_fraction,pcancelled)
-#endif
-    {
-        gint ifrom = gwy_omp_chunk_start(yres), ito = gwy_omp_chunk_end(yres);
-        gint i, j, k;
-
-        for (i = ifrom; i < ito; i++) {
-            gdouble y = yoff + qy*(i + 0.5);
-            gdouble *drow = d + i*xres;
-
-            for (j = 0; j < xres; j++) {
-                gdouble x = xoff + qx*(j + 0.5);
-                gdouble w = 0.0;
-                gdouble s = 0.0;
-
-                for (k = 0; k < npoints; k++) {
-                    const GwyXYZ *pt = points + k;
-                    gdouble dx = x - pt->x;
-                    gdouble dy = y - pt->y;
-                    gdouble r2 = dx*dx + dy*dy;
-
-                    r2 *= r2;
-                    if (G_UNLIKELY(r2 == 0.0)) {
-                        s = pt->z;
-                        w = 1.0;
-                        break;
-                    }
-
-                    r2 = 1.0/r2;
-                    w += r2;
-                    s += r2*pt->z;
-                }
-                drow[j] = s/w;
-            }
-
-            if (gwy_omp_set_fraction_check_cancel(set_fraction,
-                                                  i, ifrom, ito, pcancelled))
-                break;
-        }
+    if ((gint)args->interpolation == GWY_INTERPOLATION_FIELD) {
+        /* Pixels need not be square; measure the cutoff in their mean size. */
+        cutoff = args->cutoff*sqrt(gwy_data_field_get_dx(dfield)
+                                   *gwy_data_field_get_dy(dfield));
+        ok = gwy_point_index_rasterize_idw(pindex, dfield, args->neighbours,
+                                           cutoff, set_fraction);
     }
+    else
+        ok = gwy_point_index_rasterize_nearest(pindex, dfield, set_fraction);
+
+    gwy_point_index_free(pindex);
 
-    return !cancelled;
+    return ok;
 }
 
 /* Return TRUE if extpoints have changed. */
@@ -1668,6 +1698,8 @@ check_regular_grid(GwySurface *surface)
 static const gchar exterior_key[]      = "/module/xyz_raster/exterior";
 static const gchar interpolation_key[] = "/module/xyz_raster/interpolation";
 static const gchar mask_empty_key[]    = "/module/xyz_raster/mask_empty";
+static const gchar neighbours_key[]    = "/module/xyz_raster/neighbours";
+static const gchar cutoff_key[]        = "/module/xyz_raster/cutoff";
 static const gchar xres_key[]          = "/module/xyz_raster/xres";
 static const gchar yres_key[]          = "/module/xyz_raster/yres";
 
@@ -1683,6 +1715,8 @@ xyzras_sanitize_args(XYZRasArgs *args)
         && args->exterior != GWY_EXTERIOR_PERIODIC)
         args->exterior = GWY_EXTERIOR_BORDER_EXTEND;
     args->mask_empty = !!args->mask_empty;
+    args->neighbours = CLAMP(args->neighbours, 0, 256);
+    args->cutoff = CLAMP(args->cutoff, 0.0, 1000.0);
     args->xres = CLAMP(args->xres, 2, 16384);
     args->yres = CLAMP(args->yres, 2, 16384);
 }
@@ -1698,6 +1732,9 @@ xyzras_load_args(GwyContainer *container,
     gwy_container_gis_enum_by_name(container, exterior_key, &args->exterior);
     gwy_container_gis_boolean_by_name(container, mask_empty_key,
                                       &args->mask_empty);
+    gwy_container_gis_int32_by_name(container, neighbours_key,
+                                    &args->neighbours);
+    gwy_container_gis_double_by_name(container, cutoff_key, &args->cutoff);
     gwy_container_gis_int32_by_name(container, xres_key, &args->xres);
     gwy_container_gis_int32_by_name(container, yres_key, &args->yres);
 
@@ -1713,6 +1750,9 @@ xyzras_save_args(GwyContainer *container,
     gwy_container_set_enum_by_name(container, exterior_key, args->exterior);
     gwy_container_set_boolean_by_name(container, mask_empty_key,
                                       args->mask_empty);
+    gwy_container_set_int32_by_name(container, neighbours_key,
+                                    args->neighbours);
+    gwy_container_set_double_by_name(container, cutoff_key, args->cutoff);
     gwy_container_set_int32_by_name(container, xres_key, args->xres);
     gwy_container_set_int32_by_name(container, yres_key, args->yres);
 }
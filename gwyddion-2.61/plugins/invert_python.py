@@ -18,17 +18,15 @@ run_modes = 'noninteractive', 'with_defaults'
 plugin_info = """\
 invert_python
 /_Test/Value Invert (Python)
-""" + ' '.join(run_modes)
+""" + ' '.join(run_modes) + """
+worker"""
 
 def register(args):
     print plugin_info
 
-def run(args):
-    run_mode = args.pop(0)
+def invert(run_mode, data):
     assert run_mode in run_modes
 
-    filename = args.pop(0)
-    data = Gwyddion.dump.read(filename)
     dfield = data['/0/data']
     a = dfield['data']
 
@@ -36,8 +34,17 @@ def run(args):
     mirror = min(a) + max(a)
     for i in range(n):
         a[i] = mirror - a[i]
+
+def run(args):
+    run_mode = args.pop(0)
+    filename = args.pop(0)
+    data = Gwyddion.dump.read(filename)
+    invert(run_mode, data)
     Gwyddion.dump.write(data, filename)
 
+def worker(args):
+    Gwyddion.dump.serve(invert)
+
 try:
     args = sys.argv[1:]
     function = globals()[args.pop(0)]
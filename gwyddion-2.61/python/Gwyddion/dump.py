@@ -5,7 +5,9 @@
 # Public domain.
 
 import array as _array
+import cStringIO as _cStringIO
 import re as _re
+import sys as _sys
 import types as _types
 import struct as _struct
 
@@ -35,6 +37,14 @@ def _read_dfield(fh, data, base):
         # Python has no ungetc, seek one byte back
         fh.seek(-1, 1)
         return False
+    dfield = _make_dfield(data, base)
+    dfield['data'] = _read_array(fh, dfield)
+    c = fh.readline()
+    assert c == ']]\n'
+    data[base] = dfield
+    return True
+
+def _make_dfield(data, base):
     dfield = {}
     _dmove(data, base + '/xres', dfield, 'xres', int)
     _dmove(data, base + '/yres', dfield, 'yres', int)
@@ -42,15 +52,14 @@ def _read_dfield(fh, data, base):
     _dmove(data, base + '/yreal', dfield, 'yreal', float)
     _dmove(data, base + '/unit-xy', dfield, 'unit-xy')
     _dmove(data, base + '/unit-z', dfield, 'unit-z')
+    return dfield
+
+def _read_array(fh, dfield):
     a = _array.array('d')
     a.fromfile(fh, dfield['xres']*dfield['yres'])
     if _byte_order:
         a.byteswap()
-    c = fh.readline()
-    assert c == ']]\n'
-    dfield['data'] = a
-    data[base] = dfield
-    return True
+    return a
 
 def read(filename):
     """Read a Gwyddion plug-in proxy dump file.
@@ -95,20 +104,26 @@ def _dwrite(fh, dfield, base, key, fmt):
     if dfield.has_key(key):
         fh.write(('%s/%s=' + fmt + '\n') % (base, key, dfield[key]))
 
-def _write_dfield(fh, dfield, base):
+def _write_dfield_header(fh, dfield, base):
     _dwrite(fh, dfield, base, 'xres', '%d')
     _dwrite(fh, dfield, base, 'yres', '%d')
     _dwrite(fh, dfield, base, 'xreal', '%g')
     _dwrite(fh, dfield, base, 'yreal', '%g')
     _dwrite(fh, dfield, base, 'unit-xy', '%s')
     _dwrite(fh, dfield, base, 'unit-z', '%s')
-    fh.write('%s=[\n[' % base)
+
+def _write_array(fh, dfield):
     if _byte_order:
         dfield['data'].byteswap()
     dfield['data'].tofile(fh)
     # swap back to keep the array usable
     if _byte_order:
         dfield['data'].byteswap()
+
+def _write_dfield(fh, dfield, base):
+    _write_dfield_header(fh, dfield, base)
+    fh.write('%s=[\n[' % base)
+    _write_array(fh, dfield)
     fh.write(']]\n')
 
 def write(data, filename):
@@ -130,3 +145,71 @@ def write(data, filename):
         _write_dfield(fh, v, k)
     fh.close()
 
+
+def _read_request_header(fin):
+    lines = []
+    while True:
+        line = fin.readline()
+        if not line or line == '\n':
+            break
+        lines.append(line.rstrip('\n'))
+    return lines
+
+def _read_request(lines, filename):
+    data = dict([x.split('=', 1) for x in lines])
+    fh = file(filename, 'rb')
+    for k, v in data.items():
+        if not v.startswith('@'):
+            continue
+        dfield = _make_dfield(data, k)
+        fh.seek(int(v[1:]))
+        dfield['data'] = _read_array(fh, dfield)
+        data[k] = dfield
+    fh.close()
+    return data
+
+def _write_reply(data, filename):
+    reply = _cStringIO.StringIO()
+    fh = file(filename, 'wb')
+    for k, v in data.items():
+        if type(v) == _types.DictType:
+            continue
+        reply.write('%s=%s\n' % (k, v))
+    for k, v in data.items():
+        if type(v) != _types.DictType:
+            continue
+        _write_dfield_header(reply, v, k)
+        reply.write('%s=@%d\n' % (k, fh.tell()))
+        _write_array(fh, v)
+    fh.close()
+    return reply.getvalue()
+
+def serve(function):
+    """Serve Gwyddion plug-in proxy requests as a persistent worker.
+
+    This is what a plug-in registered with the `worker' capability should
+    do when run as `plugin worker'.  The function is called as
+    function(run_mode, data) for each request, where data is a dictionary
+    of the same form as returned by read().  It should modify data in place,
+    they are then sent back to Gwyddion.
+
+    Exceptions raised by function are reported to Gwyddion as failures of
+    the particular request.  The function returns when Gwyddion closes
+    the worker's standard input."""
+    fin, fout = _sys.stdin, _sys.stdout
+    while True:
+        line = fin.readline()
+        if not line:
+            break
+        command, name, run_mode, filename = line.rstrip('\n').split(' ', 3)
+        assert command == 'run'
+        lines = _read_request_header(fin)
+        try:
+            data = _read_request(lines, filename)
+            function(run_mode, data)
+            reply = _write_reply(data, filename)
+        except Exception, e:
+            fout.write('error %s\n' % str(e).replace('\n', ' '))
+        else:
+            fout.write('ok\n%s\n' % reply)
+        fout.flush()
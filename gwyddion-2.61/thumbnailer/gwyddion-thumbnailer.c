@@ -251,13 +251,13 @@ thumbnailer_error_quark(void)
     return error_domain;
 }
 
-static void
+static gchar*
 load_modules(void)
 {
     static const gchar *const module_types[] = { "file", "layer", NULL };
     GPtrArray *module_dirs;
     const gchar *q;
-    gchar *p;
+    gchar *p, *registry_file;
     guint i;
 
     module_dirs = g_ptr_array_new();
@@ -276,11 +276,19 @@ load_modules(void)
     }
 
     g_ptr_array_add(module_dirs, NULL);
+    /* Share the registry cache with Gwyddion.  Modules are then only loaded
+     * when needed.  Once the cache remembers which module recognised files
+     * with the same extension, it is usually the only one loaded. */
+    registry_file = g_build_filename(q, "module-registry", NULL);
+    gwy_module_load_registry_cache(registry_file);
     gwy_module_register_modules((const gchar**)module_dirs->pdata);
+    gwy_module_save_registry_cache(registry_file);
 
     for (i = 0; module_dirs->pdata[i]; i++)
         g_free(module_dirs->pdata[i]);
     g_ptr_array_free(module_dirs, TRUE);
+
+    return registry_file;
 }
 
 /* Be defensive.  On the other hand we do not perform global file validation,
@@ -427,10 +435,16 @@ write_thumbnail(const FileInfo *fileinfo,
     gdouble xreal, yreal;
     gchar *str_mtime, *str_fsize, *str_width, *str_height, *str_real_size;
     gboolean ok;
-    gint id;
+    gint id, xres, yres;
 
-    if (!(container = gwy_file_load(fileinfo->inputfile,
-                                    GWY_RUN_NONINTERACTIVE, error)))
+    /* A specific channel may not be among the data a preview provides.
+     * Otherwise avoid loading everything, files can be huge. */
+    if (channel > -1)
+        container = gwy_file_load(fileinfo->inputfile,
+                                  GWY_RUN_NONINTERACTIVE, error);
+    else
+        container = gwy_file_load_preview(fileinfo->inputfile, error);
+    if (!container)
         return FALSE;
 
     data_found.container = container;
@@ -468,8 +482,13 @@ write_thumbnail(const FileInfo *fileinfo,
     gwy_si_unit_value_format_free(vf);
     str_mtime = g_strdup_printf("%lu", (gulong)fileinfo->mtime);
     str_fsize = g_strdup_printf("%lu", (gulong)fileinfo->fsize);
-    str_width = g_strdup_printf("%d", gwy_data_field_get_xres(dfield));
-    str_height = g_strdup_printf("%d", gwy_data_field_get_yres(dfield));
+    /* Report the size of the original data, not a reduced preview. */
+    xres = gwy_data_field_get_xres(dfield);
+    yres = gwy_data_field_get_yres(dfield);
+    gwy_container_gis_int32_by_name(container, "/preview/xres", &xres);
+    gwy_container_gis_int32_by_name(container, "/preview/yres", &yres);
+    str_width = g_strdup_printf("%d", xres);
+    str_height = g_strdup_printf("%d", yres);
     g_object_unref(container);
 
     if (fileinfo->outputfile) {
@@ -637,7 +656,7 @@ main(int argc,
     };
     FileInfo fileinfo = { NULL, NULL, NULL, 0, 0 };
     gint maxsize;
-    gchar *canonpath;
+    gchar *canonpath, *registry_file;
     GError *err = NULL;
     gint channel = -1;
 
@@ -697,12 +716,16 @@ main(int argc,
     gwy_widgets_type_init();
     gwy_app_settings_load(gwy_app_settings_get_settings_filename(), NULL);
     gwy_resource_class_load(g_type_class_peek(GWY_TYPE_GRADIENT));
-    load_modules();
+    registry_file = load_modules();
 
     /* Go... */
     if (!write_thumbnail(&fileinfo, maxsize, &err, channel))
         die_gerror(err, "write_thumbnail");
 
+    /* Remember the file type detection result. */
+    gwy_module_save_registry_cache(registry_file);
+    g_free(registry_file);
+
     return 0;
 }
 